@@ -1,5 +1,8 @@
 package com.bleist.connectias.connectias
 
+import java.nio.ByteBuffer
+import java.util.WeakHashMap
+
 /**
  * Interface for bulk USB transfers. Implemented by UsbPlugin to perform
  * actual bulkTransferOut/bulkTransferIn. Passed to Rust via JNI.
@@ -7,4 +10,124 @@ package com.bleist.connectias.connectias
 interface BulkTransferHandler {
     fun bulkOut(data: ByteArray): Int
     fun bulkIn(maxLength: Int): ByteArray
+
+    /**
+     * Largest single bulkTransfer Rust may request. Since API 28 bulkTransfer
+     * is no longer capped at 16 KB; the kernel still splits URBs, so this only
+     * bounds the buffer size per call.
+     */
+    fun maxTransferSize(): Int = MAX_BULK_TRANSFER
+
+    /** True when the session uses UAS; Rust then calls [pipeOut]/[pipeIn]. */
+    fun isUas(): Boolean = false
+
+    /** Transfer on a UAS pipe (1 command, 2 status, 3 data-in, 4 data-out). */
+    fun pipeOut(pipe: Int, data: ByteArray): Int = bulkOut(data)
+    fun pipeIn(pipe: Int, maxLength: Int): ByteArray = bulkIn(maxLength)
+
+    /**
+     * Zero-copy variants used by Rust: [buffer] is a direct ByteBuffer over native
+     * memory; transfer [length] bytes from/into it and return the count. The
+     * defaults fall back to the array methods.
+     */
+    fun bulkOutDirect(buffer: ByteBuffer, length: Int): Int {
+        val data = ByteArray(length)
+        buffer.duplicate().apply { position(0) }.get(data)
+        return bulkOut(data)
+    }
+
+    fun bulkInDirect(buffer: ByteBuffer, length: Int): Int {
+        val data = bulkIn(length)
+        buffer.duplicate().apply { position(0) }.put(data)
+        return data.size
+    }
+
+    fun pipeOutDirect(pipe: Int, buffer: ByteBuffer, length: Int): Int {
+        val data = ByteArray(length)
+        buffer.duplicate().apply { position(0) }.get(data)
+        return pipeOut(pipe, data)
+    }
+
+    fun pipeInDirect(pipe: Int, buffer: ByteBuffer, length: Int): Int {
+        val data = pipeIn(pipe, length)
+        buffer.duplicate().apply { position(0) }.put(data)
+        return data.size
+    }
+
+    /**
+     * Whole Bulk-Only command in one call from Rust. [control] holds the CBW at
+     * [BOT_CBW] and a REQUEST SENSE CBW at [BOT_SENSE_CBW]; the CSW goes to
+     * [BOT_CSW] and, on Check Condition, the sense data and its CSW to
+     * [BOT_SENSE] and [BOT_SENSE_CSW]. [data] is the data phase buffer (null
+     * when [length] is 0). Returns the bytes moved in the data phase.
+     */
+    fun executeCommand(control: ByteBuffer, data: ByteBuffer?, length: Int, directionIn: Boolean): Int =
+        runBotCommand(BotBuffers.of(this, control), data, length, directionIn)
+
+    /** BOT phase sequence over the *Direct methods. */
+    fun runBotCommand(bot: BotBuffers, data: ByteBuffer?, length: Int, directionIn: Boolean): Int {
+        val sent = bulkOutDirect(bot.cbw, CBW_SIZE)
+        if (sent != CBW_SIZE) throw IllegalStateException("CBW transfer failed: $sent != $CBW_SIZE")
+        val transferred = when {
+            data == null || length == 0 -> 0
+            directionIn -> bulkInDirect(data, length)
+            else -> bulkOutDirect(data, length)
+        }
+        val csw = bulkInDirect(bot.csw, CSW_SIZE)
+        if (csw != CSW_SIZE) throw IllegalStateException("CSW read failed: $csw")
+        if (bot.csw.get(CSW_STATUS).toInt() == 1) {
+            // Auto sense; failures leave the sense area zeroed, as on the Rust side.
+            runCatching {
+                bulkOutDirect(bot.senseCbw, CBW_SIZE)
+                bulkInDirect(bot.sense, SENSE_SIZE)
+                bulkInDirect(bot.senseCsw, CSW_SIZE)
+            }
+        }
+        return transferred
+    }
+
+    companion object {
+        const val MAX_BULK_TRANSFER = 256 * 1024
+
+        const val CBW_SIZE = 31
+        const val CSW_SIZE = 13
+        const val SENSE_SIZE = 18
+        const val CSW_STATUS = 12
+
+        /** executeCommand offsets in the control buffer; must match jni_bridge.rs. */
+        const val BOT_CBW = 64
+        const val BOT_CSW = 96
+        const val BOT_SENSE_CBW = 112
+        const val BOT_SENSE = 144
+        const val BOT_SENSE_CSW = 176
+    }
+}
+
+/**
+ * Views of the executeCommand areas of a control buffer. Built once per
+ * handler (see [of]) so a command allocates nothing.
+ */
+class BotBuffers(val control: ByteBuffer) {
+    val cbw: ByteBuffer = slice(BulkTransferHandler.BOT_CBW, BulkTransferHandler.CBW_SIZE)
+    val csw: ByteBuffer = slice(BulkTransferHandler.BOT_CSW, BulkTransferHandler.CSW_SIZE)
+    val senseCbw: ByteBuffer = slice(BulkTransferHandler.BOT_SENSE_CBW, BulkTransferHandler.CBW_SIZE)
+    val sense: ByteBuffer = slice(BulkTransferHandler.BOT_SENSE, BulkTransferHandler.SENSE_SIZE)
+    val senseCsw: ByteBuffer = slice(BulkTransferHandler.BOT_SENSE_CSW, BulkTransferHandler.CSW_SIZE)
+
+    private fun slice(offset: Int, size: Int): ByteBuffer =
+        control.duplicate().apply {
+            position(offset)
+            limit(offset + size)
+        }.slice()
+
+    companion object {
+        /** Per handler; entries go with their handler when its session closes. */
+        private val cache = WeakHashMap<BulkTransferHandler, BotBuffers>()
+
+        /** Views of [handler]'s control buffer. Rust keeps one per handler, so they are built once. */
+        fun of(handler: BulkTransferHandler, control: ByteBuffer): BotBuffers = synchronized(cache) {
+            cache[handler]?.takeIf { it.control === control }
+                ?: BotBuffers(control).also { cache[handler] = it }
+        }
+    }
 }
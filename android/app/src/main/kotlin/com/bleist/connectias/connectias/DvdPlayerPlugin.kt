@@ -9,24 +9,24 @@ import io.flutter.plugin.common.MethodChannel
 import org.videolan.libvlc.LibVLC
 import org.videolan.libvlc.Media
 import org.videolan.libvlc.MediaPlayer
-import java.util.concurrent.atomic.AtomicBoolean
-import kotlin.concurrent.thread
 
 /**
  * DVD Player plugin using LibVLC with custom I/O via pipe.
- * Streams data from Rust/NativeBridge.dvdReadStream into a pipe; LibVLC reads from the pipe FD.
+ * A Rust pump thread (NativeBridge.dvdStartPump) writes the title into a pipe; LibVLC reads from the pipe FD.
+ * Audio CD tracks play the same way, as WAV from NativeBridge.cdStartPump.
  * MethodChannel: com.bleist.connectias/dvd
  */
 class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCallHandler {
 
     private var dvdHandle: Long = -1
+    private var cdHandle: Long = -1
     private var streamId: Long = -1
+    /** The open stream is a CD track (cd* calls) rather than a DVD title. */
+    private var cdStream = false
     private var libVlc: LibVLC? = null
     private var mediaPlayer: MediaPlayer? = null
     private var surfaceView: SurfaceView? = null
-    private var readerThread: Thread? = null
-    private val readerRunning = AtomicBoolean(false)
-    private var writeFd: ParcelFileDescriptor? = null
+    private var pumpId: Long = -1
 
     override fun onMethodCall(call: io.flutter.plugin.common.MethodCall, result: MethodChannel.Result) {
         when (call.method) {
@@ -40,11 +40,13 @@ class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCall
                     result.error("DVD_ERROR", "No DVD loaded", null)
                     return
                 }
+                stopPlayback()
                 streamId = NativeBridge.dvdOpenTitleStream(dvdHandle, titleId.toInt())
                 if (streamId < 0) {
                     result.error("DVD_ERROR", NativeBridge.lastError() ?: "Open stream failed", null)
                     return
                 }
+                cdStream = false
                 try {
                     startPlayback()
                     result.success(null)
@@ -53,6 +55,31 @@ class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCall
                     result.error("DVD_ERROR", e.message ?: "Playback failed", null)
                 }
             }
+            "loadCd" -> {
+                cdHandle = (call.arguments as? Number)?.toLong() ?: -1L
+                result.success(null)
+            }
+            "playCdTrack" -> {
+                val track = (call.arguments as? Map<*, *>)?.get("track") as? Number ?: 1
+                if (cdHandle < 0) {
+                    result.error("CD_ERROR", "No CD loaded", null)
+                    return
+                }
+                stopPlayback()
+                streamId = NativeBridge.cdOpenTrackStream(cdHandle, track.toInt())
+                if (streamId < 0) {
+                    result.error("CD_ERROR", NativeBridge.lastError() ?: "Open stream failed", null)
+                    return
+                }
+                cdStream = true
+                try {
+                    startPlayback()
+                    result.success(null)
+                } catch (e: Exception) {
+                    stopPlayback()
+                    result.error("CD_ERROR", e.message ?: "Playback failed", null)
+                }
+            }
             "pause" -> {
                 mediaPlayer?.pause()
                 result.success(null)
@@ -63,13 +90,28 @@ class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCall
             }
             "seek" -> {
                 val positionMs = (call.arguments as? Map<*, *>)?.get("positionMs") as? Number ?: 0
-                val offset = positionMs.toLong() * 1000L
-                if (streamId >= 0) {
-                    NativeBridge.dvdSeekStream(streamId, offset)
+                if (pumpId >= 0) {
+                    if (cdStream) {
+                        NativeBridge.cdPumpSeekTime(pumpId, positionMs.toLong())
+                    } else {
+                        NativeBridge.dvdPumpSeekTime(pumpId, positionMs.toLong())
+                    }
                 }
                 mediaPlayer?.time = positionMs.toLong()
                 result.success(null)
             }
+            "seekChapter" -> {
+                val chapter = (call.arguments as? Map<*, *>)?.get("chapter") as? Number ?: 1
+                if (pumpId < 0 || cdStream) {
+                    result.error("DVD_ERROR", "No stream open", null)
+                    return
+                }
+                if (!NativeBridge.dvdPumpSeekChapter(pumpId, chapter.toInt())) {
+                    result.error("DVD_ERROR", NativeBridge.lastError() ?: "Chapter seek failed", null)
+                    return
+                }
+                result.success(null)
+            }
             "stop" -> {
                 stopPlayback()
                 result.success(null)
@@ -79,30 +121,20 @@ class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCall
     }
 
     private fun startPlayback() {
-        stopPlayback()
+        stopPump()
 
         val pipe = ParcelFileDescriptor.createPipe()
         val readFd = pipe!![0]
-        writeFd = pipe[1]
-
-        readerRunning.set(true)
-        readerThread = thread(name = "dvd-stream-reader") {
-            val buf = ByteArray(256 * 1024)
-            try {
-                writeFd?.fileDescriptor?.let { fd ->
-                    java.io.FileOutputStream(fd).use { out ->
-                        while (readerRunning.get() && streamId >= 0) {
-                            val n = NativeBridge.dvdReadStream(streamId, buf)
-                            if (n <= 0) break
-                            out.write(buf, 0, n)
-                            out.flush()
-                        }
-                    }
-                }
-            } finally {
-                try { writeFd?.close() } catch (_: Exception) {}
-                writeFd = null
-            }
+        // Rust owns the write end from here and closes it when the pump ends.
+        val writeFd = pipe[1].detachFd()
+        pumpId = if (cdStream) {
+            NativeBridge.cdStartPump(streamId, writeFd)
+        } else {
+            NativeBridge.dvdStartPump(streamId, writeFd)
+        }
+        if (pumpId < 0) {
+            readFd.close()
+            throw IllegalStateException(NativeBridge.lastError() ?: "Stream pump failed")
         }
 
         activity.runOnUiThread {
@@ -138,10 +170,20 @@ class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCall
     }
 
     private fun stopPlayback() {
-        readerRunning.set(false)
-        readerThread?.join(2000)
-        readerThread = null
+        stopPump()
 
+        if (streamId >= 0) {
+            if (cdStream) {
+                NativeBridge.cdCloseStream(streamId)
+            } else {
+                NativeBridge.dvdCloseStream(streamId)
+            }
+            streamId = -1
+        }
+    }
+
+    /** Releases the player and stops the pump; the stream stays open. */
+    private fun stopPump() {
         activity.runOnUiThread {
             mediaPlayer?.stop()
             mediaPlayer?.release()
@@ -155,12 +197,15 @@ class DvdPlayerPlugin(private val activity: Activity) : MethodChannel.MethodCall
             libVlc = null
         }
 
-        try { writeFd?.close() } catch (_: Exception) {}
-        writeFd = null
-
-        if (streamId >= 0) {
-            NativeBridge.dvdCloseStream(streamId)
-            streamId = -1
+        // Releasing the player closes the read end, so a pump blocked on a full
+        // pipe fails with EPIPE; it also polls for stop.
+        if (pumpId >= 0) {
+            if (cdStream) {
+                NativeBridge.cdStopPump(pumpId)
+            } else {
+                NativeBridge.dvdStopPump(pumpId)
+            }
+            pumpId = -1
         }
     }
 }
@@ -3,19 +3,43 @@ package com.bleist.connectias.connectias
 import android.app.Activity
 import android.content.Intent
 import android.net.Uri
+import android.os.Handler
+import android.os.Looper
 import androidx.core.content.FileProvider
 import io.flutter.plugin.common.MethodChannel
 import java.io.File
 
 /**
  * Plugin for SAF export of logs and for opening/saving USB files (open in other app, save to device).
+ * Also streams native I/O counters to the logging screen ("ioStats" calls on [logChannel]).
  */
-class LoggingPlugin(private val activity: Activity) : MethodChannel.MethodCallHandler {
+class LoggingPlugin(
+    private val activity: Activity,
+    private val logChannel: MethodChannel? = null,
+    private val ioStatsSource: ((callback: (Map<String, String>) -> Unit) -> Unit)? = null,
+) : MethodChannel.MethodCallHandler {
+
+    private val mainHandler = Handler(Looper.getMainLooper())
+    private var ioStatsIntervalMs = 0L
+    /** Bumped on start/stop so a collection still in flight doesn't reschedule an old loop. */
+    private var ioStatsGeneration = 0
+
+    /** Sends one "ioStats" call per open device or DVD, then reschedules itself. */
+    private fun ioStatsTick(generation: Int) {
+        val source = ioStatsSource ?: return
+        if (generation != ioStatsGeneration) return
+        source { stats ->
+            if (generation != ioStatsGeneration) return@source
+            for ((key, json) in stats) {
+                logChannel?.invokeMethod("ioStats", mapOf("source" to key, "json" to json))
+            }
+            mainHandler.postDelayed({ ioStatsTick(generation) }, ioStatsIntervalMs)
+        }
+    }
 
     var pendingExportContent: String? = null
     var pendingExportResult: MethodChannel.Result? = null
-    var pendingSaveFilePath: String? = null
-    var pendingSaveFileResult: MethodChannel.Result? = null
+    var pendingSaveLocationResult: MethodChannel.Result? = null
 
     override fun onMethodCall(call: io.flutter.plugin.common.MethodCall, result: MethodChannel.Result) {
         when (call.method) {
@@ -55,21 +79,25 @@ class LoggingPlugin(private val activity: Activity) : MethodChannel.MethodCallHa
                     result.success(false)
                 }
             }
-            "saveFileToDevice" -> {
-                val tempPath = call.argument<String>("tempPath") ?: ""
+            "pickSaveLocation" -> {
                 val suggestedName = call.argument<String>("suggestedName") ?: "file"
-                if (tempPath.isEmpty()) {
-                    result.success(false)
-                    return
-                }
-                pendingSaveFilePath = tempPath
-                pendingSaveFileResult = result
+                pendingSaveLocationResult = result
                 val intent = Intent(Intent.ACTION_CREATE_DOCUMENT).apply {
                     addCategory(Intent.CATEGORY_OPENABLE)
                     type = "*/*"
                     putExtra(Intent.EXTRA_TITLE, suggestedName)
                 }
-                activity.startActivityForResult(intent, REQUEST_SAVE_FILE)
+                activity.startActivityForResult(intent, REQUEST_SAVE_LOCATION)
+            }
+            "startIoStats" -> {
+                val intervalMs = call.argument<Number>("intervalMs")?.toLong() ?: 1000L
+                ioStatsIntervalMs = intervalMs.coerceAtLeast(MIN_IO_STATS_INTERVAL_MS)
+                ioStatsTick(++ioStatsGeneration)
+                result.success(ioStatsSource != null)
+            }
+            "stopIoStats" -> {
+                ioStatsGeneration++
+                result.success(null)
             }
             else -> result.notImplemented()
         }
@@ -95,33 +123,19 @@ class LoggingPlugin(private val activity: Activity) : MethodChannel.MethodCallHa
                     result?.success(false)
                 }
             }
-            REQUEST_SAVE_FILE -> {
-                val result = pendingSaveFileResult
-                pendingSaveFileResult = null
-                val path = pendingSaveFilePath
-                pendingSaveFilePath = null
-                if (resultCode == Activity.RESULT_OK && data?.data != null && path != null) {
-                    try {
-                        val file = File(path)
-                        if (file.exists()) {
-                            activity.contentResolver.openOutputStream(data.data!!)!!.use { os ->
-                                file.inputStream().use { it.copyTo(os) }
-                            }
-                            file.delete()
-                        }
-                        result?.success(true)
-                    } catch (e: Exception) {
-                        result?.success(false)
-                    }
-                } else {
-                    result?.success(false)
-                }
+            REQUEST_SAVE_LOCATION -> {
+                val result = pendingSaveLocationResult
+                pendingSaveLocationResult = null
+                // The caller streams the file into this URI, so nothing is staged here.
+                val uri = if (resultCode == Activity.RESULT_OK) data?.data?.toString() else null
+                result?.success(uri)
             }
         }
     }
 
     companion object {
         const val REQUEST_CREATE_FILE = 9001
-        const val REQUEST_SAVE_FILE = 9002
+        const val REQUEST_SAVE_LOCATION = 9002
+        const val MIN_IO_STATS_INTERVAL_MS = 250L
     }
 }
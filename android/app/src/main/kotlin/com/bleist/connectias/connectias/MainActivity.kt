@@ -20,7 +20,7 @@ class MainActivity : FlutterActivity() {
             "com.bleist.connectias/log",
         )
         usbPlugin = UsbPlugin(this, logChannel)
-        loggingPlugin = LoggingPlugin(this)
+        loggingPlugin = LoggingPlugin(this, logChannel, usbPlugin::collectIoStats)
         dvdPlayerPlugin = DvdPlayerPlugin(this)
         logChannel.setMethodCallHandler(loggingPlugin)
 
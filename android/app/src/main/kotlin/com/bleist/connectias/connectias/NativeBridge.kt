@@ -1,5 +1,7 @@
 package com.bleist.connectias.connectias
 
+import java.nio.ByteBuffer
+
 /**
  * JNI bridge to Rust library for SCSI/NTFS operations.
  * Rust calls back to Kotlin via BulkTransferHandler for USB bulk transfers.
@@ -10,12 +12,29 @@ object NativeBridge {
     }
 
     /**
-     * Opens an NTFS volume on the given session.
+     * Opens the block device of a session and scans its partition table once.
+     * All volumes of the device share this handle's command queue and cache.
      * @param sessionId USB session ID from openDevice
      * @param handler BulkTransferHandler that performs bulk_out/bulk_in
+     * @return device handle (>0) on success, negative error code on failure
+     */
+    external fun openBlockDevice(sessionId: Long, handler: BulkTransferHandler): Long
+
+    /**
+     * Partitions of an open device.
+     * @return JSON like [{"i":0,"start":2048,"size":1000,"t":7,"ntfs":true},...] or null on error
+     */
+    external fun listPartitions(deviceHandle: Long): String?
+
+    /** Releases a device handle; volumes already open on it keep working. */
+    external fun closeBlockDevice(deviceHandle: Long): Int
+
+    /**
+     * Opens an NTFS volume on a partition of an open device.
+     * @param partition index from listPartitions, or -1 for the first NTFS partition
      * @return volume ID (>0) on success, negative error code on failure
      */
-    external fun openVolume(sessionId: Long, handler: BulkTransferHandler): Long
+    external fun openVolume(deviceHandle: Long, partition: Int): Long
 
     /**
      * Closes the volume and releases resources.
@@ -30,6 +49,22 @@ object NativeBridge {
      */
     external fun listDirectory(volumeId: Long, path: String): String?
 
+    /**
+     * Opens a paged listing of a directory for [readDirPage].
+     * @return cursor ID (positive) or negative error code
+     */
+    external fun openDirCursor(volumeId: Long, path: String): Long
+
+    /**
+     * Next page of up to [maxEntries] entries, in the listDirectory JSON format.
+     * A page shorter than [maxEntries] is the last one.
+     * @return JSON array or null on error
+     */
+    external fun readDirPage(volumeId: Long, cursorId: Long, maxEntries: Int): String?
+
+    /** Releases a directory cursor. Cursors are also released when the volume closes. */
+    external fun closeDirCursor(volumeId: Long, cursorId: Long): Int
+
     /**
      * Reads file content.
      * @param path File path
@@ -39,19 +74,199 @@ object NativeBridge {
      */
     external fun readFile(volumeId: Long, path: String, offset: Long, length: Int): ByteArray?
 
+    /**
+     * Opens a file for chunked reads; its data runs are decoded once.
+     * @return File handle (positive), or negative error code
+     */
+    external fun openFile(volumeId: Long, path: String): Long
+
+    /**
+     * Reads from a file opened with [openFile].
+     * @return Byte array (shorter than [length] at end of file) or null on error
+     */
+    external fun readFileHandle(volumeId: Long, fileHandle: Long, offset: Long, length: Int): ByteArray?
+
+    /**
+     * Releases a file handle. Handles are also released when the volume closes.
+     */
+    external fun closeFile(volumeId: Long, fileHandle: Long): Int
+
+    /**
+     * Starts indexing the volume's MFT in the background for [searchVolume].
+     * An index saved in [dir] for this volume is reused unless [rebuild].
+     * @return 0 or negative error code
+     */
+    external fun startMftIndex(volumeId: Long, dir: String, rebuild: Boolean): Int
+
+    /**
+     * Writes [records scanned, records total] into [progress] (length 2).
+     * @return index state: 0 none, 1 scanning, 2 ready, 3 failed (see lastError); negative on error
+     */
+    external fun mftIndexStatus(volumeId: Long, progress: LongArray): Int
+
+    /**
+     * Searches file names on the whole volume (case-insensitive).
+     * @return JSON like [{"p":"dir/name","d":false,"s":0},...] or null if the index isn't ready
+     */
+    external fun searchVolume(volumeId: Long, query: String, prefix: Boolean, limit: Int): String?
+
+    /**
+     * Starts copying a volume file into [fd] on a native worker thread. Rust takes
+     * ownership of the descriptor (pass ParcelFileDescriptor.detachFd()) and closes it.
+     * @return job ID (positive) or negative error code
+     */
+    external fun copyFileToFd(volumeId: Long, path: String, fd: Int): Long
+
+    /**
+     * Writes [copied, total] into [progress] (length 2).
+     * @return job state: 0 running, 1 done, 2 failed (see lastError), 3 cancelled; negative if unknown
+     */
+    external fun copyJobStatus(jobId: Long, progress: LongArray): Int
+
+    /** Asks a copy job to stop; poll copyJobStatus until it leaves the running state. */
+    external fun cancelCopyJob(jobId: Long): Int
+
+    /** Forgets a finished job (a running one is cancelled first). */
+    external fun releaseCopyJob(jobId: Long): Int
+
+    /**
+     * I/O counters of an open device since it was opened: SCSI commands by opcode,
+     * bytes in/out, failures, last sense, UAS retries, a latency histogram
+     * ("latency"[i] counts commands under latencyUs << i) and block cache counters.
+     * @return JSON object, or null if the handle is unknown
+     */
+    external fun getIoStats(deviceHandle: Long): String?
+
+    /**
+     * Sets how reads on an open device handle errors: up to [retries] retries with
+     * backoff, bisection of a failed range down to the bad sectors ([splitReads]),
+     * and zero-filling of sectors that stay unreadable ([skipBadSectors]) instead
+     * of failing the read. All off (the default) fails on the first error.
+     * @return 0 or negative error code
+     */
+    external fun setRecoveryPolicy(deviceHandle: Long, retries: Int, splitReads: Boolean, skipBadSectors: Boolean): Int
+
+    /** Sectors zero-filled so far, as JSON [[lba, count], ...]. */
+    external fun getBadSectors(deviceHandle: Long): String?
+
     /**
      * Returns last error message from Rust.
      */
     external fun lastError(): String?
 
+    // Audio CD operations
+    /**
+     * Opens the audio CD in an optical drive: reads the TOC and sets the drive to
+     * full speed.
+     * @return CD handle, or -1 on error (also when the disc has no audio tracks)
+     */
+    external fun openCd(sessionId: Long, handler: BulkTransferHandler): Long
+    external fun closeCd(cdHandle: Long)
+
+    /** TOC as JSON: {"leadOut", "tracks": [{number, start, sectors, durationMs, audio}]}. */
+    external fun cdGetToc(cdHandle: Long): String?
+
+    /** Like [getIoStats], plus "cdda" jitter correction counters (reads, corrections, unmatched, retries). */
+    external fun cdGetIoStats(cdHandle: Long): String?
+
+    /**
+     * Opens an audio track as a WAV stream for [cdStartPump]; read-ahead starts right away.
+     * @return stream ID, or -1 on error
+     */
+    external fun cdOpenTrackStream(cdHandle: Long, track: Int): Long
+    external fun cdCloseStream(streamId: Long)
+
+    /** [dvdStartPump] for a CD track stream. */
+    external fun cdStartPump(streamId: Long, fd: Int): Long
+    external fun cdPumpSeekTime(pumpId: Long, timeMs: Long): Boolean
+
+    /** Stops a pump and waits for it. Call before cdCloseStream. */
+    external fun cdStopPump(pumpId: Long): Boolean
+
+    /**
+     * Starts ripping an audio track as WAV into [fd]; Rust takes over the descriptor.
+     * Progress, cancel and release go through the copy job calls.
+     * @return job ID, or -1 on error
+     */
+    external fun cdRipTrack(cdHandle: Long, track: Int, fd: Int): Long
+
     // DVD operations (requires libdvdread)
     external fun getDeviceType(sessionId: Long, handler: BulkTransferHandler): String?
+    /**
+     * Sets where recovered CSS title keys are kept (one directory per disc
+     * inside [dir]; empty string for no cache), so reopening a known disc
+     * skips key cracking. Call once, before the first [openDvd]; later calls
+     * return -1 and change nothing.
+     */
+    external fun setCssCacheDir(dir: String): Int
+
+    /** Opens a DVD; see [setCssCacheDir] for its title-key cache. */
     external fun openDvd(sessionId: Long, handler: BulkTransferHandler): Long
     external fun closeDvd(dvdHandle: Long)
-    external fun dvdListTitles(dvdHandle: Long): String?
-    external fun dvdListChapters(dvdHandle: Long, titleId: Int): String?
+
+    /**
+     * Size in bytes of the packed title/chapter metadata (see dvd_helper.c for the layout).
+     * @return size, or -1 on error
+     */
+    external fun dvdMetadataSize(dvdHandle: Long): Int
+
+    /**
+     * Writes the packed metadata into a direct buffer of at least dvdMetadataSize bytes.
+     * @return bytes written, or -1 on error
+     */
+    external fun dvdReadMetadata(dvdHandle: Long, buffer: ByteBuffer): Int
+
     external fun dvdOpenTitleStream(dvdHandle: Long, titleId: Int): Long
     external fun dvdReadStream(streamId: Long, buffer: ByteArray): Int
     external fun dvdSeekStream(streamId: Long, offset: Long): Boolean
+
+    /** Jumps to the first sector of a 1-based chapter of the stream's title. */
+    external fun dvdSeekChapter(streamId: Long, chapter: Int): Boolean
+
+    /** Jumps to the start of the VOBU playing at [timeMs], found from the time map and NAV packs. */
+    external fun dvdSeekTime(streamId: Long, timeMs: Long): Boolean
     external fun dvdCloseStream(streamId: Long)
+
+    /**
+     * Starts a native thread that writes the stream into [fd], the write end of a
+     * pipe. Rust takes ownership of the descriptor (pass ParcelFileDescriptor.detachFd())
+     * and closes it at end of title or on stop.
+     * @return pump ID, or -1 on error
+     */
+    external fun dvdStartPump(streamId: Long, fd: Int): Long
+
+    /** Seeks a pumped stream; unwritten data from before the seek is dropped. */
+    external fun dvdPumpSeekTime(pumpId: Long, timeMs: Long): Boolean
+    external fun dvdPumpSeekChapter(pumpId: Long, chapter: Int): Boolean
+
+    /** Stops a pump and waits for it. Call before dvdCloseStream. */
+    external fun dvdStopPump(pumpId: Long): Boolean
+
+    /**
+     * Starts extracting chapters [firstChapter]..[lastChapter] (1-based, 0 = last) of a
+     * title, decrypted, into [fd]; Rust takes over the descriptor. With [resumeBytes] > 0
+     * the file's first resumeBytes (block-aligned) are kept and the copy continues after
+     * them. Progress, cancel and release go through the copy job calls.
+     * @return job ID, or -1 on error
+     */
+    external fun dvdExtractTitle(
+        dvdHandle: Long,
+        titleId: Int,
+        firstChapter: Int,
+        lastChapter: Int,
+        resumeBytes: Long,
+        fd: Int,
+    ): Long
+
+    /**
+     * Like [getIoStats] for an open DVD, plus "readahead" counters (chunks, stalls
+     * and stall time of read_stream on an empty prefetch ring, seeks, warm hits).
+     */
+    external fun dvdGetIoStats(dvdHandle: Long): String?
+
+    /** [setRecoveryPolicy] for the device of an open DVD. */
+    external fun dvdSetRecoveryPolicy(dvdHandle: Long, retries: Int, splitReads: Boolean, skipBadSectors: Boolean): Int
+
+    /** [getBadSectors] for an open DVD (2048-byte sectors). */
+    external fun dvdGetBadSectors(dvdHandle: Long): String?
 }
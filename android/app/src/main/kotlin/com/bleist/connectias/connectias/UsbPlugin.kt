@@ -8,11 +8,24 @@ import android.content.IntentFilter
 import android.hardware.usb.UsbConstants
 import android.hardware.usb.UsbDevice
 import android.hardware.usb.UsbManager
+import android.net.Uri
+import android.os.Handler
+import android.os.Looper
+import android.os.ParcelFileDescriptor
 import io.flutter.plugin.common.EventChannel
 import io.flutter.plugin.common.MethodChannel
+import java.io.File
+import java.nio.ByteBuffer
 import java.util.HashMap
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.Executors
 import java.util.concurrent.atomic.AtomicLong
 
+private const val UAS_PROTOCOL = 0x62
+private const val USB_DT_INTERFACE = 0x04
+private const val USB_DT_ENDPOINT = 0x05
+private const val USB_DT_PIPE_USAGE = 0x24
+
 /**
  * USB plugin providing device enumeration, permission, open/close, bulk transfers,
  * and attach/detach events.
@@ -37,10 +50,62 @@ class UsbPlugin(
     private var broadcastReceiver: BroadcastReceiver? = null
     private var permissionReceiver: BroadcastReceiver? = null
 
-    private val sessions = HashMap<Long, UsbSession>()
+    // Read by transfer handlers on I/O threads.
+    private val sessions = ConcurrentHashMap<Long, UsbSession>()
     private val sessionIdGenerator = AtomicLong(1)
-    private val volumeToSession = HashMap<Long, Long>()
+    private val sharedDevices = HashMap<String, SharedDevice>()
+    private val volumeToDevice = HashMap<Long, String>()
     private val dvdToSession = HashMap<Long, Long>()
+    private val cdToSession = HashMap<Long, Long>()
+
+    init {
+        // Process-wide and read by libdvdcss on every open: set once, before any disc.
+        NativeBridge.setCssCacheDir(File(context.filesDir, "dvdcss").absolutePath)
+    }
+
+    /** Native calls on open handles run here, so a slow device doesn't stall the others or the UI. */
+    private val ioExecutor = Executors.newCachedThreadPool()
+    private val mainHandler = Handler(Looper.getMainLooper())
+
+    /** USB session and native block device shared by the volumes open on one device. */
+    private class SharedDevice(val sessionId: Long, val deviceHandle: Long) {
+        val volumes = HashSet<Long>()
+    }
+
+    /** Native handle named by a call's "volumeId" (its shared device) or "dvdHandle". */
+    private sealed class NativeTarget(val handle: Long) {
+        class Device(handle: Long) : NativeTarget(handle)
+        class Dvd(handle: Long) : NativeTarget(handle)
+    }
+
+    private fun nativeTarget(call: io.flutter.plugin.common.MethodCall): NativeTarget? {
+        call.argument<Number>("volumeId")?.toLong()?.let { volumeId ->
+            val shared = volumeToDevice[volumeId]?.let { sharedDevices[it] } ?: return null
+            return NativeTarget.Device(shared.deviceHandle)
+        }
+        return call.argument<Number>("dvdHandle")?.toLong()?.let { NativeTarget.Dvd(it) }
+    }
+
+    /** Error reported through [runIo] with its channel error code. */
+    private class PluginError(val code: String, message: String?) : Exception(message)
+
+    /**
+     * Runs [block] on [ioExecutor] and replies on the main thread. Exceptions
+     * become errors with [errorCode], or the code of a [PluginError].
+     */
+    private fun runIo(result: MethodChannel.Result, errorCode: String, block: () -> Any?) {
+        ioExecutor.execute {
+            val reply: () -> Unit = try {
+                val value = block()
+                { result.success(value) }
+            } catch (e: PluginError) {
+                { result.error(e.code, e.message, null) }
+            } catch (e: Exception) {
+                { result.error(errorCode, e.message, null) }
+            }
+            mainHandler.post(reply)
+        }
+    }
 
     private val usbReceiver = object : BroadcastReceiver() {
         override fun onReceive(context: Context?, intent: Intent?) {
@@ -51,6 +116,8 @@ class UsbPlugin(
                 }
                 UsbManager.ACTION_USB_DEVICE_DETACHED -> {
                     val device = intent.getParcelableExtra<UsbDevice>(UsbManager.EXTRA_DEVICE)
+                    // A device listed but never mounted would otherwise keep its session.
+                    device?.deviceName?.let { releaseIfUnused(it) }
                     sendEvent("detached", device?.deviceId?.toString())
                 }
             }
@@ -190,29 +257,43 @@ class UsbPlugin(
             }
             "openVolume" -> {
                 val deviceId = call.argument<String>("deviceId")
-                log("UsbPlugin", "openVolume: $deviceId")
+                val allowUas = call.argument<Boolean>("allowUas") ?: true
+                val partition = call.argument<Int>("partition") ?: -1
+                log("UsbPlugin", "openVolume: $deviceId partition=$partition")
                 if (deviceId == null) {
                     result.error("USB_ERROR", "deviceId required", null)
                     return
                 }
                 try {
-                    val sessionId = openDevice(deviceId)
-                    if (sessionId == null) {
-                        result.error("USB_ERROR", "Failed to open device", null)
-                        return
-                    }
-                    val handler = object : BulkTransferHandler {
-                        override fun bulkOut(data: ByteArray): Int = bulkTransferOut(sessionId, data)
-                        override fun bulkIn(maxLength: Int): ByteArray = bulkTransferIn(sessionId, maxLength)
-                    }
-                    val volumeId = NativeBridge.openVolume(sessionId, handler)
+                    val shared = sharedDevice(deviceId, allowUas)
+                    val volumeId = NativeBridge.openVolume(shared.deviceHandle, partition)
                     if (volumeId < 0) {
-                        closeDevice(sessionId)
+                        releaseIfUnused(deviceId)
                         result.error("VOLUME_ERROR", NativeBridge.lastError() ?: "Open failed", volumeId)
                         return
                     }
-                    volumeToSession[volumeId] = sessionId
+                    shared.volumes.add(volumeId)
+                    volumeToDevice[volumeId] = deviceId
                     result.success(volumeId)
+                } catch (e: PluginError) {
+                    result.error(e.code, e.message, null)
+                } catch (e: Exception) {
+                    result.error("USB_ERROR", e.message, null)
+                }
+            }
+            "listPartitions" -> {
+                val deviceId = call.argument<String>("deviceId")
+                val allowUas = call.argument<Boolean>("allowUas") ?: true
+                if (deviceId == null) {
+                    result.error("USB_ERROR", "deviceId required", null)
+                    return
+                }
+                try {
+                    // Stays open for the openVolume calls that usually follow.
+                    val shared = sharedDevice(deviceId, allowUas)
+                    result.success(NativeBridge.listPartitions(shared.deviceHandle) ?: "[]")
+                } catch (e: PluginError) {
+                    result.error(e.code, e.message, null)
                 } catch (e: Exception) {
                     result.error("USB_ERROR", e.message, null)
                 }
@@ -229,10 +310,7 @@ class UsbPlugin(
                         result.error("USB_ERROR", "Failed to open device", null)
                         return
                     }
-                    val handler = object : BulkTransferHandler {
-                        override fun bulkOut(data: ByteArray): Int = bulkTransferOut(sessionId, data)
-                        override fun bulkIn(maxLength: Int): ByteArray = bulkTransferIn(sessionId, maxLength)
-                    }
+                    val handler = transferHandler(sessionId)
                     val type = NativeBridge.getDeviceType(sessionId, handler)
                     closeDevice(sessionId)
                     result.success(type ?: "block")
@@ -242,20 +320,18 @@ class UsbPlugin(
             }
             "openDvd" -> {
                 val deviceId = call.argument<String>("deviceId")
+                val allowUas = call.argument<Boolean>("allowUas") ?: true
                 if (deviceId == null) {
                     result.error("USB_ERROR", "deviceId required", null)
                     return
                 }
                 try {
-                    val sessionId = openDevice(deviceId)
+                    val sessionId = openDevice(deviceId, allowUas)
                     if (sessionId == null) {
                         result.error("USB_ERROR", "Failed to open device", null)
                         return
                     }
-                    val handler = object : BulkTransferHandler {
-                        override fun bulkOut(data: ByteArray): Int = bulkTransferOut(sessionId, data)
-                        override fun bulkIn(maxLength: Int): ByteArray = bulkTransferIn(sessionId, maxLength)
-                    }
+                    val handler = transferHandler(sessionId)
                     val dvdHandle = NativeBridge.openDvd(sessionId, handler)
                     if (dvdHandle < 0) {
                         closeDevice(sessionId)
@@ -268,39 +344,167 @@ class UsbPlugin(
                     result.error("USB_ERROR", e.message, null)
                 }
             }
-            "closeDvd" -> {
-                val dvdHandle = call.argument<Number>("dvdHandle")?.toLong()
-                if (dvdHandle == null) {
-                    result.error("USB_ERROR", "dvdHandle required", null)
+            "openCd" -> {
+                val deviceId = call.argument<String>("deviceId")
+                val allowUas = call.argument<Boolean>("allowUas") ?: true
+                if (deviceId == null) {
+                    result.error("USB_ERROR", "deviceId required", null)
                     return
                 }
-                NativeBridge.closeDvd(dvdHandle)
-                dvdToSession.remove(dvdHandle)?.let { closeDevice(it) }
+                try {
+                    val sessionId = openDevice(deviceId, allowUas)
+                    if (sessionId == null) {
+                        result.error("USB_ERROR", "Failed to open device", null)
+                        return
+                    }
+                    val cdHandle = NativeBridge.openCd(sessionId, transferHandler(sessionId))
+                    if (cdHandle < 0) {
+                        closeDevice(sessionId)
+                        result.error("CD_ERROR", NativeBridge.lastError() ?: "Open failed", null)
+                        return
+                    }
+                    cdToSession[cdHandle] = sessionId
+                    result.success(cdHandle)
+                } catch (e: Exception) {
+                    result.error("USB_ERROR", e.message, null)
+                }
+            }
+            "closeCd" -> {
+                val cdHandle = call.argument<Number>("cdHandle")?.toLong()
+                if (cdHandle == null) {
+                    result.error("USB_ERROR", "cdHandle required", null)
+                    return
+                }
+                NativeBridge.closeCd(cdHandle)
+                cdToSession.remove(cdHandle)?.let { closeDevice(it) }
                 result.success(null)
             }
-            "dvdListTitles" -> {
+            "cdGetToc" -> {
+                val cdHandle = call.argument<Number>("cdHandle")?.toLong()
+                if (cdHandle == null) {
+                    result.error("USB_ERROR", "cdHandle required", null)
+                    return
+                }
+                val json = NativeBridge.cdGetToc(cdHandle)
+                if (json == null) {
+                    result.error("CD_ERROR", NativeBridge.lastError() ?: "Unknown handle", null)
+                } else {
+                    result.success(json)
+                }
+            }
+            "cdRipTrack" -> {
+                val cdHandle = call.argument<Number>("cdHandle")?.toLong()
+                val track = call.argument<Int>("track") ?: 1
+                val uri = call.argument<String>("uri")
+                val filePath = call.argument<String>("filePath")
+                if (cdHandle == null || (uri == null && filePath == null)) {
+                    result.error("USB_ERROR", "cdHandle and uri or filePath required", null)
+                    return
+                }
+                runIo(result, "CD_ERROR") {
+                    val pfd = if (uri != null) {
+                        context.contentResolver.openFileDescriptor(Uri.parse(uri), "wt")
+                    } else {
+                        ParcelFileDescriptor.open(
+                            File(filePath!!),
+                            ParcelFileDescriptor.MODE_WRITE_ONLY or
+                                ParcelFileDescriptor.MODE_CREATE or
+                                ParcelFileDescriptor.MODE_TRUNCATE,
+                        )
+                    } ?: throw PluginError("CD_ERROR", "Cannot open destination")
+                    // Rust owns the descriptor from here and closes it when the job ends.
+                    val jobId = NativeBridge.cdRipTrack(cdHandle, track, pfd.detachFd())
+                    if (jobId < 0) {
+                        throw PluginError("CD_ERROR", NativeBridge.lastError() ?: "Rip failed")
+                    }
+                    jobId
+                }
+            }
+            "getIoStats" -> {
+                call.argument<Number>("cdHandle")?.toLong()?.let { cdHandle ->
+                    runIo(result, "CD_ERROR") {
+                        NativeBridge.cdGetIoStats(cdHandle)
+                            ?: throw PluginError("CD_ERROR", NativeBridge.lastError() ?: "Unknown handle")
+                    }
+                    return
+                }
+                val target = nativeTarget(call) ?: run {
+                    result.error("USB_ERROR", "volumeId or dvdHandle required", null)
+                    return
+                }
+                runIo(result, "USB_ERROR") {
+                    val json = when (target) {
+                        is NativeTarget.Device -> NativeBridge.getIoStats(target.handle)
+                        is NativeTarget.Dvd -> NativeBridge.dvdGetIoStats(target.handle)
+                    }
+                    json ?: throw PluginError("USB_ERROR", NativeBridge.lastError() ?: "Unknown handle")
+                }
+            }
+            "setRecoveryPolicy" -> {
+                val target = nativeTarget(call) ?: run {
+                    result.error("USB_ERROR", "volumeId or dvdHandle required", null)
+                    return
+                }
+                val retries = call.argument<Int>("retries") ?: 0
+                val splitReads = call.argument<Boolean>("splitReads") ?: false
+                val skipBadSectors = call.argument<Boolean>("skipBadSectors") ?: false
+                log("UsbPlugin", "setRecoveryPolicy: retries=$retries split=$splitReads skip=$skipBadSectors")
+                val code = when (target) {
+                    is NativeTarget.Device ->
+                        NativeBridge.setRecoveryPolicy(target.handle, retries, splitReads, skipBadSectors)
+                    is NativeTarget.Dvd ->
+                        NativeBridge.dvdSetRecoveryPolicy(target.handle, retries, splitReads, skipBadSectors)
+                }
+                if (code < 0) {
+                    result.error("USB_ERROR", NativeBridge.lastError() ?: "Unknown handle", code)
+                } else {
+                    result.success(null)
+                }
+            }
+            "getBadSectors" -> {
+                val target = nativeTarget(call) ?: run {
+                    result.error("USB_ERROR", "volumeId or dvdHandle required", null)
+                    return
+                }
+                val json = when (target) {
+                    is NativeTarget.Device -> NativeBridge.getBadSectors(target.handle)
+                    is NativeTarget.Dvd -> NativeBridge.dvdGetBadSectors(target.handle)
+                }
+                if (json == null) {
+                    result.error("USB_ERROR", NativeBridge.lastError() ?: "Unknown handle", null)
+                } else {
+                    result.success(json)
+                }
+            }
+            "closeDvd" -> {
                 val dvdHandle = call.argument<Number>("dvdHandle")?.toLong()
                 if (dvdHandle == null) {
                     result.error("USB_ERROR", "dvdHandle required", null)
                     return
                 }
-                try {
-                    result.success(NativeBridge.dvdListTitles(dvdHandle) ?: "[]")
-                } catch (e: Exception) {
-                    result.error("DVD_ERROR", e.message, null)
-                }
+                NativeBridge.closeDvd(dvdHandle)
+                dvdToSession.remove(dvdHandle)?.let { closeDevice(it) }
+                result.success(null)
             }
-            "dvdListChapters" -> {
+            "dvdGetMetadata" -> {
                 val dvdHandle = call.argument<Number>("dvdHandle")?.toLong()
-                val titleId = call.argument<Int>("titleId") ?: 1
                 if (dvdHandle == null) {
                     result.error("USB_ERROR", "dvdHandle required", null)
                     return
                 }
-                try {
-                    result.success(NativeBridge.dvdListChapters(dvdHandle, titleId) ?: "[]")
-                } catch (e: Exception) {
-                    result.error("DVD_ERROR", e.message, null)
+                runIo(result, "DVD_ERROR") {
+                    val size = NativeBridge.dvdMetadataSize(dvdHandle)
+                    if (size < 0) {
+                        throw PluginError("DVD_ERROR", NativeBridge.lastError() ?: "Metadata failed")
+                    }
+                    val buffer = ByteBuffer.allocateDirect(size)
+                    val n = NativeBridge.dvdReadMetadata(dvdHandle, buffer)
+                    if (n < 0) {
+                        throw PluginError("DVD_ERROR", NativeBridge.lastError() ?: "Metadata failed")
+                    }
+                    val bytes = ByteArray(n)
+                    buffer.get(bytes)
+                    bytes
                 }
             }
             "dvdOpenTitleStream" -> {
@@ -310,15 +514,12 @@ class UsbPlugin(
                     result.error("USB_ERROR", "dvdHandle required", null)
                     return
                 }
-                try {
+                runIo(result, "DVD_ERROR") {
                     val streamId = NativeBridge.dvdOpenTitleStream(dvdHandle, titleId)
                     if (streamId < 0) {
-                        result.error("DVD_ERROR", NativeBridge.lastError() ?: "Open stream failed", null)
-                        return
+                        throw PluginError("DVD_ERROR", NativeBridge.lastError() ?: "Open stream failed")
                     }
-                    result.success(streamId)
-                } catch (e: Exception) {
-                    result.error("DVD_ERROR", e.message, null)
+                    streamId
                 }
             }
             "dvdReadStream" -> {
@@ -328,16 +529,13 @@ class UsbPlugin(
                     result.error("USB_ERROR", "streamId required", null)
                     return
                 }
-                try {
+                runIo(result, "DVD_ERROR") {
                     val buf = ByteArray(length)
                     val n = NativeBridge.dvdReadStream(streamId, buf)
                     if (n < 0) {
-                        result.error("DVD_ERROR", NativeBridge.lastError() ?: "Read failed", null)
-                        return
+                        throw PluginError("DVD_ERROR", NativeBridge.lastError() ?: "Read failed")
                     }
-                    result.success(buf.take(n).map { it.toInt() }.toList())
-                } catch (e: Exception) {
-                    result.error("DVD_ERROR", e.message, null)
+                    buf.take(n).map { it.toInt() }.toList()
                 }
             }
             "dvdSeekStream" -> {
@@ -353,6 +551,40 @@ class UsbPlugin(
                     result.error("DVD_ERROR", e.message, null)
                 }
             }
+            "dvdExtractTitle" -> {
+                val dvdHandle = call.argument<Number>("dvdHandle")?.toLong()
+                val titleId = call.argument<Int>("titleId") ?: 1
+                val firstChapter = call.argument<Int>("firstChapter") ?: 1
+                val lastChapter = call.argument<Int>("lastChapter") ?: 0
+                val resumeBytes = call.argument<Number>("resumeBytes")?.toLong() ?: 0L
+                val uri = call.argument<String>("uri")
+                val filePath = call.argument<String>("filePath")
+                if (dvdHandle == null || (uri == null && filePath == null)) {
+                    result.error("USB_ERROR", "dvdHandle and uri or filePath required", null)
+                    return
+                }
+                runIo(result, "DVD_ERROR") {
+                    // A resumed extraction keeps the existing output; Rust trims it to the resume point.
+                    val pfd = if (uri != null) {
+                        context.contentResolver.openFileDescriptor(Uri.parse(uri), if (resumeBytes > 0) "rw" else "wt")
+                    } else {
+                        ParcelFileDescriptor.open(
+                            File(filePath!!),
+                            ParcelFileDescriptor.MODE_READ_WRITE or
+                                ParcelFileDescriptor.MODE_CREATE or
+                                (if (resumeBytes > 0) 0 else ParcelFileDescriptor.MODE_TRUNCATE),
+                        )
+                    } ?: throw PluginError("DVD_ERROR", "Cannot open destination")
+                    // Rust owns the descriptor from here and closes it when the job ends.
+                    val jobId = NativeBridge.dvdExtractTitle(
+                        dvdHandle, titleId, firstChapter, lastChapter, resumeBytes, pfd.detachFd(),
+                    )
+                    if (jobId < 0) {
+                        throw PluginError("DVD_ERROR", NativeBridge.lastError() ?: "Extraction failed")
+                    }
+                    jobId
+                }
+            }
             "dvdCloseStream" -> {
                 val streamId = call.argument<Number>("streamId")?.toLong()
                 if (streamId == null) {
@@ -369,7 +601,10 @@ class UsbPlugin(
                     return
                 }
                 val rc = NativeBridge.closeVolume(volumeId)
-                volumeToSession.remove(volumeId)?.let { closeDevice(it) }
+                volumeToDevice.remove(volumeId)?.let { deviceId ->
+                    sharedDevices[deviceId]?.volumes?.remove(volumeId)
+                    releaseIfUnused(deviceId)
+                }
                 result.success(rc)
             }
             "listDirectory" -> {
@@ -379,11 +614,47 @@ class UsbPlugin(
                     result.error("USB_ERROR", "volumeId required", null)
                     return
                 }
-                try {
-                    val json = NativeBridge.listDirectory(volumeId, path)
-                    result.success(json ?: "[]")
-                } catch (e: Exception) {
-                    result.error("VOLUME_ERROR", e.message, null)
+                runIo(result, "VOLUME_ERROR") {
+                    NativeBridge.listDirectory(volumeId, path) ?: "[]"
+                }
+            }
+            "openDirCursor" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val path = call.argument<String>("path") ?: ""
+                if (volumeId == null) {
+                    result.error("USB_ERROR", "volumeId required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    val cursor = NativeBridge.openDirCursor(volumeId, path)
+                    if (cursor < 0) {
+                        throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "List failed")
+                    }
+                    cursor
+                }
+            }
+            "readDirPage" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val cursorId = call.argument<Number>("cursorId")?.toLong()
+                val maxEntries = call.argument<Int>("maxEntries") ?: 500
+                if (volumeId == null || cursorId == null) {
+                    result.error("USB_ERROR", "volumeId and cursorId required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    NativeBridge.readDirPage(volumeId, cursorId, maxEntries)
+                        ?: throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "List failed")
+                }
+            }
+            "closeDirCursor" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val cursorId = call.argument<Number>("cursorId")?.toLong()
+                if (volumeId == null || cursorId == null) {
+                    result.error("USB_ERROR", "volumeId and cursorId required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    NativeBridge.closeDirCursor(volumeId, cursorId)
                 }
             }
             "readFile" -> {
@@ -395,13 +666,163 @@ class UsbPlugin(
                     result.error("USB_ERROR", "volumeId and path required", null)
                     return
                 }
-                try {
-                    val data = NativeBridge.readFile(volumeId, path, offset, length)
-                    result.success(data?.toList() ?: emptyList<Int>())
-                } catch (e: Exception) {
-                    result.error("VOLUME_ERROR", e.message, null)
+                runIo(result, "VOLUME_ERROR") {
+                    NativeBridge.readFile(volumeId, path, offset, length)?.toList() ?: emptyList<Int>()
+                }
+            }
+            "openFile" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val path = call.argument<String>("path")
+                if (volumeId == null || path == null) {
+                    result.error("USB_ERROR", "volumeId and path required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    val handle = NativeBridge.openFile(volumeId, path)
+                    if (handle < 0) {
+                        throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "Open file failed")
+                    }
+                    handle
+                }
+            }
+            "readFileHandle" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val fileHandle = call.argument<Number>("fileHandle")?.toLong()
+                val offset = call.argument<Number>("offset")?.toLong() ?: 0L
+                val length = call.argument<Int>("length") ?: 65536
+                if (volumeId == null || fileHandle == null) {
+                    result.error("USB_ERROR", "volumeId and fileHandle required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    // Returned as a byte array (Uint8List in Dart), not a boxed list.
+                    NativeBridge.readFileHandle(volumeId, fileHandle, offset, length)
+                        ?: throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "Read failed")
                 }
             }
+            "closeFile" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val fileHandle = call.argument<Number>("fileHandle")?.toLong()
+                if (volumeId == null || fileHandle == null) {
+                    result.error("USB_ERROR", "volumeId and fileHandle required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    NativeBridge.closeFile(volumeId, fileHandle)
+                }
+            }
+            "startMftIndex" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val rebuild = call.argument<Boolean>("rebuild") ?: false
+                if (volumeId == null) {
+                    result.error("USB_ERROR", "volumeId required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    val dir = File(context.noBackupFilesDir, "mft_index").apply { mkdirs() }
+                    val code = NativeBridge.startMftIndex(volumeId, dir.absolutePath, rebuild)
+                    if (code < 0) {
+                        throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "Indexing failed")
+                    }
+                    code
+                }
+            }
+            "mftIndexStatus" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                if (volumeId == null) {
+                    result.error("USB_ERROR", "volumeId required", null)
+                    return
+                }
+                val progress = LongArray(2)
+                val state = NativeBridge.mftIndexStatus(volumeId, progress)
+                if (state < 0) {
+                    result.error("VOLUME_ERROR", NativeBridge.lastError() ?: "Volume not found", null)
+                    return
+                }
+                result.success(mapOf(
+                    "state" to state,
+                    "scanned" to progress[0],
+                    "total" to progress[1],
+                    "error" to if (state == 3) NativeBridge.lastError() else null,
+                ))
+            }
+            "searchVolume" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val query = call.argument<String>("query")
+                val prefix = call.argument<Boolean>("prefix") ?: false
+                val limit = call.argument<Int>("limit") ?: 200
+                if (volumeId == null || query == null) {
+                    result.error("USB_ERROR", "volumeId and query required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    NativeBridge.searchVolume(volumeId, query, prefix, limit)
+                        ?: throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "Search failed")
+                }
+            }
+            "copyFileToFd" -> {
+                val volumeId = call.argument<Number>("volumeId")?.toLong()
+                val path = call.argument<String>("path")
+                val uri = call.argument<String>("uri")
+                val filePath = call.argument<String>("filePath")
+                if (volumeId == null || path == null || (uri == null && filePath == null)) {
+                    result.error("USB_ERROR", "volumeId, path and uri or filePath required", null)
+                    return
+                }
+                runIo(result, "VOLUME_ERROR") {
+                    val pfd = if (uri != null) {
+                        context.contentResolver.openFileDescriptor(Uri.parse(uri), "wt")
+                    } else {
+                        ParcelFileDescriptor.open(
+                            File(filePath!!),
+                            ParcelFileDescriptor.MODE_WRITE_ONLY or
+                                ParcelFileDescriptor.MODE_CREATE or
+                                ParcelFileDescriptor.MODE_TRUNCATE,
+                        )
+                    } ?: throw PluginError("VOLUME_ERROR", "Cannot open destination")
+                    // Rust owns the descriptor from here and closes it when the copy ends.
+                    val jobId = NativeBridge.copyFileToFd(volumeId, path, pfd.detachFd())
+                    if (jobId < 0) {
+                        throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "Copy failed")
+                    }
+                    jobId
+                }
+            }
+            "copyJobStatus" -> {
+                val jobId = call.argument<Number>("jobId")?.toLong()
+                if (jobId == null) {
+                    result.error("USB_ERROR", "jobId required", null)
+                    return
+                }
+                val progress = LongArray(2)
+                val state = NativeBridge.copyJobStatus(jobId, progress)
+                if (state < 0) {
+                    result.error("VOLUME_ERROR", NativeBridge.lastError() ?: "Job not found", null)
+                    return
+                }
+                result.success(mapOf(
+                    "state" to state,
+                    "copied" to progress[0],
+                    "total" to progress[1],
+                    "error" to if (state == 2) NativeBridge.lastError() else null,
+                ))
+            }
+            "cancelCopyJob" -> {
+                val jobId = call.argument<Number>("jobId")?.toLong()
+                if (jobId == null) {
+                    result.error("USB_ERROR", "jobId required", null)
+                    return
+                }
+                result.success(NativeBridge.cancelCopyJob(jobId))
+            }
+            "releaseCopyJob" -> {
+                val jobId = call.argument<Number>("jobId")?.toLong()
+                if (jobId == null) {
+                    result.error("USB_ERROR", "jobId required", null)
+                    return
+                }
+                result.success(NativeBridge.releaseCopyJob(jobId))
+            }
             else -> result.notImplemented()
         }
     }
@@ -442,11 +863,96 @@ class UsbPlugin(
         return null
     }
 
-    private fun openDevice(deviceId: String): Long? {
+    /**
+     * UAS alternate setting (protocol 0x62) usable without bulk streams, i.e. on a
+     * high-speed link (512-byte bulk packets). Android has no stream API, and UAS
+     * over SuperSpeed requires streams, so those devices stay on BOT.
+     */
+    private fun findUasInterface(device: UsbDevice): android.hardware.usb.UsbInterface? {
+        for (i in 0 until device.interfaceCount) {
+            val iface = device.getInterface(i)
+            if (iface.interfaceClass != UsbConstants.USB_CLASS_MASS_STORAGE ||
+                iface.interfaceProtocol != UAS_PROTOCOL ||
+                iface.endpointCount != 4
+            ) continue
+            val allHighSpeedBulk = (0 until iface.endpointCount).all {
+                val ep = iface.getEndpoint(it)
+                ep.type == UsbConstants.USB_ENDPOINT_XFER_BULK && ep.maxPacketSize <= 512
+            }
+            if (allHighSpeedBulk) return iface
+        }
+        return null
+    }
+
+    /**
+     * Maps the UAS interface's endpoints to pipes using the Pipe Usage descriptors
+     * (type 0x24) that follow each endpoint descriptor in the raw configuration.
+     */
+    private fun mapUasPipes(
+        connection: android.hardware.usb.UsbDeviceConnection,
+        iface: android.hardware.usb.UsbInterface,
+    ): UasPipes? {
+        val raw = connection.rawDescriptors ?: return null
+        val pipeByAddress = HashMap<Int, Int>()
+        var inInterface = false
+        var lastEndpoint = -1
+        var i = 0
+        while (i + 1 < raw.size) {
+            val len = raw[i].toInt() and 0xFF
+            val type = raw[i + 1].toInt() and 0xFF
+            if (len < 2 || i + len > raw.size) break
+            when (type) {
+                USB_DT_INTERFACE -> {
+                    inInterface = len >= 4 &&
+                        (raw[i + 2].toInt() and 0xFF) == iface.id &&
+                        (raw[i + 3].toInt() and 0xFF) == iface.alternateSetting
+                    lastEndpoint = -1
+                }
+                USB_DT_ENDPOINT -> if (inInterface && len >= 3) lastEndpoint = raw[i + 2].toInt() and 0xFF
+                USB_DT_PIPE_USAGE -> if (inInterface && lastEndpoint >= 0 && len >= 3) {
+                    pipeByAddress[lastEndpoint] = raw[i + 2].toInt() and 0xFF
+                }
+            }
+            i += len
+        }
+        val endpoints = (0 until iface.endpointCount).map { iface.getEndpoint(it) }
+        fun pipe(id: Int) = endpoints.firstOrNull { pipeByAddress[it.address] == id }
+        return UasPipes(
+            command = pipe(1) ?: return null,
+            status = pipe(2) ?: return null,
+            dataIn = pipe(3) ?: return null,
+            dataOut = pipe(4) ?: return null,
+        )
+    }
+
+    /** Opens a UAS session, or returns null so the caller falls back to BOT. */
+    private fun openUasSession(
+        connection: android.hardware.usb.UsbDeviceConnection,
+        device: UsbDevice,
+    ): UsbSession? {
+        val iface = findUasInterface(device) ?: return null
+        val pipes = mapUasPipes(connection, iface) ?: return null
+        if (!connection.claimInterface(iface, true)) return null
+        if (!connection.setInterface(iface)) {
+            connection.releaseInterface(iface)
+            return null
+        }
+        log("UsbPlugin", "Using UAS on interface ${iface.id} alt ${iface.alternateSetting}")
+        return UsbSession(connection, iface, pipes.dataIn, pipes.dataOut, pipes)
+    }
+
+    private fun openDevice(deviceId: String, allowUas: Boolean = false): Long? {
         val device = usbManager.deviceList[deviceId] ?: return null
         if (!usbManager.hasPermission(device)) return null
 
         val connection = usbManager.openDevice(device) ?: return null
+        if (allowUas) {
+            openUasSession(connection, device)?.let { session ->
+                val sessionId = sessionIdGenerator.getAndIncrement()
+                sessions[sessionId] = session
+                return sessionId
+            }
+        }
         val iface = findMassStorageInterface(device) ?: run {
             connection.close()
             return null
@@ -475,6 +981,85 @@ class UsbPlugin(
         return sessionId
     }
 
+    private fun transferHandler(sessionId: Long): BulkTransferHandler {
+        val uas = sessions[sessionId]?.uasPipes != null
+        return object : BulkTransferHandler {
+            override fun bulkOut(data: ByteArray): Int = bulkTransferOut(sessionId, data)
+            override fun bulkIn(maxLength: Int): ByteArray = bulkTransferIn(sessionId, maxLength)
+            override fun isUas(): Boolean = uas
+            override fun pipeOut(pipe: Int, data: ByteArray): Int = pipeTransferOut(sessionId, pipe, data)
+            override fun pipeIn(pipe: Int, maxLength: Int): ByteArray = pipeTransferIn(sessionId, pipe, maxLength)
+            override fun bulkOutDirect(buffer: ByteBuffer, length: Int): Int =
+                sessionOf(sessionId).let { directTransfer(it, it.endpointOut, buffer, length) }
+            override fun bulkInDirect(buffer: ByteBuffer, length: Int): Int =
+                sessionOf(sessionId).let { directTransfer(it, it.endpointIn, buffer, length) }
+            override fun pipeOutDirect(pipe: Int, buffer: ByteBuffer, length: Int): Int =
+                uasEndpoint(sessionId, pipe).let { (s, ep) -> directTransfer(s, ep, buffer, length) }
+            override fun pipeInDirect(pipe: Int, buffer: ByteBuffer, length: Int): Int =
+                uasEndpoint(sessionId, pipe).let { (s, ep) -> directTransfer(s, ep, buffer, length) }
+        }
+    }
+
+    private fun sessionOf(sessionId: Long): UsbSession =
+        sessions[sessionId] ?: throw IllegalStateException("Session not found: $sessionId")
+
+    /**
+     * Transfers [length] bytes between [buffer] (a direct buffer over Rust memory)
+     * and [endpoint] with a queued UsbRequest, so no Java array is allocated or
+     * copied. Rust serializes transfers per session, so the request that
+     * requestWait returns is ours.
+     */
+    private fun directTransfer(
+        session: UsbSession,
+        endpoint: android.hardware.usb.UsbEndpoint,
+        buffer: ByteBuffer,
+        length: Int,
+    ): Int {
+        val request = session.request(endpoint)
+        buffer.clear()
+        buffer.limit(length)
+        if (!request.queue(buffer)) {
+            throw IllegalStateException("UsbRequest.queue failed on endpoint ${endpoint.address}")
+        }
+        val done = try {
+            session.connection.requestWait(30000)
+        } catch (e: java.util.concurrent.TimeoutException) {
+            session.discardRequest(endpoint)
+            throw IllegalStateException("Transfer timed out on endpoint ${endpoint.address}")
+        }
+        if (done !== request) {
+            // requestWait failed (null) or reaped another request: ours may still be queued.
+            session.discardRequest(endpoint)
+            throw IllegalStateException(
+                if (done == null) "Transfer failed on endpoint ${endpoint.address}"
+                else "Unexpected UsbRequest completed on endpoint ${endpoint.address}"
+            )
+        }
+        return buffer.position()
+    }
+
+    private fun uasEndpoint(sessionId: Long, pipe: Int): Pair<UsbSession, android.hardware.usb.UsbEndpoint> {
+        val session = sessions[sessionId] ?: throw IllegalStateException("Session not found: $sessionId")
+        val pipes = session.uasPipes ?: throw IllegalStateException("Session $sessionId is not UAS")
+        val ep = pipes.endpoint(pipe) ?: throw IllegalArgumentException("Invalid UAS pipe: $pipe")
+        return session to ep
+    }
+
+    private fun pipeTransferOut(sessionId: Long, pipe: Int, data: ByteArray): Int {
+        val (session, ep) = uasEndpoint(sessionId, pipe)
+        val result = session.connection.bulkTransfer(ep, data, data.size, 30000)
+        if (result < 0) throw IllegalStateException("pipeTransferOut($pipe) failed: $result")
+        return result
+    }
+
+    private fun pipeTransferIn(sessionId: Long, pipe: Int, maxLength: Int): ByteArray {
+        val (session, ep) = uasEndpoint(sessionId, pipe)
+        val buffer = ByteArray(maxLength)
+        val result = session.connection.bulkTransfer(ep, buffer, maxLength, 30000)
+        if (result < 0) throw IllegalStateException("pipeTransferIn($pipe) failed: $result")
+        return if (result < maxLength) buffer.copyOf(result) else buffer
+    }
+
     private fun bulkTransferOut(sessionId: Long, data: ByteArray): Int {
         val session = sessions[sessionId] ?: throw IllegalStateException("Session not found: $sessionId")
         val result = session.connection.bulkTransfer(session.endpointOut, data, data.size, 30000)
@@ -494,6 +1079,47 @@ class UsbPlugin(
         sessions.remove(sessionId)?.close()
     }
 
+    /** Session and native device for [deviceId], opened (and partitions scanned) on first use. */
+    private fun sharedDevice(deviceId: String, allowUas: Boolean): SharedDevice {
+        sharedDevices[deviceId]?.let { return it }
+        val sessionId = openDevice(deviceId, allowUas)
+            ?: throw PluginError("USB_ERROR", "Failed to open device")
+        val handle = NativeBridge.openBlockDevice(sessionId, transferHandler(sessionId))
+        if (handle < 0) {
+            closeDevice(sessionId)
+            throw PluginError("VOLUME_ERROR", NativeBridge.lastError() ?: "Open failed")
+        }
+        return SharedDevice(sessionId, handle).also { sharedDevices[deviceId] = it }
+    }
+
+    /**
+     * Current I/O counters of every open device, DVD and CD, keyed "device:<deviceId>",
+     * "dvd:<handle>" or "cd:<handle>". Handles are taken on the main thread; the native calls
+     * wait on the device's command lock, so they run on [ioExecutor] and
+     * [callback] is invoked back on the main thread.
+     */
+    fun collectIoStats(callback: (Map<String, String>) -> Unit) {
+        val devices = sharedDevices.map { (id, shared) -> "device:$id" to shared.deviceHandle }
+        val dvds = dvdToSession.keys.map { "dvd:$it" to it }
+        val cds = cdToSession.keys.map { "cd:$it" to it }
+        ioExecutor.execute {
+            val stats = HashMap<String, String>()
+            for ((key, handle) in devices) NativeBridge.getIoStats(handle)?.let { stats[key] = it }
+            for ((key, handle) in dvds) NativeBridge.dvdGetIoStats(handle)?.let { stats[key] = it }
+            for ((key, handle) in cds) NativeBridge.cdGetIoStats(handle)?.let { stats[key] = it }
+            mainHandler.post { callback(stats) }
+        }
+    }
+
+    /** Closes the shared device once no volume uses it. */
+    private fun releaseIfUnused(deviceId: String) {
+        val shared = sharedDevices[deviceId] ?: return
+        if (shared.volumes.isNotEmpty()) return
+        sharedDevices.remove(deviceId)
+        NativeBridge.closeBlockDevice(shared.deviceHandle)
+        closeDevice(shared.sessionId)
+    }
+
     private fun sendEvent(type: String, deviceId: String?) {
         val map = HashMap<String, Any?>().apply {
             put("type", type)
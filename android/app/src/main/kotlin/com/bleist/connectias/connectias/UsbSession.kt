@@ -3,17 +3,73 @@ package com.bleist.connectias.connectias
 import android.hardware.usb.UsbDeviceConnection
 import android.hardware.usb.UsbEndpoint
 import android.hardware.usb.UsbInterface
+import android.hardware.usb.UsbRequest
+import java.util.concurrent.TimeoutException
+
+/**
+ * UAS pipes of a session that claimed the UAS alternate setting.
+ */
+internal data class UasPipes(
+    val command: UsbEndpoint,
+    val status: UsbEndpoint,
+    val dataIn: UsbEndpoint,
+    val dataOut: UsbEndpoint,
+) {
+    /** Endpoint for a UAS pipe ID (1 command, 2 status, 3 data-in, 4 data-out). */
+    fun endpoint(pipe: Int): UsbEndpoint? = when (pipe) {
+        1 -> command
+        2 -> status
+        3 -> dataIn
+        4 -> dataOut
+        else -> null
+    }
+}
 
 /**
  * Holds an open USB Mass Storage session with bulk IN/OUT endpoints.
+ * [uasPipes] is set when the session runs UAS instead of Bulk-Only Transport.
  */
 internal data class UsbSession(
     val connection: UsbDeviceConnection,
     val usbInterface: UsbInterface,
     val endpointIn: UsbEndpoint,
     val endpointOut: UsbEndpoint,
+    val uasPipes: UasPipes? = null,
 ) {
+    private val requests = HashMap<Int, UsbRequest>()
+
+    /** Reusable async request for [endpoint] (used for direct ByteBuffer transfers). */
+    @Synchronized
+    fun request(endpoint: UsbEndpoint): UsbRequest = requests.getOrPut(endpoint.address) {
+        UsbRequest().apply {
+            if (!initialize(connection, endpoint)) {
+                throw IllegalStateException("UsbRequest init failed for endpoint ${endpoint.address}")
+            }
+        }
+    }
+
+    /**
+     * Cancels and closes the request of [endpoint] after a transfer on it
+     * timed out or failed, so the next [request] starts from a fresh one
+     * instead of one still queued on the device.
+     */
+    @Synchronized
+    fun discardRequest(endpoint: UsbEndpoint) {
+        val request = requests.remove(endpoint.address) ?: return
+        request.cancel()
+        try {
+            // Reap the cancelled request; transfers are serialized per session.
+            connection.requestWait(1000)
+        } catch (_: TimeoutException) {
+        }
+        request.close()
+    }
+
     fun close() {
+        synchronized(this) {
+            requests.values.forEach { it.close() }
+            requests.clear()
+        }
         connection.releaseInterface(usbInterface)
         connection.close()
     }
@@ -12,4 +12,5 @@ abstract final class AppRouter {
   static const String logging = '/logging';
   static const String dvd = '/dvd';
   static const String dvdPlayer = '/dvd-player';
+  static const String cdPlayer = '/cd-player';
 }
@@ -14,6 +14,7 @@ import '../../features/notes/ui/notes_screen.dart';
 import '../../features/settings/ui/settings_screen.dart';
 import '../../features/dvd/ui/dvd_player_screen.dart';
 import '../../features/dvd/ui/dvd_device_screen.dart';
+import '../../features/audio_cd/ui/cd_player_screen.dart';
 
 /// Root application widget.
 class ConnectiasApp extends StatelessWidget {
@@ -50,6 +51,13 @@ class ConnectiasApp extends StatelessWidget {
             deviceName: args?['deviceName'] as String?,
           );
         },
+        AppRouter.cdPlayer: (ctx) {
+          final args = ModalRoute.of(ctx)?.settings.arguments as Map<String, dynamic>?;
+          return CdPlayerScreen(
+            deviceId: args?['deviceId'] as String? ?? '',
+            deviceName: args?['deviceName'] as String?,
+          );
+        },
       },
     );
   }
@@ -0,0 +1,42 @@
+import 'dart:convert';
+
+/// A track from the TOC of an audio CD (UsbPlugin `cdGetToc`).
+class CdTrack {
+  const CdTrack({
+    required this.number,
+    required this.startSector,
+    required this.sectors,
+    required this.durationMs,
+    required this.audio,
+  });
+
+  final int number;
+
+  /// First sector (LBA) and length in 2352-byte sectors.
+  final int startSector;
+  final int sectors;
+  final int durationMs;
+
+  /// False for the data track of a mixed-mode or Enhanced CD.
+  final bool audio;
+
+  /// Size of the track ripped as WAV (44-byte header plus PCM).
+  int get wavBytes => 44 + sectors * 2352;
+
+  /// Parses the TOC JSON: {"leadOut", "tracks": [...]}.
+  static List<CdTrack> fromTocJson(String json) {
+    final map = jsonDecode(json) as Map<String, dynamic>;
+    final tracks = map['tracks'] as List<dynamic>? ?? const [];
+    return tracks.map((e) {
+      final t = e as Map<String, dynamic>;
+      int n(String key) => (t[key] as num?)?.toInt() ?? 0;
+      return CdTrack(
+        number: n('number'),
+        startSector: n('start'),
+        sectors: n('sectors'),
+        durationMs: n('durationMs'),
+        audio: t['audio'] as bool? ?? false,
+      );
+    }).toList();
+  }
+}
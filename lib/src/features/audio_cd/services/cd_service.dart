@@ -0,0 +1,140 @@
+import 'package:flutter/services.dart';
+
+import '../../logging/services/logging_service.dart';
+import '../../storage_media/data/usb_copy_job_status.dart';
+import '../data/cd_track.dart';
+
+/// Service for audio CD operations via MethodChannel.
+/// Uses /usb for open, TOC and ripping, and /dvd for playback (the player
+/// plugin plays CD tracks too); the save location picker lives on /log.
+class CdService {
+  CdService()
+      : _usbChannel = const MethodChannel('com.bleist.connectias/usb'),
+        _playerChannel = const MethodChannel('com.bleist.connectias/dvd'),
+        _logChannel = const MethodChannel('com.bleist.connectias/log');
+
+  final MethodChannel _usbChannel;
+  final MethodChannel _playerChannel;
+  final MethodChannel _logChannel;
+
+  /// Opens the audio CD in the given drive. Returns the CD handle.
+  /// Throws PlatformException if the disc has no audio tracks.
+  Future<int> openCd(String deviceId) async {
+    LoggingService.instance.v('CdService', 'openCd: $deviceId');
+    final result = await _usbChannel.invokeMethod<int>(
+      'openCd',
+      {'deviceId': deviceId},
+    );
+    if (result == null || result < 0) {
+      throw PlatformException(
+        code: 'CD_ERROR',
+        message: 'Failed to open CD',
+      );
+    }
+    return result;
+  }
+
+  /// Closes the CD and releases the USB session.
+  Future<void> closeCd(int cdHandle) async {
+    LoggingService.instance.v('CdService', 'closeCd: $cdHandle');
+    await _usbChannel.invokeMethod('closeCd', {'cdHandle': cdHandle});
+  }
+
+  /// Tracks of the disc, read once when it was opened.
+  Future<List<CdTrack>> getTracks(int cdHandle) async {
+    final result = await _usbChannel.invokeMethod<String>(
+      'cdGetToc',
+      {'cdHandle': cdHandle},
+    );
+    return CdTrack.fromTocJson(result ?? '{}');
+  }
+
+  /// Opens SAF "save as" for a ripped track. Returns the document URI, or
+  /// null if the user backed out.
+  Future<String?> pickSaveLocation(String suggestedName) {
+    return _logChannel.invokeMethod<String>(
+      'pickSaveLocation',
+      {'suggestedName': suggestedName},
+    );
+  }
+
+  /// Rips a track as WAV into a content [uri] or a local [filePath], polling
+  /// progress every [pollInterval]. Returns false if [isCancelled] stopped it.
+  Future<bool> ripTrack(
+    int cdHandle,
+    int track, {
+    String? uri,
+    String? filePath,
+    void Function(int copied, int total)? onProgress,
+    bool Function()? isCancelled,
+    Duration pollInterval = const Duration(milliseconds: 500),
+  }) async {
+    LoggingService.instance.v('CdService', 'ripTrack: $cdHandle track $track');
+    final jobId = await _usbChannel.invokeMethod<int>('cdRipTrack', {
+      'cdHandle': cdHandle,
+      'track': track,
+      'uri': uri,
+      'filePath': filePath,
+    });
+    if (jobId == null || jobId < 0) {
+      throw PlatformException(
+        code: 'CD_ERROR',
+        message: 'Failed to start rip',
+      );
+    }
+    try {
+      var cancelRequested = false;
+      while (true) {
+        final map = await _usbChannel.invokeMethod<Map<Object?, Object?>>(
+          'copyJobStatus',
+          {'jobId': jobId},
+        );
+        final status = UsbCopyJobStatus.fromMap(map ?? const {});
+        onProgress?.call(status.copied, status.total);
+        if (!status.isRunning) {
+          if (status.state == UsbCopyJobStatus.failed) {
+            throw PlatformException(
+              code: 'CD_ERROR',
+              message: status.error ?? 'Rip failed',
+            );
+          }
+          return status.state == UsbCopyJobStatus.done;
+        }
+        if (!cancelRequested && (isCancelled?.call() ?? false)) {
+          cancelRequested = true;
+          await _usbChannel.invokeMethod('cancelCopyJob', {'jobId': jobId});
+        }
+        await Future<void>.delayed(pollInterval);
+      }
+    } finally {
+      await _usbChannel.invokeMethod('releaseCopyJob', {'jobId': jobId});
+    }
+  }
+
+  /// Loads the CD for playback (passes cdHandle to the player plugin).
+  Future<void> loadCd(int cdHandle) async {
+    await _playerChannel.invokeMethod('loadCd', cdHandle);
+  }
+
+  /// Starts playing a track. Call loadCd(cdHandle) first.
+  Future<void> playTrack(int track) async {
+    await _playerChannel.invokeMethod('playCdTrack', {'track': track});
+  }
+
+  Future<void> pause() async {
+    await _playerChannel.invokeMethod('pause');
+  }
+
+  Future<void> resume() async {
+    await _playerChannel.invokeMethod('resume');
+  }
+
+  /// Seeks within the playing track, in milliseconds.
+  Future<void> seek(int positionMs) async {
+    await _playerChannel.invokeMethod('seek', {'positionMs': positionMs});
+  }
+
+  Future<void> stop() async {
+    await _playerChannel.invokeMethod('stop');
+  }
+}
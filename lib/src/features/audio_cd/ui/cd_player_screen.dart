@@ -0,0 +1,233 @@
+import 'package:flutter/material.dart';
+
+import '../data/cd_track.dart';
+import '../services/cd_service.dart';
+
+/// Audio CD screen: track list, transport controls and ripping to WAV.
+class CdPlayerScreen extends StatefulWidget {
+  const CdPlayerScreen({
+    super.key,
+    required this.deviceId,
+    this.deviceName,
+  });
+
+  final String deviceId;
+  final String? deviceName;
+
+  @override
+  State<CdPlayerScreen> createState() => _CdPlayerScreenState();
+}
+
+class _CdPlayerScreenState extends State<CdPlayerScreen> {
+  final _cdService = CdService();
+  int? _cdHandle;
+  List<CdTrack> _tracks = [];
+  bool _loading = true;
+  String? _error;
+  bool _playing = false;
+  int? _selectedTrack;
+  int? _rippingTrack;
+  double _ripProgress = 0;
+  bool _ripCancelled = false;
+
+  @override
+  void initState() {
+    super.initState();
+    _openCd();
+  }
+
+  Future<void> _openCd() async {
+    setState(() {
+      _loading = true;
+      _error = null;
+    });
+    try {
+      final handle = await _cdService.openCd(widget.deviceId);
+      final tracks = await _cdService.getTracks(handle);
+      if (mounted) {
+        setState(() {
+          _cdHandle = handle;
+          _tracks = tracks;
+          _loading = false;
+        });
+      }
+    } catch (e) {
+      if (mounted) {
+        setState(() {
+          _error = e.toString();
+          _loading = false;
+        });
+      }
+    }
+  }
+
+  @override
+  void dispose() {
+    _ripCancelled = true;
+    if (_cdHandle != null) {
+      _cdService.closeCd(_cdHandle!);
+    }
+    super.dispose();
+  }
+
+  Future<void> _playTrack(int track) async {
+    if (_cdHandle == null) return;
+    try {
+      await _cdService.loadCd(_cdHandle!);
+      await _cdService.playTrack(track);
+      setState(() {
+        _playing = true;
+        _selectedTrack = track;
+      });
+    } catch (e) {
+      setState(() => _error = e.toString());
+    }
+  }
+
+  /// Rips the track as WAV to a picked document; tapping again cancels.
+  Future<void> _ripTrack(CdTrack track) async {
+    if (_cdHandle == null) return;
+    if (_rippingTrack != null) {
+      _ripCancelled = true;
+      return;
+    }
+    final messenger = ScaffoldMessenger.of(context);
+    try {
+      final name = 'Track_${track.number.toString().padLeft(2, '0')}.wav';
+      final uri = await _cdService.pickSaveLocation(name);
+      if (uri == null || !mounted) return;
+      setState(() {
+        _rippingTrack = track.number;
+        _ripProgress = 0;
+        _ripCancelled = false;
+      });
+      final done = await _cdService.ripTrack(
+        _cdHandle!,
+        track.number,
+        uri: uri,
+        onProgress: (copied, total) {
+          if (mounted && total > 0) setState(() => _ripProgress = copied / total);
+        },
+        isCancelled: () => _ripCancelled,
+      );
+      messenger.showSnackBar(SnackBar(
+        content: Text(done ? 'Track ${track.number} gesichert' : 'Sicherung abgebrochen'),
+      ));
+    } catch (e) {
+      messenger.showSnackBar(SnackBar(content: Text('Sicherung fehlgeschlagen: $e')));
+    } finally {
+      if (mounted) setState(() => _rippingTrack = null);
+    }
+  }
+
+  Future<void> _pause() async {
+    await _cdService.pause();
+    setState(() => _playing = false);
+  }
+
+  Future<void> _resume() async {
+    await _cdService.resume();
+    setState(() => _playing = true);
+  }
+
+  Future<void> _stop() async {
+    await _cdService.stop();
+    setState(() {
+      _playing = false;
+      _selectedTrack = null;
+    });
+  }
+
+  static String _formatDuration(int ms) {
+    final d = Duration(milliseconds: ms);
+    final m = d.inMinutes.toString().padLeft(2, '0');
+    final s = d.inSeconds.remainder(60).toString().padLeft(2, '0');
+    return '$m:$s';
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return Scaffold(
+      appBar: AppBar(
+        title: Text(widget.deviceName ?? 'Audio-CD'),
+      ),
+      body: _loading
+          ? const Center(child: CircularProgressIndicator())
+          : _error != null
+              ? Center(
+                  child: Padding(
+                    padding: const EdgeInsets.all(24),
+                    child: Column(
+                      mainAxisAlignment: MainAxisAlignment.center,
+                      children: [
+                        Icon(Icons.error_outline, size: 48, color: Theme.of(context).colorScheme.error),
+                        const SizedBox(height: 16),
+                        Text(_error!, textAlign: TextAlign.center),
+                        const SizedBox(height: 16),
+                        FilledButton(
+                          onPressed: () => Navigator.pop(context),
+                          child: const Text('Zurück'),
+                        ),
+                      ],
+                    ),
+                  ),
+                )
+              : Column(
+                  children: [
+                    Expanded(
+                      child: ListView.builder(
+                        itemCount: _tracks.length,
+                        itemBuilder: (context, i) {
+                          final t = _tracks[i];
+                          final ripping = _rippingTrack == t.number;
+                          return ListTile(
+                            enabled: t.audio,
+                            leading: Icon(t.audio ? Icons.music_note : Icons.insert_drive_file),
+                            title: Text('Track ${t.number}'),
+                            subtitle: ripping
+                                ? LinearProgressIndicator(value: _ripProgress)
+                                : Text(t.audio ? _formatDuration(t.durationMs) : 'Datenspur'),
+                            selected: _selectedTrack == t.number,
+                            trailing: t.audio
+                                ? IconButton(
+                                    icon: Icon(ripping ? Icons.close : Icons.download),
+                                    tooltip: ripping ? 'Sicherung abbrechen' : 'Track sichern',
+                                    onPressed: _rippingTrack == null || ripping
+                                        ? () => _ripTrack(t)
+                                        : null,
+                                  )
+                                : null,
+                            onTap: t.audio ? () => _playTrack(t.number) : null,
+                          );
+                        },
+                      ),
+                    ),
+                    if (_playing || _selectedTrack != null)
+                      Container(
+                        padding: const EdgeInsets.all(16),
+                        color: Theme.of(context).colorScheme.surfaceContainerHighest,
+                        child: Row(
+                          mainAxisAlignment: MainAxisAlignment.center,
+                          children: [
+                            IconButton(
+                              icon: const Icon(Icons.stop),
+                              onPressed: _stop,
+                            ),
+                            if (_playing)
+                              IconButton(
+                                icon: const Icon(Icons.pause),
+                                onPressed: _pause,
+                              )
+                            else
+                              IconButton(
+                                icon: const Icon(Icons.play_arrow),
+                                onPressed: _resume,
+                              ),
+                          ],
+                        ),
+                      ),
+                  ],
+                ),
+    );
+  }
+}
@@ -1,53 +1,97 @@
-/// Represents a DVD title from listTitles JSON.
+import 'dart:typed_data';
+
+const int _kMetadataMagic = 0x4D445644; // "DVDM"
+const int _kHeaderSize = 16;
+
+/// A chapter (PTT) of a DVD title.
+class DvdChapter {
+  const DvdChapter({
+    required this.chapterNumber,
+    required this.pgcn,
+    required this.pgn,
+    this.startMs = 0,
+    this.durationMs = 0,
+    this.startSector = 0,
+    this.lastSector = 0,
+  });
+
+  final int chapterNumber;
+  final int pgcn;
+  final int pgn;
+
+  /// Offset from the start of the title (sum of the preceding chapters).
+  final int startMs;
+  final int durationMs;
+
+  /// First/last sector within the title set's title VOBs.
+  final int startSector;
+  final int lastSector;
+}
+
+/// Represents a DVD title from the packed disc metadata.
 class DvdTitle {
   const DvdTitle({
     required this.titleNumber,
     this.chapterCount = 0,
     this.angleCount = 1,
+    this.titleSetNr = 0,
+    this.chapters = const [],
+    this.durationMs = 0,
   });
 
   final int titleNumber;
   final int chapterCount;
   final int angleCount;
+  final int titleSetNr;
+  final List<DvdChapter> chapters;
+  final int durationMs;
 
-  static List<DvdTitle> fromJson(String json) {
-    if (json.isEmpty || json == '[]') return [];
-    try {
-      final decoded = _tryDecode(json);
-      if (decoded.isEmpty) {
-        return [const DvdTitle(titleNumber: 1)];
-      }
-      return decoded;
-    } catch (_) {
-      return [const DvdTitle(titleNumber: 1)];
+  /// Parses the packed metadata from dvd_helper.c (little endian, fixed-size
+  /// records; record sizes come from the header so newer fields are skipped).
+  static List<DvdTitle> fromMetadata(Uint8List bytes) {
+    if (bytes.length < _kHeaderSize) return [];
+    final data = ByteData.sublistView(bytes);
+    if (data.getUint32(0, Endian.little) != _kMetadataMagic) return [];
+    final titleCount = data.getUint16(6, Endian.little);
+    final chapterCount = data.getUint32(8, Endian.little);
+    final titleSize = data.getUint16(12, Endian.little);
+    final chapterSize = data.getUint16(14, Endian.little);
+    final chaptersStart = _kHeaderSize + titleCount * titleSize;
+    if (titleSize < 16 ||
+        chapterSize < 8 ||
+        bytes.length < chaptersStart + chapterCount * chapterSize) {
+      return [];
     }
-  }
 
-  static List<DvdTitle> _tryDecode(String json) {
-    final list = <DvdTitle>[];
-    final inner = json.replaceAll(RegExp(r'^\s*\[\s*|\s*\]\s*$'), '').trim();
-    if (inner.isEmpty) return list;
-    var i = 0;
-    while (i < inner.length) {
-      if (inner[i] == '{') {
-        var end = inner.indexOf('}', i);
-        if (end > i) {
-          final obj = inner.substring(i, end + 1);
-          final numMatch = RegExp(r'"titleNumber"|"n"\s*:\s*(\d+)').firstMatch(obj);
-          final num = numMatch != null ? int.tryParse(numMatch.group(1) ?? '1') ?? 1 : list.length + 1;
-          final chMatch = RegExp(r'"chapters"|"c"\s*:\s*(\d+)').firstMatch(obj);
-          list.add(DvdTitle(
-            titleNumber: num,
-            chapterCount: chMatch != null ? int.tryParse(chMatch.group(1) ?? '0') ?? 0 : 0,
-          ));
-          i = end + 1;
-        } else {
-          i++;
-        }
-      } else {
-        i++;
+    final titles = <DvdTitle>[];
+    for (var i = 0; i < titleCount; i++) {
+      final off = _kHeaderSize + i * titleSize;
+      final nrOfChapters = data.getUint16(off + 8, Endian.little);
+      final firstChapter = data.getUint32(off + 12, Endian.little);
+      final chapters = <DvdChapter>[];
+      for (var c = 0; c < nrOfChapters && firstChapter + c < chapterCount; c++) {
+        final co = chaptersStart + (firstChapter + c) * chapterSize;
+        final timed = chapterSize >= 24;
+        chapters.add(DvdChapter(
+          chapterNumber: data.getUint16(co, Endian.little),
+          pgcn: data.getUint16(co + 2, Endian.little),
+          pgn: data.getUint16(co + 4, Endian.little),
+          startMs: timed ? data.getUint32(co + 8, Endian.little) : 0,
+          durationMs: timed ? data.getUint32(co + 12, Endian.little) : 0,
+          startSector: timed ? data.getUint32(co + 16, Endian.little) : 0,
+          lastSector: timed ? data.getUint32(co + 20, Endian.little) : 0,
+        ));
       }
+      titles.add(DvdTitle(
+        titleNumber: data.getUint16(off, Endian.little),
+        titleSetNr: data.getUint8(off + 2),
+        angleCount: data.getUint8(off + 4),
+        chapterCount: data.getUint16(off + 6, Endian.little),
+        chapters: chapters,
+        durationMs:
+            titleSize >= 20 ? data.getUint32(off + 16, Endian.little) : 0,
+      ));
     }
-    return list;
+    return titles;
   }
 }
@@ -1,16 +1,24 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 
 import '../../logging/services/logging_service.dart';
+import '../../storage_media/data/usb_copy_job_status.dart';
+import '../../storage_media/data/usb_read_recovery.dart';
+import '../../storage_media/services/usb_ffi.dart';
 
 /// Service for DVD operations via MethodChannel.
-/// Uses /usb for device/open/list and /dvd for playback control.
+/// Uses /usb for device/open/list and /dvd for playback control; the save
+/// location picker lives on /log.
 class DvdService {
   DvdService()
       : _usbChannel = const MethodChannel('com.bleist.connectias/usb'),
-        _dvdChannel = const MethodChannel('com.bleist.connectias/dvd');
+        _dvdChannel = const MethodChannel('com.bleist.connectias/dvd'),
+        _logChannel = const MethodChannel('com.bleist.connectias/log');
 
   final MethodChannel _usbChannel;
   final MethodChannel _dvdChannel;
+  final MethodChannel _logChannel;
 
   /// Returns device type: "block" or "optical".
   Future<String> getDeviceType(String deviceId) async {
@@ -45,23 +53,106 @@ class DvdService {
     await _usbChannel.invokeMethod('closeDvd', {'dvdHandle': dvdHandle});
   }
 
-  /// Lists DVD titles as JSON array.
-  Future<String> listTitles(int dvdHandle) async {
-    LoggingService.instance.v('DvdService', 'listTitles: $dvdHandle');
+  /// Sets how reads on the disc handle unreadable sectors.
+  Future<void> setReadRecovery(int dvdHandle, UsbReadRecovery recovery) async {
+    LoggingService.instance.v('DvdService', 'setReadRecovery: $dvdHandle');
+    await _usbChannel.invokeMethod('setRecoveryPolicy', {
+      'dvdHandle': dvdHandle,
+      ...recovery.toArguments(),
+    });
+  }
+
+  /// Sectors of the disc zero-filled so far.
+  Future<List<UsbBadSectorRange>> getBadSectors(int dvdHandle) async {
     final result = await _usbChannel.invokeMethod<String>(
-      'dvdListTitles',
+      'getBadSectors',
       {'dvdHandle': dvdHandle},
     );
-    return result ?? '[]';
+    return UsbBadSectorRange.fromJsonList(result ?? '[]');
   }
 
-  /// Lists chapters for a title as JSON array.
-  Future<String> listChapters(int dvdHandle, int titleId) async {
-    final result = await _usbChannel.invokeMethod<String>(
-      'dvdListChapters',
-      {'dvdHandle': dvdHandle, 'titleId': titleId},
+  /// Returns the packed title/chapter metadata (parse with [DvdTitle.fromMetadata]).
+  Future<Uint8List> getMetadata(int dvdHandle) async {
+    LoggingService.instance.v('DvdService', 'getMetadata: $dvdHandle');
+    final direct = await UsbFfi.instance?.dvdMetadata(dvdHandle);
+    if (direct != null) return direct;
+    final result = await _usbChannel.invokeMethod<Uint8List>(
+      'dvdGetMetadata',
+      {'dvdHandle': dvdHandle},
     );
-    return result ?? '[]';
+    return result ?? Uint8List(0);
+  }
+
+  /// Opens SAF "save as" for an extracted title. Returns the document URI,
+  /// or null if the user backed out.
+  Future<String?> pickSaveLocation(String suggestedName) {
+    return _logChannel.invokeMethod<String>(
+      'pickSaveLocation',
+      {'suggestedName': suggestedName},
+    );
+  }
+
+  /// Extracts chapters [firstChapter]..[lastChapter] (0 = last) of a title,
+  /// decrypted, into a content [uri] or a local [filePath], polling progress
+  /// every [pollInterval]. With [resumeBytes] > 0 an interrupted extraction
+  /// into the same destination continues after that many bytes. Returns
+  /// false if [isCancelled] stopped it; the partial output stays and can be
+  /// resumed from its length.
+  Future<bool> extractTitle(
+    int dvdHandle,
+    int titleId, {
+    int firstChapter = 1,
+    int lastChapter = 0,
+    int resumeBytes = 0,
+    String? uri,
+    String? filePath,
+    void Function(int copied, int total)? onProgress,
+    bool Function()? isCancelled,
+    Duration pollInterval = const Duration(milliseconds: 500),
+  }) async {
+    LoggingService.instance.v('DvdService', 'extractTitle: $dvdHandle title $titleId');
+    final jobId = await _usbChannel.invokeMethod<int>('dvdExtractTitle', {
+      'dvdHandle': dvdHandle,
+      'titleId': titleId,
+      'firstChapter': firstChapter,
+      'lastChapter': lastChapter,
+      'resumeBytes': resumeBytes,
+      'uri': uri,
+      'filePath': filePath,
+    });
+    if (jobId == null || jobId < 0) {
+      throw PlatformException(
+        code: 'DVD_ERROR',
+        message: 'Failed to start extraction',
+      );
+    }
+    try {
+      var cancelRequested = false;
+      while (true) {
+        final map = await _usbChannel.invokeMethod<Map<Object?, Object?>>(
+          'copyJobStatus',
+          {'jobId': jobId},
+        );
+        final status = UsbCopyJobStatus.fromMap(map ?? const {});
+        onProgress?.call(status.copied, status.total);
+        if (!status.isRunning) {
+          if (status.state == UsbCopyJobStatus.failed) {
+            throw PlatformException(
+              code: 'DVD_ERROR',
+              message: status.error ?? 'Extraction failed',
+            );
+          }
+          return status.state == UsbCopyJobStatus.done;
+        }
+        if (!cancelRequested && (isCancelled?.call() ?? false)) {
+          cancelRequested = true;
+          await _usbChannel.invokeMethod('cancelCopyJob', {'jobId': jobId});
+        }
+        await Future<void>.delayed(pollInterval);
+      }
+    } finally {
+      await _usbChannel.invokeMethod('releaseCopyJob', {'jobId': jobId});
+    }
   }
 
   /// Loads DVD for playback (passes dvdHandle to DvdPlayerPlugin).
@@ -89,6 +180,11 @@ class DvdService {
     await _dvdChannel.invokeMethod('seek', {'positionMs': positionMs});
   }
 
+  /// Jumps to the start of a 1-based chapter of the playing title.
+  Future<void> seekChapter(int chapter) async {
+    await _dvdChannel.invokeMethod('seekChapter', {'chapter': chapter});
+  }
+
   /// Stops playback.
   Future<void> stop() async {
     await _dvdChannel.invokeMethod('stop');
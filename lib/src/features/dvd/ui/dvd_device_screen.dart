@@ -131,6 +131,20 @@ class _DvdDeviceScreenState extends State<DvdDeviceScreen> {
                           leading: const Icon(Icons.disc_full),
                           title: Text(d.productName?.isNotEmpty == true ? d.productName! : 'DVD-Laufwerk'),
                           subtitle: Text(d.deviceId),
+                          trailing: IconButton(
+                            icon: const Icon(Icons.album),
+                            tooltip: 'Audio-CD',
+                            onPressed: () {
+                              Navigator.pushNamed(
+                                context,
+                                AppRouter.cdPlayer,
+                                arguments: {
+                                  'deviceId': deviceId,
+                                  'deviceName': d.productName?.isNotEmpty == true ? d.productName! : 'Audio-CD',
+                                },
+                              );
+                            },
+                          ),
                           onTap: () {
                             Navigator.pushNamed(
                               context,
@@ -1,5 +1,6 @@
 import 'package:flutter/material.dart';
 
+import '../../storage_media/data/usb_read_recovery.dart';
 import '../data/dvd_title.dart';
 import '../services/dvd_service.dart';
 
@@ -26,6 +27,9 @@ class _DvdPlayerScreenState extends State<DvdPlayerScreen> {
   String? _error;
   bool _playing = false;
   int? _selectedTitleId;
+  int? _extractingTitleId;
+  double _extractProgress = 0;
+  bool _extractCancelled = false;
 
   @override
   void initState() {
@@ -40,8 +44,11 @@ class _DvdPlayerScreenState extends State<DvdPlayerScreen> {
     });
     try {
       final handle = await _dvdService.openDvd(widget.deviceId);
-      final json = await _dvdService.listTitles(handle);
-      final titles = DvdTitle.fromJson(json);
+      final metadata = await _dvdService.getMetadata(handle);
+      final titles = DvdTitle.fromMetadata(metadata);
+      // The disc key and VMG were read strictly; from here on a scratch should
+      // cost a glitch in playback, not stop it.
+      await _dvdService.setReadRecovery(handle, UsbReadRecovery.tolerant);
       if (mounted) {
         setState(() {
           _dvdHandle = handle;
@@ -61,6 +68,7 @@ class _DvdPlayerScreenState extends State<DvdPlayerScreen> {
 
   @override
   void dispose() {
+    _extractCancelled = true;
     if (_dvdHandle != null) {
       _dvdService.closeDvd(_dvdHandle!);
     }
@@ -81,6 +89,42 @@ class _DvdPlayerScreenState extends State<DvdPlayerScreen> {
     }
   }
 
+  /// Saves the title's VOB data to a picked document; tapping again cancels.
+  Future<void> _extractTitle(DvdTitle title) async {
+    if (_dvdHandle == null) return;
+    if (_extractingTitleId != null) {
+      _extractCancelled = true;
+      return;
+    }
+    final messenger = ScaffoldMessenger.of(context);
+    try {
+      final name = 'VTS_TITLE_${title.titleNumber.toString().padLeft(2, '0')}.VOB';
+      final uri = await _dvdService.pickSaveLocation(name);
+      if (uri == null || !mounted) return;
+      setState(() {
+        _extractingTitleId = title.titleNumber;
+        _extractProgress = 0;
+        _extractCancelled = false;
+      });
+      final done = await _dvdService.extractTitle(
+        _dvdHandle!,
+        title.titleNumber,
+        uri: uri,
+        onProgress: (copied, total) {
+          if (mounted && total > 0) setState(() => _extractProgress = copied / total);
+        },
+        isCancelled: () => _extractCancelled,
+      );
+      messenger.showSnackBar(SnackBar(
+        content: Text(done ? 'Titel ${title.titleNumber} gesichert' : 'Sicherung abgebrochen'),
+      ));
+    } catch (e) {
+      messenger.showSnackBar(SnackBar(content: Text('Sicherung fehlgeschlagen: $e')));
+    } finally {
+      if (mounted) setState(() => _extractingTitleId = null);
+    }
+  }
+
   Future<void> _pause() async {
     await _dvdService.pause();
     setState(() => _playing = false);
@@ -99,6 +143,13 @@ class _DvdPlayerScreenState extends State<DvdPlayerScreen> {
     });
   }
 
+  static String _formatDuration(int ms) {
+    final d = Duration(milliseconds: ms);
+    final m = d.inMinutes.remainder(60).toString().padLeft(2, '0');
+    final s = d.inSeconds.remainder(60).toString().padLeft(2, '0');
+    return d.inHours > 0 ? '${d.inHours}:$m:$s' : '$m:$s';
+  }
+
   @override
   Widget build(BuildContext context) {
     return Scaffold(
@@ -133,10 +184,22 @@ class _DvdPlayerScreenState extends State<DvdPlayerScreen> {
                         itemCount: _titles.length,
                         itemBuilder: (context, i) {
                           final t = _titles[i];
+                          final extracting = _extractingTitleId == t.titleNumber;
                           return ListTile(
                             leading: const Icon(Icons.movie),
                             title: Text('Titel ${t.titleNumber}'),
-                            subtitle: Text('${t.chapterCount} Kapitel'),
+                            subtitle: extracting
+                                ? LinearProgressIndicator(value: _extractProgress)
+                                : Text(t.durationMs > 0
+                                    ? '${t.chapterCount} Kapitel · ${_formatDuration(t.durationMs)}'
+                                    : '${t.chapterCount} Kapitel'),
+                            trailing: IconButton(
+                              icon: Icon(extracting ? Icons.close : Icons.download),
+                              tooltip: extracting ? 'Sicherung abbrechen' : 'Titel sichern',
+                              onPressed: _extractingTitleId == null || extracting
+                                  ? () => _extractTitle(t)
+                                  : null,
+                            ),
                             onTap: () => _playTitle(t.titleNumber),
                           );
                         },
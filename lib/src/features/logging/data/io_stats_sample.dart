@@ -0,0 +1,138 @@
+import 'dart:convert';
+
+/// One snapshot of the native I/O counters of an open device, DVD or audio CD
+/// (NativeBridge.getIoStats / dvdGetIoStats / cdGetIoStats). Counters are
+/// totals since the device was opened; rates come from the difference of two
+/// samples.
+class IoStatsSample {
+  const IoStatsSample({
+    required this.source,
+    required this.timestamp,
+    required this.commands,
+    required this.bytesIn,
+    required this.failed,
+    required this.checkConditions,
+    required this.lastSense,
+    required this.retries,
+    required this.busyUs,
+    required this.latencyBaseUs,
+    required this.latency,
+    required this.cacheHits,
+    required this.cacheMisses,
+    this.readaheadStalls = 0,
+    this.readaheadStallUs = 0,
+    this.zeroFilled = 0,
+    this.jitterCorrections = 0,
+  });
+
+  /// "device:<deviceId>", "dvd:<handle>" or "cd:<handle>".
+  final String source;
+  final DateTime timestamp;
+
+  /// Commands issued, by opcode name (e.g. READ_10).
+  final Map<String, int> commands;
+  final int bytesIn;
+  final int failed;
+  final int checkConditions;
+
+  /// Sense key, ASC, ASCQ of the last Check Condition.
+  final List<int> lastSense;
+  final int retries;
+
+  /// Total time spent in commands.
+  final int busyUs;
+
+  /// latency[i] counts commands under latencyBaseUs << i.
+  final int latencyBaseUs;
+  final List<int> latency;
+  final int cacheHits;
+  final int cacheMisses;
+
+  /// Waits of read_stream on an empty prefetch ring (DVD only).
+  final int readaheadStalls;
+  final int readaheadStallUs;
+
+  /// Unreadable sectors returned as zeros by the read recovery policy.
+  final int zeroFilled;
+
+  /// Audio CD reads moved back into place by jitter correction.
+  final int jitterCorrections;
+
+  int get commandCount => commands.values.fold(0, (a, b) => a + b);
+
+  factory IoStatsSample.fromJson(String source, String json, {DateTime? timestamp}) {
+    final map = jsonDecode(json) as Map<String, dynamic>;
+    final cache = map['cache'] as Map<String, dynamic>? ?? const {};
+    final readahead = map['readahead'] as Map<String, dynamic>? ?? const {};
+    final recovery = map['recovery'] as Map<String, dynamic>? ?? const {};
+    final cdda = map['cdda'] as Map<String, dynamic>? ?? const {};
+    int n(Map<String, dynamic> m, String key) => (m[key] as num?)?.toInt() ?? 0;
+    return IoStatsSample(
+      source: source,
+      timestamp: timestamp ?? DateTime.now(),
+      commands: (map['commands'] as Map<String, dynamic>? ?? const {})
+          .map((k, v) => MapEntry(k, (v as num).toInt())),
+      bytesIn: n(map, 'bytesIn'),
+      failed: n(map, 'failed'),
+      checkConditions: n(map, 'checkConditions'),
+      lastSense: (map['lastSense'] as List<dynamic>? ?? const [])
+          .map((e) => (e as num).toInt())
+          .toList(),
+      retries: n(map, 'retries'),
+      busyUs: n(map, 'busyUs'),
+      latencyBaseUs: n(map, 'latencyUs'),
+      latency: (map['latency'] as List<dynamic>? ?? const [])
+          .map((e) => (e as num).toInt())
+          .toList(),
+      cacheHits: n(cache, 'hits'),
+      cacheMisses: n(cache, 'misses'),
+      readaheadStalls: n(readahead, 'stalls'),
+      readaheadStallUs: n(readahead, 'stallUs'),
+      zeroFilled: n(recovery, 'zeroFilled'),
+      jitterCorrections: n(cdda, 'corrections'),
+    );
+  }
+
+  /// Summary of the interval since [previous] (or since open without one):
+  /// throughput, command rate, mean latency and errors.
+  String describeSince(IoStatsSample? previous) {
+    final seconds = previous == null
+        ? null
+        : timestamp.difference(previous.timestamp).inMicroseconds / 1e6;
+    final commandsDelta = commandCount - (previous?.commandCount ?? 0);
+    final bytesDelta = bytesIn - (previous?.bytesIn ?? 0);
+    final busyDelta = busyUs - (previous?.busyUs ?? 0);
+    final parts = <String>[];
+    if (seconds != null && seconds > 0) {
+      parts.add('${(bytesDelta / seconds / (1024 * 1024)).toStringAsFixed(1)} MiB/s');
+      parts.add('${(commandsDelta / seconds).toStringAsFixed(0)} cmd/s');
+    } else {
+      parts.add('${(bytesIn / (1024 * 1024)).toStringAsFixed(1)} MiB in $commandCount cmds');
+    }
+    if (commandsDelta > 0) {
+      parts.add('avg ${(busyDelta / commandsDelta / 1000).toStringAsFixed(2)} ms');
+    }
+    final lookups = cacheHits + cacheMisses;
+    if (lookups > 0) {
+      parts.add('cache ${(cacheHits * 100 / lookups).toStringAsFixed(0)}%');
+    }
+    if (readaheadStalls > 0) {
+      parts.add('stalls $readaheadStalls (${readaheadStallUs ~/ 1000} ms)');
+    }
+    if (failed > 0 || retries > 0) {
+      final sense = lastSense.length == 3
+          ? ' sense ${lastSense[0]}/${_hex(lastSense[1])}/${_hex(lastSense[2])}'
+          : '';
+      parts.add('failed $failed, retries $retries$sense');
+    }
+    if (zeroFilled > 0) {
+      parts.add('$zeroFilled bad sectors skipped');
+    }
+    if (jitterCorrections > 0) {
+      parts.add('jitter $jitterCorrections');
+    }
+    return parts.join(' · ');
+  }
+
+  static String _hex(int v) => '0x${v.toRadixString(16).padLeft(2, '0')}';
+}
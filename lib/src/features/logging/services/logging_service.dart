@@ -2,6 +2,7 @@ import 'dart:async';
 
 import 'package:flutter/services.dart';
 
+import '../data/io_stats_sample.dart';
 import '../data/log_repository.dart';
 
 /// Central logging service. Writes to SQLite. Receives logs from Dart, Kotlin, Rust.
@@ -14,6 +15,12 @@ class LoggingService {
 
   bool _initialized = false;
 
+  final _ioStats = StreamController<IoStatsSample>.broadcast();
+
+  /// Native I/O counters while [startIoStats] is active, one sample per open
+  /// device or DVD per interval. Not written to the log database.
+  Stream<IoStatsSample> get ioStats => _ioStats.stream;
+
   /// Initialize: set up Kotlin log receiver.
   void init() {
     if (_initialized) return;
@@ -22,6 +29,17 @@ class LoggingService {
   }
 
   Future<dynamic> _handleLogFromKotlin(MethodCall call) async {
+    if (call.method == 'ioStats') {
+      final args = call.arguments as Map<Object?, Object?>?;
+      final source = args?['source'] as String?;
+      final json = args?['json'] as String?;
+      if (source != null && json != null) {
+        try {
+          _ioStats.add(IoStatsSample.fromJson(source, json));
+        } catch (_) {}
+      }
+      return null;
+    }
     if (call.method == 'log') {
       final args = call.arguments as Map<Object?, Object?>?;
       if (args != null) {
@@ -87,6 +105,25 @@ class LoggingService {
     await LogRepository.instance.clear();
   }
 
+  /// Starts streaming native I/O counters to [ioStats] every [interval].
+  Future<bool> startIoStats({Duration interval = const Duration(seconds: 1)}) async {
+    try {
+      final ok = await _logChannel.invokeMethod<bool>(
+        'startIoStats',
+        {'intervalMs': interval.inMilliseconds},
+      );
+      return ok ?? false;
+    } catch (_) {
+      return false;
+    }
+  }
+
+  Future<void> stopIoStats() async {
+    try {
+      await _logChannel.invokeMethod<void>('stopIoStats');
+    } catch (_) {}
+  }
+
   /// Request SAF export: Kotlin opens document picker, writes content, returns success.
   Future<bool> exportToFile() async {
     try {
@@ -1,6 +1,9 @@
+import 'dart:async';
+
 import 'package:flutter/material.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 
+import '../data/io_stats_sample.dart';
 import '../data/log_entry.dart';
 import '../services/logging_service.dart';
 import '../domain/export_logs_use_case.dart';
@@ -29,12 +32,54 @@ class _LoggingScreenState extends ConsumerState<LoggingScreen> {
   bool _loading = true;
   String? _error;
 
+  /// Live I/O counters: latest and previous sample per source.
+  StreamSubscription<IoStatsSample>? _ioStatsSub;
+  final Map<String, IoStatsSample> _ioLatest = {};
+  final Map<String, IoStatsSample> _ioPrevious = {};
+
   @override
   void initState() {
     super.initState();
     _loadLogs();
   }
 
+  @override
+  void dispose() {
+    if (_ioStatsSub != null) {
+      _ioStatsSub!.cancel();
+      LoggingService.instance.stopIoStats();
+    }
+    super.dispose();
+  }
+
+  Future<void> _toggleIoStats() async {
+    final service = LoggingService.instance;
+    if (_ioStatsSub != null) {
+      await _ioStatsSub!.cancel();
+      await service.stopIoStats();
+      setState(() {
+        _ioStatsSub = null;
+        _ioLatest.clear();
+        _ioPrevious.clear();
+      });
+      return;
+    }
+    final sub = service.ioStats.listen((sample) {
+      setState(() {
+        final last = _ioLatest[sample.source];
+        if (last != null) _ioPrevious[sample.source] = last;
+        _ioLatest[sample.source] = sample;
+      });
+    });
+    setState(() => _ioStatsSub = sub);
+    final ok = await service.startIoStats();
+    if (!ok && mounted) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        const SnackBar(content: Text('I/O stats not available')),
+      );
+    }
+  }
+
   Future<void> _loadLogs() async {
     setState(() {
       _loading = true;
@@ -98,6 +143,11 @@ class _LoggingScreenState extends ConsumerState<LoggingScreen> {
       appBar: AppBar(
         title: const Text('Logs'),
         actions: [
+          IconButton(
+            icon: Icon(_ioStatsSub != null ? Icons.speed : Icons.speed_outlined),
+            tooltip: 'Live I/O stats',
+            onPressed: _toggleIoStats,
+          ),
           IconButton(
             icon: const Icon(Icons.refresh),
             onPressed: _loading ? null : _loadLogs,
@@ -112,7 +162,37 @@ class _LoggingScreenState extends ConsumerState<LoggingScreen> {
           ),
         ],
       ),
-      body: _buildBody(),
+      body: Column(
+        children: [
+          if (_ioStatsSub != null) _buildIoStats(),
+          Expanded(child: _buildBody()),
+        ],
+      ),
+    );
+  }
+
+  Widget _buildIoStats() {
+    final theme = Theme.of(context);
+    return Material(
+      color: theme.colorScheme.surfaceContainerHighest,
+      child: Padding(
+        padding: const EdgeInsets.symmetric(horizontal: 16, vertical: 8),
+        child: Column(
+          crossAxisAlignment: CrossAxisAlignment.start,
+          children: _ioLatest.isEmpty
+              ? [Text('No open device', style: theme.textTheme.bodySmall)]
+              : [
+                  for (final sample in _ioLatest.values)
+                    Padding(
+                      padding: const EdgeInsets.symmetric(vertical: 2),
+                      child: Text(
+                        '${sample.source}  ${sample.describeSince(_ioPrevious[sample.source])}',
+                        style: theme.textTheme.bodySmall,
+                      ),
+                    ),
+                ],
+        ),
+      ),
     );
   }
 
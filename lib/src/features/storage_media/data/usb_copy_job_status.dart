@@ -0,0 +1,30 @@
+/// Progress of a native copy job started with `copyFileToFd`.
+class UsbCopyJobStatus {
+  const UsbCopyJobStatus({
+    required this.state,
+    required this.copied,
+    required this.total,
+    this.error,
+  });
+
+  static const int running = 0;
+  static const int done = 1;
+  static const int failed = 2;
+  static const int cancelled = 3;
+
+  final int state;
+  final int copied;
+  final int total;
+  final String? error;
+
+  bool get isRunning => state == running;
+
+  factory UsbCopyJobStatus.fromMap(Map<Object?, Object?> map) {
+    return UsbCopyJobStatus(
+      state: (map['state'] as num?)?.toInt() ?? failed,
+      copied: (map['copied'] as num?)?.toInt() ?? 0,
+      total: (map['total'] as num?)?.toInt() ?? 0,
+      error: map['error'] as String?,
+    );
+  }
+}
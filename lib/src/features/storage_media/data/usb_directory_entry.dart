@@ -25,28 +25,40 @@ class UsbDirectoryEntry {
     try {
       final decoded = jsonDecode(jsonStr) as List<dynamic>?;
       if (decoded == null) return [];
-      return decoded
-          .map((e) => UsbDirectoryEntry.fromJson(Map<String, dynamic>.from(e as Map)))
-          .where((entry) {
-            final name = entry.name;
-            if (name.isEmpty) {
-              return false;
-            }
-            // Hide NTFS metadata files and common system folders from the UI.
-            final lower = name.toLowerCase();
-            if (name.startsWith(r'$')) {
-              return false;
-            }
-            if (lower == 'system volume information' ||
-                lower == r'$recycle.bin' ||
-                lower == 'recycler') {
-              return false;
-            }
-            return true;
-          })
-          .toList();
+      return fromDecodedList(decoded);
     } catch (_) {
       return [];
     }
   }
+
+  /// Entries from an already decoded JSON array, without hidden system entries.
+  static List<UsbDirectoryEntry> fromDecodedList(List<dynamic> decoded) {
+    try {
+      return visible(decoded
+          .map((e) => UsbDirectoryEntry.fromJson(Map<String, dynamic>.from(e as Map))));
+    } catch (_) {
+      return [];
+    }
+  }
+
+  /// [entries] without hidden system entries.
+  static List<UsbDirectoryEntry> visible(Iterable<UsbDirectoryEntry> entries) {
+    return entries.where((entry) {
+      final name = entry.name;
+      if (name.isEmpty) {
+        return false;
+      }
+      // Hide NTFS metadata files and common system folders from the UI.
+      final lower = name.toLowerCase();
+      if (name.startsWith(r'$')) {
+        return false;
+      }
+      if (lower == 'system volume information' ||
+          lower == r'$recycle.bin' ||
+          lower == 'recycler') {
+        return false;
+      }
+      return true;
+    }).toList();
+  }
 }
@@ -0,0 +1,45 @@
+import 'dart:convert';
+
+/// A partition of a USB disk, from its MBR or GPT.
+class UsbPartition {
+  const UsbPartition({
+    required this.index,
+    required this.startLba,
+    required this.size,
+    required this.mbrType,
+    required this.isNtfs,
+  });
+
+  /// Pass to openVolume to mount this partition.
+  final int index;
+  final int startLba;
+  final int size;
+
+  /// MBR type byte (7 for NTFS and GPT basic data), 0 if unknown.
+  final int mbrType;
+
+  /// Boot sector identifies an NTFS volume.
+  final bool isNtfs;
+
+  factory UsbPartition.fromJson(Map<String, dynamic> json) {
+    return UsbPartition(
+      index: (json['i'] as num?)?.toInt() ?? 0,
+      startLba: (json['start'] as num?)?.toInt() ?? 0,
+      size: (json['size'] as num?)?.toInt() ?? 0,
+      mbrType: (json['t'] as num?)?.toInt() ?? 0,
+      isNtfs: json['ntfs'] as bool? ?? false,
+    );
+  }
+
+  static List<UsbPartition> fromJsonList(String jsonStr) {
+    if (jsonStr.isEmpty || jsonStr == '[]') return [];
+    try {
+      final decoded = jsonDecode(jsonStr) as List<dynamic>;
+      return decoded
+          .map((e) => UsbPartition.fromJson(Map<String, dynamic>.from(e as Map)))
+          .toList();
+    } catch (_) {
+      return [];
+    }
+  }
+}
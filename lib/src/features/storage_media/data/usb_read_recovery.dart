@@ -0,0 +1,54 @@
+import 'dart:convert';
+
+/// How native reads on a USB device react to unreadable sectors
+/// (UsbPlugin `setRecoveryPolicy`).
+class UsbReadRecovery {
+  const UsbReadRecovery({
+    this.retries = 0,
+    this.splitReads = false,
+    this.skipBadSectors = false,
+  });
+
+  /// Fail a read on the first error (the default).
+  static const strict = UsbReadRecovery();
+
+  /// Retry, narrow failed reads down to the bad sectors and return zeros for
+  /// those. For playback, where a short glitch beats stopping.
+  static const tolerant = UsbReadRecovery(
+    retries: 2,
+    splitReads: true,
+    skipBadSectors: true,
+  );
+
+  /// Retries of a failed read, with backoff (at most 8).
+  final int retries;
+
+  /// Bisect a read that hit a medium error to find the bad sectors.
+  final bool splitReads;
+
+  /// Zero-fill sectors that stay unreadable instead of failing the read.
+  final bool skipBadSectors;
+
+  Map<String, Object> toArguments() => {
+        'retries': retries,
+        'splitReads': splitReads,
+        'skipBadSectors': skipBadSectors,
+      };
+}
+
+/// A run of sectors that were zero-filled because they could not be read.
+class UsbBadSectorRange {
+  const UsbBadSectorRange(this.lba, this.count);
+
+  final int lba;
+  final int count;
+
+  /// Parses the JSON array of [lba, count] pairs from `getBadSectors`.
+  static List<UsbBadSectorRange> fromJsonList(String json) {
+    final list = jsonDecode(json) as List<dynamic>;
+    return list.map((e) {
+      final pair = e as List<dynamic>;
+      return UsbBadSectorRange((pair[0] as num).toInt(), (pair[1] as num).toInt());
+    }).toList();
+  }
+}
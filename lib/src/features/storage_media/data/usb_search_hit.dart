@@ -0,0 +1,38 @@
+import 'dart:convert';
+
+/// A file or directory found by a whole-volume search.
+class UsbSearchHit {
+  const UsbSearchHit({
+    required this.path,
+    required this.isDirectory,
+    required this.size,
+  });
+
+  /// Path from the volume root, '/'-separated.
+  final String path;
+  final bool isDirectory;
+  final int size;
+
+  String get name => path.split('/').last;
+
+  factory UsbSearchHit.fromJson(Map<String, dynamic> json) {
+    return UsbSearchHit(
+      path: json['p'] as String? ?? '',
+      isDirectory: json['d'] as bool? ?? false,
+      size: (json['s'] as num?)?.toInt() ?? 0,
+    );
+  }
+
+  static List<UsbSearchHit> fromJsonList(String jsonStr) {
+    if (jsonStr.isEmpty || jsonStr == '[]') return [];
+    try {
+      final decoded = jsonDecode(jsonStr) as List<dynamic>;
+      return decoded
+          .map((e) => UsbSearchHit.fromJson(Map<String, dynamic>.from(e as Map)))
+          .where((hit) => hit.path.isNotEmpty)
+          .toList();
+    } catch (_) {
+      return [];
+    }
+  }
+}
@@ -1,30 +1,36 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 
 import '../../logging/services/logging_service.dart';
+import 'usb_copy_job_status.dart';
 import 'usb_directory_entry.dart';
+import 'usb_partition.dart';
+import 'usb_read_recovery.dart';
+import 'usb_search_hit.dart';
 import '../services/usb_bridge.dart';
+import '../services/usb_ffi.dart';
 import '../services/usb_volume_service.dart';
 
 /// Repository for NTFS volume operations on USB devices.
 /// Handles permission, open/close, directory listing, file reading.
+/// Listings and reads go over [UsbFfi] when it is available, everything else
+/// (and those too, without it) over the MethodChannel.
 class UsbVolumeRepository {
-  UsbVolumeRepository(this._bridge, this._volumeService);
+  UsbVolumeRepository(this._bridge, this._volumeService, [this._ffi]);
 
   final UsbBridge _bridge;
   final UsbVolumeService _volumeService;
+  final UsbFfi? _ffi;
 
-  /// Ensures permission and opens the NTFS volume on the device.
-  Future<int> openVolume(String deviceId) async {
+  /// Ensures permission and opens the NTFS volume on the device: partition
+  /// [partition] from [listPartitions], or the first NTFS one by default.
+  Future<int> openVolume(String deviceId, {int partition = -1}) async {
     LoggingService.instance.v('UsbVolumeRepository', 'openVolume: $deviceId');
-    final hasPermission = await _bridge.hasPermission(deviceId);
-    if (!hasPermission) {
-      final granted = await _bridge.requestPermission(deviceId);
-      if (!granted) {
-        throw UsbVolumeRepositoryException('USB permission denied');
-      }
-    }
+    await _ensurePermission(deviceId);
     try {
-      return await _volumeService.openVolume(deviceId);
+      return await _volumeService.openVolume(deviceId, partition: partition);
     } on PlatformException catch (e) {
       final msg = e.message ?? 'Failed to open volume';
       LoggingService.instance.e('UsbVolumeRepository', 'openVolume: $msg');
@@ -37,6 +43,30 @@ class UsbVolumeRepository {
     }
   }
 
+  /// Partitions of the device; the partition table is read once per session.
+  Future<List<UsbPartition>> listPartitions(String deviceId) async {
+    await _ensurePermission(deviceId);
+    try {
+      return UsbPartition.fromJsonList(await _volumeService.listPartitions(deviceId));
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'listPartitions: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to read partitions',
+        cause: e,
+      );
+    }
+  }
+
+  Future<void> _ensurePermission(String deviceId) async {
+    final hasPermission = await _bridge.hasPermission(deviceId);
+    if (!hasPermission) {
+      final granted = await _bridge.requestPermission(deviceId);
+      if (!granted) {
+        throw UsbVolumeRepositoryException('USB permission denied');
+      }
+    }
+  }
+
   /// Closes the volume.
   Future<void> closeVolume(int volumeId) async {
     await _volumeService.closeVolume(volumeId);
@@ -45,6 +75,10 @@ class UsbVolumeRepository {
   /// Lists directory entries at the given path.
   Future<List<UsbDirectoryEntry>> listDirectory(int volumeId, {String path = ''}) async {
     try {
+      final ffi = _ffi;
+      if (ffi != null) {
+        return UsbDirectoryEntry.visible(await ffi.listDirectory(volumeId, path: path));
+      }
       final json = await _volumeService.listDirectory(volumeId, path: path);
       return UsbDirectoryEntry.fromJsonList(json);
     } on PlatformException catch (e) {
@@ -56,6 +90,57 @@ class UsbVolumeRepository {
     }
   }
 
+  /// Lists a directory page by page, so the first entries can be shown before
+  /// the whole directory has been transferred.
+  Stream<List<UsbDirectoryEntry>> listDirectoryPages(
+    int volumeId, {
+    String path = '',
+    int pageSize = 500,
+  }) async* {
+    final ffi = _ffi;
+    final int cursor;
+    try {
+      cursor = ffi != null
+          ? await ffi.openDirCursor(volumeId, path: path)
+          : await _volumeService.openDirCursor(volumeId, path: path);
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'listDirectoryPages: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to list directory',
+        cause: e,
+      );
+    }
+    try {
+      if (ffi != null) {
+        while (true) {
+          final (page, more) = await ffi.readDirPage(volumeId, cursor, maxEntries: pageSize);
+          yield UsbDirectoryEntry.visible(page);
+          if (!more) break;
+        }
+      } else {
+        while (true) {
+          final json = await _volumeService.readDirPage(volumeId, cursor, maxEntries: pageSize);
+          final raw = jsonDecode(json) as List<dynamic>;
+          yield UsbDirectoryEntry.fromDecodedList(raw);
+          // Count before filtering: hidden entries still fill the page.
+          if (raw.length < pageSize) break;
+        }
+      }
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'listDirectoryPages: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to list directory',
+        cause: e,
+      );
+    } finally {
+      if (ffi != null) {
+        await ffi.closeDirCursor(volumeId, cursor);
+      } else {
+        await _volumeService.closeDirCursor(volumeId, cursor);
+      }
+    }
+  }
+
   /// Reads file content.
   Future<List<int>> readFile(
     int volumeId,
@@ -64,6 +149,10 @@ class UsbVolumeRepository {
     int length = 65536,
   }) async {
     try {
+      final ffi = _ffi;
+      if (ffi != null) {
+        return await ffi.readFile(volumeId, path, offset: offset, length: length);
+      }
       return await _volumeService.readFile(
         volumeId,
         path,
@@ -78,6 +167,190 @@ class UsbVolumeRepository {
       );
     }
   }
+
+  /// Opens a file for chunked reads. Close it with [closeFile].
+  Future<int> openFile(int volumeId, String path) async {
+    try {
+      final ffi = _ffi;
+      if (ffi != null) {
+        final (handle, _) = await ffi.openFile(volumeId, path);
+        return handle;
+      }
+      return await _volumeService.openFile(volumeId, path);
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'openFile: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to open file',
+        cause: e,
+      );
+    }
+  }
+
+  /// Reads a chunk of a file opened with [openFile].
+  Future<Uint8List> readFileHandle(
+    int volumeId,
+    int fileHandle, {
+    required int offset,
+    int length = 65536,
+  }) async {
+    try {
+      final ffi = _ffi;
+      if (ffi != null) {
+        return await ffi.readFileHandle(volumeId, fileHandle, offset: offset, length: length);
+      }
+      return await _volumeService.readFileHandle(
+        volumeId,
+        fileHandle,
+        offset: offset,
+        length: length,
+      );
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'readFileHandle: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to read file',
+        cause: e,
+      );
+    }
+  }
+
+  /// Releases a file handle.
+  Future<void> closeFile(int volumeId, int fileHandle) async {
+    try {
+      final ffi = _ffi;
+      if (ffi != null) {
+        await ffi.closeFile(volumeId, fileHandle);
+      } else {
+        await _volumeService.closeFile(volumeId, fileHandle);
+      }
+    } on PlatformException catch (e) {
+      LoggingService.instance.w('UsbVolumeRepository', 'closeFile: ${e.message}');
+    }
+  }
+
+  /// Starts the background index used by [search].
+  Future<void> startIndex(int volumeId, {bool rebuild = false}) async {
+    try {
+      await _volumeService.startMftIndex(volumeId, rebuild: rebuild);
+    } on PlatformException catch (e) {
+      LoggingService.instance.w('UsbVolumeRepository', 'startIndex: ${e.message}');
+    }
+  }
+
+  /// Whether [search] can run yet.
+  Future<bool> isIndexReady(int volumeId) async {
+    try {
+      final status = await _volumeService.mftIndexStatus(volumeId);
+      return (status['state'] as num?)?.toInt() == 2;
+    } on PlatformException catch (e) {
+      LoggingService.instance.w('UsbVolumeRepository', 'isIndexReady: ${e.message}');
+      return false;
+    }
+  }
+
+  /// Files and directories anywhere on the volume whose name contains
+  /// [query] (or starts with it, if [prefix]).
+  Future<List<UsbSearchHit>> search(
+    int volumeId,
+    String query, {
+    bool prefix = false,
+    int limit = 200,
+  }) async {
+    try {
+      final json = await _volumeService.searchVolume(
+        volumeId,
+        query,
+        prefix: prefix,
+        limit: limit,
+      );
+      return UsbSearchHit.fromJsonList(json);
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'search: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Search failed',
+        cause: e,
+      );
+    }
+  }
+
+  /// Sets how reads on the volume's device handle unreadable sectors.
+  /// With [UsbReadRecovery.skipBadSectors], copies complete with zeros in
+  /// place of bad sectors; check [badSectors] afterwards.
+  Future<void> setReadRecovery(int volumeId, UsbReadRecovery recovery) async {
+    try {
+      await _volumeService.setRecoveryPolicy(
+        volumeId,
+        retries: recovery.retries,
+        splitReads: recovery.splitReads,
+        skipBadSectors: recovery.skipBadSectors,
+      );
+    } on PlatformException catch (e) {
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to set read recovery',
+        cause: e,
+      );
+    }
+  }
+
+  /// Sectors of the volume's device zero-filled so far (device LBAs).
+  Future<List<UsbBadSectorRange>> badSectors(int volumeId) async {
+    try {
+      return UsbBadSectorRange.fromJsonList(await _volumeService.getBadSectors(volumeId));
+    } on PlatformException catch (e) {
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to read bad sectors',
+        cause: e,
+      );
+    }
+  }
+
+  /// Copies [path] into a content [uri] or local [filePath] natively, polling
+  /// progress every [pollInterval]. Returns false if [isCancelled] stopped it.
+  Future<bool> copyFile(
+    int volumeId,
+    String path, {
+    String? uri,
+    String? filePath,
+    void Function(int copied, int total)? onProgress,
+    bool Function()? isCancelled,
+    Duration pollInterval = const Duration(milliseconds: 200),
+  }) async {
+    try {
+      final jobId = await _volumeService.copyFileToFd(
+        volumeId,
+        path,
+        uri: uri,
+        filePath: filePath,
+      );
+      try {
+        var cancelRequested = false;
+        while (true) {
+          final status = UsbCopyJobStatus.fromMap(
+            await _volumeService.copyJobStatus(jobId),
+          );
+          onProgress?.call(status.copied, status.total);
+          if (!status.isRunning) {
+            if (status.state == UsbCopyJobStatus.failed) {
+              throw UsbVolumeRepositoryException(status.error ?? 'Copy failed');
+            }
+            return status.state == UsbCopyJobStatus.done;
+          }
+          if (!cancelRequested && (isCancelled?.call() ?? false)) {
+            cancelRequested = true;
+            await _volumeService.cancelCopyJob(jobId);
+          }
+          await Future<void>.delayed(pollInterval);
+        }
+      } finally {
+        await _volumeService.releaseCopyJob(jobId);
+      }
+    } on PlatformException catch (e) {
+      LoggingService.instance.e('UsbVolumeRepository', 'copyFile: ${e.message}');
+      throw UsbVolumeRepositoryException(
+        e.message ?? 'Failed to copy file',
+        cause: e,
+      );
+    }
+  }
 }
 
 class UsbVolumeRepositoryException implements Exception {
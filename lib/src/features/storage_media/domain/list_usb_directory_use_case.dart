@@ -9,4 +9,8 @@ class ListUsbDirectoryUseCase {
 
   Future<List<UsbDirectoryEntry>> call(int volumeId, {String path = ''}) =>
       _repository.listDirectory(volumeId, path: path);
+
+  /// Same entries in pages, for showing a large directory while it loads.
+  Stream<List<UsbDirectoryEntry>> pages(int volumeId, {String path = ''}) =>
+      _repository.listDirectoryPages(volumeId, path: path);
 }
@@ -10,8 +10,6 @@ import '../data/usb_volume_repository.dart';
 /// Max size to read for "open in other app" / "save to device" (100 MB).
 const int _kMaxFileSize = 100 * 1024 * 1024;
 
-const int _kChunkSize = 256 * 1024;
-
 /// MIME types by file extension (common types).
 const Map<String, String> _mimeTypes = {
   'txt': 'text/plain',
@@ -67,29 +65,33 @@ class FileOpenSaveService {
     return file.delete().catchError((_) => file);
   }
 
-  /// Reads file from USB into a temp file, then opens SAF "save as" and copies there.
+  /// Opens SAF "save as", then copies the file from USB straight into the
+  /// picked document on a native worker thread.
   /// Returns true if user picked a location and copy succeeded.
   Future<bool> saveToDevice({
     required int volumeId,
     required String path,
     required String fileName,
+    void Function(int copied, int total)? onProgress,
+    bool Function()? isCancelled,
   }) async {
-    final tempPath = await _readToTempFile(volumeId, path, fileName);
-    if (tempPath == null) return false;
     try {
-      final result = await _channel.invokeMethod<bool>(
-        'saveFileToDevice',
-        {'tempPath': tempPath, 'suggestedName': fileName},
+      final uri = await _channel.invokeMethod<String>(
+        'pickSaveLocation',
+        {'suggestedName': fileName},
+      );
+      if (uri == null) return false;
+      return await _repository.copyFile(
+        volumeId,
+        path,
+        uri: uri,
+        onProgress: onProgress,
+        isCancelled: isCancelled,
       );
-      return result ?? false;
     } catch (e) {
       LoggingService.instance.e('FileOpenSaveService', 'saveToDevice: $e');
       return false;
     }
-    // Kotlin deletes temp file after successful copy; if user cancelled, we delete here
-    finally {
-      await _deleteSafe(File(tempPath));
-    }
   }
 
   /// Returns temp file path or null on error. Caller should delete the file when done.
@@ -99,25 +101,20 @@ class FileOpenSaveService {
     if (safeName.isEmpty) return null;
     final file = File(p.join(dir.path, 'usb_$safeName'));
     try {
-      int offset = 0;
-      int totalRead = 0;
-      final sink = file.openWrite();
-      try {
-        while (totalRead < _kMaxFileSize) {
-          final chunk = await _repository.readFile(
-            volumeId,
-            path,
-            offset: offset,
-            length: _kChunkSize,
-          );
-          if (chunk.isEmpty) break;
-          sink.add(chunk);
-          totalRead += chunk.length;
-          offset += chunk.length;
-          if (chunk.length < _kChunkSize) break;
+      var tooLarge = false;
+      final ok = await _repository.copyFile(
+        volumeId,
+        path,
+        filePath: file.path,
+        onProgress: (_, total) => tooLarge = total > _kMaxFileSize,
+        isCancelled: () => tooLarge,
+      );
+      if (!ok) {
+        if (tooLarge) {
+          LoggingService.instance.w('FileOpenSaveService', '_readToTempFile: file exceeds limit');
         }
-      } finally {
-        await sink.close();
+        await _deleteSafe(file);
+        return null;
       }
       return file.path;
     } catch (e) {
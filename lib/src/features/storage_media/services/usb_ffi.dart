@@ -0,0 +1,319 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/services.dart';
+
+import '../../logging/services/logging_service.dart';
+import '../data/usb_directory_entry.dart';
+
+const String _kLibrary = 'libconnectias_rust.so';
+
+/// Directory listings, file reads and DVD metadata straight from the Rust
+/// library over dart:ffi (rust/src/c_api.rs), skipping the MethodChannel,
+/// Kotlin and JNI hops and the JSON/boxed list marshalling. Handles are the
+/// ones from the channel calls (openVolume, openDvd); Kotlin still opens the
+/// sessions and does the bulk transfers.
+///
+/// Calls block on USB I/O, so they run one at a time on a background isolate
+/// that reads into its own native buffer. Errors are thrown as
+/// [PlatformException], like the channel methods they replace.
+class UsbFfi {
+  UsbFfi._();
+
+  /// Null where the library or its C ABI is missing (not on Android, or an
+  /// older build); callers then use the MethodChannel.
+  static final UsbFfi? instance = _open();
+
+  static UsbFfi? _open() {
+    if (!Platform.isAndroid) return null;
+    try {
+      final lib = DynamicLibrary.open(_kLibrary);
+      if (!lib.providesSymbol('connectias_read_dir_page')) return null;
+      return UsbFfi._();
+    } catch (e) {
+      LoggingService.instance.w('UsbFfi', 'FFI unavailable: $e');
+      return null;
+    }
+  }
+
+  Future<SendPort>? _worker;
+
+  Future<SendPort> _spawn() async {
+    final ready = ReceivePort();
+    await Isolate.spawn(_workerMain, ready.sendPort, debugName: 'usb-ffi');
+    return await ready.first as SendPort;
+  }
+
+  /// Runs [task] on the worker isolate with the native bindings. Tasks are
+  /// sent as closures, so they are built in non-async methods and capture
+  /// only the call's arguments.
+  Future<R> _run<R>(R Function(_NativeApi api) task, {String code = 'VOLUME_ERROR'}) async {
+    final worker = await (_worker ??= _spawn());
+    final reply = ReceivePort();
+    worker.send((task, reply.sendPort));
+    final (result, error) = await reply.first as (Object?, String?);
+    reply.close();
+    if (error != null) {
+      throw PlatformException(code: code, message: error);
+    }
+    return result as R;
+  }
+
+  /// Opens a paged listing for [readDirPage]. Returns the cursor ID.
+  Future<int> openDirCursor(int volumeId, {String path = ''}) {
+    return _run((api) => api.openDirCursor(volumeId, path));
+  }
+
+  /// Next page of up to [maxEntries] entries, unfiltered, and whether the
+  /// cursor has more.
+  Future<(List<UsbDirectoryEntry>, bool)> readDirPage(
+    int volumeId,
+    int cursorId, {
+    int maxEntries = 500,
+  }) {
+    return _run((api) => api.readDirPage(volumeId, cursorId, maxEntries));
+  }
+
+  Future<void> closeDirCursor(int volumeId, int cursorId) {
+    return _run((api) => api.closeDirCursor(volumeId, cursorId));
+  }
+
+  /// All entries of a directory, unfiltered, in one round trip.
+  Future<List<UsbDirectoryEntry>> listDirectory(int volumeId, {String path = ''}) {
+    return _run((api) {
+      final cursor = api.openDirCursor(volumeId, path);
+      try {
+        final entries = <UsbDirectoryEntry>[];
+        while (true) {
+          final (page, more) = api.readDirPage(volumeId, cursor, 1 << 16);
+          entries.addAll(page);
+          if (!more) return entries;
+        }
+      } finally {
+        api.closeDirCursor(volumeId, cursor);
+      }
+    });
+  }
+
+  /// Reads up to [length] bytes at [offset] of the file at [path].
+  Future<Uint8List> readFile(int volumeId, String path, {int offset = 0, int length = 65536}) {
+    return _run((api) => api.readFile(volumeId, path, offset, length)).then(_bytes);
+  }
+
+  /// Opens a file for [readFileHandle]. Returns the handle and file size.
+  Future<(int, int)> openFile(int volumeId, String path) {
+    return _run((api) => api.openFile(volumeId, path));
+  }
+
+  /// Reads up to [length] bytes at [offset] of an open file; fewer at the end.
+  Future<Uint8List> readFileHandle(
+    int volumeId,
+    int fileHandle, {
+    required int offset,
+    int length = 65536,
+  }) {
+    return _run((api) => api.readFileHandle(volumeId, fileHandle, offset, length)).then(_bytes);
+  }
+
+  Future<void> closeFile(int volumeId, int fileHandle) {
+    return _run((api) => api.closeFile(volumeId, fileHandle));
+  }
+
+  /// Packed DVD title/chapter metadata (parse with DvdTitle.fromMetadata).
+  /// Null if the library was built without DVD support.
+  Future<Uint8List?> dvdMetadata(int dvdHandle) {
+    return _run((api) => api.dvdMetadata(dvdHandle), code: 'DVD_ERROR')
+        .then((data) => data == null ? null : _bytes(data));
+  }
+
+  static Uint8List _bytes(TransferableTypedData data) => data.materialize().asUint8List();
+}
+
+void _workerMain(SendPort ready) {
+  final api = _NativeApi(DynamicLibrary.open(_kLibrary));
+  final requests = ReceivePort();
+  ready.send(requests.sendPort);
+  requests.listen((message) {
+    final (task, reply) = message as (Object? Function(_NativeApi), SendPort);
+    try {
+      reply.send((task(api), null));
+    } on _NativeError catch (e) {
+      reply.send((null, e.message));
+    } catch (e) {
+      reply.send((null, e.toString()));
+    }
+  });
+}
+
+class _NativeError implements Exception {
+  _NativeError(this.message);
+
+  final String message;
+}
+
+final class _DirPage extends Struct {
+  @Uint32()
+  external int entries;
+
+  @Uint32()
+  external int bytes;
+
+  @Uint32()
+  external int more;
+}
+
+typedef _LastErrorC = Int32 Function(Pointer<Uint8>, Size);
+typedef _LastError = int Function(Pointer<Uint8>, int);
+typedef _PathCallC = Int64 Function(Uint64, Pointer<Uint8>, Size);
+typedef _PathCall = int Function(int, Pointer<Uint8>, int);
+typedef _ReadDirPageC = Int32 Function(Uint64, Uint64, Uint32, Pointer<Uint8>, Size, Pointer<_DirPage>);
+typedef _ReadDirPage = int Function(int, int, int, Pointer<Uint8>, int, Pointer<_DirPage>);
+typedef _CloseC = Int32 Function(Uint64, Uint64);
+typedef _Close = int Function(int, int);
+typedef _OpenFileC = Int64 Function(Uint64, Pointer<Uint8>, Size, Pointer<Uint64>);
+typedef _OpenFile = int Function(int, Pointer<Uint8>, int, Pointer<Uint64>);
+typedef _ReadFileHandleC = Int64 Function(Uint64, Uint64, Uint64, Pointer<Uint8>, Size);
+typedef _ReadFileHandle = int Function(int, int, int, Pointer<Uint8>, int);
+typedef _ReadFileC = Int64 Function(Uint64, Pointer<Uint8>, Size, Uint64, Pointer<Uint8>, Size);
+typedef _ReadFile = int Function(int, Pointer<Uint8>, int, int, Pointer<Uint8>, int);
+typedef _MetadataSizeC = Int64 Function(Uint64);
+typedef _MetadataSize = int Function(int);
+typedef _ReadMetadataC = Int64 Function(Uint64, Pointer<Uint8>, Size);
+typedef _ReadMetadata = int Function(int, Pointer<Uint8>, int);
+
+/// Bindings and buffers of the worker isolate.
+class _NativeApi {
+  _NativeApi(DynamicLibrary lib)
+      : _lastError = lib.lookupFunction<_LastErrorC, _LastError>('connectias_last_error'),
+        _openDirCursor = lib.lookupFunction<_PathCallC, _PathCall>('connectias_open_dir_cursor'),
+        _readDirPage = lib.lookupFunction<_ReadDirPageC, _ReadDirPage>('connectias_read_dir_page'),
+        _closeDirCursor = lib.lookupFunction<_CloseC, _Close>('connectias_close_dir_cursor'),
+        _openFile = lib.lookupFunction<_OpenFileC, _OpenFile>('connectias_open_file'),
+        _readFileHandle =
+            lib.lookupFunction<_ReadFileHandleC, _ReadFileHandle>('connectias_read_file_handle'),
+        _readFile = lib.lookupFunction<_ReadFileC, _ReadFile>('connectias_read_file'),
+        _closeFile = lib.lookupFunction<_CloseC, _Close>('connectias_close_file'),
+        _metadataSize = lib.providesSymbol('connectias_dvd_metadata_size')
+            ? lib.lookupFunction<_MetadataSizeC, _MetadataSize>('connectias_dvd_metadata_size')
+            : null,
+        _readMetadata = lib.providesSymbol('connectias_dvd_read_metadata')
+            ? lib.lookupFunction<_ReadMetadataC, _ReadMetadata>('connectias_dvd_read_metadata')
+            : null;
+
+  /// Directory pages; large enough for a few thousand entries per call.
+  static const int _kPageBufferSize = 256 * 1024;
+  static const int _kPathBufferSize = 4096;
+
+  final _LastError _lastError;
+  final _PathCall _openDirCursor;
+  final _ReadDirPage _readDirPage;
+  final _Close _closeDirCursor;
+  final _OpenFile _openFile;
+  final _ReadFileHandle _readFileHandle;
+  final _ReadFile _readFile;
+  final _Close _closeFile;
+  final _MetadataSize? _metadataSize;
+  final _ReadMetadata? _readMetadata;
+
+  final Pointer<_DirPage> _page = calloc<_DirPage>();
+  final Pointer<Uint64> _size = calloc<Uint64>();
+  final Pointer<Uint8> _path = malloc<Uint8>(_kPathBufferSize);
+  Pointer<Uint8> _buf = malloc<Uint8>(_kPageBufferSize);
+  int _bufSize = _kPageBufferSize;
+
+  /// The shared read buffer, grown to at least [size] bytes.
+  Pointer<Uint8> _buffer(int size) {
+    if (size > _bufSize) {
+      malloc.free(_buf);
+      _buf = malloc<Uint8>(size);
+      _bufSize = size;
+    }
+    return _buf;
+  }
+
+  /// Copies [path] as UTF-8 into the path buffer. Returns its length.
+  int _setPath(String path) {
+    final bytes = utf8.encode(path);
+    if (bytes.length > _kPathBufferSize) {
+      throw _NativeError('Path too long');
+    }
+    _path.asTypedList(bytes.length).setAll(0, bytes);
+    return bytes.length;
+  }
+
+  /// [result], or the native error for a negative one.
+  int _check(int result) {
+    if (result >= 0) return result;
+    final n = _lastError(_path, _kPathBufferSize);
+    final message = n > 0
+        ? utf8.decode(_path.asTypedList(n < _kPathBufferSize ? n : _kPathBufferSize), allowMalformed: true)
+        : 'Native call failed (code: $result)';
+    throw _NativeError(message);
+  }
+
+  /// Copies [n] bytes of the read buffer out for the main isolate.
+  TransferableTypedData _take(int n) => TransferableTypedData.fromList([_buf.asTypedList(n)]);
+
+  int openDirCursor(int volumeId, String path) {
+    return _check(_openDirCursor(volumeId, _path, _setPath(path)));
+  }
+
+  (List<UsbDirectoryEntry>, bool) readDirPage(int volumeId, int cursor, int maxEntries) {
+    final buf = _buffer(_kPageBufferSize);
+    _check(_readDirPage(volumeId, cursor, maxEntries, buf, _kPageBufferSize, _page));
+    final bytes = buf.asTypedList(_page.ref.bytes);
+    final data = ByteData.sublistView(bytes);
+    final entries = <UsbDirectoryEntry>[];
+    var at = 0;
+    while (at < bytes.length) {
+      final size = data.getUint64(at, Endian.little);
+      final nameLength = data.getUint16(at + 8, Endian.little);
+      final isDirectory = data.getUint8(at + 10) & 0x01 != 0;
+      at += 11;
+      entries.add(UsbDirectoryEntry(
+        name: utf8.decode(Uint8List.sublistView(bytes, at, at + nameLength), allowMalformed: true),
+        isDirectory: isDirectory,
+        size: size,
+      ));
+      at += nameLength;
+    }
+    return (entries, _page.ref.more != 0);
+  }
+
+  void closeDirCursor(int volumeId, int cursor) {
+    _closeDirCursor(volumeId, cursor);
+  }
+
+  (int, int) openFile(int volumeId, String path) {
+    final handle = _check(_openFile(volumeId, _path, _setPath(path), _size));
+    return (handle, _size.value);
+  }
+
+  TransferableTypedData readFileHandle(int volumeId, int handle, int offset, int length) {
+    final n = _check(_readFileHandle(volumeId, handle, offset, _buffer(length), length));
+    return _take(n);
+  }
+
+  TransferableTypedData readFile(int volumeId, String path, int offset, int length) {
+    final pathLength = _setPath(path);
+    final n = _check(_readFile(volumeId, _path, pathLength, offset, _buffer(length), length));
+    return _take(n);
+  }
+
+  void closeFile(int volumeId, int handle) {
+    _closeFile(volumeId, handle);
+  }
+
+  TransferableTypedData? dvdMetadata(int dvdHandle) {
+    final sizeOf = _metadataSize;
+    final read = _readMetadata;
+    if (sizeOf == null || read == null) return null;
+    final size = _check(sizeOf(dvdHandle));
+    final n = _check(read(dvdHandle, _buffer(size), size));
+    return _take(n);
+  }
+}
@@ -1,3 +1,5 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 
 import '../../logging/services/logging_service.dart';
@@ -9,13 +11,15 @@ class UsbVolumeService {
 
   final MethodChannel _channel;
 
-  /// Opens an NTFS volume on the given USB device.
+  /// Opens an NTFS volume on the given USB device: partition [partition]
+  /// from [listPartitions], or the first NTFS partition if negative.
+  /// Volumes on one device share its USB session.
   /// Returns volume ID on success.
-  Future<int> openVolume(String deviceId) async {
-    LoggingService.instance.v('UsbVolumeService', 'openVolume: $deviceId');
+  Future<int> openVolume(String deviceId, {int partition = -1}) async {
+    LoggingService.instance.v('UsbVolumeService', 'openVolume: $deviceId partition=$partition');
     final result = await _channel.invokeMethod<int>(
       'openVolume',
-      {'deviceId': deviceId},
+      {'deviceId': deviceId, 'partition': partition},
     );
     if (result == null) {
       LoggingService.instance.e('UsbVolumeService', 'openVolume failed');
@@ -34,7 +38,17 @@ class UsbVolumeService {
     return result;
   }
 
-  /// Closes the volume and releases the USB session.
+  /// Lists the partitions of a USB disk. Returns JSON array of
+  /// {i, start, size, t, ntfs} objects.
+  Future<String> listPartitions(String deviceId) async {
+    final result = await _channel.invokeMethod<String>(
+      'listPartitions',
+      {'deviceId': deviceId},
+    );
+    return result ?? '[]';
+  }
+
+  /// Closes the volume; the USB session is released with the device's last volume.
   Future<void> closeVolume(int volumeId) async {
     await _channel.invokeMethod('closeVolume', {'volumeId': volumeId});
   }
@@ -49,6 +63,41 @@ class UsbVolumeService {
     return result ?? '[]';
   }
 
+  /// Opens a paged listing for [readDirPage]. Returns the cursor ID.
+  Future<int> openDirCursor(int volumeId, {String path = ''}) async {
+    LoggingService.instance.v('UsbVolumeService', 'openDirCursor: $volumeId path=$path');
+    final result = await _channel.invokeMethod<int>(
+      'openDirCursor',
+      {'volumeId': volumeId, 'path': path},
+    );
+    if (result == null || result < 0) {
+      LoggingService.instance.e('UsbVolumeService', 'openDirCursor failed');
+      throw PlatformException(
+        code: 'VOLUME_ERROR',
+        message: 'Failed to list directory',
+      );
+    }
+    return result;
+  }
+
+  /// Next page of up to [maxEntries] entries, as the JSON of [listDirectory].
+  /// A shorter page is the last one.
+  Future<String> readDirPage(int volumeId, int cursorId, {int maxEntries = 500}) async {
+    final result = await _channel.invokeMethod<String>(
+      'readDirPage',
+      {'volumeId': volumeId, 'cursorId': cursorId, 'maxEntries': maxEntries},
+    );
+    return result ?? '[]';
+  }
+
+  /// Releases a cursor from [openDirCursor].
+  Future<void> closeDirCursor(int volumeId, int cursorId) async {
+    await _channel.invokeMethod(
+      'closeDirCursor',
+      {'volumeId': volumeId, 'cursorId': cursorId},
+    );
+  }
+
   /// Reads file content.
   Future<List<int>> readFile(
     int volumeId,
@@ -74,4 +123,168 @@ class UsbVolumeService {
     }
     return result.map((e) => (e as num).toInt()).toList();
   }
+
+  /// Opens a file for chunked reads with [readFileHandle].
+  /// Returns the file handle.
+  Future<int> openFile(int volumeId, String path) async {
+    final result = await _channel.invokeMethod<int>(
+      'openFile',
+      {'volumeId': volumeId, 'path': path},
+    );
+    if (result == null || result < 0) {
+      LoggingService.instance.e('UsbVolumeService', 'openFile failed');
+      throw PlatformException(
+        code: 'VOLUME_ERROR',
+        message: 'Failed to open file',
+      );
+    }
+    return result;
+  }
+
+  /// Reads up to [length] bytes at [offset] of an open file.
+  /// Returns fewer bytes at end of file.
+  Future<Uint8List> readFileHandle(
+    int volumeId,
+    int fileHandle, {
+    required int offset,
+    int length = 65536,
+  }) async {
+    final result = await _channel.invokeMethod<Uint8List>(
+      'readFileHandle',
+      {
+        'volumeId': volumeId,
+        'fileHandle': fileHandle,
+        'offset': offset,
+        'length': length,
+      },
+    );
+    if (result == null) {
+      LoggingService.instance.e('UsbVolumeService', 'readFileHandle failed');
+      throw PlatformException(
+        code: 'VOLUME_ERROR',
+        message: 'Failed to read file',
+      );
+    }
+    return result;
+  }
+
+  /// Releases a file handle from [openFile].
+  Future<void> closeFile(int volumeId, int fileHandle) async {
+    await _channel.invokeMethod(
+      'closeFile',
+      {'volumeId': volumeId, 'fileHandle': fileHandle},
+    );
+  }
+
+  /// Starts indexing the volume for [searchVolume] in the background. A saved
+  /// index from an earlier mount is reused unless [rebuild].
+  Future<void> startMftIndex(int volumeId, {bool rebuild = false}) async {
+    await _channel.invokeMethod(
+      'startMftIndex',
+      {'volumeId': volumeId, 'rebuild': rebuild},
+    );
+  }
+
+  /// Returns {state, scanned, total, error}; state 2 means searchable.
+  Future<Map<Object?, Object?>> mftIndexStatus(int volumeId) async {
+    final result = await _channel.invokeMethod<Map<Object?, Object?>>(
+      'mftIndexStatus',
+      {'volumeId': volumeId},
+    );
+    return result ?? const {};
+  }
+
+  /// Searches names on the whole volume. Returns JSON array of {p, d, s} objects.
+  Future<String> searchVolume(
+    int volumeId,
+    String query, {
+    bool prefix = false,
+    int limit = 200,
+  }) async {
+    final result = await _channel.invokeMethod<String>(
+      'searchVolume',
+      {'volumeId': volumeId, 'query': query, 'prefix': prefix, 'limit': limit},
+    );
+    return result ?? '[]';
+  }
+
+  /// Starts a native copy of [path] into a content [uri] or a local [filePath].
+  /// The copy runs on a Rust worker thread; poll it with [copyJobStatus].
+  /// Returns the job ID.
+  Future<int> copyFileToFd(
+    int volumeId,
+    String path, {
+    String? uri,
+    String? filePath,
+  }) async {
+    final result = await _channel.invokeMethod<int>(
+      'copyFileToFd',
+      {
+        'volumeId': volumeId,
+        'path': path,
+        'uri': uri,
+        'filePath': filePath,
+      },
+    );
+    if (result == null || result < 0) {
+      LoggingService.instance.e('UsbVolumeService', 'copyFileToFd failed');
+      throw PlatformException(
+        code: 'VOLUME_ERROR',
+        message: 'Failed to start copy',
+      );
+    }
+    return result;
+  }
+
+  /// Returns {state, copied, total, error} for a copy job.
+  Future<Map<Object?, Object?>> copyJobStatus(int jobId) async {
+    final result = await _channel.invokeMethod<Map<Object?, Object?>>(
+      'copyJobStatus',
+      {'jobId': jobId},
+    );
+    if (result == null) {
+      throw PlatformException(
+        code: 'VOLUME_ERROR',
+        message: 'Copy job not found',
+      );
+    }
+    return result;
+  }
+
+  /// Asks a copy job to stop.
+  Future<void> cancelCopyJob(int jobId) async {
+    await _channel.invokeMethod('cancelCopyJob', {'jobId': jobId});
+  }
+
+  /// Releases a finished copy job.
+  Future<void> releaseCopyJob(int jobId) async {
+    await _channel.invokeMethod('releaseCopyJob', {'jobId': jobId});
+  }
+
+  /// Sets read error handling for the device of [volumeId] (shared by all
+  /// volumes on it): retries, bisection of failed reads and zero-filling of
+  /// unreadable sectors.
+  Future<void> setRecoveryPolicy(
+    int volumeId, {
+    int retries = 0,
+    bool splitReads = false,
+    bool skipBadSectors = false,
+  }) async {
+    await _channel.invokeMethod('setRecoveryPolicy', {
+      'volumeId': volumeId,
+      'retries': retries,
+      'splitReads': splitReads,
+      'skipBadSectors': skipBadSectors,
+    });
+  }
+
+  /// Returns the zero-filled sectors of the volume's device as a JSON array
+  /// of [lba, count] pairs.
+  Future<String> getBadSectors(int volumeId) async {
+    final result = await _channel.invokeMethod<String>(
+      'getBadSectors',
+      {'volumeId': volumeId},
+    );
+    return result ?? '[]';
+  }
 }
@@ -1,8 +1,12 @@
+import 'dart:async';
+
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 
 import '../../logging/services/logging_service.dart';
 import '../data/usb_directory_entry.dart';
+import '../data/usb_search_hit.dart';
 import '../services/file_open_save_service.dart';
+import '../services/usb_ffi.dart';
 import '../services/usb_volume_service.dart';
 import '../data/usb_volume_repository.dart';
 import '../domain/list_usb_directory_use_case.dart';
@@ -32,10 +36,13 @@ class FileExplorerState {
 
 final usbVolumeServiceProvider = Provider<UsbVolumeService>((ref) => UsbVolumeService());
 
+final usbFfiProvider = Provider<UsbFfi?>((ref) => UsbFfi.instance);
+
 final usbVolumeRepositoryProvider = Provider<UsbVolumeRepository>((ref) {
   return UsbVolumeRepository(
     ref.watch(usbBridgeProvider),
     ref.watch(usbVolumeServiceProvider),
+    ref.watch(usbFfiProvider),
   );
 });
 
@@ -58,8 +65,9 @@ class FileExplorerViewModel extends Notifier<FileExplorerState> {
   @override
   FileExplorerState build() => FileExplorerState.initial;
 
-  /// Opens the volume and loads root directory.
-  Future<void> openVolume(String deviceId) async {
+  /// Opens the volume (the first NTFS partition unless [partition] is given)
+  /// and loads root directory.
+  Future<void> openVolume(String deviceId, {int partition = -1}) async {
     state = FileExplorerState(
       isLoading: true,
       currentPath: '',
@@ -70,8 +78,10 @@ class FileExplorerViewModel extends Notifier<FileExplorerState> {
     final listUseCase = ref.read(listUsbDirectoryUseCaseProvider);
 
     try {
-      final volumeId = await repository.openVolume(deviceId);
-      final entries = await listUseCase.call(volumeId, path: '');
+      final volumeId = await repository.openVolume(deviceId, partition: partition);
+      // Loads the saved index of a known volume, or scans $MFT while browsing.
+      unawaited(repository.startIndex(volumeId));
+      final entries = await _listPaged(listUseCase, volumeId, '');
 
       state = FileExplorerState(
         volumeId: volumeId,
@@ -88,6 +98,28 @@ class FileExplorerViewModel extends Notifier<FileExplorerState> {
     }
   }
 
+  /// Lists [path] page by page, showing entries as they arrive. Stops updating
+  /// the state if the user has navigated elsewhere meanwhile.
+  Future<List<UsbDirectoryEntry>> _listPaged(
+    ListUsbDirectoryUseCase listUseCase,
+    int volumeId,
+    String path,
+  ) async {
+    final entries = <UsbDirectoryEntry>[];
+    await for (final page in listUseCase.pages(volumeId, path: path)) {
+      entries.addAll(page);
+      if (state.currentPath == path) {
+        state = FileExplorerState(
+          volumeId: volumeId,
+          currentPath: path,
+          entries: List.unmodifiable(entries),
+          isLoading: true,
+        );
+      }
+    }
+    return entries;
+  }
+
   /// Navigates into a directory.
   Future<void> navigateTo(String name) async {
     final volumeId = state.volumeId;
@@ -107,7 +139,7 @@ class FileExplorerViewModel extends Notifier<FileExplorerState> {
     final listUseCase = ref.read(listUsbDirectoryUseCaseProvider);
 
     try {
-      final entries = await listUseCase.call(volumeId, path: newPath);
+      final entries = await _listPaged(listUseCase, volumeId, newPath);
       state = FileExplorerState(
         volumeId: volumeId,
         currentPath: newPath,
@@ -133,6 +165,20 @@ class FileExplorerViewModel extends Notifier<FileExplorerState> {
     }
   }
 
+  /// Searches the whole volume by name. Empty until the index is ready.
+  Future<List<UsbSearchHit>> searchFiles(String query) async {
+    final volumeId = state.volumeId;
+    if (volumeId == null || query.isEmpty) return const [];
+    final repository = ref.read(usbVolumeRepositoryProvider);
+    try {
+      if (!await repository.isIndexReady(volumeId)) return const [];
+      return await repository.search(volumeId, query);
+    } on UsbVolumeRepositoryException catch (e) {
+      LoggingService.instance.e('FileExplorerViewModel', 'searchFiles: ${e.message}');
+      return const [];
+    }
+  }
+
   /// Navigates up one level.
   Future<void> navigateUp() async {
     final volumeId = state.volumeId;
@@ -154,7 +200,7 @@ class FileExplorerViewModel extends Notifier<FileExplorerState> {
     final listUseCase = ref.read(listUsbDirectoryUseCaseProvider);
 
     try {
-      final entries = await listUseCase.call(volumeId, path: newPath);
+      final entries = await _listPaged(listUseCase, volumeId, newPath);
       state = FileExplorerState(
         volumeId: volumeId,
         currentPath: newPath,
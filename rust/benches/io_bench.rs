@@ -0,0 +1,436 @@
+//! Host benchmarks for the USB storage stack over a simulated BOT device.
+//!
+//!     cargo bench --bench io_bench [-- <name filter>]
+//!
+//! Synthetic scenarios always run (cdda_stream over a jittery audio CD
+//! drive, checking the output is seamless). Image scenarios run when the variables are
+//! set: CONNECTIAS_BENCH_NTFS (raw disk or partition image, optionally
+//! CONNECTIAS_BENCH_NTFS_FILE to pick the copied file) and CONNECTIAS_BENCH_DVD
+//! (DVD-Video ISO; needs `--features host-dvd` and the third_party checkouts).
+//!
+//! Device time comes from the simulator's per-command latency, bandwidth and
+//! seek cost (see sim::SimConfig::with_env), so the reported throughput is
+//! (bytes) / (CPU time + simulated device time) and is stable across runs.
+//! Commands and allocations are exact counts; compare them between builds.
+
+mod sim;
+
+use connectias_rust::block_cache::{BlockCache, DEFAULT_BUDGET_BYTES};
+use connectias_rust::block_device::ScsiBlockDevice;
+use connectias_rust::cdda;
+use connectias_rust::device_session::DeviceSession;
+use connectias_rust::ntfs_reader::BlockDeviceReader;
+use connectias_rust::ntfs_volume::NtfsVolume;
+use connectias_rust::recovery::RecoveryPolicy;
+use sim::{audio_byte, Backing, SimConfig, SimDevice, SimStats};
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::collections::VecDeque;
+use std::fs::File;
+use std::io;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::Instant;
+
+/// Counts every allocation made by the process.
+struct CountingAlloc;
+
+static ALLOCS: AtomicU64 = AtomicU64::new(0);
+static ALLOC_BYTES: AtomicU64 = AtomicU64::new(0);
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCS.fetch_add(1, Ordering::Relaxed);
+        ALLOC_BYTES.fetch_add(layout.size() as u64, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCS.fetch_add(1, Ordering::Relaxed);
+        ALLOC_BYTES.fetch_add(new_size as u64, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAlloc = CountingAlloc;
+
+const MIB: usize = 1024 * 1024;
+/// Synthetic disk: 1 GiB of 512-byte blocks.
+const DISK_BLOCKS: u64 = 2 * 1024 * 1024;
+/// Synthetic single-layer DVD.
+const DVD_BLOCKS: u64 = 2_295_104;
+/// Fixed seed so random scenarios issue the same reads every run.
+const SEED: u64 = 0x5EED_C0DE;
+
+/// Work done by a scenario body: bytes delivered to the caller and operations.
+struct Work {
+    bytes: u64,
+    ops: u64,
+}
+
+/// xorshift64*: deterministic and allocation free.
+struct Rng(u64);
+
+impl Rng {
+    fn next(&mut self) -> u64 {
+        self.0 ^= self.0 >> 12;
+        self.0 ^= self.0 << 25;
+        self.0 ^= self.0 >> 27;
+        self.0.wrapping_mul(0x2545_F491_4F6C_DD1D)
+    }
+
+    fn below(&mut self, n: u64) -> u64 {
+        self.next() % n.max(1)
+    }
+}
+
+fn device(config: SimConfig, backing: Backing) -> io::Result<(ScsiBlockDevice, Arc<SimStats>)> {
+    let sim = SimDevice::new(config.with_env(), backing)?;
+    let stats = sim.stats();
+    Ok((ScsiBlockDevice::new(Box::new(sim), 1)?, stats))
+}
+
+fn header() {
+    println!(
+        "{:<22} {:>9} {:>10} {:>10} {:>10} {:>9} {:>7} {:>10} {:>10}",
+        "scenario", "ops", "MiB", "MiB/s", "ops/s", "commands", "seeks", "allocs", "alloc MiB"
+    );
+}
+
+/// Runs `body` and prints its row. Setup done before the call is not counted.
+fn measure(name: &str, stats: &SimStats, body: impl FnOnce() -> io::Result<Work>) -> io::Result<()> {
+    let start_stats = stats.snapshot();
+    let start_allocs = (ALLOCS.load(Ordering::Relaxed), ALLOC_BYTES.load(Ordering::Relaxed));
+    let started = Instant::now();
+    let work = body()?;
+    let cpu_ns = started.elapsed().as_nanos() as u64;
+    let allocs = ALLOCS.load(Ordering::Relaxed) - start_allocs.0;
+    let alloc_bytes = ALLOC_BYTES.load(Ordering::Relaxed) - start_allocs.1;
+    let device = stats.snapshot().since(&start_stats);
+    let secs = (cpu_ns + device.device_ns).max(1) as f64 / 1e9;
+    println!(
+        "{:<22} {:>9} {:>10.1} {:>10.1} {:>10.0} {:>9} {:>7} {:>10} {:>10.1}",
+        name,
+        work.ops,
+        work.bytes as f64 / MIB as f64,
+        work.bytes as f64 / MIB as f64 / secs,
+        work.ops as f64 / secs,
+        device.commands,
+        device.seeks,
+        allocs,
+        alloc_bytes as f64 / MIB as f64,
+    );
+    Ok(())
+}
+
+/// 256 MiB in 1 MiB reads: large reads bypass the cache and are split by
+/// max_transfer_blocks.
+fn sequential_read() -> io::Result<()> {
+    let (dev, stats) = device(SimConfig::disk(), Backing::Pattern(DISK_BLOCKS))?;
+    let cache = BlockCache::new(dev, DEFAULT_BUDGET_BYTES);
+    let mut buf = vec![0u8; MIB];
+    let per_chunk = (MIB / 512) as u32;
+    measure("sequential_read", &stats, || {
+        let mut lba = 0u64;
+        for _ in 0..256 {
+            cache.read_blocks(lba, per_chunk, &mut buf)?;
+            lba += per_chunk as u64;
+        }
+        Ok(Work { bytes: 256 * MIB as u64, ops: 256 })
+    })
+}
+
+/// Random 4 KiB reads over the first 64 MiB of a disk: metadata-style
+/// access that partly hits the cache.
+fn seek_storm_disk() -> io::Result<()> {
+    let (dev, stats) = device(SimConfig::disk(), Backing::Pattern(DISK_BLOCKS))?;
+    let cache = BlockCache::new(dev, DEFAULT_BUDGET_BYTES);
+    let mut buf = vec![0u8; 4096];
+    let mut rng = Rng(SEED);
+    measure("seek_storm_disk", &stats, || {
+        let span = (64 * MIB / 512) as u64;
+        for _ in 0..20_000 {
+            cache.read_blocks(rng.below(span / 8) * 8, 8, &mut buf)?;
+        }
+        Ok(Work { bytes: 20_000 * 4096, ops: 20_000 })
+    })
+}
+
+/// Random single-sector reads across a DVD; every miss pays the drive's seek.
+fn seek_storm_optical() -> io::Result<()> {
+    let (dev, stats) = device(SimConfig::optical(), Backing::Pattern(DVD_BLOCKS))?;
+    let cache = BlockCache::new(dev, DEFAULT_BUDGET_BYTES);
+    let mut buf = vec![0u8; 2048];
+    let mut rng = Rng(SEED);
+    measure("seek_storm_optical", &stats, || {
+        for _ in 0..2_000 {
+            cache.read_blocks(rng.below(DVD_BLOCKS), 1, &mut buf)?;
+        }
+        Ok(Work { bytes: 2_000 * 2048, ops: 2_000 })
+    })
+}
+
+/// Unaligned small reads as the ntfs crate issues them (record and index
+/// parsing): BlockDeviceReader::read_at through the cache.
+fn reader_unaligned() -> io::Result<()> {
+    let (dev, stats) = device(SimConfig::disk(), Backing::Pattern(DISK_BLOCKS))?;
+    let cache = Arc::new(BlockCache::new(dev, DEFAULT_BUDGET_BYTES));
+    let reader = BlockDeviceReader::new(cache, 2048, (DISK_BLOCKS - 2048) * 512);
+    let mut buf = vec![0u8; 1000];
+    measure("reader_unaligned", &stats, || {
+        let mut pos = 77u64;
+        for _ in 0..50_000 {
+            reader.read_at(pos, &mut buf)?;
+            pos = (pos + 1337) % (256 * MIB as u64);
+        }
+        Ok(Work { bytes: 50_000 * 1000, ops: 50_000 })
+    })
+}
+
+/// 64 MiB in 64 KiB reads (the DVD prefetch size) over a disk with a bad
+/// sector every 4096 blocks, with retries, bisection and zero-fill. The second
+/// pass reads around the sectors recorded as bad in the first.
+fn degraded_read() -> io::Result<()> {
+    const BAD_EVERY: u64 = 4096;
+    const BLOCKS: u64 = 64 * MIB as u64 / 512;
+    let bad: Vec<u64> = (0..BLOCKS / BAD_EVERY).map(|i| i * BAD_EVERY + BAD_EVERY / 3).collect();
+    let sim = SimDevice::new(SimConfig::disk().with_env(), Backing::Pattern(DISK_BLOCKS))?
+        .with_bad_sectors(bad, 20_000);
+    let stats = sim.stats();
+    let dev = ScsiBlockDevice::new(Box::new(sim), 1)?;
+    dev.recovery.set_policy(RecoveryPolicy { retries: 1, split: true, skip_bad: true });
+    let mut buf = vec![0u8; 64 * 1024];
+    let per_read = (buf.len() / 512) as u32;
+    for name in ["degraded_read", "degraded_reread"] {
+        measure(name, &stats, || {
+            let mut lba = 0u64;
+            while lba < BLOCKS {
+                dev.read_blocks(lba, per_read, &mut buf)?;
+                lba += per_read as u64;
+            }
+            Ok(Work { bytes: BLOCKS * 512, ops: BLOCKS / per_read as u64 })
+        })?;
+    }
+    Ok(())
+}
+
+fn ntfs_image() -> Option<io::Result<File>> {
+    let path = std::env::var_os("CONNECTIAS_BENCH_NTFS")?;
+    Some(File::open(path))
+}
+
+/// Breadth-first walk of the whole tree (cold caches), up to 5000 directories.
+/// Returns (directories listed, entries, largest file).
+fn walk(volume: &mut NtfsVolume) -> io::Result<(u64, u64, Option<(String, u64)>)> {
+    let mut queue = VecDeque::from([String::new()]);
+    let (mut dirs, mut entries) = (0u64, 0u64);
+    let mut largest: Option<(String, u64)> = None;
+    while let Some(dir) = queue.pop_front() {
+        if dirs == 5000 {
+            break;
+        }
+        let listing = match volume.list_directory(&dir) {
+            Ok(l) => l,
+            Err(_) => continue, // unreadable system directories
+        };
+        dirs += 1;
+        for e in listing.iter() {
+            entries += 1;
+            let path = format!("{}/{}", dir, e.name);
+            if e.is_dir {
+                if e.name != "." && e.name != ".." {
+                    queue.push_back(path);
+                }
+            } else if largest.as_ref().map_or(true, |l| e.size > l.1) {
+                largest = Some((path, e.size));
+            }
+        }
+    }
+    Ok((dirs, entries, largest))
+}
+
+fn ntfs_browse() -> io::Result<()> {
+    let Some(image) = ntfs_image() else { return Ok(()) };
+    let (dev, stats) = device(SimConfig::disk(), Backing::Image(image?))?;
+    let session = DeviceSession::open(dev)?;
+    let mut volume = NtfsVolume::open(&session, None)?;
+    measure("ntfs_browse", &stats, || {
+        let (dirs, entries, _) = walk(&mut volume)?;
+        println!("  {} directories, {} entries", dirs, entries);
+        Ok(Work { bytes: 0, ops: dirs })
+    })
+}
+
+/// Copies a file the way a copy job's reader does: 1 MiB chunks into a
+/// reused buffer. Large files on a used volume are usually fragmented.
+fn ntfs_copy() -> io::Result<()> {
+    let Some(image) = ntfs_image() else { return Ok(()) };
+    let (dev, stats) = device(SimConfig::disk(), Backing::Image(image?))?;
+    let session = DeviceSession::open(dev)?;
+    let mut volume = NtfsVolume::open(&session, None)?;
+    let path = match std::env::var("CONNECTIAS_BENCH_NTFS_FILE") {
+        Ok(p) => p,
+        Err(_) => match walk(&mut volume)?.2 {
+            Some((p, _)) => p,
+            None => return Ok(()),
+        },
+    };
+    let mut buf = vec![0u8; MIB];
+    measure("ntfs_copy", &stats, || {
+        let handle = volume.open_file(&path)?;
+        let size = volume.open_file_size(handle)?;
+        let (mut offset, mut chunks) = (0u64, 0u64);
+        while offset < size {
+            let n = volume.read_open_file_into(handle, offset, &mut buf)?;
+            if n == 0 {
+                break;
+            }
+            offset += n as u64;
+            chunks += 1;
+        }
+        volume.close_file(handle);
+        println!("  {} ({} bytes)", path, size);
+        Ok(Work { bytes: offset, ops: chunks })
+    })
+}
+
+#[cfg(has_dvd)]
+mod dvd_scenarios {
+    use super::*;
+    use connectias_rust::dvd;
+
+    fn err(e: String) -> io::Error {
+        io::Error::new(io::ErrorKind::Other, e)
+    }
+
+    /// Open, metadata export, sequential title read and a seek storm on one disc.
+    pub fn run(filter: &str) -> io::Result<()> {
+        let Some(path) = std::env::var_os("CONNECTIAS_BENCH_DVD") else { return Ok(()) };
+        let sim = SimDevice::new(SimConfig::optical().with_env(), Backing::Image(File::open(path)?))?;
+        let stats = sim.stats();
+        let mut handle = 0u64;
+        // Open and metadata rows always print: the other scenarios need the handle.
+        // No title-key cache, so every run measures key recovery.
+        dvd::css_cache::set_cache_root(std::path::Path::new(""));
+        measure("dvd_open", &stats, || {
+            handle = dvd::open_dvd(1, Box::new(sim)).map_err(err)?;
+            Ok(Work { bytes: 0, ops: 1 })
+        })?;
+        let mut meta = vec![0u8; 0];
+        measure("dvd_metadata", &stats, || {
+            for _ in 0..1000 {
+                let size = dvd::metadata_size(handle).map_err(err)?;
+                meta.resize(size, 0);
+                dvd::export_metadata(handle, &mut meta).map_err(err)?;
+            }
+            Ok(Work { bytes: 1000 * meta.len() as u64, ops: 1000 })
+        })?;
+        let stream = dvd::open_title_stream(handle, 1).map_err(err)?;
+        let mut buf = vec![0u8; 256 * 1024];
+        if "dvd_title_read".contains(filter) {
+            measure("dvd_title_read", &stats, || {
+                let (mut bytes, mut reads) = (0u64, 0u64);
+                while bytes < 64 * MIB as u64 {
+                    let n = dvd::read_stream(stream, &mut buf).map_err(err)?;
+                    if n == 0 {
+                        break;
+                    }
+                    bytes += n as u64;
+                    reads += 1;
+                }
+                Ok(Work { bytes, ops: reads })
+            })?;
+        }
+        if "dvd_seek_storm".contains(filter) {
+            let mut rng = Rng(SEED);
+            measure("dvd_seek_storm", &stats, || {
+                let mut bytes = 0u64;
+                for _ in 0..200 {
+                    dvd::seek_time(stream, rng.below(2 * 3600 * 1000)).map_err(err)?;
+                    bytes += dvd::read_stream(stream, &mut buf[..64 * 1024]).map_err(err)? as u64;
+                }
+                Ok(Work { bytes, ops: 200 })
+            })?;
+        }
+        dvd::close_stream(stream);
+        dvd::close_dvd(handle);
+        Ok(())
+    }
+}
+
+/// Streams the second track of an audio CD whose drive starts every READ CD
+/// up to half a sector off. The first read fixes the stream's offset; after
+/// it, every byte must follow on, or the jitter correction slipped.
+fn cdda_stream() -> io::Result<()> {
+    const TRACK_SECTORS: u32 = 60 * 75;
+    let sim = SimDevice::new(SimConfig::audio_cd().with_env(), Backing::Pattern(2 * TRACK_SECTORS as u64))?
+        .with_tracks(vec![0, TRACK_SECTORS]);
+    let stats = sim.stats();
+    let jitter = SimConfig::audio_cd().jitter_bytes as i64;
+    let handle = cdda::open_cd(1, Box::new(sim))?;
+    let stream = cdda::open_track_stream(handle, 2)?;
+    let mut buf = vec![0u8; 64 * 1024];
+    let base = TRACK_SECTORS as u64 * connectias_rust::scsi::CD_RAW_SECTOR as u64;
+    let (mut mismatched, mut corrections) = (0u64, String::new());
+    measure("cdda_stream", &stats, || {
+        let (mut pcm, mut reads, mut shift) = (0u64, 0u64, None);
+        loop {
+            let n = cdda::stream::read_stream(stream, &mut buf)?;
+            if n == 0 {
+                break;
+            }
+            let data = if reads == 0 { &buf[cdda::stream::WAV_HEADER_BYTES..n] } else { &buf[..n] };
+            let s = *shift.get_or_insert_with(|| {
+                (-jitter..=jitter)
+                    .find(|&s| (0..64).all(|i| data[i] == audio_byte((base as i64 + s + i as i64) as u64)))
+                    .unwrap_or(0)
+            });
+            for (i, &b) in data.iter().enumerate() {
+                let p = (base + pcm + i as u64) as i64 + s;
+                mismatched += (b != audio_byte(p as u64)) as u64;
+            }
+            pcm += data.len() as u64;
+            reads += 1;
+        }
+        corrections = cdda::io_stats_json(handle).unwrap_or_default();
+        Ok(Work { bytes: pcm, ops: reads })
+    })?;
+    let cdda_stats = corrections.split("\"cdda\":").nth(1).unwrap_or("{}").trim_end_matches('}');
+    println!("  {}}}, {} bytes out of place", cdda_stats, mismatched);
+    cdda::close_stream(stream);
+    cdda::close_cd(handle);
+    Ok(())
+}
+
+fn main() {
+    // cargo bench passes --bench; the first other argument filters scenarios.
+    let filter = std::env::args().skip(1).find(|a| !a.starts_with("--")).unwrap_or_default();
+    let scenarios: [(&str, fn() -> io::Result<()>); 8] = [
+        ("sequential_read", sequential_read),
+        ("seek_storm_disk", seek_storm_disk),
+        ("seek_storm_optical", seek_storm_optical),
+        ("reader_unaligned", reader_unaligned),
+        ("degraded_read", degraded_read),
+        ("cdda_stream", cdda_stream),
+        ("ntfs_browse", ntfs_browse),
+        ("ntfs_copy", ntfs_copy),
+    ];
+    header();
+    for (name, run) in scenarios {
+        if name.contains(&filter) {
+            if let Err(e) = run() {
+                println!("{:<22} failed: {}", name, e);
+            }
+        }
+    }
+    #[cfg(has_dvd)]
+    if "dvd".contains(&filter) || filter.starts_with("dvd") {
+        if let Err(e) = dvd_scenarios::run(&filter) {
+            println!("{:<22} failed: {}", "dvd", e);
+        }
+    }
+}
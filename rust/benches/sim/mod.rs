@@ -0,0 +1,518 @@
+//! Simulated USB mass-storage device for host benches.
+//! Speaks BOT at the TransferHandler level (the combined execute_bot path the
+//! JNI handler uses, and separate bulk phases for vectored reads) and answers
+//! the SCSI commands ScsiBlockDevice issues, including READ TOC and READ CD
+//! for audio CDs. Device time is charged to a virtual clock instead of
+//! sleeping, so runs are fast and reproducible.
+
+use connectias_rust::block_device::{BotCompletion, TransferHandler};
+use connectias_rust::scsi;
+use std::fs::File;
+use std::io;
+use std::os::unix::fs::FileExt;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+const SENSE_ILLEGAL_REQUEST: u8 = 0x05;
+const ASC_INVALID_OPCODE: u8 = 0x20;
+const ASC_LBA_OUT_OF_RANGE: u8 = 0x21;
+const ASC_UNRECOVERED_READ_ERROR: u8 = 0x11;
+
+#[derive(Clone, Copy)]
+pub struct SimConfig {
+    pub block_size: u32,
+    /// INQUIRY peripheral type: 0x00 disk, 0x05 optical.
+    pub peripheral_type: u8,
+    /// Fixed cost per command (CBW, CSW and data round trips).
+    pub latency_us: u64,
+    /// Media transfer rate.
+    pub bandwidth_mb_s: u64,
+    /// Added when a read does not continue the previous one.
+    pub seek_us: u64,
+    pub max_transfer: usize,
+    /// Largest offset, in bytes either way, at which READ CD starts off the
+    /// requested sector (whole stereo frames).
+    pub jitter_bytes: usize,
+}
+
+impl SimConfig {
+    /// USB 2.0 flash drive or SSD enclosure.
+    pub fn disk() -> Self {
+        Self {
+            block_size: 512,
+            peripheral_type: 0x00,
+            latency_us: 250,
+            bandwidth_mb_s: 35,
+            seek_us: 0,
+            max_transfer: 120 * 1024,
+            jitter_bytes: 0,
+        }
+    }
+
+    /// USB DVD drive reading at about 8x.
+    pub fn optical() -> Self {
+        Self {
+            block_size: 2048,
+            peripheral_type: 0x05,
+            latency_us: 500,
+            bandwidth_mb_s: 10,
+            seek_us: 80_000,
+            max_transfer: 64 * 1024,
+            jitter_bytes: 0,
+        }
+    }
+
+    /// USB CD drive reading audio at about 24x, with the start of each READ
+    /// CD off by up to half a sector.
+    pub fn audio_cd() -> Self {
+        Self {
+            block_size: scsi::CD_RAW_SECTOR as u32,
+            peripheral_type: 0x05,
+            latency_us: 500,
+            bandwidth_mb_s: 3,
+            seek_us: 80_000,
+            max_transfer: 256 * 1024,
+            jitter_bytes: 1176,
+        }
+    }
+
+    /// Overrides from CONNECTIAS_BENCH_LATENCY_US, _MBPS and _SEEK_US.
+    pub fn with_env(mut self) -> Self {
+        let var = |name: &str| std::env::var(name).ok().and_then(|v| v.parse::<u64>().ok());
+        if let Some(v) = var("CONNECTIAS_BENCH_LATENCY_US") {
+            self.latency_us = v;
+        }
+        if let Some(v) = var("CONNECTIAS_BENCH_MBPS") {
+            self.bandwidth_mb_s = v.max(1);
+        }
+        if let Some(v) = var("CONNECTIAS_BENCH_SEEK_US") {
+            self.seek_us = v;
+        }
+        self
+    }
+}
+
+pub enum Backing {
+    /// Generated content, `blocks` long. Each block starts with its LBA;
+    /// audio CD sectors are noise (see audio_byte).
+    Pattern(u64),
+    /// Disk or ISO image; reads past its end return zeros.
+    Image(File),
+}
+
+#[derive(Default)]
+pub struct SimStats {
+    pub commands: AtomicU64,
+    pub reads: AtomicU64,
+    pub seeks: AtomicU64,
+    pub bytes: AtomicU64,
+    pub device_ns: AtomicU64,
+}
+
+#[derive(Clone, Copy, Default)]
+pub struct StatsSnapshot {
+    pub commands: u64,
+    pub reads: u64,
+    pub seeks: u64,
+    pub bytes: u64,
+    pub device_ns: u64,
+}
+
+impl SimStats {
+    pub fn snapshot(&self) -> StatsSnapshot {
+        StatsSnapshot {
+            commands: self.commands.load(Ordering::Relaxed),
+            reads: self.reads.load(Ordering::Relaxed),
+            seeks: self.seeks.load(Ordering::Relaxed),
+            bytes: self.bytes.load(Ordering::Relaxed),
+            device_ns: self.device_ns.load(Ordering::Relaxed),
+        }
+    }
+}
+
+impl StatsSnapshot {
+    pub fn since(&self, start: &StatsSnapshot) -> StatsSnapshot {
+        StatsSnapshot {
+            commands: self.commands - start.commands,
+            reads: self.reads - start.reads,
+            seeks: self.seeks - start.seeks,
+            bytes: self.bytes - start.bytes,
+            device_ns: self.device_ns - start.device_ns,
+        }
+    }
+}
+
+enum Response {
+    /// Data `skew` bytes off the start of `lba`.
+    Read { lba: u64, len: usize, skew: i64 },
+    Data(Vec<u8>),
+    Empty,
+    Check(u8, u8),
+}
+
+/// Command received through bulk_out, completed by the following bulk_in calls.
+struct Pending {
+    tag: u32,
+    response: Response,
+    /// Data bytes already returned.
+    offset: usize,
+    expected: usize,
+}
+
+#[derive(Default)]
+struct State {
+    /// Block after the last one read, for seek accounting.
+    next_lba: u64,
+    sense: (u8, u8),
+    pending: Option<Pending>,
+}
+
+pub struct SimDevice {
+    config: SimConfig,
+    backing: Backing,
+    blocks: u64,
+    /// Unreadable LBAs, ascending, and the time the drive spends on each
+    /// before giving up.
+    bad: Vec<u64>,
+    bad_us: u64,
+    /// First sectors of the audio tracks, for READ TOC.
+    tracks: Vec<u32>,
+    stats: Arc<SimStats>,
+    state: Mutex<State>,
+}
+
+impl SimDevice {
+    pub fn new(config: SimConfig, backing: Backing) -> io::Result<Self> {
+        let blocks = match &backing {
+            Backing::Pattern(blocks) => *blocks,
+            Backing::Image(file) => file.metadata()?.len() / config.block_size as u64,
+        };
+        Ok(Self {
+            config,
+            backing,
+            blocks,
+            bad: Vec::new(),
+            bad_us: 0,
+            tracks: vec![0],
+            stats: Arc::new(SimStats::default()),
+            state: Mutex::new(State::default()),
+        })
+    }
+
+    /// Makes `lbas` fail with MEDIUM ERROR, each costing `cost_us` per read.
+    pub fn with_bad_sectors(mut self, mut lbas: Vec<u64>, cost_us: u64) -> Self {
+        lbas.sort_unstable();
+        self.bad = lbas;
+        self.bad_us = cost_us;
+        self
+    }
+
+    /// Audio tracks starting at `starts` (ascending), up to the last block.
+    pub fn with_tracks(mut self, starts: Vec<u32>) -> Self {
+        self.tracks = starts;
+        self
+    }
+
+    pub fn stats(&self) -> Arc<SimStats> {
+        Arc::clone(&self.stats)
+    }
+
+    /// Decodes a CDB and charges its cost to the virtual clock.
+    fn execute(&self, state: &mut State, cdb: &[u8], expected: usize) -> Response {
+        self.stats.commands.fetch_add(1, Ordering::Relaxed);
+        let mut ns = self.config.latency_us * 1000;
+        let read = match cdb.first().copied() {
+            Some(scsi::READ_10) if cdb.len() >= 10 => Some((
+                u32::from_be_bytes([cdb[2], cdb[3], cdb[4], cdb[5]]) as u64,
+                u16::from_be_bytes([cdb[7], cdb[8]]) as u64,
+            )),
+            Some(scsi::READ_16) if cdb.len() >= 16 => Some((
+                u64::from_be_bytes(cdb[2..10].try_into().unwrap()),
+                u32::from_be_bytes([cdb[10], cdb[11], cdb[12], cdb[13]]) as u64,
+            )),
+            Some(scsi::READ_CD) if cdb.len() >= 12 => Some((
+                u32::from_be_bytes([cdb[2], cdb[3], cdb[4], cdb[5]]) as u64,
+                u32::from_be_bytes([0, cdb[6], cdb[7], cdb[8]]) as u64,
+            )),
+            _ => None,
+        };
+        let response = if let Some((lba, count)) = read {
+            let first_bad = self.bad.partition_point(|&b| b < lba);
+            if lba + count > self.blocks {
+                Response::Check(SENSE_ILLEGAL_REQUEST, ASC_LBA_OUT_OF_RANGE)
+            } else if self.bad.get(first_bad).is_some_and(|&b| b < lba + count) {
+                // The drive reads up to the bad sector, retries it and fails.
+                ns += self.config.seek_us * 1000 + self.bad_us * 1000;
+                state.next_lba = u64::MAX;
+                Response::Check(scsi::SENSE_MEDIUM_ERROR, ASC_UNRECOVERED_READ_ERROR)
+            } else {
+                let len = (count * self.config.block_size as u64) as usize;
+                // The drive's buffer still holds the last sectors read, so an
+                // audio read stepping back a little doesn't seek.
+                let rereads = cdb[0] == scsi::READ_CD && lba < state.next_lba && state.next_lba - lba <= 8;
+                if lba != state.next_lba && !rereads {
+                    self.stats.seeks.fetch_add(1, Ordering::Relaxed);
+                    ns += self.config.seek_us * 1000;
+                }
+                state.next_lba = lba + count;
+                ns += len as u64 * 1000 / self.config.bandwidth_mb_s.max(1);
+                self.stats.reads.fetch_add(1, Ordering::Relaxed);
+                self.stats.bytes.fetch_add(len as u64, Ordering::Relaxed);
+                let skew = if cdb[0] == scsi::READ_CD { self.skew() } else { 0 };
+                Response::Read { lba, len: len.min(expected), skew }
+            }
+        } else {
+            self.control(state, cdb)
+        };
+        self.stats.device_ns.fetch_add(ns, Ordering::Relaxed);
+        if let Response::Check(key, asc) = response {
+            state.sense = (key, asc);
+        }
+        response
+    }
+
+    fn control(&self, state: &mut State, cdb: &[u8]) -> Response {
+        let bs = self.config.block_size;
+        match cdb.first().copied() {
+            Some(scsi::TEST_UNIT_READY) => Response::Empty,
+            Some(scsi::INQUIRY) if cdb.len() >= 2 && cdb[1] & 0x01 == 0 => {
+                let mut data = vec![0u8; 36];
+                data[0] = self.config.peripheral_type;
+                data[1] = if self.config.peripheral_type == 0x05 { 0x80 } else { 0x00 };
+                data[2] = 0x04; // SPC-2: no VPD probing
+                data[4] = 31;
+                data[8..16].copy_from_slice(b"SIMUSB  ");
+                data[16..32].copy_from_slice(b"BENCH DEVICE    ");
+                Response::Data(data)
+            }
+            Some(scsi::READ_CAPACITY_10) => {
+                let last = (self.blocks.saturating_sub(1)).min(u32::MAX as u64) as u32;
+                let mut data = last.to_be_bytes().to_vec();
+                data.extend_from_slice(&bs.to_be_bytes());
+                Response::Data(data)
+            }
+            Some(scsi::SERVICE_ACTION_IN_16) if cdb.len() >= 2 && cdb[1] & 0x1F == scsi::SA_READ_CAPACITY_16 => {
+                let mut data = vec![0u8; 32];
+                data[0..8].copy_from_slice(&self.blocks.saturating_sub(1).to_be_bytes());
+                data[8..12].copy_from_slice(&bs.to_be_bytes());
+                Response::Data(data)
+            }
+            Some(scsi::READ_TOC) => Response::Data(self.toc()),
+            Some(scsi::SET_CD_SPEED) => Response::Empty,
+            Some(scsi::REQUEST_SENSE) => {
+                let sense = sense_data(state.sense);
+                state.sense = (0, 0);
+                Response::Data(sense.to_vec())
+            }
+            _ => Response::Check(SENSE_ILLEGAL_REQUEST, ASC_INVALID_OPCODE),
+        }
+    }
+
+    /// Start offset of the next READ CD: deterministic, whole frames.
+    fn skew(&self) -> i64 {
+        let frames = (self.config.jitter_bytes / 4) as u64;
+        if frames == 0 {
+            return 0;
+        }
+        let n = self.stats.reads.load(Ordering::Relaxed).wrapping_mul(0x9E37_79B9_7F4A_7C15) >> 32;
+        (n % (2 * frames + 1)) as i64 * 4 - frames as i64 * 4
+    }
+
+    /// READ TOC format 0: one audio descriptor per track and the lead-out.
+    fn toc(&self) -> Vec<u8> {
+        let entries = self.tracks.len() + 1;
+        let mut data = vec![0u8; 4 + entries * 8];
+        data[0..2].copy_from_slice(&((2 + entries * 8) as u16).to_be_bytes());
+        data[2] = 1;
+        data[3] = self.tracks.len() as u8;
+        let lead_out = self.blocks.min(u32::MAX as u64) as u32;
+        let numbers = (1..=self.tracks.len() as u8).chain([0xAA]);
+        let starts = self.tracks.iter().copied().chain([lead_out]);
+        for (d, (number, start)) in data[4..].chunks_exact_mut(8).zip(numbers.zip(starts)) {
+            d[1] = 0x10; // ADR 1, audio
+            d[2] = number;
+            d[4..8].copy_from_slice(&start.to_be_bytes());
+        }
+        data
+    }
+
+    /// Copies read data for `lba` starting `offset` bytes in, `skew` bytes
+    /// off. Anything before the first block reads as zeros (like the lead-in).
+    fn fill(&self, lba: u64, offset: usize, skew: i64, dst: &mut [u8]) -> io::Result<()> {
+        let bs = self.config.block_size as u64;
+        let start = (lba * bs + offset as u64) as i64 + skew;
+        let lead = (-start).clamp(0, dst.len() as i64) as usize;
+        dst[..lead].fill(0);
+        let (pos, dst) = ((start + lead as i64) as u64, &mut dst[lead..]);
+        match &self.backing {
+            Backing::Image(file) => {
+                let mut done = 0;
+                while done < dst.len() {
+                    let n = file.read_at(&mut dst[done..], pos + done as u64)?;
+                    if n == 0 {
+                        dst[done..].fill(0);
+                        break;
+                    }
+                    done += n;
+                }
+            }
+            Backing::Pattern(_) if bs == scsi::CD_RAW_SECTOR as u64 => {
+                for (i, b) in dst.iter_mut().enumerate() {
+                    *b = audio_byte(pos + i as u64);
+                }
+            }
+            Backing::Pattern(_) => {
+                for (i, b) in dst.iter_mut().enumerate() {
+                    let p = pos + i as u64;
+                    let (block, in_block) = (p / bs, (p % bs) as usize);
+                    *b = if in_block < 8 {
+                        block.to_le_bytes()[in_block]
+                    } else {
+                        (block as u8).wrapping_mul(31).wrapping_add(in_block as u8)
+                    };
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Writes the response into `dst`; returns bytes transferred.
+    fn transfer(&self, response: &Response, offset: usize, dst: &mut [u8]) -> io::Result<usize> {
+        match response {
+            Response::Read { lba, len, skew } => {
+                let n = dst.len().min(len.saturating_sub(offset));
+                self.fill(*lba, offset, *skew, &mut dst[..n])?;
+                Ok(n)
+            }
+            Response::Data(data) => {
+                let n = dst.len().min(data.len().saturating_sub(offset));
+                dst[..n].copy_from_slice(&data[offset..offset + n]);
+                Ok(n)
+            }
+            Response::Empty | Response::Check(..) => Ok(0),
+        }
+    }
+}
+
+/// Byte `p` of the simulated audio: noise, so no stretch of a track matches
+/// another and jitter can only be corrected to the right place.
+pub fn audio_byte(p: u64) -> u8 {
+    // splitmix64 finalizer
+    let mut z = p.wrapping_add(0x9E37_79B9_7F4A_7C15);
+    z = (z ^ (z >> 30)).wrapping_mul(0xBF58_476D_1CE4_E5B9);
+    z = (z ^ (z >> 27)).wrapping_mul(0x94D0_49BB_1331_11EB);
+    (z ^ (z >> 31)) as u8
+}
+
+fn parse_cbw(cbw: &[u8]) -> io::Result<(u32, u32, &[u8])> {
+    if cbw.len() != scsi::CBW_SIZE || u32::from_le_bytes(cbw[0..4].try_into().unwrap()) != scsi::CBW_SIGNATURE {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, "Not a CBW"));
+    }
+    let tag = u32::from_le_bytes(cbw[4..8].try_into().unwrap());
+    let length = u32::from_le_bytes(cbw[8..12].try_into().unwrap());
+    let cdb_len = (cbw[14] as usize).clamp(1, 16);
+    Ok((tag, length, &cbw[15..15 + cdb_len]))
+}
+
+fn build_csw(tag: u32, residue: u32, status: u8) -> [u8; scsi::CSW_SIZE] {
+    let mut csw = [0u8; scsi::CSW_SIZE];
+    csw[0..4].copy_from_slice(&scsi::CSW_SIGNATURE.to_le_bytes());
+    csw[4..8].copy_from_slice(&tag.to_le_bytes());
+    csw[8..12].copy_from_slice(&residue.to_le_bytes());
+    csw[12] = status;
+    csw
+}
+
+fn sense_data((key, asc): (u8, u8)) -> [u8; scsi::SENSE_SIZE] {
+    let mut sense = [0u8; scsi::SENSE_SIZE];
+    sense[0] = 0x70;
+    sense[2] = key;
+    sense[7] = 10;
+    sense[12] = asc;
+    sense
+}
+
+fn status_of(response: &Response) -> u8 {
+    matches!(response, Response::Check(..)) as u8
+}
+
+impl TransferHandler for SimDevice {
+    fn bulk_out(&self, _session_id: u64, data: &[u8]) -> io::Result<usize> {
+        let (tag, length, cdb) = parse_cbw(data)?;
+        let mut state = self.state.lock().unwrap();
+        let response = self.execute(&mut state, cdb, length as usize);
+        state.pending = Some(Pending {
+            tag,
+            response,
+            offset: 0,
+            expected: length as usize,
+        });
+        Ok(data.len())
+    }
+
+    fn bulk_in(&self, _session_id: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let mut state = self.state.lock().unwrap();
+        let Some(pending) = state.pending.as_mut() else {
+            return Err(io::Error::new(io::ErrorKind::BrokenPipe, "No command in progress"));
+        };
+        let available = match &pending.response {
+            Response::Read { len, .. } => *len,
+            Response::Data(data) => data.len().min(pending.expected),
+            _ => 0,
+        };
+        if pending.offset < available {
+            let len = buf.len().min(available - pending.offset);
+            let n = self.transfer(&pending.response, pending.offset, &mut buf[..len])?;
+            pending.offset += n;
+            return Ok(n);
+        }
+        let csw = build_csw(
+            pending.tag,
+            (pending.expected - pending.offset.min(pending.expected)) as u32,
+            status_of(&pending.response),
+        );
+        state.pending = None;
+        let n = buf.len().min(csw.len());
+        buf[..n].copy_from_slice(&csw[..n]);
+        Ok(n)
+    }
+
+    fn max_transfer_size(&self) -> usize {
+        self.config.max_transfer
+    }
+
+    fn execute_bot(
+        &self,
+        _session_id: u64,
+        cbw: &[u8; scsi::CBW_SIZE],
+        _sense_cbw: &[u8; scsi::CBW_SIZE],
+        data: Option<(*mut u8, usize)>,
+        _direction: u8,
+    ) -> Option<io::Result<BotCompletion>> {
+        let run = || {
+            let (tag, length, cdb) = parse_cbw(cbw)?;
+            let mut state = self.state.lock().unwrap();
+            let response = self.execute(&mut state, cdb, length as usize);
+            let transferred = match data {
+                Some((ptr, len)) if !ptr.is_null() && len > 0 => {
+                    // SAFETY: ScsiBlockDevice passes its live data buffer for this command.
+                    let dst = unsafe { std::slice::from_raw_parts_mut(ptr, len) };
+                    self.transfer(&response, 0, dst)?
+                }
+                _ => 0,
+            };
+            let status = status_of(&response);
+            let sense = (status != 0).then(|| {
+                let sense = sense_data(state.sense);
+                state.sense = (0, 0);
+                sense
+            });
+            Ok(BotCompletion {
+                transferred,
+                csw: build_csw(tag, (length as usize).saturating_sub(transferred) as u32, status),
+                sense,
+            })
+        };
+        Some(run())
+    }
+}
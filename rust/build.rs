@@ -1,5 +1,7 @@
-//! Build script: compiles libdvdcss and libdvdread for Android when targeting aarch64-linux-android.
-//! Uses cc crate to compile C sources directly. For stream-only use, ioctl_stub.c replaces ioctl.c.
+//! Build script: compiles libdvdcss and libdvdread for Android when targeting aarch64-linux-android,
+//! or for the host with the host-dvd feature (benches). Uses cc crate to compile C sources
+//! directly, with the host's default compiler outside Android. For stream-only use,
+//! ioctl_stub.c replaces ioctl.c.
 
 use std::env;
 use std::path::PathBuf;
@@ -57,18 +59,18 @@ fn find_ndk_clang(target: &str) -> Option<(PathBuf, PathBuf)> {
 fn main() {
     println!("cargo:rustc-check-cfg=cfg(has_dvd)");
     let target = env::var("TARGET").unwrap_or_default();
-    if !target.contains("android") {
-        // Not building for Android - skip DVD libs
-        return;
-    }
-
-    if let Some((clang, ar)) = find_ndk_clang(&target) {
-        let cc_key = format!("CC_{}", target.replace("-", "_"));
-        let ar_key = format!("AR_{}", target.replace("-", "_"));
-        env::set_var(&cc_key, &clang);
-        env::set_var(&ar_key, ar);
-    } else {
-        eprintln!("cargo:warning=Android NDK not found. DVD libs will not be built. Set ANDROID_NDK_HOME.");
+    if target.contains("android") {
+        if let Some((clang, ar)) = find_ndk_clang(&target) {
+            let cc_key = format!("CC_{}", target.replace("-", "_"));
+            let ar_key = format!("AR_{}", target.replace("-", "_"));
+            env::set_var(&cc_key, &clang);
+            env::set_var(&ar_key, ar);
+        } else {
+            eprintln!("cargo:warning=Android NDK not found. DVD libs will not be built. Set ANDROID_NDK_HOME.");
+            return;
+        }
+    } else if env::var_os("CARGO_FEATURE_HOST_DVD").is_none() {
+        // Not building for Android - skip DVD libs unless host-dvd is enabled
         return;
     }
 
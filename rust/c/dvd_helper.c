@@ -1,137 +1,481 @@
 /**
- * DVD helper: reads IFO structures and returns JSON for titles/chapters.
+ * DVD helper: reads IFO structures and exports titles/chapters as packed binary.
  * Links against libdvdread. Used by Rust FFI.
+ *
+ * The disc is described at open (dvd_describe_disc) from VMGI alone; each
+ * title set's VTS IFO is parsed into the compact dvd_disc_t model the first
+ * time it is needed (dvd_disc_load_title_set). Title/chapter queries are then
+ * answered from the model without device I/O.
+ *
+ * dvd_nav_parse decodes the NAV pack at the start of a VOBU (nav_read.c) for
+ * the VOBU seek index in dvd/vobu_index.rs.
  */
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
 #include <stdint.h>
 #include <dvdread/ifo_read.h>
 #include <dvdread/ifo_types.h>
+#include <dvdread/nav_read.h>
+#include <dvdread/nav_types.h>
 
 #define DVD_BLOCK_LEN 2048
 
-static int snappend(char *buf, size_t *pos, size_t cap, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    int n = vsnprintf(buf + *pos, cap - *pos, fmt, ap);
-    va_end(ap);
-    if (n > 0 && (size_t)n < cap - *pos) {
-        *pos += (size_t)n;
-        return 0;
-    }
-    return -1;
+/*
+ * Chapter (PTT) entry: program chain and program number in the VTS, plus
+ * timing and sector range from the PGC cell playback table. Sectors are
+ * relative to the title set's title VOBs (DVDReadBlocks offsets).
+ */
+typedef struct {
+    uint16_t pgcn;
+    uint16_t pgn;
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    uint32_t start_sector;
+    uint32_t last_sector;
+    uint32_t first_cell; /* index into the title's cells */
+    uint32_t nr_of_cells;
+} dvd_chapter_info_t;
+
+/* Sector range (inclusive) of one cell, same offsets as the chapters. */
+typedef struct {
+    uint32_t first_sector;
+    uint32_t last_sector;
+} dvd_cell_range_t;
+
+/* Title entry from VMGI TT_SRPT plus its chapters from VTS_PTT_SRPT. */
+typedef struct {
+    uint8_t title_set_nr;
+    uint8_t vts_ttn;
+    uint8_t nr_of_angles;
+    uint8_t tmap_unit_s;    /* seconds per time map entry, 0 = no VTS_TMAPT */
+    uint16_t nr_of_ptts;
+    uint16_t nr_of_chapters;
+    uint32_t first_chapter; /* index into dvd_disc_t.chapters */
+    uint32_t duration_ms;
+    uint32_t nr_of_tmap_entries;
+    uint32_t first_tmap_entry; /* index into dvd_disc_t.tmap_sectors */
+    uint32_t nr_of_cells;
+    uint32_t first_cell; /* index into dvd_disc_t.cells */
+} dvd_title_info_t;
+
+/* VTS numbers are 1..99 on disc. */
+#define DVD_MAX_TITLE_SETS 100
+
+typedef struct dvd_disc_s {
+    uint16_t nr_of_titles;
+    dvd_title_info_t *titles;
+    uint8_t title_set_loaded[DVD_MAX_TITLE_SETS];
+    uint32_t nr_of_chapters;
+    uint32_t chapters_cap;
+    dvd_chapter_info_t *chapters;
+    uint32_t nr_of_tmap_entries;
+    uint32_t tmap_cap;
+    uint32_t *tmap_sectors;
+    uint32_t nr_of_cells;
+    uint32_t cells_cap;
+    dvd_cell_range_t *cells;
+} dvd_disc_t;
+
+void dvd_disc_free(dvd_disc_t *disc) {
+    if (!disc) return;
+    free(disc->titles);
+    free(disc->chapters);
+    free(disc->tmap_sectors);
+    free(disc->cells);
+    free(disc);
 }
 
-/**
- * Fills buf with JSON array of titles from VMGI TT_SRPT.
- * Returns 0 on success, -1 on error.
+/* Grows *pool (element size elem) so it holds at least need elements. */
+static int grow_pool(void **pool, uint32_t *cap, uint32_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    uint32_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    void *grown = realloc(*pool, (size_t)n * elem);
+    if (!grown) return -1;
+    *pool = grown;
+    *cap = n;
+    return 0;
+}
+
+static unsigned int bcd(uint8_t v) {
+    return (v >> 4) * 10 + (v & 0x0f);
+}
+
+/* dvd_time_t is BCD; the top two bits of frame_u give the frame rate (1 = 25, 3 = 30 fps). */
+static uint32_t dvd_time_ms(const dvd_time_t *t) {
+    uint32_t ms = ((bcd(t->hour) * 60 + bcd(t->minute)) * 60 + bcd(t->second)) * 1000;
+    unsigned int fps = ((t->frame_u >> 6) == 1) ? 25 : 30;
+    return ms + bcd(t->frame_u & 0x3f) * 1000 / fps;
+}
+
+/*
+ * Fills timing and sector range of a chapter from its program's cells and
+ * appends the cells' sector ranges, in PGC order, to the disc's cell pool
+ * (t->first_cell is the title's first). Only the first cell of an angle
+ * block counts towards the duration and is listed. Returns -1 if out of memory.
  */
-int dvd_list_titles_json(void *dvd, char *buf, size_t buf_size) {
-    dvd_reader_t *ctx = (dvd_reader_t *)dvd;
-    if (!ctx || !buf || buf_size < 16) return -1;
+static int describe_chapter(dvd_disc_t *disc, const pgcit_t *pgcit,
+                            const dvd_title_info_t *t, dvd_chapter_info_t *ch) {
+    ch->first_cell = disc->nr_of_cells - t->first_cell;
+    if (!pgcit || ch->pgcn < 1 || ch->pgcn > pgcit->nr_of_pgci_srp) return 0;
+    const pgc_t *pgc = pgcit->pgci_srp[ch->pgcn - 1].pgc;
+    if (!pgc || !pgc->program_map || !pgc->cell_playback) return 0;
+    if (ch->pgn < 1 || ch->pgn > pgc->nr_of_programs) return 0;
+    unsigned int first_cell = pgc->program_map[ch->pgn - 1];
+    unsigned int last_cell = ch->pgn < pgc->nr_of_programs
+        ? (unsigned int)pgc->program_map[ch->pgn] - 1
+        : pgc->nr_of_cells;
+    if (first_cell < 1 || last_cell > pgc->nr_of_cells || first_cell > last_cell) return 0;
+    uint32_t need = disc->nr_of_cells + (last_cell - first_cell + 1);
+    if (grow_pool((void **)&disc->cells, &disc->cells_cap, need, sizeof(dvd_cell_range_t)) < 0)
+        return -1;
 
-    ifo_handle_t *ifo = ifoOpen(ctx, 0);
-    if (!ifo) return -1;
+    ch->start_sector = pgc->cell_playback[first_cell - 1].first_sector;
+    ch->last_sector = pgc->cell_playback[last_cell - 1].last_sector;
+    for (unsigned int c = first_cell; c <= last_cell; c++) {
+        const cell_playback_t *cell = &pgc->cell_playback[c - 1];
+        if (cell->block_type == 1 && cell->block_mode > 1) continue; /* other angles */
+        ch->duration_ms += dvd_time_ms(&cell->playback_time);
+        dvd_cell_range_t *range = &disc->cells[disc->nr_of_cells++];
+        range->first_sector = cell->first_sector;
+        range->last_sector = cell->last_sector;
+        ch->nr_of_cells++;
+    }
+    return 0;
+}
 
-    if (ifoRead_TT_SRPT(ifo) != 1) {
-        ifoClose(ifo);
+/*
+ * Copies the title's time map (one entry per tmap_unit_s seconds, VOBU start
+ * sectors) into the disc model. The time map is indexed by PGC number.
+ */
+static int describe_tmap(dvd_disc_t *disc, const vts_tmapt_t *tmapt, int pgcn,
+                         dvd_title_info_t *t) {
+    if (!tmapt || pgcn < 1 || pgcn > tmapt->nr_of_tmaps) return 0;
+    const vts_tmap_t *tmap = &tmapt->tmap[pgcn - 1];
+    if (tmap->tmu == 0 || tmap->nr_of_entries == 0 || !tmap->map_ent) return 0;
+    uint32_t need = disc->nr_of_tmap_entries + tmap->nr_of_entries;
+    if (grow_pool((void **)&disc->tmap_sectors, &disc->tmap_cap, need, sizeof(uint32_t)) < 0)
         return -1;
+    t->tmap_unit_s = tmap->tmu;
+    t->first_tmap_entry = disc->nr_of_tmap_entries;
+    t->nr_of_tmap_entries = tmap->nr_of_entries;
+    for (unsigned int i = 0; i < tmap->nr_of_entries; i++) {
+        /* Top bit flags a discontinuity; the rest is the sector. */
+        disc->tmap_sectors[disc->nr_of_tmap_entries++] = tmap->map_ent[i] & 0x7fffffff;
     }
+    return 0;
+}
 
-    tt_srpt_t *tt = ifo->tt_srpt;
-    if (!tt || tt->nr_of_srpts == 0) {
-        ifoClose(ifo);
-        buf[0] = '[';
-        buf[1] = ']';
-        buf[2] = '\0';
+/**
+ * Copies the chapters of every title in title set vtsn into the disc model.
+ * Opens the VTS IFO once for all titles that reference it and reads
+ * VTS_PTT_SRPT, VTS_PGCIT and (when present) VTS_TMAPT from it.
+ * Titles whose VTS cannot be read are left with zero chapters.
+ */
+static int describe_title_set(dvd_reader_t *ctx, dvd_disc_t *disc, int vtsn) {
+    ifo_handle_t *vts = ifoOpen(ctx, vtsn);
+    if (!vts) return 0;
+    if (!vts->vts_ptt_srpt && ifoRead_VTS_PTT_SRPT(vts) != 1) {
+        ifoClose(vts);
         return 0;
     }
-
-    size_t pos = 0;
-    if (snappend(buf, &pos, buf_size, "[") < 0) goto fail;
-    for (unsigned int i = 0; i < tt->nr_of_srpts; i++) {
-        title_info_t *t = &tt->title[i];
-        if (i > 0) {
-            if (snappend(buf, &pos, buf_size, ",") < 0) goto fail;
+    if (!vts->vts_pgcit) ifoRead_PGCIT(vts);
+    if (!vts->vts_tmapt) ifoRead_VTS_TMAPT(vts);
+    vts_ptt_srpt_t *ptt = vts->vts_ptt_srpt;
+    for (unsigned int i = 0; i < disc->nr_of_titles; i++) {
+        dvd_title_info_t *t = &disc->titles[i];
+        if (t->title_set_nr != vtsn) continue;
+        if (!ptt || t->vts_ttn < 1 || t->vts_ttn > ptt->nr_of_srpts) continue;
+        ttu_t *ttu = &ptt->title[t->vts_ttn - 1];
+        uint32_t need = disc->nr_of_chapters + ttu->nr_of_ptts;
+        if (grow_pool((void **)&disc->chapters, &disc->chapters_cap, need,
+                      sizeof(dvd_chapter_info_t)) < 0) {
+            ifoClose(vts);
+            return -1;
+        }
+        t->first_chapter = disc->nr_of_chapters;
+        t->nr_of_chapters = ttu->nr_of_ptts;
+        t->duration_ms = 0; /* a retry after a failed load starts over */
+        t->first_cell = disc->nr_of_cells;
+        for (unsigned int c = 0; c < ttu->nr_of_ptts; c++) {
+            dvd_chapter_info_t *ch = &disc->chapters[disc->nr_of_chapters++];
+            memset(ch, 0, sizeof(*ch));
+            ch->pgcn = ttu->ptt[c].pgcn;
+            ch->pgn = ttu->ptt[c].pgn;
+            if (describe_chapter(disc, vts->vts_pgcit, t, ch) < 0) {
+                ifoClose(vts);
+                return -1;
+            }
+            ch->start_ms = t->duration_ms;
+            t->duration_ms += ch->duration_ms;
+        }
+        t->nr_of_cells = disc->nr_of_cells - t->first_cell;
+        if (ttu->nr_of_ptts > 0 &&
+            describe_tmap(disc, vts->vts_tmapt, ttu->ptt[0].pgcn, t) < 0) {
+            ifoClose(vts);
+            return -1;
         }
-        /* title_id is 1-based in DVD spec */
-        if (snappend(buf, &pos, buf_size,
-            "{\"titleNumber\":%u,\"titleSetNr\":%u,\"vtsTtn\":%u,\"chapters\":%u}",
-            i + 1, (unsigned)t->title_set_nr, (unsigned)t->vts_ttn,
-            (unsigned)t->nr_of_ptts) < 0) goto fail;
     }
-    if (snappend(buf, &pos, buf_size, "]") < 0) goto fail;
-    ifoClose(ifo);
+    ifoClose(vts);
     return 0;
-fail:
-    ifoClose(ifo);
-    return -1;
 }
 
 /**
- * Fills buf with JSON array of chapters for the given title.
- * title_id is 1-based. Uses VMGI tt_srpt to find title_set_nr/vts_ttn,
- * then opens VTS IFO and reads VTS_PTT_SRPT.
- * Returns 0 on success, -1 on error.
+ * Parses VMGI and returns the disc model with every title's chapters still
+ * unloaded. Returns NULL if the VMGI cannot be read. Free with dvd_disc_free.
  */
-int dvd_list_chapters_json(void *dvd, int title_id, char *buf, size_t buf_size) {
+dvd_disc_t *dvd_describe_disc(void *dvd) {
     dvd_reader_t *ctx = (dvd_reader_t *)dvd;
-    if (!ctx || !buf || buf_size < 16 || title_id < 1) return -1;
+    if (!ctx) return NULL;
 
     ifo_handle_t *vmgi = ifoOpen(ctx, 0);
-    if (!vmgi) return -1;
-    if (ifoRead_TT_SRPT(vmgi) != 1) {
+    if (!vmgi) return NULL;
+    if (!vmgi->tt_srpt && ifoRead_TT_SRPT(vmgi) != 1) {
         ifoClose(vmgi);
-        return -1;
+        return NULL;
     }
-    tt_srpt_t *tt = vmgi->tt_srpt;
-    if (!tt || (unsigned)title_id > tt->nr_of_srpts) {
+
+    dvd_disc_t *disc = calloc(1, sizeof(*disc));
+    if (!disc) {
         ifoClose(vmgi);
-        return -1;
+        return NULL;
+    }
+    tt_srpt_t *tt = vmgi->tt_srpt;
+    if (tt && tt->nr_of_srpts > 0) {
+        disc->titles = calloc(tt->nr_of_srpts, sizeof(*disc->titles));
+        if (!disc->titles) {
+            ifoClose(vmgi);
+            dvd_disc_free(disc);
+            return NULL;
+        }
+        disc->nr_of_titles = tt->nr_of_srpts;
+        for (unsigned int i = 0; i < tt->nr_of_srpts; i++) {
+            title_info_t *src = &tt->title[i];
+            dvd_title_info_t *t = &disc->titles[i];
+            t->title_set_nr = src->title_set_nr;
+            t->vts_ttn = src->vts_ttn;
+            t->nr_of_angles = src->nr_of_angles;
+            t->nr_of_ptts = src->nr_of_ptts;
+        }
     }
-    title_info_t *ti = &tt->title[title_id - 1];
-    int title_set_nr = ti->title_set_nr;
-    int vts_ttn = ti->vts_ttn;
     ifoClose(vmgi);
+    return disc;
+}
 
-    ifo_handle_t *vts = ifoOpen(ctx, title_set_nr);
-    if (!vts) return -1;
-    if (ifoRead_VTS_PTT_SRPT(vts) != 1) {
-        ifoClose(vts);
-        return -1;
-    }
-    vts_ptt_srpt_t *ptt = vts->vts_ptt_srpt;
-    if (!ptt || (unsigned)vts_ttn > ptt->nr_of_srpts) {
-        ifoClose(vts);
-        return -1;
-    }
-    ttu_t *ttu = &ptt->title[vts_ttn - 1];
-    unsigned int nr = ttu->nr_of_ptts;
-    if (nr == 0) {
-        ifoClose(vts);
-        buf[0] = '[';
-        buf[1] = ']';
-        buf[2] = '\0';
-        return 0;
-    }
+/**
+ * Parses title set vtsn into the model unless already done. A VTS that cannot
+ * be read counts as loaded, with zero chapters for its titles.
+ * Returns 0, or -1 if out of memory (the set stays unloaded).
+ */
+int dvd_disc_load_title_set(dvd_disc_t *disc, void *dvd, int vtsn) {
+    if (!disc || !dvd || vtsn < 1 || vtsn >= DVD_MAX_TITLE_SETS) return -1;
+    if (disc->title_set_loaded[vtsn]) return 0;
+    if (describe_title_set((dvd_reader_t *)dvd, disc, vtsn) < 0) return -1;
+    disc->title_set_loaded[vtsn] = 1;
+    return 0;
+}
+
+/**
+ * Returns 1 if title set vtsn has been loaded, else 0.
+ */
+int dvd_disc_title_set_loaded(const dvd_disc_t *disc, int vtsn) {
+    if (!disc || vtsn < 1 || vtsn >= DVD_MAX_TITLE_SETS) return 0;
+    return disc->title_set_loaded[vtsn];
+}
+
+/**
+ * Returns the number of titles on the disc.
+ */
+int dvd_disc_title_count(const dvd_disc_t *disc) {
+    return disc ? disc->nr_of_titles : 0;
+}
+
+/**
+ * Returns the title set number (VTS) of the 1-based title, or -1.
+ */
+int dvd_disc_title_set(const dvd_disc_t *disc, int title_id) {
+    if (!disc || title_id < 1 || title_id > disc->nr_of_titles) return -1;
+    return disc->titles[title_id - 1].title_set_nr;
+}
+
+/**
+ * Returns the number of chapters of the 1-based title and points *chapters
+ * at them (sorted by chapter number), or -1.
+ */
+int dvd_disc_title_chapters(const dvd_disc_t *disc, int title_id,
+                            const dvd_chapter_info_t **chapters) {
+    if (!disc || !chapters || title_id < 1 || title_id > disc->nr_of_titles) return -1;
+    const dvd_title_info_t *t = &disc->titles[title_id - 1];
+    *chapters = t->nr_of_chapters ? &disc->chapters[t->first_chapter] : NULL;
+    return t->nr_of_chapters;
+}
+
+/**
+ * Returns the number of cells of the 1-based title and points *cells at them
+ * (PGC order, chapter by chapter; see dvd_chapter_info_t.first_cell), or -1.
+ */
+int dvd_disc_title_cells(const dvd_disc_t *disc, int title_id,
+                         const dvd_cell_range_t **cells) {
+    if (!disc || !cells || title_id < 1 || title_id > disc->nr_of_titles) return -1;
+    const dvd_title_info_t *t = &disc->titles[title_id - 1];
+    *cells = t->nr_of_cells ? &disc->cells[t->first_cell] : NULL;
+    return (int)t->nr_of_cells;
+}
+
+/**
+ * Returns the number of VTS_TMAPT entries of the 1-based title, stores the
+ * seconds per entry in *unit_s and points *sectors at them, or -1.
+ * Entry i holds the VOBU start sector at (i + 1) * unit_s seconds.
+ */
+int dvd_disc_title_tmap(const dvd_disc_t *disc, int title_id, uint32_t *unit_s,
+                        const uint32_t **sectors) {
+    if (!disc || !unit_s || !sectors || title_id < 1 || title_id > disc->nr_of_titles) return -1;
+    const dvd_title_info_t *t = &disc->titles[title_id - 1];
+    *unit_s = t->tmap_unit_s;
+    *sectors = t->nr_of_tmap_entries ? &disc->tmap_sectors[t->first_tmap_entry] : NULL;
+    return (int)t->nr_of_tmap_entries;
+}
 
-    size_t pos = 0;
-    if (snappend(buf, &pos, buf_size, "[") < 0) goto fail_ch;
-    for (unsigned int i = 0; i < nr; i++) {
-        if (i > 0) {
-            if (snappend(buf, &pos, buf_size, ",") < 0) goto fail_ch;
+/*
+ * Packed metadata export (little endian, fixed-size records):
+ *
+ *   header   16 bytes  magic "DVDM", version, title/chapter counts, record sizes
+ *   titles   nr_of_titles * DVD_META_TITLE_SIZE
+ *   chapters nr_of_chapters * DVD_META_CHAPTER_SIZE, grouped by title in
+ *            title order; a title's first_chapter indexes these records
+ *
+ * Readers must use the record sizes from the header so fields can be
+ * appended to records without breaking older parsers.
+ */
+#define DVD_META_MAGIC 0x4D445644u /* "DVDM" */
+#define DVD_META_VERSION 2
+#define DVD_META_HEADER_SIZE 16
+#define DVD_META_TITLE_SIZE 20
+#define DVD_META_CHAPTER_SIZE 24
+
+static uint8_t *put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+/*
+ * Chapter records the export writes. The pool can hold more than this:
+ * a title set that failed to load and was retried leaves its first
+ * attempt's chapters behind.
+ */
+static uint32_t exported_chapters(const dvd_disc_t *disc) {
+    uint32_t n = 0;
+    for (unsigned int i = 0; i < disc->nr_of_titles; i++)
+        n += disc->titles[i].nr_of_chapters;
+    return n;
+}
+
+/**
+ * Returns the number of bytes dvd_disc_export needs for this disc.
+ */
+size_t dvd_disc_export_size(const dvd_disc_t *disc) {
+    if (!disc) return 0;
+    return DVD_META_HEADER_SIZE
+        + (size_t)disc->nr_of_titles * DVD_META_TITLE_SIZE
+        + (size_t)exported_chapters(disc) * DVD_META_CHAPTER_SIZE;
+}
+
+/**
+ * Writes the packed metadata into buf.
+ * Returns bytes written, or -1 if buf is smaller than dvd_disc_export_size.
+ */
+long dvd_disc_export(const dvd_disc_t *disc, uint8_t *buf, size_t buf_size) {
+    size_t need = dvd_disc_export_size(disc);
+    if (!disc || !buf || buf_size < need) return -1;
+
+    uint8_t *p = buf;
+    p = put32(p, DVD_META_MAGIC);
+    p = put16(p, DVD_META_VERSION);
+    p = put16(p, disc->nr_of_titles);
+    p = put32(p, exported_chapters(disc));
+    p = put16(p, DVD_META_TITLE_SIZE);
+    p = put16(p, DVD_META_CHAPTER_SIZE);
+
+    /* The pool is in title set load order; records are in title order. */
+    uint32_t first_record = 0;
+    for (unsigned int i = 0; i < disc->nr_of_titles; i++) {
+        const dvd_title_info_t *t = &disc->titles[i];
+        /* title number is 1-based in DVD spec */
+        p = put16(p, (uint16_t)(i + 1));
+        *p++ = t->title_set_nr;
+        *p++ = t->vts_ttn;
+        *p++ = t->nr_of_angles;
+        *p++ = 0;
+        p = put16(p, t->nr_of_ptts);
+        p = put16(p, t->nr_of_chapters);
+        p = put16(p, 0);
+        p = put32(p, first_record);
+        first_record += t->nr_of_chapters;
+        p = put32(p, t->duration_ms);
+    }
+    for (unsigned int i = 0; i < disc->nr_of_titles; i++) {
+        const dvd_title_info_t *t = &disc->titles[i];
+        for (unsigned int c = 0; c < t->nr_of_chapters; c++) {
+            const dvd_chapter_info_t *ch = &disc->chapters[t->first_chapter + c];
+            p = put16(p, (uint16_t)(c + 1));
+            p = put16(p, ch->pgcn);
+            p = put16(p, ch->pgn);
+            p = put16(p, 0);
+            p = put32(p, ch->start_ms);
+            p = put32(p, ch->duration_ms);
+            p = put32(p, ch->start_sector);
+            p = put32(p, ch->last_sector);
         }
-        /* Chapter: id (1-based), pgcn, pgn - no duration without TMAP */
-        ptt_info_t *pi = &ttu->ptt[i];
-        if (snappend(buf, &pos, buf_size, "{\"id\":%u,\"pgcn\":%u,\"pgn\":%u}",
-            i + 1, (unsigned)pi->pgcn, (unsigned)pi->pgn) < 0) goto fail_ch;
     }
-    if (snappend(buf, &pos, buf_size, "]") < 0) goto fail_ch;
-    ifoClose(vts);
+    return (long)(p - buf);
+}
+
+/*
+ * What the seek index needs from a NAV pack (PCI + DSI). Sectors are title
+ * VOB offsets like those of dvd_chapter_info_t; search offsets are relative
+ * to this VOBU, raw from the DSI (SRI_END_OF_CELL or flag bits included).
+ */
+typedef struct {
+    uint32_t lbn;          /* sector of this NAV pack, the VOBU start */
+    uint32_t vobu_ea;      /* last sector of the VOBU, relative */
+    uint32_t next_vobu;
+    uint32_t fwda[19];     /* first VOBU at least 120, 60, 30, 10, 7.5 ... 0.5 s later */
+    uint32_t start_ptm;    /* 90 kHz presentation times of the VOBU */
+    uint32_t end_ptm;
+    uint16_t vob_id;
+    uint8_t cell_id;
+} dvd_nav_info_t;
+
+/* NAV pack layout: PCI packet at 0x26 (data at 0x2d), DSI packet at 0x400 (data at 0x407). */
+static int is_nav_packet(const uint8_t *p, uint8_t substream) {
+    return p[0] == 0 && p[1] == 0 && p[2] == 1 && p[3] == 0xbf && p[6] == substream;
+}
+
+/** Decodes the NAV pack in a 2048-byte block. Returns 0, or -1 if it is not one. */
+int dvd_nav_parse(const uint8_t *block, dvd_nav_info_t *info) {
+    if (!block || !info) return -1;
+    if (block[0] != 0 || block[1] != 0 || block[2] != 1 || block[3] != 0xba) return -1;
+    if (!is_nav_packet(block + 0x26, 0x00) || !is_nav_packet(block + 0x400, 0x01)) return -1;
+    pci_t pci;
+    dsi_t dsi;
+    navRead_PCI(&pci, (unsigned char *)block + 0x2d);
+    navRead_DSI(&dsi, (unsigned char *)block + 0x407);
+    info->lbn = dsi.dsi_gi.nv_pck_lbn;
+    info->vobu_ea = dsi.dsi_gi.vobu_ea;
+    info->next_vobu = dsi.vobu_sri.next_vobu;
+    memcpy(info->fwda, dsi.vobu_sri.fwda, sizeof(info->fwda));
+    info->start_ptm = pci.pci_gi.vobu_s_ptm;
+    info->end_ptm = pci.pci_gi.vobu_e_ptm;
+    info->vob_id = dsi.dsi_gi.vobu_vob_idn;
+    info->cell_id = dsi.dsi_gi.vobu_c_idn;
     return 0;
-fail_ch:
-    ifoClose(vts);
-    return -1;
 }
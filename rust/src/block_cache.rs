@@ -0,0 +1,349 @@
+//! Bounded LRU block cache over ScsiBlockDevice.
+//! Shared (Arc) by the NTFS reader and the libdvdread stream callbacks so
+//! metadata sectors (UDF, IFO/BUP, MFT, index blocks) are fetched once.
+//! Large reads bypass the cache so streaming data doesn't evict metadata.
+
+use crate::block_device::{IoVec, ScsiBlockDevice};
+use crate::io_stats::IoStats;
+use crate::recovery::Recovery;
+use std::collections::{BTreeMap, HashMap};
+use std::io;
+use std::sync::{Arc, Mutex};
+
+/// Default memory budget for cached block data.
+pub const DEFAULT_BUDGET_BYTES: usize = 4 * 1024 * 1024;
+/// Reads at least this large go straight to the device.
+const BYPASS_BYTES: usize = 64 * 1024;
+/// Extra bytes fetched after a miss that continues the previous miss.
+const READAHEAD_BYTES: usize = 32 * 1024;
+
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CacheStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub readahead_blocks: u64,
+    pub evictions: u64,
+    pub bypass_reads: u64,
+}
+
+struct Slot {
+    tick: u64,
+    data: Box<[u8]>,
+}
+
+struct Inner {
+    device: ScsiBlockDevice,
+    slots: HashMap<u64, Slot>,
+    /// tick -> lba, oldest first.
+    lru: BTreeMap<u64, u64>,
+    tick: u64,
+    /// Buffers of evicted slots, reused for new ones.
+    free: Vec<Box<[u8]>>,
+    /// Reused for miss fills.
+    scratch: Vec<u8>,
+    /// End of the last miss run, for sequential read-ahead.
+    last_miss_end: u64,
+    stats: CacheStats,
+}
+
+pub struct BlockCache {
+    inner: Mutex<Inner>,
+    block_size: u32,
+    block_count: u64,
+    max_blocks: usize,
+    /// The device's command counters and read recovery, usable without the
+    /// cache lock.
+    io_stats: Arc<IoStats>,
+    recovery: Arc<Recovery>,
+}
+
+impl BlockCache {
+    pub fn new(device: ScsiBlockDevice, budget_bytes: usize) -> Self {
+        let block_size = device.block_size;
+        let block_count = device.block_count;
+        let max_blocks = std::cmp::max(budget_bytes / block_size.max(1) as usize, 1);
+        let io_stats = device.stats.clone();
+        let recovery = device.recovery.clone();
+        Self {
+            inner: Mutex::new(Inner {
+                device,
+                slots: HashMap::new(),
+                lru: BTreeMap::new(),
+                tick: 0,
+                free: Vec::new(),
+                scratch: Vec::new(),
+                last_miss_end: u64::MAX,
+                stats: CacheStats::default(),
+            }),
+            block_size,
+            block_count,
+            max_blocks,
+            io_stats,
+            recovery,
+        }
+    }
+
+    pub fn block_size(&self) -> u32 {
+        self.block_size
+    }
+
+    pub fn block_count(&self) -> u64 {
+        self.block_count
+    }
+
+    pub fn stats(&self) -> CacheStats {
+        self.inner.lock().unwrap().stats
+    }
+
+    pub fn io_stats(&self) -> &IoStats {
+        &self.io_stats
+    }
+
+    /// Blocks zero-filled by the recovery policy are cached like read ones.
+    pub fn recovery(&self) -> &Recovery {
+        &self.recovery
+    }
+
+    /// Same contract as ScsiBlockDevice::read_blocks.
+    pub fn read_blocks(&self, lba: u64, count: u32, buffer: &mut [u8]) -> io::Result<usize> {
+        let bs = self.block_size as usize;
+        let bytes = count as usize * bs;
+        if buffer.len() < bytes {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Buffer too small"));
+        }
+        let mut inner = self.inner.lock().unwrap();
+        if bytes >= BYPASS_BYTES {
+            inner.stats.bypass_reads += 1;
+            return inner.device.read_blocks(lba, count, &mut buffer[..bytes]);
+        }
+        let mut i = 0u64;
+        while i < count as u64 {
+            let cur = lba + i;
+            let dst = &mut buffer[i as usize * bs..(i as usize + 1) * bs];
+            if self.copy_cached(&mut inner, cur, 0, dst, true) {
+                i += 1;
+                continue;
+            }
+            // Miss: fetch the run of uncached blocks in one command.
+            let mut run = 1u64;
+            while i + run < count as u64 && !inner.slots.contains_key(&(cur + run)) {
+                run += 1;
+            }
+            inner.stats.misses += run;
+            self.fill(&mut inner, cur, run)?;
+            for j in 0..run {
+                let off = (i + j) as usize * bs;
+                if !self.copy_cached(&mut inner, cur + j, 0, &mut buffer[off..off + bs], false) {
+                    return Err(io::Error::new(io::ErrorKind::UnexpectedEof, "Short read"));
+                }
+            }
+            i += run;
+        }
+        Ok(bytes)
+    }
+
+    /// Copy `dst.len()` bytes at `offset` inside block `lba`, through the cache.
+    pub fn copy_from_block(&self, lba: u64, offset: usize, dst: &mut [u8]) -> io::Result<()> {
+        if offset + dst.len() > self.block_size as usize {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Range exceeds block"));
+        }
+        let mut inner = self.inner.lock().unwrap();
+        if self.copy_cached(&mut inner, lba, offset, dst, true) {
+            return Ok(());
+        }
+        inner.stats.misses += 1;
+        self.fill(&mut inner, lba, 1)?;
+        if self.copy_cached(&mut inner, lba, offset, dst, false) {
+            Ok(())
+        } else {
+            Err(io::Error::new(io::ErrorKind::UnexpectedEof, "Short read"))
+        }
+    }
+
+    /// Reads `count` blocks at `lba` into the cache in one command, whatever
+    /// the size, so the scattered small reads that follow are hits. Cached
+    /// blocks at either end are skipped; at most half the budget is filled.
+    pub fn prefetch(&self, lba: u64, count: u32) -> io::Result<()> {
+        let mut inner = self.inner.lock().unwrap();
+        let end = lba + count as u64;
+        let Some(first) = (lba..end).find(|b| !inner.slots.contains_key(b)) else {
+            return Ok(());
+        };
+        let last = (first..end).rev().find(|b| !inner.slots.contains_key(b)).unwrap_or(first);
+        let run = std::cmp::min(last - first + 1, (self.max_blocks / 2).max(1) as u64);
+        inner.stats.readahead_blocks += run;
+        self.fill(&mut inner, first, run)
+    }
+
+    /// Scatter-gather reads are streaming reads; they always bypass the cache.
+    pub fn read_blocks_vectored(&self, lba: u64, iov: &[IoVec]) -> io::Result<usize> {
+        let mut inner = self.inner.lock().unwrap();
+        inner.stats.bypass_reads += 1;
+        inner.device.read_blocks_vectored(lba, iov)
+    }
+
+    /// Copy out of a cached block and mark it most recently used.
+    fn copy_cached(
+        &self,
+        inner: &mut Inner,
+        lba: u64,
+        offset: usize,
+        dst: &mut [u8],
+        count_hit: bool,
+    ) -> bool {
+        inner.tick += 1;
+        let tick = inner.tick;
+        let Some(slot) = inner.slots.get_mut(&lba) else {
+            return false;
+        };
+        dst.copy_from_slice(&slot.data[offset..offset + dst.len()]);
+        let old = std::mem::replace(&mut slot.tick, tick);
+        inner.lru.remove(&old);
+        inner.lru.insert(tick, lba);
+        if count_hit {
+            inner.stats.hits += 1;
+        }
+        true
+    }
+
+    /// Read `run` blocks at `lba` (plus read-ahead when sequential) into the cache.
+    fn fill(&self, inner: &mut Inner, lba: u64, run: u64) -> io::Result<()> {
+        let bs = self.block_size as usize;
+        let mut total = run;
+        if lba == inner.last_miss_end {
+            let extra = (READAHEAD_BYTES / bs) as u64;
+            total = std::cmp::min(run + extra, (self.max_blocks / 2).max(1) as u64).max(run);
+        }
+        if self.block_count > 0 {
+            total = std::cmp::min(total, self.block_count.saturating_sub(lba)).max(1);
+        }
+        let mut scratch = std::mem::take(&mut inner.scratch);
+        if scratch.len() < total as usize * bs {
+            scratch.resize(total as usize * bs, 0);
+        }
+        let result = inner
+            .device
+            .read_blocks(lba, total as u32, &mut scratch[..total as usize * bs]);
+        let n = match result {
+            Ok(n) => n,
+            Err(e) => {
+                inner.scratch = scratch;
+                return Err(e);
+            }
+        };
+        let got = (n / bs) as u64;
+        for j in 0..got {
+            let src = &scratch[j as usize * bs..(j as usize + 1) * bs];
+            self.insert(inner, lba + j, src);
+        }
+        if got > run {
+            inner.stats.readahead_blocks += got - run;
+        }
+        inner.last_miss_end = lba + got;
+        inner.scratch = scratch;
+        Ok(())
+    }
+
+    fn insert(&self, inner: &mut Inner, lba: u64, src: &[u8]) {
+        inner.tick += 1;
+        let tick = inner.tick;
+        if let Some(slot) = inner.slots.get_mut(&lba) {
+            slot.data.copy_from_slice(src);
+            let old = std::mem::replace(&mut slot.tick, tick);
+            inner.lru.remove(&old);
+            inner.lru.insert(tick, lba);
+            return;
+        }
+        while inner.slots.len() >= self.max_blocks {
+            let Some((_, victim)) = inner.lru.pop_first() else { break };
+            if let Some(slot) = inner.slots.remove(&victim) {
+                inner.free.push(slot.data);
+                inner.stats.evictions += 1;
+            }
+        }
+        let mut data = inner
+            .free
+            .pop()
+            .unwrap_or_else(|| vec![0u8; src.len()].into_boxed_slice());
+        data.copy_from_slice(src);
+        inner.slots.insert(lba, Slot { tick, data });
+        inner.lru.insert(tick, lba);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::block_device::testing::{mem_device, numbered_blocks, BLOCK};
+
+    fn cache(blocks: usize, budget_blocks: usize) -> (BlockCache, Arc<Mutex<Vec<(u64, u32)>>>) {
+        let (dev, reads) = mem_device(numbered_blocks(blocks));
+        (BlockCache::new(dev, budget_blocks * BLOCK), reads)
+    }
+
+    fn read(cache: &BlockCache, lba: u64, count: u32) -> Vec<u8> {
+        let mut buf = vec![0u8; count as usize * BLOCK];
+        assert_eq!(cache.read_blocks(lba, count, &mut buf).unwrap(), buf.len());
+        buf
+    }
+
+    #[test]
+    fn hits_after_a_miss_and_evicts_least_recently_used() {
+        let (cache, reads) = cache(64, 4);
+        assert_eq!(read(&cache, 10, 1), [10u8; BLOCK]);
+        read(&cache, 20, 1);
+        read(&cache, 30, 1);
+        read(&cache, 40, 1);
+        read(&cache, 10, 1); // 10 is now newer than 20
+        read(&cache, 50, 1); // evicts 20
+        assert_eq!(reads.lock().unwrap().len(), 5);
+        read(&cache, 10, 1);
+        assert_eq!(reads.lock().unwrap().len(), 5);
+        assert_eq!(read(&cache, 20, 1), [20u8; BLOCK]);
+        assert_eq!(reads.lock().unwrap().last(), Some(&(20, 1)));
+        let s = cache.stats();
+        assert_eq!((s.hits, s.misses, s.evictions), (2, 6, 2));
+    }
+
+    #[test]
+    fn uncached_runs_are_fetched_in_one_command() {
+        let (cache, reads) = cache(64, 16);
+        read(&cache, 3, 1);
+        let buf = read(&cache, 1, 5);
+        assert_eq!(buf[..BLOCK], [1u8; BLOCK]);
+        assert_eq!(buf[4 * BLOCK..], [5u8; BLOCK]);
+        // 1..3 in one command, 3 from the cache, then 4..6 continuing it.
+        assert_eq!(reads.lock().unwrap()[1..], [(1, 2), (4, 2)]);
+    }
+
+    #[test]
+    fn sequential_misses_read_ahead_within_half_the_budget() {
+        let (cache, reads) = cache(256, 32);
+        read(&cache, 0, 1);
+        read(&cache, 1, 1);
+        // The second miss continues the first: fetched with read-ahead,
+        // capped at half the budget.
+        assert_eq!(reads.lock().unwrap()[1], (1, 16));
+        assert_eq!(cache.stats().readahead_blocks, 15);
+        assert_eq!(read(&cache, 16, 1), [16u8; BLOCK]);
+        assert_eq!(reads.lock().unwrap().len(), 2);
+    }
+
+    #[test]
+    fn read_ahead_stops_at_the_last_block() {
+        let (cache, reads) = cache(4, 32);
+        read(&cache, 0, 1);
+        read(&cache, 1, 1);
+        assert_eq!(reads.lock().unwrap()[1], (1, 3));
+    }
+
+    #[test]
+    fn large_reads_bypass_the_cache() {
+        let (cache, reads) = cache(256, 512);
+        let blocks = (BYPASS_BYTES / BLOCK) as u32;
+        read(&cache, 0, blocks);
+        read(&cache, 0, 1);
+        assert_eq!(reads.lock().unwrap()[..], [(0, blocks), (0, 1)]);
+        assert_eq!(cache.stats().bypass_reads, 1);
+    }
+}
@@ -1,12 +1,76 @@
 //! Block device abstraction over SCSI BOT.
 
+use crate::io_stats::IoStats;
+use crate::recovery::{self, Failure, Recovery, RecoveryPolicy};
 use crate::scsi;
+use crate::uas::{self, UasCommand};
 use std::io;
+use std::sync::Arc;
+use std::time::Instant;
+
+/// UAS pipe IDs, as in the Pipe Usage descriptor.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum UasPipe {
+    Command = 1,
+    Status = 2,
+    DataIn = 3,
+    DataOut = 4,
+}
 
 /// Transfer handler for bulk USB transfers. Implemented by JNI (Kotlin) or C callbacks.
 pub trait TransferHandler: Send {
     fn bulk_out(&self, session_id: u64, data: &[u8]) -> io::Result<usize>;
     fn bulk_in(&self, session_id: u64, buf: &mut [u8]) -> io::Result<usize>;
+    /// Largest single bulk transfer the host side accepts.
+    fn max_transfer_size(&self) -> usize {
+        DEFAULT_MAX_TRANSFER_BYTES
+    }
+    /// True when the session claimed the UAS alternate setting; BOT otherwise.
+    fn is_uas(&self) -> bool {
+        false
+    }
+    /// Transfer on a UAS pipe. BOT handlers map everything onto their one pipe pair.
+    fn pipe_out(&self, session_id: u64, _pipe: UasPipe, data: &[u8]) -> io::Result<usize> {
+        self.bulk_out(session_id, data)
+    }
+    fn pipe_in(&self, session_id: u64, _pipe: UasPipe, buf: &mut [u8]) -> io::Result<usize> {
+        self.bulk_in(session_id, buf)
+    }
+    /// Runs a whole BOT command in one call: CBW, data phase, CSW and, on Check
+    /// Condition, `sense_cbw` with its sense data and CSW. None when the handler
+    /// has no combined path; the device then issues each phase itself.
+    fn execute_bot(
+        &self,
+        _session_id: u64,
+        _cbw: &[u8; scsi::CBW_SIZE],
+        _sense_cbw: &[u8; scsi::CBW_SIZE],
+        _data: Option<(*mut u8, usize)>,
+        _direction: u8,
+    ) -> Option<io::Result<BotCompletion>> {
+        None
+    }
+}
+
+/// Outcome of TransferHandler::execute_bot.
+pub struct BotCompletion {
+    /// Bytes moved in the data phase.
+    pub transferred: usize,
+    pub csw: [u8; scsi::CSW_SIZE],
+    /// REQUEST SENSE data, when the CSW reported Check Condition.
+    pub sense: Option<[u8; scsi::SENSE_SIZE]>,
+}
+
+/// Bulk transfer size used when the handler doesn't report one (Linux's
+/// usb-storage default of 240 sectors).
+pub const DEFAULT_MAX_TRANSFER_BYTES: usize = 120 * 1024;
+
+/// One scatter-gather segment. Layout-compatible with POSIX `struct iovec`,
+/// so a C iovec array can be used as `&[IoVec]` directly.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct IoVec {
+    pub base: *mut u8,
+    pub len: usize,
 }
 
 pub struct ScsiBlockDevice {
@@ -15,39 +79,56 @@ pub struct ScsiBlockDevice {
     pub block_size: u32,
     pub block_count: u64,
     pub tag: std::sync::atomic::AtomicU32,
+    /// Blocks per READ command, from the bulk endpoint and Block Limits VPD.
+    pub max_transfer_blocks: u32,
+    /// Set when the capacity needs 64-bit LBAs (READ CAPACITY(10) saturated).
+    pub use_read_16: bool,
+    /// UAS with queued commands instead of BOT.
+    pub uas: bool,
+    /// Command counters, shared with getIoStats.
+    pub stats: Arc<IoStats>,
+    /// Read recovery policy and bad-sector map (strict by default).
+    pub recovery: Arc<Recovery>,
 }
 
 impl ScsiBlockDevice {
     pub fn new(transfer: Box<dyn TransferHandler>, session_id: u64) -> io::Result<Self> {
-        let mut dev = Self {
-            session_id,
-            transfer,
-            block_size: 512,
-            block_count: 0,
-            tag: std::sync::atomic::AtomicU32::new(1),
-        };
+        let mut dev = Self::new_minimal(transfer, session_id);
         dev.read_capacity()?;
+        dev.update_transfer_limits();
         Ok(dev)
     }
 
     /// Create without read_capacity (e.g. for INQUIRY on devices that may not support it).
     pub fn new_minimal(transfer: Box<dyn TransferHandler>, session_id: u64) -> Self {
+        let max_transfer_blocks = (transfer.max_transfer_size() / 512).clamp(1, u16::MAX as usize) as u32;
+        let uas = transfer.is_uas();
         Self {
             session_id,
             transfer,
             block_size: 512,
             block_count: 0,
             tag: std::sync::atomic::AtomicU32::new(1),
+            max_transfer_blocks,
+            use_read_16: false,
+            uas,
+            stats: Arc::new(IoStats::new()),
+            recovery: Arc::default(),
         }
     }
 
     /// Run SCSI INQUIRY and return peripheral device type (byte 0).
     /// 0x00 = block, 0x05 = CD/DVD-ROM
     pub fn inquiry(&self) -> io::Result<u8> {
+        Ok(self.inquiry_data()?[0])
+    }
+
+    /// Standard INQUIRY response (peripheral type in byte 0, version in byte 2).
+    fn inquiry_data(&self) -> io::Result<[u8; 36]> {
         let cdb = scsi::build_inquiry_cdb();
         let mut buf = [0u8; 36];
         self.execute_command(&cdb, Some((buf.as_mut_ptr(), 36)), scsi::DIRECTION_IN)?;
-        Ok(buf[0])
+        Ok(buf)
     }
 
     fn next_tag(&self) -> u32 {
@@ -60,6 +141,10 @@ impl ScsiBlockDevice {
         self.execute_command(&cdb, Some((&mut buffer as *mut u8, 8)), scsi::DIRECTION_IN)?;
         let last_lba = u32::from_be_bytes([buffer[0], buffer[1], buffer[2], buffer[3]]) as u64;
         let block_len = u32::from_be_bytes([buffer[4], buffer[5], buffer[6], buffer[7]]);
+        if last_lba == u32::MAX as u64 {
+            // More than 2^32 blocks: only READ CAPACITY(16) reports the real size.
+            return self.read_capacity_16();
+        }
         if block_len > 0 && block_len <= 4096 {
             self.block_size = block_len;
             self.block_count = last_lba + 1;
@@ -67,15 +152,142 @@ impl ScsiBlockDevice {
         Ok(())
     }
 
+    fn read_capacity_16(&mut self) -> io::Result<()> {
+        let cdb = scsi::build_read_capacity_16_cdb();
+        let mut buffer = [0u8; 32];
+        self.execute_command(&cdb, Some((buffer.as_mut_ptr(), 32)), scsi::DIRECTION_IN)?;
+        let last_lba = u64::from_be_bytes(buffer[0..8].try_into().unwrap());
+        let block_len = u32::from_be_bytes([buffer[8], buffer[9], buffer[10], buffer[11]]);
+        if block_len > 0 && block_len <= 4096 {
+            self.block_size = block_len;
+            self.block_count = last_lba + 1;
+            self.use_read_16 = true;
+        }
+        Ok(())
+    }
+
+    /// Largest transfer the bulk endpoint and the device (Block Limits VPD)
+    /// both allow. VPD is only queried on SPC-3+ disks: older USB bridges
+    /// tend to stall on EVPD requests, which BOT can't recover from here.
+    fn update_transfer_limits(&mut self) {
+        let block = self.block_size.max(1) as usize;
+        let mut blocks = (self.transfer.max_transfer_size() / block).max(1) as u64;
+        if let Some(limit) = self.block_limits_max_transfer() {
+            blocks = blocks.min(limit as u64);
+        }
+        let cmd_max = if self.use_read_16 { u32::MAX as u64 } else { u16::MAX as u64 };
+        self.max_transfer_blocks = blocks.min(cmd_max) as u32;
+    }
+
+    /// MAXIMUM TRANSFER LENGTH from VPD page 0xB0, if reported and non-zero.
+    fn block_limits_max_transfer(&self) -> Option<u32> {
+        let inq = self.inquiry_data().ok()?;
+        if inq[0] & 0x1F != 0x00 || inq[2] < 0x05 {
+            return None;
+        }
+        let mut pages = [0u8; 64];
+        let cdb = scsi::build_inquiry_vpd_cdb(scsi::VPD_SUPPORTED_PAGES, 64);
+        let n = self
+            .execute_command(&cdb, Some((pages.as_mut_ptr(), 64)), scsi::DIRECTION_IN)
+            .ok()?;
+        let listed = (pages[3] as usize).min(n.saturating_sub(4));
+        if !pages[4..4 + listed].contains(&scsi::VPD_BLOCK_LIMITS) {
+            return None;
+        }
+        let mut limits = [0u8; 64];
+        let cdb = scsi::build_inquiry_vpd_cdb(scsi::VPD_BLOCK_LIMITS, 64);
+        let n = self
+            .execute_command(&cdb, Some((limits.as_mut_ptr(), 64)), scsi::DIRECTION_IN)
+            .ok()?;
+        if n < 12 || limits[1] != scsi::VPD_BLOCK_LIMITS {
+            return None;
+        }
+        let max = u32::from_be_bytes([limits[8], limits[9], limits[10], limits[11]]);
+        (max > 0).then_some(max)
+    }
+
+    /// READ(10), or READ(16) when the LBA or count doesn't fit. Returns the
+    /// CDB buffer and its length.
+    fn read_cdb(&self, lba: u64, count: u32) -> ([u8; 16], usize) {
+        let mut cdb = [0u8; 16];
+        if self.use_read_16 || lba + count as u64 > u32::MAX as u64 || count > u16::MAX as u32 {
+            cdb.copy_from_slice(&scsi::build_read_16_cdb(lba, count));
+            (cdb, 16)
+        } else {
+            cdb[..10].copy_from_slice(&scsi::build_read_10_cdb(lba as u32, count as u16));
+            (cdb, 10)
+        }
+    }
+
     fn execute_command(
         &self,
         cdb: &[u8],
         data: Option<(*mut u8, usize)>,
         direction: u8,
+    ) -> io::Result<usize> {
+        let (data_ptr, data_len) = data.unwrap_or((std::ptr::null_mut(), 0));
+        if self.uas {
+            let data: &mut [u8] = if data_len > 0 && !data_ptr.is_null() {
+                unsafe { std::slice::from_raw_parts_mut(data_ptr, data_len) }
+            } else {
+                &mut []
+            };
+            let mut cmd = [uas_command(cdb, data)];
+            return uas::execute_queued(self.transfer.as_ref(), self.session_id, &mut cmd, &self.stats);
+        }
+        let started = Instant::now();
+        let result = self.execute_bot_command(cdb, data, direction);
+        self.stats.record(cdb[0], started.elapsed(), scsi::CBW_SIZE, result.as_ref().ok().copied());
+        result
+    }
+
+    fn execute_bot_command(
+        &self,
+        cdb: &[u8],
+        data: Option<(*mut u8, usize)>,
+        direction: u8,
     ) -> io::Result<usize> {
         let (data_ptr, data_len) = data.unwrap_or((std::ptr::null_mut(), 0));
         let tag = self.next_tag();
         let cbw = scsi::build_cbw(tag, data_len as u32, direction, cdb);
+        // The sense CBW is only sent after this command's CSW, so it can share the tag.
+        let sense_cbw = scsi::build_cbw(
+            tag,
+            scsi::SENSE_SIZE as u32,
+            scsi::DIRECTION_IN,
+            &scsi::build_request_sense_cdb(scsi::SENSE_SIZE as u8),
+        );
+        if let Some(done) = self
+            .transfer
+            .execute_bot(self.session_id, &cbw, &sense_cbw, data, direction)
+        {
+            let done = done?;
+            return self.complete_command(&done.csw, done.transferred, done.sense.as_ref());
+        }
+        self.execute_command_with(cdb, data_len, direction, || {
+            if data_len > 0 && !data_ptr.is_null() {
+                let slice = unsafe { std::slice::from_raw_parts_mut(data_ptr, data_len) };
+                self.transfer.bulk_in(self.session_id, slice)
+            } else {
+                Ok(0)
+            }
+        })
+    }
+
+    /// CBW, data phase (done by `data_phase`, returns bytes moved), CSW and
+    /// auto REQUEST SENSE on Check Condition.
+    fn execute_command_with<F>(
+        &self,
+        cdb: &[u8],
+        data_len: usize,
+        direction: u8,
+        data_phase: F,
+    ) -> io::Result<usize>
+    where
+        F: FnOnce() -> io::Result<usize>,
+    {
+        let tag = self.next_tag();
+        let cbw = scsi::build_cbw(tag, data_len as u32, direction, cdb);
 
         let out_result = self.transfer.bulk_out(self.session_id, &cbw)?;
         if out_result != cbw.len() {
@@ -85,11 +297,7 @@ impl ScsiBlockDevice {
             ));
         }
 
-        let mut transferred = 0usize;
-        if data_len > 0 && !data_ptr.is_null() {
-            let slice = unsafe { std::slice::from_raw_parts_mut(data_ptr, data_len) };
-            transferred = self.transfer.bulk_in(self.session_id, slice)?;
-        }
+        let transferred = data_phase()?;
 
         let mut csw_buf = [0u8; scsi::CSW_SIZE];
         let csw_slice = &mut csw_buf[..];
@@ -101,7 +309,18 @@ impl ScsiBlockDevice {
             ));
         }
 
-        let (sig_ok, _tag_ok, status, _residue) = scsi::parse_csw(&csw_buf)?;
+        self.complete_command(&csw_buf, transferred, None)
+    }
+
+    /// Map a CSW to the command result. On Check Condition the sense data is
+    /// used if the handler already fetched it, otherwise REQUEST SENSE is issued.
+    fn complete_command(
+        &self,
+        csw: &[u8; scsi::CSW_SIZE],
+        transferred: usize,
+        sense: Option<&[u8; scsi::SENSE_SIZE]>,
+    ) -> io::Result<usize> {
+        let (sig_ok, _tag_ok, status, _residue) = scsi::parse_csw(csw)?;
         if !sig_ok {
             return Err(io::Error::new(
                 io::ErrorKind::InvalidData,
@@ -112,25 +331,13 @@ impl ScsiBlockDevice {
         match status {
             0 => Ok(transferred),
             1 => {
-                let mut sense_buf = [0u8; 18];
-                let sense_cdb = scsi::build_request_sense_cdb(18);
-                let sense_cbw = scsi::build_cbw(
-                    self.next_tag(),
-                    18,
-                    scsi::DIRECTION_IN,
-                    &sense_cdb,
-                );
-                let _ = self.transfer.bulk_out(self.session_id, &sense_cbw);
-                let sense_slice = &mut sense_buf[..];
-                let _ = self.transfer.bulk_in(self.session_id, sense_slice);
-                let mut csw = [0u8; scsi::CSW_SIZE];
-                let csw_slice = &mut csw[..];
-                let _ = self.transfer.bulk_in(self.session_id, csw_slice);
+                let sense_buf = match sense {
+                    Some(s) => *s,
+                    None => self.request_sense(),
+                };
                 let (sense_key, asc, ascq) = scsi::parse_sense(&sense_buf);
-                Err(io::Error::new(
-                    io::ErrorKind::Other,
-                    format!("SCSI Check Condition: sense_key={} asc=0x{:02x} ascq=0x{:02x}", sense_key, asc, ascq),
-                ))
+                self.stats.record_sense(sense_key, asc, ascq);
+                Err(scsi::SenseError { sense_key, asc, ascq }.into_io())
             }
             _ => Err(io::Error::new(
                 io::ErrorKind::Other,
@@ -139,6 +346,25 @@ impl ScsiBlockDevice {
         }
     }
 
+    /// REQUEST SENSE as separate transfers; failures leave the sense zeroed.
+    fn request_sense(&self) -> [u8; scsi::SENSE_SIZE] {
+        let mut sense_buf = [0u8; scsi::SENSE_SIZE];
+        let sense_cdb = scsi::build_request_sense_cdb(scsi::SENSE_SIZE as u8);
+        let sense_cbw = scsi::build_cbw(
+            self.next_tag(),
+            scsi::SENSE_SIZE as u32,
+            scsi::DIRECTION_IN,
+            &sense_cdb,
+        );
+        let _ = self.transfer.bulk_out(self.session_id, &sense_cbw);
+        let sense_slice = &mut sense_buf[..];
+        let _ = self.transfer.bulk_in(self.session_id, sense_slice);
+        let mut csw = [0u8; scsi::CSW_SIZE];
+        let csw_slice = &mut csw[..];
+        let _ = self.transfer.bulk_in(self.session_id, csw_slice);
+        sense_buf
+    }
+
     pub fn read_blocks(&self, lba: u64, count: u32, buffer: &mut [u8]) -> io::Result<usize> {
         let bytes_needed = (count as usize) * (self.block_size as usize);
         if buffer.len() < bytes_needed {
@@ -147,18 +373,31 @@ impl ScsiBlockDevice {
                 "Buffer too small",
             ));
         }
-        let max_blocks_per_read = 64u32;
+        let policy = self.recovery.policy();
+        if policy.is_strict() {
+            return self.read_blocks_once(lba, &mut buffer[..bytes_needed]);
+        }
+        self.read_recovering(lba, &mut buffer[..bytes_needed], &policy)
+    }
+
+    /// Whole blocks into `buffer`, failing on the first error.
+    fn read_blocks_once(&self, lba: u64, buffer: &mut [u8]) -> io::Result<usize> {
+        if self.uas {
+            return self.read_blocks_uas(lba, buffer);
+        }
+        let count = (buffer.len() / self.block_size as usize) as u32;
         let mut total_read = 0usize;
         let mut remaining = count;
         let mut current_lba = lba;
         let mut offset = 0;
 
         while remaining > 0 {
-            let to_read = std::cmp::min(remaining, max_blocks_per_read);
-            let cdb = scsi::build_read_10_cdb(current_lba as u32, to_read as u16);
+            let to_read = std::cmp::min(remaining, self.max_transfer_blocks);
+            let (cdb, cdb_len) = self.read_cdb(current_lba, to_read);
+            let cdb = &cdb[..cdb_len];
             let slice = &mut buffer[offset..offset + (to_read as usize) * (self.block_size as usize)];
             let n = self.execute_command(
-                &cdb,
+                cdb,
                 Some((slice.as_mut_ptr(), slice.len())),
                 scsi::DIRECTION_IN,
             )?;
@@ -170,9 +409,335 @@ impl ScsiBlockDevice {
         Ok(total_read)
     }
 
+    /// Read whole blocks starting at `lba` and scatter them into `iov` with no
+    /// intermediate copy. Segments that are adjacent in memory are merged into
+    /// one bulk IN transfer; a partial trailing block is not read.
+    pub fn read_blocks_vectored(&self, lba: u64, iov: &[IoVec]) -> io::Result<usize> {
+        let policy = self.recovery.policy();
+        if policy.is_strict() {
+            return self.read_blocks_vectored_once(lba, iov);
+        }
+        let block = self.block_size as usize;
+        let count = (iov.iter().map(|v| v.len).sum::<usize>() / block) as u64;
+        if !(policy.skip_bad && self.recovery.known_bad(lba, count).is_some()) {
+            match self.read_blocks_vectored_once(lba, iov) {
+                Err(e) if recovery::classify(&e) != Failure::Fatal => {}
+                r => return r,
+            }
+        }
+        // Recover through a bounce buffer; only failing reads pay for it.
+        let mut bounce = vec![0u8; count as usize * block];
+        let n = self.read_recovering(lba, &mut bounce, &policy)?;
+        let mut off = 0;
+        for v in iov {
+            let take = v.len.min(n - off);
+            unsafe { std::ptr::copy_nonoverlapping(bounce.as_ptr().add(off), v.base, take) };
+            off += take;
+        }
+        Ok(n)
+    }
+
+    fn read_blocks_vectored_once(&self, lba: u64, iov: &[IoVec]) -> io::Result<usize> {
+        if self.uas {
+            return self.read_blocks_vectored_uas(lba, iov);
+        }
+        let block = self.block_size as usize;
+        let total: usize = iov.iter().map(|v| v.len).sum();
+        let count = (total / block) as u32;
+        let mut seg = 0usize;
+        let mut seg_off = 0usize;
+        let mut total_read = 0usize;
+        let mut current_lba = lba;
+        let mut remaining = count;
+
+        while remaining > 0 {
+            let to_read = std::cmp::min(remaining, self.max_transfer_blocks);
+            let chunk_len = (to_read as usize) * block;
+            let (cdb, cdb_len) = self.read_cdb(current_lba, to_read);
+            let started = Instant::now();
+            let result = self.execute_command_with(&cdb[..cdb_len], chunk_len, scsi::DIRECTION_IN, || {
+                let mut moved = 0usize;
+                while moved < chunk_len && seg < iov.len() {
+                    if seg_off == iov[seg].len {
+                        seg += 1;
+                        seg_off = 0;
+                        continue;
+                    }
+                    let base = unsafe { iov[seg].base.add(seg_off) };
+                    let mut len = std::cmp::min(iov[seg].len - seg_off, chunk_len - moved);
+                    // Extend over following segments that continue in memory.
+                    let mut end_seg = seg;
+                    let mut end_off = seg_off + len;
+                    while moved + len < chunk_len
+                        && end_off == iov[end_seg].len
+                        && end_seg + 1 < iov.len()
+                        && iov[end_seg + 1].base == unsafe { iov[end_seg].base.add(iov[end_seg].len) }
+                    {
+                        end_seg += 1;
+                        let take = std::cmp::min(iov[end_seg].len, chunk_len - moved - len);
+                        len += take;
+                        end_off = take;
+                    }
+                    let slice = unsafe { std::slice::from_raw_parts_mut(base, len) };
+                    let got = self.transfer.bulk_in(self.session_id, slice)?;
+                    moved += got;
+                    // Advance the cursor by what actually arrived.
+                    let mut left = got;
+                    while left > 0 && seg < iov.len() {
+                        let avail = iov[seg].len - seg_off;
+                        if left >= avail {
+                            left -= avail;
+                            seg += 1;
+                            seg_off = 0;
+                        } else {
+                            seg_off += left;
+                            left = 0;
+                        }
+                    }
+                    if got < len {
+                        break;
+                    }
+                }
+                Ok(moved)
+            });
+            self.stats.record(cdb[0], started.elapsed(), scsi::CBW_SIZE, result.as_ref().ok().copied());
+            let n = result?;
+            total_read += n;
+            if n < chunk_len {
+                break;
+            }
+            current_lba += to_read as u64;
+            remaining -= to_read;
+        }
+        Ok(total_read)
+    }
+
+    /// Reads whole blocks under a recovery policy. Known bad sectors are
+    /// zero-filled without touching the drive; the runs between them are read
+    /// with read_range.
+    fn read_recovering(&self, lba: u64, buffer: &mut [u8], policy: &RecoveryPolicy) -> io::Result<usize> {
+        let block = self.block_size as usize;
+        let count = (buffer.len() / block) as u64;
+        let mut done = 0u64;
+        let mut total = 0usize;
+        while done < count {
+            let cur = lba + done;
+            let known = if policy.skip_bad { self.recovery.known_bad(cur, count - done) } else { None };
+            let (run, bad) = match known {
+                Some((start, end)) if start == cur => (end - start, true),
+                Some((start, _)) => (start - cur, false),
+                None => (count - done, false),
+            };
+            let part = &mut buffer[done as usize * block..(done + run) as usize * block];
+            if bad {
+                part.fill(0);
+                total += part.len();
+            } else {
+                total += self.read_range(cur, part, policy)?;
+            }
+            done += run;
+        }
+        Ok(total)
+    }
+
+    /// One read of the range, then recovery by failure class: transient
+    /// errors are retried with backoff; a medium error is bisected (no
+    /// retries until a single sector is left, so good sectors cost one read),
+    /// and a sector that still fails is zero-filled when the policy allows.
+    fn read_range(&self, lba: u64, buffer: &mut [u8], policy: &RecoveryPolicy) -> io::Result<usize> {
+        let block = self.block_size as usize;
+        let count = (buffer.len() / block) as u64;
+        let mut attempt = 0;
+        loop {
+            let err = match self.read_blocks_once(lba, buffer) {
+                Ok(n) => return Ok(n),
+                Err(e) => e,
+            };
+            match recovery::classify(&err) {
+                Failure::Medium if policy.split && count > 1 => {
+                    self.recovery.record_split();
+                    let half = count / 2;
+                    let (head, tail) = buffer.split_at_mut(half as usize * block);
+                    let n = self.read_range(lba, head, policy)?;
+                    return Ok(n + self.read_range(lba + half, tail, policy)?);
+                }
+                Failure::Transient | Failure::Medium if attempt < policy.retries => {
+                    self.recovery.record_retry();
+                    std::thread::sleep(RecoveryPolicy::backoff(attempt));
+                    attempt += 1;
+                }
+                Failure::Medium if policy.skip_bad => {
+                    buffer.fill(0);
+                    self.recovery.record_bad(lba, count);
+                    return Ok(buffer.len());
+                }
+                _ => return Err(err),
+            }
+        }
+    }
+
+    /// UAS: one READ per max_transfer_blocks chunk, all queued together.
+    fn read_blocks_uas(&self, lba: u64, buffer: &mut [u8]) -> io::Result<usize> {
+        let chunk = self.max_transfer_blocks as usize * self.block_size as usize;
+        let mut cmds = Vec::with_capacity(buffer.len().div_ceil(chunk));
+        let mut current_lba = lba;
+        for part in buffer.chunks_mut(chunk) {
+            let blocks = (part.len() / self.block_size as usize) as u32;
+            let (cdb, cdb_len) = self.read_cdb(current_lba, blocks);
+            cmds.push(uas_command(&cdb[..cdb_len], part));
+            current_lba += blocks as u64;
+        }
+        uas::execute_queued(self.transfer.as_ref(), self.session_id, &mut cmds, &self.stats)
+    }
+
+    /// UAS scatter-gather: each run of memory-adjacent segments becomes one
+    /// READ; the runs are queued together. Runs must be whole blocks.
+    fn read_blocks_vectored_uas(&self, lba: u64, iov: &[IoVec]) -> io::Result<usize> {
+        let block = self.block_size as usize;
+        let max = self.max_transfer_blocks as usize * block;
+        let mut cmds = Vec::new();
+        let mut current_lba = lba;
+        let mut i = 0;
+        while i < iov.len() {
+            let base = iov[i].base;
+            let mut len = iov[i].len;
+            i += 1;
+            while i < iov.len() && iov[i].base == unsafe { base.add(len) } && len + iov[i].len <= max {
+                len += iov[i].len;
+                i += 1;
+            }
+            if len == 0 {
+                continue;
+            }
+            if len % block != 0 || len > max {
+                return Err(io::Error::new(
+                    io::ErrorKind::InvalidInput,
+                    "UAS readv segment is not a whole number of blocks",
+                ));
+            }
+            let blocks = (len / block) as u32;
+            let (cdb, cdb_len) = self.read_cdb(current_lba, blocks);
+            let data = unsafe { std::slice::from_raw_parts_mut(base, len) };
+            cmds.push(uas_command(&cdb[..cdb_len], data));
+            current_lba += blocks as u64;
+        }
+        uas::execute_queued(self.transfer.as_ref(), self.session_id, &mut cmds, &self.stats)
+    }
+
     pub fn test_unit_ready(&self) -> io::Result<()> {
         let cdb = scsi::build_test_unit_ready_cdb();
         self.execute_command(&cdb, None, scsi::DIRECTION_IN)?;
         Ok(())
     }
+
+    /// READ TOC format 0: the TOC header and track descriptors as returned.
+    pub fn read_toc(&self) -> io::Result<Vec<u8>> {
+        // 100 descriptors (99 tracks and the lead-out) plus the header.
+        let mut buf = vec![0u8; 4 + 100 * 8];
+        let cdb = scsi::build_read_toc_cdb(buf.len() as u16);
+        let n = self.execute_command(&cdb, Some((buf.as_mut_ptr(), buf.len())), scsi::DIRECTION_IN)?;
+        buf.truncate(n);
+        Ok(buf)
+    }
+
+    /// Raw CD-DA sectors (2352 bytes each) with READ CD, as large transfers as
+    /// the bulk endpoint takes. Returns bytes read.
+    pub fn read_cd(&self, lba: u32, count: u32, buffer: &mut [u8]) -> io::Result<usize> {
+        let sector = scsi::CD_RAW_SECTOR;
+        if buffer.len() < count as usize * sector {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Buffer too small"));
+        }
+        let per_command = (self.transfer.max_transfer_size() / sector).max(1) as u32;
+        let mut done = 0u32;
+        let mut total = 0usize;
+        while done < count {
+            let n = (count - done).min(per_command);
+            let cdb = scsi::build_read_cd_cdb(lba + done, n);
+            let slice = &mut buffer[done as usize * sector..(done + n) as usize * sector];
+            total += self.execute_command(&cdb, Some((slice.as_mut_ptr(), slice.len())), scsi::DIRECTION_IN)?;
+            done += n;
+        }
+        Ok(total)
+    }
+
+    /// SET CD SPEED to the drive's maximum. Drives spin down for audio
+    /// otherwise; some ignore the command or reject it, which is harmless.
+    pub fn set_cd_speed_max(&self) -> io::Result<()> {
+        let cdb = scsi::build_set_cd_speed_cdb(0xFFFF);
+        self.execute_command(&cdb, None, scsi::DIRECTION_IN)?;
+        Ok(())
+    }
+}
+
+fn uas_command<'a>(cdb: &[u8], data: &'a mut [u8]) -> UasCommand<'a> {
+    let mut buf = [0u8; 16];
+    let n = cdb.len().min(16);
+    buf[..n].copy_from_slice(&cdb[..n]);
+    UasCommand {
+        cdb: buf,
+        cdb_len: n,
+        data,
+        transferred: 0,
+    }
+}
+
+/// In-memory BOT device for unit tests of the layers above ScsiBlockDevice.
+#[cfg(test)]
+pub(crate) mod testing {
+    use super::*;
+    use std::sync::Mutex;
+
+    pub const BLOCK: usize = 512;
+
+    /// Answers READ(10) from `data` through the combined BOT path and logs
+    /// each command as (lba, blocks).
+    pub struct MemDisk {
+        data: Vec<u8>,
+        reads: Arc<Mutex<Vec<(u64, u32)>>>,
+    }
+
+    impl TransferHandler for MemDisk {
+        fn bulk_out(&self, _: u64, _: &[u8]) -> io::Result<usize> {
+            unreachable!("commands go through execute_bot")
+        }
+        fn bulk_in(&self, _: u64, _: &mut [u8]) -> io::Result<usize> {
+            unreachable!("commands go through execute_bot")
+        }
+        fn execute_bot(
+            &self,
+            _: u64,
+            cbw: &[u8; scsi::CBW_SIZE],
+            _: &[u8; scsi::CBW_SIZE],
+            data: Option<(*mut u8, usize)>,
+            _: u8,
+        ) -> Option<io::Result<BotCompletion>> {
+            let cdb = &cbw[15..];
+            assert_eq!(cdb[0], scsi::READ_10, "only READ(10) is emulated");
+            let lba = u32::from_be_bytes([cdb[2], cdb[3], cdb[4], cdb[5]]) as u64;
+            let blocks = u16::from_be_bytes([cdb[7], cdb[8]]) as u32;
+            self.reads.lock().unwrap().push((lba, blocks));
+            let (ptr, len) = data.expect("READ has a data phase");
+            let out = unsafe { std::slice::from_raw_parts_mut(ptr, len) };
+            let start = lba as usize * BLOCK;
+            out.copy_from_slice(&self.data[start..start + len]);
+            let mut csw = [0u8; scsi::CSW_SIZE];
+            csw[0..4].copy_from_slice(&scsi::CSW_SIGNATURE.to_le_bytes());
+            Some(Ok(BotCompletion { transferred: len, csw, sense: None }))
+        }
+    }
+
+    /// A device over `data` (whole 512-byte blocks) and its command log.
+    pub fn mem_device(data: Vec<u8>) -> (ScsiBlockDevice, Arc<Mutex<Vec<(u64, u32)>>>) {
+        let reads = Arc::new(Mutex::new(Vec::new()));
+        let blocks = (data.len() / BLOCK) as u64;
+        let disk = MemDisk { data, reads: Arc::clone(&reads) };
+        let mut dev = ScsiBlockDevice::new_minimal(Box::new(disk), 1);
+        dev.block_count = blocks;
+        (dev, reads)
+    }
+
+    /// Blocks whose bytes are all their LBA (mod 256).
+    pub fn numbered_blocks(count: usize) -> Vec<u8> {
+        (0..count).flat_map(|b| [b as u8; BLOCK]).collect()
+    }
 }
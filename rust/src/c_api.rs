@@ -0,0 +1,263 @@
+//! C ABI for dart:ffi: directory pages, file reads and DVD metadata without
+//! the MethodChannel and JNI hops. Handles are the ones the JNI calls hand
+//! out (openVolume, openDvd), so Kotlin still opens sessions and does the
+//! bulk transfers; the calls here run on the caller's thread (a Dart
+//! background isolate), which the transfer handler attaches to the JVM.
+//!
+//! Results go into caller buffers. Return values are >= 0 on success and a
+//! negative ERR_* code on error, with the message from connectias_last_error
+//! on the same thread.
+//!
+//! Directory pages are packed entries, each an 11-byte header (size u64,
+//! name length u16, flags u8; little-endian) followed by the UTF-8 name.
+
+use crate::{set_last_error, ERR_NOT_FOUND, ERR_NTFS, ERR_OK, VOLUMES};
+use std::io;
+
+/// Header bytes before each entry name in a directory page.
+const ENTRY_HEADER: usize = 11;
+const FLAG_DIR: u8 = 0x01;
+
+/// Filled by connectias_read_dir_page.
+#[repr(C)]
+pub struct ConnectiasDirPage {
+    pub entries: u32,
+    /// Bytes of the buffer used.
+    pub bytes: u32,
+    /// 1 if the cursor has entries left.
+    pub more: u32,
+}
+
+fn error_code(e: &io::Error) -> i64 {
+    set_last_error(&e.to_string());
+    if e.kind() == io::ErrorKind::NotFound {
+        -(ERR_NOT_FOUND as i64)
+    } else {
+        -(ERR_NTFS as i64)
+    }
+}
+
+fn volume_not_found() -> i64 {
+    set_last_error("Volume not found");
+    -(ERR_NOT_FOUND as i64)
+}
+
+/// # Safety
+/// `ptr` must point to `len` readable bytes (or be null with `len` 0).
+unsafe fn path_arg<'a>(ptr: *const u8, len: usize) -> Result<&'a str, i64> {
+    if len == 0 {
+        return Ok("");
+    }
+    std::str::from_utf8(std::slice::from_raw_parts(ptr, len)).map_err(|_| {
+        set_last_error("Invalid path");
+        -(ERR_NOT_FOUND as i64)
+    })
+}
+
+/// # Safety
+/// `ptr` must point to `len` writable bytes (or be null with `len` 0).
+unsafe fn buf_arg<'a>(ptr: *mut u8, len: usize) -> &'a mut [u8] {
+    if len == 0 {
+        &mut []
+    } else {
+        std::slice::from_raw_parts_mut(ptr, len)
+    }
+}
+
+/// Copies this thread's last error message into `buf` (truncated to `cap`).
+/// Returns its full length in bytes; 0 if there is none.
+#[no_mangle]
+pub unsafe extern "C" fn connectias_last_error(buf: *mut u8, cap: usize) -> i32 {
+    crate::LAST_ERROR.with(|e| match e.borrow().as_ref() {
+        Some(msg) => {
+            let bytes = msg.as_bytes();
+            let n = bytes.len().min(cap);
+            buf_arg(buf, cap)[..n].copy_from_slice(&bytes[..n]);
+            bytes.len() as i32
+        }
+        None => 0,
+    })
+}
+
+/// Opens a paged listing of a directory (see openDirCursor). Returns the cursor ID.
+#[no_mangle]
+pub unsafe extern "C" fn connectias_open_dir_cursor(
+    volume_id: u64,
+    path: *const u8,
+    path_len: usize,
+) -> i64 {
+    let path = match path_arg(path, path_len) {
+        Ok(p) => p,
+        Err(code) => return code,
+    };
+    match VOLUMES.with(volume_id, |v| v.open_dir_cursor(path)) {
+        Some(Ok(cursor)) => cursor as i64,
+        Some(Err(e)) => error_code(&e),
+        None => volume_not_found(),
+    }
+}
+
+/// Packs up to `max_entries` entries of the cursor into `buf`; a page ends
+/// early when the next entry doesn't fit. Returns ERR_OK and fills `page`.
+#[no_mangle]
+pub unsafe extern "C" fn connectias_read_dir_page(
+    volume_id: u64,
+    cursor: u64,
+    max_entries: u32,
+    buf: *mut u8,
+    cap: usize,
+    page: *mut ConnectiasDirPage,
+) -> i32 {
+    let out = buf_arg(buf, cap);
+    let mut used = 0usize;
+    let result = VOLUMES.with(volume_id, |v| {
+        v.drain_dir_page(cursor, max_entries.max(1) as usize, |e| {
+            let name = e.name.as_bytes();
+            let end = used + ENTRY_HEADER + name.len();
+            if end > out.len() {
+                return false;
+            }
+            let h = &mut out[used..used + ENTRY_HEADER];
+            h[0..8].copy_from_slice(&e.size.to_le_bytes());
+            h[8..10].copy_from_slice(&(name.len() as u16).to_le_bytes());
+            h[10] = if e.is_dir { FLAG_DIR } else { 0 };
+            out[used + ENTRY_HEADER..end].copy_from_slice(name);
+            used = end;
+            true
+        })
+    });
+    let (entries, more) = match result {
+        Some(Ok(r)) => r,
+        Some(Err(e)) => return error_code(&e) as i32,
+        None => return volume_not_found() as i32,
+    };
+    if entries == 0 && more {
+        set_last_error("Directory page buffer too small");
+        return -(ERR_NTFS);
+    }
+    *page = ConnectiasDirPage {
+        entries: entries as u32,
+        bytes: used as u32,
+        more: more as u32,
+    };
+    ERR_OK
+}
+
+#[no_mangle]
+pub extern "C" fn connectias_close_dir_cursor(volume_id: u64, cursor: u64) -> i32 {
+    match VOLUMES.with(volume_id, |v| v.close_dir_cursor(cursor)) {
+        Some(true) => ERR_OK,
+        _ => -ERR_NOT_FOUND,
+    }
+}
+
+/// Opens a file for connectias_read_file_handle and stores its size in
+/// `size_out`. Returns the file handle.
+#[no_mangle]
+pub unsafe extern "C" fn connectias_open_file(
+    volume_id: u64,
+    path: *const u8,
+    path_len: usize,
+    size_out: *mut u64,
+) -> i64 {
+    let path = match path_arg(path, path_len) {
+        Ok(p) => p,
+        Err(code) => return code,
+    };
+    let opened = VOLUMES.with(volume_id, |v| {
+        let handle = v.open_file(path)?;
+        Ok::<_, io::Error>((handle, v.open_file_size(handle)?))
+    });
+    match opened {
+        Some(Ok((handle, size))) => {
+            if !size_out.is_null() {
+                *size_out = size;
+            }
+            handle as i64
+        }
+        Some(Err(e)) => error_code(&e),
+        None => volume_not_found(),
+    }
+}
+
+/// Reads at `offset` of an open file straight into `buf`. Returns bytes
+/// read; fewer than `len` only at the end of the file.
+#[no_mangle]
+pub unsafe extern "C" fn connectias_read_file_handle(
+    volume_id: u64,
+    file_handle: u64,
+    offset: u64,
+    buf: *mut u8,
+    len: usize,
+) -> i64 {
+    let out = buf_arg(buf, len);
+    match VOLUMES.with(volume_id, |v| v.read_open_file_into(file_handle, offset, out)) {
+        Some(Ok(n)) => n as i64,
+        Some(Err(e)) => error_code(&e),
+        None => volume_not_found(),
+    }
+}
+
+/// Reads up to `len` bytes at `offset` of the file at `path` into `buf`
+/// (see readFile). Returns bytes read.
+#[no_mangle]
+pub unsafe extern "C" fn connectias_read_file(
+    volume_id: u64,
+    path: *const u8,
+    path_len: usize,
+    offset: u64,
+    buf: *mut u8,
+    len: usize,
+) -> i64 {
+    let path = match path_arg(path, path_len) {
+        Ok(p) => p,
+        Err(code) => return code,
+    };
+    let out = buf_arg(buf, len);
+    match VOLUMES.with(volume_id, |v| v.read_file(path, offset, len)) {
+        Some(Ok(data)) => {
+            out[..data.len()].copy_from_slice(&data);
+            data.len() as i64
+        }
+        Some(Err(e)) => error_code(&e),
+        None => volume_not_found(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn connectias_close_file(volume_id: u64, file_handle: u64) -> i32 {
+    match VOLUMES.with(volume_id, |v| v.close_file(file_handle)) {
+        Some(true) => ERR_OK,
+        _ => {
+            set_last_error("File handle not found");
+            -ERR_NOT_FOUND
+        }
+    }
+}
+
+/// Bytes of the packed DVD title/chapter metadata (see dvdMetadataSize).
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "C" fn connectias_dvd_metadata_size(dvd_handle: u64) -> i64 {
+    match crate::dvd::metadata_size(dvd_handle) {
+        Ok(n) => n as i64,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
+
+/// Writes the packed DVD metadata into `buf`, at least
+/// connectias_dvd_metadata_size bytes. Returns bytes written.
+#[cfg(has_dvd)]
+#[no_mangle]
+pub unsafe extern "C" fn connectias_dvd_read_metadata(dvd_handle: u64, buf: *mut u8, cap: usize) -> i64 {
+    match crate::dvd::export_metadata(dvd_handle, buf_arg(buf, cap)) {
+        Ok(n) => n as i64,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
@@ -0,0 +1,138 @@
+//! Audio CD (CD-DA) playback and ripping over READ CD on the optical drive.
+//! The TOC is read once at open. Tracks are read as raw 2352-byte sectors
+//! with jitter correction (reader), read ahead into a ring for playback
+//! (stream, fed to LibVLC by the same pipe pump as DVD titles) and written
+//! to a file as WAV by a copy job (rip). The drive is set to its maximum
+//! speed at open and again for each stream and rip.
+
+pub mod reader;
+pub mod rip;
+pub mod stream;
+pub mod toc;
+
+use crate::block_device::{ScsiBlockDevice, TransferHandler};
+use crate::registry::Registry;
+use reader::{CddaStats, TrackReader};
+use std::io;
+use std::os::fd::RawFd;
+use std::sync::{Arc, Mutex};
+use toc::{Toc, Track};
+
+static CD_HANDLES: std::sync::LazyLock<Registry<CdHandle>> =
+    std::sync::LazyLock::new(Registry::new);
+
+struct CdHandle {
+    /// Shared by the disc's streams and rips, one READ CD at a time.
+    device: Arc<Mutex<ScsiBlockDevice>>,
+    toc: Toc,
+    stats: Arc<CddaStats>,
+    io_stats: Arc<crate::io_stats::IoStats>,
+}
+
+fn not_found() -> io::Error {
+    io::Error::new(io::ErrorKind::NotFound, "CD handle not found")
+}
+
+/// Opens the audio CD in the drive: reads the TOC and spins the drive up to
+/// full speed. Fails if the disc has no audio tracks.
+pub fn open_cd(session_id: u64, transfer: Box<dyn TransferHandler>) -> io::Result<u64> {
+    // No READ CAPACITY: audio discs have no 2048-byte data area to report.
+    let device = ScsiBlockDevice::new_minimal(transfer, session_id);
+    let toc = Toc::parse(&device.read_toc()?)?;
+    if !toc.tracks.iter().any(|t| t.audio) {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, "No audio tracks on disc"));
+    }
+    let _ = device.set_cd_speed_max();
+    let io_stats = Arc::clone(&device.stats);
+    Ok(CD_HANDLES.insert(CdHandle {
+        device: Arc::new(Mutex::new(device)),
+        toc,
+        stats: Arc::default(),
+        io_stats,
+    }))
+}
+
+/// Streams and rips of the disc keep the device until they end.
+pub fn close_cd(cd_handle: u64) -> bool {
+    CD_HANDLES.remove(cd_handle).is_some()
+}
+
+/// The TOC as JSON (see Toc::to_json).
+pub fn toc_json(cd_handle: u64) -> Option<String> {
+    CD_HANDLES.with(cd_handle, |h| h.toc.to_json())
+}
+
+/// Command counters of the drive (see getIoStats) plus
+/// "cdda":{reads, corrections, unmatched, retries} of the jitter correction.
+pub fn io_stats_json(cd_handle: u64) -> Option<String> {
+    CD_HANDLES.with(cd_handle, |h| {
+        let mut json = String::with_capacity(512);
+        json.push('{');
+        h.io_stats.write_json(&mut json);
+        json.push_str(",\"cdda\":{");
+        h.stats.write_json(&mut json);
+        json.push_str("}}");
+        json
+    })
+}
+
+/// A reader for an audio track, positioned at its start.
+fn track_reader(cd_handle: u64, number: u8) -> io::Result<(TrackReader, Track)> {
+    CD_HANDLES
+        .with(cd_handle, |h| {
+            let track = *h.toc.track(number).ok_or_else(|| {
+                io::Error::new(io::ErrorKind::NotFound, format!("Track {} not found", number))
+            })?;
+            if !track.audio {
+                return Err(io::Error::new(
+                    io::ErrorKind::InvalidInput,
+                    format!("Track {} is a data track", number),
+                ));
+            }
+            // Drives drop back to a low audio speed after idling.
+            let _ = h.device.lock().unwrap().set_cd_speed_max();
+            let reader = TrackReader::new(
+                Arc::clone(&h.device),
+                track.start,
+                track.end(),
+                h.toc.session_end(&track),
+                Arc::clone(&h.stats),
+            );
+            Ok((reader, track))
+        })
+        .unwrap_or_else(|| Err(not_found()))
+}
+
+/// Opens a track as a WAV stream; read-ahead starts right away. Returns the
+/// stream ID for the stream calls and cdStartPump.
+pub fn open_track_stream(cd_handle: u64, number: u8) -> io::Result<u64> {
+    let (reader, track) = track_reader(cd_handle, number)?;
+    Ok(stream::register_stream(stream::CdStream::new(reader, track.length)?))
+}
+
+/// Starts ripping a track as WAV into `fd` (owned from here on). Returns a
+/// job ID for the copy job calls.
+pub fn rip_track(cd_handle: u64, number: u8, fd: RawFd) -> io::Result<u64> {
+    let out = crate::jobs::adopt_fd(fd);
+    let (reader, track) = track_reader(cd_handle, number)?;
+    rip::start(reader, track.length, out)
+}
+
+pub fn close_stream(stream_id: u64) -> bool {
+    stream::close_stream(stream_id)
+}
+
+/// Starts a native pump of the stream into `fd` (a pipe write end, owned from
+/// here on). Returns the pump ID.
+pub fn start_pump(stream_id: u64, fd: RawFd) -> io::Result<u64> {
+    stream::start_pump(stream_id, fd)
+}
+
+pub fn pump_seek_time(pump_id: u64, time_ms: u64) -> io::Result<()> {
+    stream::pump_seek_time(pump_id, time_ms)
+}
+
+/// Stops the pump; call before close_stream.
+pub fn stop_pump(pump_id: u64) -> io::Result<()> {
+    crate::pump::stop(pump_id)
+}
@@ -0,0 +1,257 @@
+//! Sequential CD-DA reads with jitter correction.
+//! Audio sectors carry no header, and many drives start a READ CD a few
+//! samples off the requested address. Each read after the first therefore
+//! starts OVERLAP_SECTORS early, and the last bytes already output are
+//! searched for in the overlap (a sector either way, in whole stereo frames);
+//! the new data continues right after the match. Silence or a constant tail
+//! can't be placed and is taken at the requested address.
+//! Reads are one READ CD command each, as large as the bulk endpoint takes.
+
+use crate::block_device::ScsiBlockDevice;
+use crate::scsi::CD_RAW_SECTOR;
+use std::fmt::Write;
+use std::io;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+/// Sectors re-read before each read to place it.
+const OVERLAP_SECTORS: u32 = 2;
+/// Sectors read past each read, so a late start still covers it.
+const SLACK_SECTORS: u32 = 1;
+/// Bytes of the previous output matched in the overlap.
+const MATCH_BYTES: usize = 1024;
+/// Largest drift searched, either way.
+const SEARCH_BYTES: usize = CD_RAW_SECTOR;
+/// One stereo frame of 16-bit samples.
+const FRAME_BYTES: usize = 4;
+/// READ CD attempts per read before the error is returned.
+const READ_ATTEMPTS: u32 = 3;
+/// Fewest sectors per read; below it the overlap costs too much.
+const MIN_READ_SECTORS: u32 = 16;
+
+/// Jitter correction counters of a disc, reported by cdGetIoStats.
+#[derive(Default)]
+pub struct CddaStats {
+    reads: AtomicU64,
+    /// Reads that had drifted and were moved to the match.
+    corrections: AtomicU64,
+    /// Reads whose overlap didn't match within the search range.
+    unmatched: AtomicU64,
+    retries: AtomicU64,
+}
+
+impl CddaStats {
+    /// Appends the counters as JSON object members (no braces).
+    pub fn write_json(&self, out: &mut String) {
+        let _ = write!(
+            out,
+            "\"reads\":{},\"corrections\":{},\"unmatched\":{},\"retries\":{}",
+            self.reads.load(Ordering::Relaxed),
+            self.corrections.load(Ordering::Relaxed),
+            self.unmatched.load(Ordering::Relaxed),
+            self.retries.load(Ordering::Relaxed),
+        );
+    }
+}
+
+pub struct TrackReader {
+    device: Arc<Mutex<ScsiBlockDevice>>,
+    /// Track sectors, end exclusive.
+    start: u32,
+    end: u32,
+    /// End of the track's session (Toc::session_end): reads stop short of
+    /// the lead-out and any session gap.
+    limit: u32,
+    /// Next sector to output.
+    next: u32,
+    /// Last MATCH_BYTES output; empty at the start or after a seek.
+    tail: Vec<u8>,
+    buf: Vec<u8>,
+    sectors_per_read: u32,
+    stats: Arc<CddaStats>,
+}
+
+impl TrackReader {
+    pub fn new(
+        device: Arc<Mutex<ScsiBlockDevice>>,
+        start: u32,
+        end: u32,
+        limit: u32,
+        stats: Arc<CddaStats>,
+    ) -> Self {
+        let per_command = (device.lock().unwrap().transfer.max_transfer_size() / CD_RAW_SECTOR) as u32;
+        let sectors_per_read =
+            per_command.saturating_sub(OVERLAP_SECTORS + SLACK_SECTORS).max(MIN_READ_SECTORS);
+        Self {
+            device,
+            start,
+            end,
+            limit,
+            next: start,
+            tail: Vec::with_capacity(MATCH_BYTES),
+            buf: Vec::new(),
+            sectors_per_read,
+            stats,
+        }
+    }
+
+    /// Bytes per read_next call (except the last of the track).
+    pub fn read_bytes(&self) -> usize {
+        self.sectors_per_read as usize * CD_RAW_SECTOR
+    }
+
+    /// A reader of the same track starting `sector` sectors into it (clamped
+    /// to its end).
+    pub fn clone_at(&self, sector: u32) -> Self {
+        Self {
+            device: Arc::clone(&self.device),
+            start: self.start,
+            end: self.end,
+            limit: self.limit,
+            next: self.start + sector.min(self.end - self.start),
+            tail: Vec::with_capacity(MATCH_BYTES),
+            buf: Vec::new(),
+            sectors_per_read: self.sectors_per_read,
+            stats: Arc::clone(&self.stats),
+        }
+    }
+
+    /// Reads the next sectors of the track into `out` (at least read_bytes
+    /// long). Returns bytes written, always whole sectors; 0 at the end.
+    pub fn read_next(&mut self, out: &mut [u8]) -> io::Result<usize> {
+        if self.next >= self.end {
+            return Ok(0);
+        }
+        let sectors = self
+            .sectors_per_read
+            .min(self.end - self.next)
+            .min((out.len() / CD_RAW_SECTOR) as u32);
+        if sectors == 0 {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Buffer too small"));
+        }
+        let want = sectors as usize * CD_RAW_SECTOR;
+        let overlap = if self.tail.is_empty() { 0 } else { OVERLAP_SECTORS.min(self.next) };
+        let first = self.next - overlap;
+        let slack = if overlap > 0 { SLACK_SECTORS } else { 0 };
+        let last = (self.next + sectors + slack).min(self.limit);
+        let len = (last - first) as usize * CD_RAW_SECTOR;
+        self.buf.resize(len, 0);
+        self.read_retrying(first, last - first)?;
+        let expected = overlap as usize * CD_RAW_SECTOR;
+        let at = if overlap > 0 { self.align(expected) } else { expected };
+        let n = want.min(len - at);
+        out[..n].copy_from_slice(&self.buf[at..at + n]);
+        // Only short at the lead-out, which the drive can't read past.
+        out[n..want].fill(0);
+        self.tail.clear();
+        self.tail.extend_from_slice(&out[want - MATCH_BYTES.min(want)..want]);
+        self.next += sectors;
+        self.stats.reads.fetch_add(1, Ordering::Relaxed);
+        Ok(want)
+    }
+
+    fn read_retrying(&mut self, lba: u32, count: u32) -> io::Result<()> {
+        let mut attempt = 1;
+        loop {
+            let result = self.device.lock().unwrap().read_cd(lba, count, &mut self.buf);
+            match result {
+                Ok(_) => return Ok(()),
+                Err(_) if attempt < READ_ATTEMPTS => {
+                    attempt += 1;
+                    self.stats.retries.fetch_add(1, Ordering::Relaxed);
+                }
+                Err(e) => return Err(e),
+            }
+        }
+    }
+
+    /// Offset in buf where the data after the tail starts; `expected` when
+    /// the drive was on target or the tail can't be placed.
+    fn align(&self, expected: usize) -> usize {
+        let tail = &self.tail[..];
+        let m = tail.len();
+        if expected < m || is_uniform(tail) {
+            return expected;
+        }
+        let matches = |end: usize| end <= self.buf.len() && end >= m && &self.buf[end - m..end] == tail;
+        if matches(expected) {
+            return expected;
+        }
+        for d in (FRAME_BYTES..=SEARCH_BYTES).step_by(FRAME_BYTES) {
+            for end in [expected + d, expected.wrapping_sub(d)] {
+                if end <= expected + SEARCH_BYTES && matches(end) {
+                    self.stats.corrections.fetch_add(1, Ordering::Relaxed);
+                    return end;
+                }
+            }
+        }
+        self.stats.unmatched.fetch_add(1, Ordering::Relaxed);
+        expected
+    }
+}
+
+/// True when every frame of `data` is the same (digital silence, or a held
+/// sample), which matches at any offset.
+fn is_uniform(data: &[u8]) -> bool {
+    let mut frames = data.chunks_exact(FRAME_BYTES);
+    match frames.next() {
+        Some(first) => frames.all(|f| f == first),
+        None => true,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::block_device::testing::mem_device;
+
+    /// Audio that never repeats within the search range.
+    fn noise(len: usize, seed: u32) -> Vec<u8> {
+        let mut x = seed;
+        (0..len)
+            .map(|_| {
+                x = x.wrapping_mul(1_103_515_245).wrapping_add(12_345);
+                (x >> 16) as u8
+            })
+            .collect()
+    }
+
+    /// A reader whose last output is `audio[..at]`, with `buf` as the next
+    /// read: the overlap expected at `expected`, shifted by `drift` bytes.
+    fn reader(audio: &[u8], at: usize, expected: usize, drift: isize) -> TrackReader {
+        let (dev, _) = mem_device(Vec::new());
+        let mut r = TrackReader::new(Arc::new(Mutex::new(dev)), 0, 100, 100, Arc::default());
+        r.tail = audio[at - MATCH_BYTES..at].to_vec();
+        let start = (at as isize - expected as isize - drift) as usize;
+        r.buf = audio[start..start + 4 * CD_RAW_SECTOR].to_vec();
+        r
+    }
+
+    #[test]
+    fn align_finds_the_tail_on_target_or_drifted() {
+        let audio = noise(16 * CD_RAW_SECTOR, 7);
+        let expected = 2 * CD_RAW_SECTOR;
+        let at = 8 * CD_RAW_SECTOR;
+        let on_target = reader(&audio, at, expected, 0);
+        assert_eq!(on_target.align(expected), expected);
+        assert_eq!(on_target.stats.corrections.load(Ordering::Relaxed), 0);
+        for drift in [8isize, -12, CD_RAW_SECTOR as isize, -(CD_RAW_SECTOR as isize)] {
+            let r = reader(&audio, at, expected, drift);
+            assert_eq!(r.align(expected), (expected as isize + drift) as usize, "drift {}", drift);
+            assert_eq!(r.stats.corrections.load(Ordering::Relaxed), 1);
+        }
+    }
+
+    #[test]
+    fn align_keeps_the_requested_address_when_the_tail_cant_be_placed() {
+        let audio = noise(16 * CD_RAW_SECTOR, 7);
+        let expected = 2 * CD_RAW_SECTOR;
+        let beyond = reader(&audio, 8 * CD_RAW_SECTOR, expected, CD_RAW_SECTOR as isize + 4);
+        assert_eq!(beyond.align(expected), expected);
+        assert_eq!(beyond.stats.unmatched.load(Ordering::Relaxed), 1);
+        let mut silent = reader(&audio, 8 * CD_RAW_SECTOR, expected, 8);
+        silent.tail.fill(0);
+        assert_eq!(silent.align(expected), expected);
+        assert_eq!(silent.stats.unmatched.load(Ordering::Relaxed), 0);
+    }
+}
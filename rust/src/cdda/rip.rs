@@ -0,0 +1,53 @@
+//! Ripping a track to a WAV file as a job in crate::jobs. A producer reads
+//! ahead (see stream::Producer) while this thread writes, so the drive keeps
+//! streaming through slow storage writes.
+
+use crate::cdda::reader::TrackReader;
+use crate::cdda::stream::{wav_header, Producer, WAV_HEADER_BYTES};
+use crate::jobs::{self, CopyJob};
+use crate::scsi::CD_RAW_SECTOR;
+use std::fs::File;
+use std::io::{self, Write};
+use std::sync::Arc;
+
+/// Starts the job; `sectors` is the track length.
+pub fn start(reader: TrackReader, sectors: u32, out: File) -> io::Result<u64> {
+    let data_bytes = sectors as u64 * CD_RAW_SECTOR as u64;
+    let (id, job) = jobs::register(WAV_HEADER_BYTES as u64 + data_bytes, 0);
+    let producer = match Producer::start(reader) {
+        Ok(p) => p,
+        Err(e) => {
+            jobs::abandon(id);
+            return Err(e);
+        }
+    };
+    let thread_job = Arc::clone(&job);
+    let spawned = std::thread::Builder::new()
+        .name("cdda-rip".to_string())
+        .spawn(move || {
+            let result = write_track(&thread_job, producer, data_bytes as u32, out);
+            thread_job.finish(result);
+        });
+    if let Err(e) = spawned {
+        // The producer was moved into the closure and stopped with it.
+        jobs::abandon(id);
+        return Err(e);
+    }
+    Ok(id)
+}
+
+fn write_track(job: &CopyJob, mut producer: Producer, data_bytes: u32, mut out: File) -> io::Result<()> {
+    out.write_all(&wav_header(data_bytes))?;
+    job.add_copied(WAV_HEADER_BYTES as u64);
+    while let Some(chunk) = producer.next(true) {
+        if job.cancelled() {
+            break;
+        }
+        let chunk = chunk?;
+        out.write_all(&chunk)?;
+        job.add_copied(chunk.len() as u64);
+        producer.recycle(chunk);
+    }
+    producer.stop();
+    out.flush()
+}
@@ -0,0 +1,258 @@
+//! Track streams: a WAV header followed by the track's PCM, read ahead by a
+//! producer thread so the drive keeps streaming at speed instead of stopping
+//! and re-seeking between the player's small reads. The ring holds about
+//! ten seconds of audio; a seek stops the producer and starts a new one at
+//! the target sector.
+
+use crate::cdda::reader::TrackReader;
+use crate::cdda::toc::SECTORS_PER_SECOND;
+use crate::jobs::{self, BufferReturn};
+use crate::pump::{self, PumpSource};
+use crate::registry::Registry;
+use crate::scsi::CD_RAW_SECTOR;
+use std::io;
+use std::os::fd::RawFd;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{sync_channel, Receiver};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+pub const WAV_HEADER_BYTES: usize = 44;
+/// Chunks read ahead (each one READ CD, up to ~256 KiB).
+const RING_CHUNKS: usize = 8;
+
+/// Canonical 44-byte RIFF/WAVE header for `data_bytes` of CD audio
+/// (44.1 kHz, 16-bit little-endian stereo).
+pub fn wav_header(data_bytes: u32) -> [u8; WAV_HEADER_BYTES] {
+    let mut h = [0u8; WAV_HEADER_BYTES];
+    h[0..4].copy_from_slice(b"RIFF");
+    h[4..8].copy_from_slice(&data_bytes.saturating_add(36).to_le_bytes());
+    h[8..12].copy_from_slice(b"WAVE");
+    h[12..16].copy_from_slice(b"fmt ");
+    h[16..20].copy_from_slice(&16u32.to_le_bytes());
+    h[20..22].copy_from_slice(&1u16.to_le_bytes()); // PCM
+    h[22..24].copy_from_slice(&2u16.to_le_bytes());
+    h[24..28].copy_from_slice(&44_100u32.to_le_bytes());
+    h[28..32].copy_from_slice(&(44_100u32 * 4).to_le_bytes());
+    h[32..34].copy_from_slice(&4u16.to_le_bytes());
+    h[34..36].copy_from_slice(&16u16.to_le_bytes());
+    h[36..40].copy_from_slice(b"data");
+    h[40..44].copy_from_slice(&data_bytes.to_le_bytes());
+    h
+}
+
+/// Thread filling a bounded queue with the reader's chunks. Buffers come
+/// back through `recycle`.
+pub struct Producer {
+    chunks: Option<Receiver<io::Result<Vec<u8>>>>,
+    free: Option<BufferReturn>,
+    stop: Arc<AtomicBool>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl Producer {
+    pub fn start(mut reader: TrackReader) -> io::Result<Self> {
+        let (tx, rx) = sync_channel(RING_CHUNKS);
+        let (mut pool, free) = jobs::buffer_pool(RING_CHUNKS + 2, reader.read_bytes());
+        let stop = Arc::new(AtomicBool::new(false));
+        let thread_stop = Arc::clone(&stop);
+        let thread = std::thread::Builder::new()
+            .name("cdda-read".to_string())
+            .spawn(move || {
+                let len = reader.read_bytes();
+                while !thread_stop.load(Ordering::Relaxed) {
+                    let Some(mut buf) = pool.take() else {
+                        return; // consumer gone
+                    };
+                    // Chunks come back truncated to what was read.
+                    buf.resize(len, 0);
+                    match reader.read_next(&mut buf) {
+                        Ok(0) => return,
+                        Ok(n) => {
+                            buf.truncate(n);
+                            if tx.send(Ok(buf)).is_err() {
+                                return;
+                            }
+                        }
+                        Err(e) => {
+                            let _ = tx.send(Err(e));
+                            return;
+                        }
+                    }
+                }
+            })?;
+        Ok(Self {
+            chunks: Some(rx),
+            free: Some(free),
+            stop,
+            thread: Some(thread),
+        })
+    }
+
+    /// Next chunk; None at the end of the track. With `wait` false, also None
+    /// while the producer is behind.
+    pub fn next(&self, wait: bool) -> Option<io::Result<Vec<u8>>> {
+        let rx = self.chunks.as_ref()?;
+        if wait {
+            rx.recv().ok()
+        } else {
+            rx.try_recv().ok()
+        }
+    }
+
+    pub fn recycle(&self, buf: Vec<u8>) {
+        if let Some(free) = &self.free {
+            free.give(buf);
+        }
+    }
+
+    /// Stops the thread; a READ CD in flight finishes first.
+    pub fn stop(&mut self) {
+        self.stop.store(true, Ordering::Relaxed);
+        // Closing both queues wakes a producer blocked on either.
+        self.chunks = None;
+        self.free = None;
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+impl Drop for Producer {
+    fn drop(&mut self) {
+        self.stop();
+    }
+}
+
+pub struct CdStream {
+    /// Positioned copies of it feed each producer.
+    reader: TrackReader,
+    producer: Producer,
+    header: [u8; WAV_HEADER_BYTES],
+    /// Track length in sectors.
+    sectors: u32,
+    /// Byte offset in the WAV stream.
+    position: u64,
+    chunk: Vec<u8>,
+    /// Bytes of `chunk` already returned.
+    offset: usize,
+    /// Read error held back while returning the data before it.
+    error: Option<io::Error>,
+}
+
+static STREAMS: std::sync::LazyLock<Registry<CdStream>> =
+    std::sync::LazyLock::new(Registry::new);
+
+impl CdStream {
+    /// Starts reading ahead from the track's first sector.
+    pub fn new(reader: TrackReader, sectors: u32) -> io::Result<Self> {
+        Ok(Self {
+            producer: Producer::start(reader.clone_at(0))?,
+            reader,
+            header: wav_header(sectors.saturating_mul(CD_RAW_SECTOR as u32)),
+            sectors,
+            position: 0,
+            chunk: Vec::new(),
+            offset: 0,
+            error: None,
+        })
+    }
+
+    pub fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        if let Some(e) = self.error.take() {
+            return Err(e);
+        }
+        let mut n = 0;
+        if self.position < WAV_HEADER_BYTES as u64 {
+            let h = &self.header[self.position as usize..];
+            n = h.len().min(buf.len());
+            buf[..n].copy_from_slice(&h[..n]);
+        }
+        let header = n;
+        while n < buf.len() {
+            if self.offset == self.chunk.len() {
+                // Wait only while no audio has been returned yet.
+                let chunk = match self.producer.next(n == header) {
+                    Some(Ok(chunk)) => chunk,
+                    Some(Err(e)) if n == header => return Err(e),
+                    Some(Err(e)) => {
+                        self.error = Some(e);
+                        break;
+                    }
+                    None => break,
+                };
+                self.producer.recycle(std::mem::replace(&mut self.chunk, chunk));
+                self.offset = 0;
+                continue;
+            }
+            let m = (self.chunk.len() - self.offset).min(buf.len() - n);
+            buf[n..n + m].copy_from_slice(&self.chunk[self.offset..self.offset + m]);
+            self.offset += m;
+            n += m;
+        }
+        self.position += n as u64;
+        Ok(n)
+    }
+
+    /// Sector into the track; the stream continues with PCM (no new header).
+    pub fn seek_sector(&mut self, sector: u32) -> io::Result<()> {
+        let sector = sector.min(self.sectors);
+        self.restart(sector)?;
+        self.position = WAV_HEADER_BYTES as u64 + sector as u64 * CD_RAW_SECTOR as u64;
+        Ok(())
+    }
+
+    fn restart(&mut self, sector: u32) -> io::Result<()> {
+        self.producer.stop();
+        self.producer = Producer::start(self.reader.clone_at(sector))?;
+        self.chunk.clear();
+        self.offset = 0;
+        self.error = None;
+        Ok(())
+    }
+}
+
+/// Track sector playing at a time.
+pub fn time_to_sector(time_ms: u64) -> u32 {
+    (time_ms * SECTORS_PER_SECOND as u64 / 1000).min(u32::MAX as u64) as u32
+}
+
+fn not_found() -> io::Error {
+    io::Error::new(io::ErrorKind::NotFound, "Stream not found")
+}
+
+pub fn register_stream(stream: CdStream) -> u64 {
+    STREAMS.insert(stream)
+}
+
+pub fn read_stream(stream_id: u64, buf: &mut [u8]) -> io::Result<usize> {
+    STREAMS.with(stream_id, |s| s.read(buf)).unwrap_or_else(|| Err(not_found()))
+}
+
+/// Removes the stream and stops its producer.
+pub fn close_stream(stream_id: u64) -> bool {
+    STREAMS.remove(stream_id).is_some()
+}
+
+/// A track stream as read by the pump; positions are track sectors.
+struct TrackSource(u64);
+
+impl PumpSource for TrackSource {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        read_stream(self.0, buf)
+    }
+
+    fn seek_block(&mut self, block: u32) -> io::Result<()> {
+        STREAMS
+            .with(self.0, |s| s.seek_sector(block))
+            .unwrap_or_else(|| Err(not_found()))
+    }
+}
+
+pub fn start_pump(stream_id: u64, fd: RawFd) -> io::Result<u64> {
+    pump::start(stream_id, TrackSource(stream_id), "cdda-pump", fd)
+}
+
+pub fn pump_seek_time(pump_id: u64, time_ms: u64) -> io::Result<()> {
+    pump::seek_block(pump_id, time_to_sector(time_ms))
+}
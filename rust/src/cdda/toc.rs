@@ -0,0 +1,194 @@
+//! Table of contents of an audio CD, from READ TOC format 0.
+
+use std::fmt::Write;
+use std::io;
+
+/// 75 sectors per second of CD-DA.
+pub const SECTORS_PER_SECOND: u32 = 75;
+/// Track number of the lead-out descriptor.
+const LEAD_OUT: u8 = 0xAA;
+/// Control bit set on data tracks.
+const CONTROL_DATA: u8 = 0x04;
+/// Lead-out, lead-in and pregap between the audio session and the data
+/// session of an Enhanced CD (CD-Extra): 6750 + 4500 + 150 sectors.
+const SESSION_GAP: u32 = 11_400;
+
+#[derive(Clone, Copy, Debug)]
+pub struct Track {
+    pub number: u8,
+    /// First sector (LBA).
+    pub start: u32,
+    /// Sectors up to the next track, the session gap or the lead-out.
+    pub length: u32,
+    pub audio: bool,
+}
+
+impl Track {
+    pub fn end(&self) -> u32 {
+        self.start + self.length
+    }
+
+    pub fn duration_ms(&self) -> u64 {
+        self.length as u64 * 1000 / SECTORS_PER_SECOND as u64
+    }
+}
+
+#[derive(Clone, Debug)]
+pub struct Toc {
+    pub tracks: Vec<Track>,
+    /// Lead-out start: one past the last readable sector.
+    pub lead_out: u32,
+}
+
+impl Toc {
+    /// Parses the READ TOC response: a 4-byte header, then 8-byte
+    /// descriptors (ADR/control, track number, LBA) ending with the lead-out.
+    pub fn parse(data: &[u8]) -> io::Result<Self> {
+        if data.len() < 4 {
+            return Err(invalid("TOC too short"));
+        }
+        let len = (u16::from_be_bytes([data[0], data[1]]) as usize + 2).min(data.len());
+        let mut entries = Vec::new();
+        let mut lead_out = None;
+        for d in data[4..len].chunks_exact(8) {
+            let lba = u32::from_be_bytes([d[4], d[5], d[6], d[7]]);
+            if d[2] == LEAD_OUT {
+                lead_out = Some(lba);
+            } else {
+                entries.push((d[2], lba, d[1] & CONTROL_DATA == 0));
+            }
+        }
+        let lead_out = lead_out.ok_or_else(|| invalid("TOC has no lead-out"))?;
+        let mut tracks = Vec::with_capacity(entries.len());
+        for (i, &(number, start, audio)) in entries.iter().enumerate() {
+            let end = match entries.get(i + 1) {
+                // Audio followed by a data track: the data session starts
+                // after the session gap.
+                Some(&(_, next, false)) if audio => next.saturating_sub(SESSION_GAP),
+                Some(&(_, next, _)) => next,
+                None => lead_out,
+            };
+            if end <= start {
+                return Err(invalid("TOC tracks out of order"));
+            }
+            tracks.push(Track { number, start, length: end - start, audio });
+        }
+        if tracks.is_empty() {
+            return Err(invalid("TOC has no tracks"));
+        }
+        Ok(Self { tracks, lead_out })
+    }
+
+    pub fn track(&self, number: u8) -> Option<&Track> {
+        self.tracks.iter().find(|t| t.number == number)
+    }
+
+    /// One past the last sector of the session holding `track`: the session
+    /// gap before the next data track, else the lead-out. Reads past a
+    /// track's end (jitter slack) must stop here, not in the gap.
+    pub fn session_end(&self, track: &Track) -> u32 {
+        self.tracks
+            .iter()
+            .find(|t| !t.audio && t.start > track.start)
+            .map_or(self.lead_out, |t| t.start.saturating_sub(SESSION_GAP))
+    }
+
+    /// {"leadOut":n,"tracks":[{"number","start","sectors","durationMs","audio"}]}
+    pub fn to_json(&self) -> String {
+        let mut out = format!("{{\"leadOut\":{},\"tracks\":[", self.lead_out);
+        for (i, t) in self.tracks.iter().enumerate() {
+            if i > 0 {
+                out.push(',');
+            }
+            let _ = write!(
+                out,
+                "{{\"number\":{},\"start\":{},\"sectors\":{},\"durationMs\":{},\"audio\":{}}}",
+                t.number,
+                t.start,
+                t.length,
+                t.duration_ms(),
+                t.audio
+            );
+        }
+        out.push_str("]}");
+        out
+    }
+}
+
+fn invalid(msg: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, msg)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// READ TOC format 0 response for (track, lba, audio) and the lead-out.
+    fn toc_bytes(tracks: &[(u8, u32, bool)], lead_out: u32) -> Vec<u8> {
+        let mut out = vec![0u8; 4];
+        for &(number, lba, audio) in tracks.iter().chain(&[(LEAD_OUT, lead_out, true)]) {
+            let control = if audio { 0x10 } else { 0x10 | CONTROL_DATA };
+            out.extend_from_slice(&[0, control, number, 0]);
+            out.extend_from_slice(&lba.to_be_bytes());
+        }
+        let len = (out.len() - 2) as u16;
+        out[0..2].copy_from_slice(&len.to_be_bytes());
+        out[2] = tracks[0].0;
+        out[3] = tracks[tracks.len() - 1].0;
+        out
+    }
+
+    #[test]
+    fn parses_an_audio_cd() {
+        let toc = Toc::parse(&toc_bytes(&[(1, 0, true), (2, 15_000, true), (3, 33_000, true)], 45_000)).unwrap();
+        let lengths: Vec<_> = toc.tracks.iter().map(|t| (t.number, t.start, t.length)).collect();
+        assert_eq!(lengths, [(1, 0, 15_000), (2, 15_000, 18_000), (3, 33_000, 12_000)]);
+        assert_eq!(toc.lead_out, 45_000);
+        assert_eq!(toc.track(2).unwrap().duration_ms(), 240_000);
+        assert!(toc.track(4).is_none());
+        assert_eq!(
+            Toc::parse(&toc_bytes(&[(1, 0, true)], 75)).unwrap().to_json(),
+            r#"{"leadOut":75,"tracks":[{"number":1,"start":0,"sectors":75,"durationMs":1000,"audio":true}]}"#
+        );
+    }
+
+    #[test]
+    fn ignores_bytes_past_the_data_length() {
+        let mut data = toc_bytes(&[(1, 0, true), (2, 15_000, true)], 45_000);
+        let full = data.len();
+        // A stale descriptor after the response, which the length excludes.
+        data.extend_from_slice(&[0, 0x10, 3, 0, 0, 0, 0xff, 0xff]);
+        let toc = Toc::parse(&data).unwrap();
+        assert_eq!(toc.tracks.len(), 2);
+        // A length beyond the buffer is clamped; the cut lead-out is dropped.
+        assert!(Toc::parse(&data[..full - 1]).is_err());
+    }
+
+    #[test]
+    fn rejects_malformed_tocs() {
+        assert!(Toc::parse(&[0, 2, 1]).is_err());
+        let mut no_lead_out = toc_bytes(&[(1, 0, true)], 100);
+        no_lead_out[0..2].copy_from_slice(&10u16.to_be_bytes());
+        assert!(Toc::parse(&no_lead_out).is_err());
+        assert!(Toc::parse(&toc_bytes(&[(1, 500, true), (2, 100, true)], 1_000)).is_err());
+        assert!(Toc::parse(&toc_bytes(&[(1, 0, true)], 0)).is_err());
+    }
+
+    #[test]
+    fn session_end_stops_before_the_data_session() {
+        let toc = Toc::parse(&toc_bytes(&[(1, 0, true), (2, 20_000, true), (3, 50_000, false)], 60_000)).unwrap();
+        let last_audio = *toc.track(2).unwrap();
+        assert_eq!(last_audio.end(), 50_000 - SESSION_GAP);
+        assert_eq!(toc.session_end(toc.track(1).unwrap()), 50_000 - SESSION_GAP);
+        assert_eq!(toc.session_end(&last_audio), 50_000 - SESSION_GAP);
+        assert_eq!(toc.session_end(toc.track(3).unwrap()), 60_000);
+    }
+
+    #[test]
+    fn session_end_of_an_audio_only_disc_is_the_lead_out() {
+        // Mixed mode: the data track comes first, in the same session.
+        let toc = Toc::parse(&toc_bytes(&[(1, 0, false), (2, 30_000, true)], 40_000)).unwrap();
+        assert_eq!(toc.track(1).unwrap().length, 30_000);
+        assert_eq!(toc.session_end(toc.track(2).unwrap()), 40_000);
+    }
+}
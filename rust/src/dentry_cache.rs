@@ -0,0 +1,200 @@
+//! Path lookup caches for NtfsVolume.
+//! Maps normalized paths to file record numbers and keeps parsed directory
+//! listings, so navigation and chunked reads skip the index B-tree walk.
+//! The volume is mounted read-only, so entries never go stale.
+
+use crate::ntfs_volume::DirEntry;
+use std::borrow::Borrow;
+use std::collections::{BTreeMap, HashMap};
+use std::hash::Hash;
+use std::sync::Arc;
+
+/// Paths remembered (a few hundred bytes each).
+const DENTRY_CAPACITY: usize = 4096;
+/// Memory for remembered directory listings (names plus entry structs).
+const LISTING_BUDGET_BYTES: usize = 4 * 1024 * 1024;
+/// Larger listings aren't cached at all: re-reading one huge directory is
+/// cheaper than evicting every other listing for it.
+const LISTING_MAX_BYTES: usize = LISTING_BUDGET_BYTES / 4;
+/// Listings with more subdirectories than this don't prime the path cache,
+/// so one huge directory can't evict everything else.
+pub const PRIME_MAX: usize = 512;
+
+/// LRU map bounded by the total weight of its values (1 each unless given);
+/// same tick scheme as the block cache.
+struct Lru<K, V> {
+    /// key -> (tick, weight, value)
+    map: HashMap<K, (u64, usize, V)>,
+    /// tick -> key, oldest first.
+    order: BTreeMap<u64, K>,
+    tick: u64,
+    weight: usize,
+    capacity: usize,
+}
+
+impl<K: Hash + Eq + Clone, V: Clone> Lru<K, V> {
+    fn new(capacity: usize) -> Self {
+        Self {
+            map: HashMap::new(),
+            order: BTreeMap::new(),
+            tick: 0,
+            weight: 0,
+            capacity: capacity.max(1),
+        }
+    }
+
+    /// Looks up by any borrowed form of the key, like HashMap::get; the
+    /// owned key moves within `order`, so a hit allocates nothing.
+    fn get<Q>(&mut self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: ?Sized + Hash + Eq,
+    {
+        self.tick += 1;
+        let tick = self.tick;
+        let (t, _, v) = self.map.get_mut(key)?;
+        let old = std::mem::replace(t, tick);
+        if let Some(owned) = self.order.remove(&old) {
+            self.order.insert(tick, owned);
+        }
+        Some(v.clone())
+    }
+
+    fn insert(&mut self, key: K, value: V) {
+        self.insert_weighted(key, value, 1);
+    }
+
+    fn insert_weighted(&mut self, key: K, value: V, weight: usize) {
+        self.tick += 1;
+        let tick = self.tick;
+        if let Some((old, old_weight, _)) = self.map.insert(key.clone(), (tick, weight, value)) {
+            self.order.remove(&old);
+            self.weight -= old_weight;
+        }
+        self.order.insert(tick, key);
+        self.weight += weight;
+        while self.weight > self.capacity && self.map.len() > 1 {
+            let Some((_, victim)) = self.order.pop_first() else { break };
+            if let Some((_, w, _)) = self.map.remove(&victim) {
+                self.weight -= w;
+            }
+        }
+    }
+}
+
+pub struct DentryCache {
+    records: Lru<String, u64>,
+    listings: Lru<u64, Arc<Vec<DirEntry>>>,
+}
+
+impl DentryCache {
+    pub fn new() -> Self {
+        Self {
+            records: Lru::new(DENTRY_CAPACITY),
+            listings: Lru::new(LISTING_BUDGET_BYTES),
+        }
+    }
+
+    /// Record number of a path key built by `path_key`.
+    pub fn record(&mut self, key: &str) -> Option<u64> {
+        self.records.get(key)
+    }
+
+    pub fn insert_record(&mut self, key: String, record: u64) {
+        self.records.insert(key, record);
+    }
+
+    pub fn listing(&mut self, dir_record: u64) -> Option<Arc<Vec<DirEntry>>> {
+        self.listings.get(&dir_record)
+    }
+
+    /// Remembers a listing unless it is over LISTING_MAX_BYTES.
+    pub fn insert_listing(&mut self, dir_record: u64, entries: Arc<Vec<DirEntry>>) {
+        let bytes = listing_bytes(&entries);
+        if bytes <= LISTING_MAX_BYTES {
+            self.listings.insert_weighted(dir_record, entries, bytes);
+        }
+    }
+}
+
+/// Memory held by a listing: entry structs plus name bytes.
+fn listing_bytes(entries: &[DirEntry]) -> usize {
+    entries
+        .iter()
+        .map(|e| std::mem::size_of::<DirEntry>() + e.name.len())
+        .sum()
+}
+
+/// Cache key for the first components of a path. NTFS compares names through
+/// the volume's $UpCase table, a 1:1 UTF-16 mapping; characters whose Unicode
+/// uppercase is a single char are folded the same way, others are kept.
+pub fn path_key(components: &[&str]) -> String {
+    let mut key = String::new();
+    for (i, part) in components.iter().enumerate() {
+        if i > 0 {
+            key.push('/');
+        }
+        for c in part.chars() {
+            let mut upper = c.to_uppercase();
+            match (upper.next(), upper.next()) {
+                (Some(u), None) => key.push(u),
+                _ => key.push(c),
+            }
+        }
+    }
+    key
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn listing(count: usize, name_len: usize) -> Arc<Vec<DirEntry>> {
+        let entry = DirEntry { name: "x".repeat(name_len), is_dir: false, size: 0 };
+        Arc::new(vec![entry; count])
+    }
+
+    #[test]
+    fn lru_evicts_the_least_recently_used() {
+        let mut lru = Lru::new(2);
+        lru.insert(1, "a");
+        lru.insert(2, "b");
+        assert_eq!(lru.get(&1), Some("a"));
+        lru.insert(3, "c");
+        assert_eq!(lru.get(&2), None);
+        assert_eq!(lru.get(&1), Some("a"));
+        assert_eq!(lru.get(&3), Some("c"));
+        // Replacing a key doesn't count it twice.
+        lru.insert(3, "d");
+        assert_eq!((lru.map.len(), lru.weight), (2, 2));
+    }
+
+    #[test]
+    fn listings_are_bounded_by_bytes() {
+        let mut cache = DentryCache::new();
+        let entry = std::mem::size_of::<DirEntry>() + 100;
+        let per_listing = LISTING_MAX_BYTES / entry;
+        for dir in 0..5 {
+            cache.insert_listing(dir, listing(per_listing, 100));
+        }
+        assert!(cache.listings.weight <= LISTING_BUDGET_BYTES);
+        assert!(cache.listing(0).is_none());
+        assert!(cache.listing(4).is_some());
+    }
+
+    #[test]
+    fn skips_listings_over_the_limit() {
+        let mut cache = DentryCache::new();
+        cache.insert_listing(1, listing(1, 10));
+        cache.insert_listing(2, listing(LISTING_MAX_BYTES / 64, 64));
+        assert!(cache.listing(1).is_some());
+        assert!(cache.listing(2).is_none());
+    }
+
+    #[test]
+    fn path_keys_fold_case() {
+        assert_eq!(path_key(&["Program Files", "stra\u{df}e"]), "PROGRAM FILES/STRA\u{df}E");
+        assert_eq!(path_key(&["\u{e9}t\u{e9}"]), "\u{c9}T\u{c9}");
+        assert_eq!(path_key(&[]), "");
+    }
+}
@@ -0,0 +1,82 @@
+//! One USB mass-storage device shared by every volume opened on it.
+//! The block device, its command queue (the BlockCache lock) and the cache
+//! are created once per USB session, and the partition table is scanned
+//! once; each NtfsVolume then reads its own partition through them.
+
+use crate::block_cache::{self, BlockCache};
+use crate::block_device::ScsiBlockDevice;
+use crate::partition;
+use std::io;
+use std::sync::Arc;
+
+pub struct Partition {
+    pub start_lba: u64,
+    pub block_count: u64,
+    pub mbr_type: u8,
+    /// Boot sector carries the NTFS OEM ID.
+    pub is_ntfs: bool,
+}
+
+pub struct DeviceSession {
+    cache: Arc<BlockCache>,
+    partitions: Vec<Partition>,
+}
+
+impl DeviceSession {
+    pub fn open(device: ScsiBlockDevice) -> io::Result<Self> {
+        let cache = Arc::new(BlockCache::new(device, block_cache::DEFAULT_BUDGET_BYTES));
+        let mut partitions: Vec<Partition> = partition::read_partitions(&cache)?
+            .into_iter()
+            .map(|p| Partition {
+                start_lba: p.start_lba,
+                block_count: p.block_count,
+                mbr_type: p.mbr_type,
+                is_ntfs: false,
+            })
+            .collect();
+        if partitions.is_empty() {
+            // No partition table: the filesystem may start at LBA 0 (superfloppy).
+            partitions.push(Partition {
+                start_lba: 0,
+                block_count: cache.block_count(),
+                mbr_type: 0,
+                is_ntfs: false,
+            });
+        }
+        let mut boot = vec![0u8; cache.block_size() as usize];
+        for p in &mut partitions {
+            if p.start_lba < cache.block_count() && cache.read_blocks(p.start_lba, 1, &mut boot).is_ok() {
+                p.is_ntfs = partition::is_ntfs_boot_sector(&boot);
+            }
+        }
+        Ok(Self { cache, partitions })
+    }
+
+    pub fn partitions(&self) -> &[Partition] {
+        &self.partitions
+    }
+
+    pub fn cache(&self) -> Arc<BlockCache> {
+        Arc::clone(&self.cache)
+    }
+
+    /// (start LBA, size in bytes) of partition `index`, or of the first NTFS
+    /// partition when None. Without one, the first partition is returned so
+    /// the NTFS mount reports why it failed.
+    pub fn locate(&self, index: Option<usize>) -> io::Result<(u64, u64)> {
+        let p = match index {
+            Some(i) => self.partitions.get(i).ok_or_else(|| {
+                io::Error::new(io::ErrorKind::NotFound, format!("No partition {}", i))
+            })?,
+            None => self
+                .partitions
+                .iter()
+                .find(|p| p.is_ntfs)
+                .unwrap_or(&self.partitions[0]),
+        };
+        let block_size = self.cache.block_size() as u64;
+        let remaining = self.cache.block_count().saturating_sub(p.start_lba);
+        let blocks = if p.block_count == 0 { remaining } else { std::cmp::min(p.block_count, remaining) };
+        Ok((p.start_lba, blocks * block_size))
+    }
+}
@@ -1,20 +1,131 @@
-//! Stream callback adapter: ScsiBlockDevice -> libdvdread dvd_reader_stream_cb.
+//! Stream callback adapter: BlockCache -> libdvdread dvd_reader_stream_cb.
 //! DVD uses 2048-byte blocks. ScsiBlockDevice may use 512 - we convert.
+//! Block-aligned reads go straight into libdvdread's buffer; anything else
+//! goes through a bounce buffer owned by the StreamContext. Reads inside a
+//! staged extent (sectors already fetched by title extraction) are copied
+//! from memory instead.
 
-use crate::block_device::ScsiBlockDevice;
+use crate::block_cache::BlockCache;
+use crate::block_device::IoVec;
 use crate::dvd::ffi;
 use std::os::raw::{c_int, c_void};
+use std::sync::Arc;
 
 const DVD_BLOCK: usize = ffi::DVD_VIDEO_LB_LEN;
 
 /// Context passed as p_stream to libdvdread callbacks.
 pub struct StreamContext {
-    pub block_device: ScsiBlockDevice,
+    pub block_device: Arc<BlockCache>,
     pub position: u64,
+    /// Reused for reads that don't start or end on a DVD block boundary.
+    /// Only grows, so steady-state callbacks don't allocate.
+    bounce: Vec<u8>,
+    /// Raw sectors at a DVD block, served to reads that lie inside them.
+    staged: Option<(u64, Vec<u8>)>,
 }
 
 unsafe impl Send for StreamContext {}
 
+impl StreamContext {
+    pub fn new(block_device: Arc<BlockCache>) -> Self {
+        Self {
+            block_device,
+            position: 0,
+            bounce: Vec::new(),
+            staged: None,
+        }
+    }
+
+    /// Serves reads of `data.len()` bytes at DVD block `lba` from `data` until
+    /// unstage. Only call with the disc's reader lock held.
+    pub fn stage(&mut self, lba: u64, data: Vec<u8>) {
+        self.staged = Some((lba, data));
+    }
+
+    pub fn unstage(&mut self) -> Option<Vec<u8>> {
+        self.staged.take().map(|(_, data)| data)
+    }
+
+    fn per_dvd_block(&self) -> u64 {
+        per_dvd_block(&self.block_device)
+    }
+
+    /// Read whole DVD blocks starting at `lba` into `buf` (a multiple of DVD_BLOCK).
+    fn read_dvd_blocks(&self, lba: u64, buf: &mut [u8]) -> std::io::Result<usize> {
+        if let Some((start, data)) = &self.staged {
+            let off = lba.checked_sub(*start).map(|b| b as usize * DVD_BLOCK);
+            if let Some(off) = off.filter(|&o| o + buf.len() <= data.len()) {
+                buf.copy_from_slice(&data[off..off + buf.len()]);
+                return Ok(buf.len());
+            }
+        }
+        read_raw_dvd_blocks(&self.block_device, lba, buf)
+    }
+
+    /// Fills `iov` from the staged extent if it covers the whole request.
+    fn read_staged_vectored(&self, iov: &[IoVec]) -> Option<usize> {
+        let (start, data) = self.staged.as_ref()?;
+        let total: usize = iov.iter().map(|v| v.len).sum();
+        let off = (self.position / DVD_BLOCK as u64).checked_sub(*start)? as usize * DVD_BLOCK;
+        if off + total > data.len() {
+            return None;
+        }
+        let mut src = &data[off..off + total];
+        for v in iov {
+            let dst = unsafe { std::slice::from_raw_parts_mut(v.base, v.len) };
+            dst.copy_from_slice(&src[..v.len]);
+            src = &src[v.len..];
+        }
+        Some(total)
+    }
+
+    /// Loads `count` DVD blocks at `lba` into the block cache with one device read.
+    pub fn prefetch_dvd_blocks(&self, lba: u64, count: u32) -> std::io::Result<()> {
+        let per_dvd_block = self.per_dvd_block();
+        self.block_device
+            .prefetch(lba * per_dvd_block, (count as u64 * per_dvd_block) as u32)
+    }
+
+    fn read_at_position(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+        let lba = self.position / DVD_BLOCK as u64;
+        let skip = (self.position % DVD_BLOCK as u64) as usize;
+        if skip == 0 && buf.len() % DVD_BLOCK == 0 {
+            return self.read_dvd_blocks(lba, buf);
+        }
+        let span = (skip + buf.len()).div_ceil(DVD_BLOCK) * DVD_BLOCK;
+        if self.bounce.len() < span {
+            self.bounce.resize(span, 0);
+        }
+        let mut bounce = std::mem::take(&mut self.bounce);
+        let result = self.read_dvd_blocks(lba, &mut bounce[..span]);
+        let copied = result.map(|n| {
+            let n = n.saturating_sub(skip).min(buf.len());
+            buf[..n].copy_from_slice(&bounce[skip..skip + n]);
+            n
+        });
+        self.bounce = bounce;
+        copied
+    }
+}
+
+/// Device blocks per DVD block (1 for optical drives).
+fn per_dvd_block(cache: &BlockCache) -> u64 {
+    let dev_block = cache.block_size() as usize;
+    if dev_block > 0 && dev_block < DVD_BLOCK {
+        (DVD_BLOCK / dev_block) as u64
+    } else {
+        1
+    }
+}
+
+/// Reads whole DVD blocks at `lba` from the device, without libdvdread (so
+/// without CSS decryption) and without a StreamContext.
+pub fn read_raw_dvd_blocks(cache: &BlockCache, lba: u64, buf: &mut [u8]) -> std::io::Result<usize> {
+    let per_dvd_block = per_dvd_block(cache);
+    let count = (buf.len() / DVD_BLOCK) as u64 * per_dvd_block;
+    cache.read_blocks(lba * per_dvd_block, count as u32, buf)
+}
+
 extern "C" fn stream_seek(p_stream: *mut c_void, i_pos: u64) -> c_int {
     if p_stream.is_null() {
         return -1;
@@ -30,31 +141,35 @@ extern "C" fn stream_read(p_stream: *mut c_void, buffer: *mut c_void, i_read: c_
     }
     let ctx = unsafe { &mut *(p_stream as *mut StreamContext) };
     let buf = unsafe { std::slice::from_raw_parts_mut(buffer as *mut u8, i_read as usize) };
-    let lba = ctx.position / DVD_BLOCK as u64;
-    let block_count = ((i_read as usize) + DVD_BLOCK - 1) / DVD_BLOCK;
-    let block_count = block_count as u32;
-    let mut read_buf = vec![0u8; (block_count as usize) * DVD_BLOCK];
-    match ctx.block_device.read_blocks(lba, block_count, &mut read_buf) {
+    match ctx.read_at_position(buf) {
         Ok(n) => {
-            let bytes_to_copy = n.min(i_read as usize);
-            buf[..bytes_to_copy].copy_from_slice(&read_buf[..bytes_to_copy]);
-            ctx.position += bytes_to_copy as u64;
-            bytes_to_copy as c_int
+            ctx.position += n as u64;
+            n as c_int
         }
         Err(_) => -1,
     }
 }
 
-extern "C" fn stream_readv(p_stream: *mut c_void, _p_iovec: *mut c_void, i_blocks: c_int) -> c_int {
-    if p_stream.is_null() || i_blocks <= 0 {
+/// `p_iovec` is a `struct iovec` array with `i_blocks` entries (libdvdcss
+/// passes it as the iovcnt); returns bytes read, like pf_read.
+extern "C" fn stream_readv(p_stream: *mut c_void, p_iovec: *mut c_void, i_blocks: c_int) -> c_int {
+    if p_stream.is_null() || p_iovec.is_null() || i_blocks <= 0 {
         return -1;
     }
     let ctx = unsafe { &mut *(p_stream as *mut StreamContext) };
-    let mut buf = vec![0u8; (i_blocks as usize) * DVD_BLOCK];
-    match ctx.block_device.read_blocks(ctx.position / DVD_BLOCK as u64, i_blocks as u32, &mut buf) {
+    let iov = unsafe { std::slice::from_raw_parts(p_iovec as *const IoVec, i_blocks as usize) };
+    if ctx.position % DVD_BLOCK as u64 != 0 {
+        return -1;
+    }
+    if let Some(n) = ctx.read_staged_vectored(iov) {
+        ctx.position += n as u64;
+        return n as c_int;
+    }
+    let lba = ctx.position / DVD_BLOCK as u64 * ctx.per_dvd_block();
+    match ctx.block_device.read_blocks_vectored(lba, iov) {
         Ok(n) => {
             ctx.position += n as u64;
-            (n / DVD_BLOCK) as c_int
+            n as c_int
         }
         Err(_) => -1,
     }
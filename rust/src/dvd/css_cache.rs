@@ -0,0 +1,48 @@
+//! Persistent CSS title-key cache.
+//! libdvdcss caches recovered title keys under the directory named by the
+//! DVDCSS_CACHE variable, which is read when the reader is opened. Android
+//! apps have no usable HOME, so without it every open cracks the keys again.
+//!
+//! The variable is process-wide and setting it races getenv on other
+//! threads, so it is set once, right after the library is loaded and before
+//! any disc is opened, to a fixed root. libdvdcss keeps one directory per
+//! disc inside it, named by volume label, manufacturing date, serial and a
+//! hash of the disc key, so discs with the same label don't share keys.
+
+use crate::dvd::block_read::StreamContext;
+use crate::dvd::ffi;
+use std::ffi::c_void;
+use std::path::Path;
+use std::sync::Once;
+
+static CACHE_ROOT: Once = Once::new();
+
+/// Points libdvdcss at `root` for the rest of the process; an empty root (or
+/// one that can't be created) disables the cache. Only the first call has an
+/// effect; returns false for later ones.
+pub fn set_cache_root(root: &Path) -> bool {
+    let mut applied = false;
+    CACHE_ROOT.call_once(|| {
+        let usable = !root.as_os_str().is_empty() && std::fs::create_dir_all(root).is_ok();
+        let value = if usable { root.as_os_str() } else { "off".as_ref() };
+        std::env::set_var("DVDCSS_CACHE", value);
+        applied = true;
+    });
+    applied
+}
+
+/// Opens a reader on the stream, with title keys cached per set_cache_root.
+pub fn open_reader(ctx: &StreamContext) -> Result<*mut ffi::dvd_reader_t, String> {
+    let stream_cb = crate::dvd::block_read::make_stream_cb();
+    let reader = unsafe {
+        ffi::DVDOpenStream2(
+            ctx as *const StreamContext as *mut c_void,
+            std::ptr::null(),
+            &stream_cb,
+        )
+    };
+    if reader.is_null() {
+        return Err("DVDOpenStream2 failed".to_string());
+    }
+    Ok(reader)
+}
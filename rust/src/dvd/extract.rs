@@ -0,0 +1,295 @@
+//! Title extraction: copies a title's VOB sectors (optionally a chapter range)
+//! decrypted into a file descriptor, as a job in crate::jobs. The sectors are
+//! the title's cells in playback order, so a title whose PGC jumps around the
+//! VOBs comes out as played.
+//! Three stages run on their own threads, connected by bounded queues:
+//! - read: raw sectors straight from the block device, in large sequential
+//!   commands, so an optical drive keeps streaming instead of stopping and
+//!   re-seeking while the slower stages catch up;
+//! - decrypt: DVDReadBlocks over the chunk staged in the disc's
+//!   StreamContext, so libdvdcss descrambles it without touching the device;
+//! - write: the decrypted chunk to the descriptor.
+//! A job resumes from a byte offset of an earlier partial output; the range
+//! is block-aligned, so the output is the same as an uninterrupted copy.
+
+use super::{open_title_file, DVD_HANDLES};
+use crate::block_cache::BlockCache;
+use crate::dvd::block_read;
+use crate::dvd::ffi;
+use crate::jobs::{self, BufferPool, BufferReturn, CopyJob};
+use std::ffi::CString;
+use std::fs::File;
+use std::io::{self, Seek, SeekFrom, Write};
+use std::os::fd::RawFd;
+use std::sync::mpsc::{sync_channel, Receiver, SyncSender};
+use std::sync::Arc;
+
+const DVD_BLOCK: usize = ffi::DVD_VIDEO_LB_LEN;
+/// DVD blocks per device read and per DVDReadBlocks call (512 KiB). Well
+/// above the block cache's bypass size, so a copy doesn't evict playback data.
+const CHUNK_BLOCKS: u32 = 256;
+const CHUNK_BYTES: usize = CHUNK_BLOCKS as usize * DVD_BLOCK;
+/// Raw chunks read ahead of the decrypt stage: 4 MiB keeps the drive reading
+/// through a slow write.
+const READ_DEPTH: usize = 8;
+/// Decrypted chunks queued for the writer.
+const WRITE_DEPTH: usize = 4;
+
+/// A run of title sectors: `blocks` DVD blocks at title offset `block`.
+struct Chunk {
+    data: Vec<u8>,
+    block: u32,
+    blocks: u32,
+}
+
+/// The title VOBs opened for the job, closed when the job ends.
+#[derive(Clone, Copy)]
+struct TitleFile(*mut ffi::dvd_file_t);
+
+unsafe impl Send for TitleFile {}
+
+/// Starts extracting `title_id`, chapters `first_chapter..=last_chapter`
+/// (1-based, 0 for the last chapter), into `fd`. Output up to `resume_bytes`
+/// (rounded down to a block) is kept and the copy continues after it; pass 0
+/// for a new file. Takes ownership of `fd`. Release the job before closing
+/// the disc.
+pub fn start(
+    dvd_handle: u64,
+    title_id: i32,
+    first_chapter: u32,
+    last_chapter: u32,
+    resume_bytes: u64,
+    fd: RawFd,
+) -> io::Result<u64> {
+    let mut out = jobs::adopt_fd(fd);
+    let (file, cache, vob_start, runs) = DVD_HANDLES
+        .with(dvd_handle, |h| {
+            let (file, index, title_set) = open_title_file(h, title_id).map_err(other)?;
+            let file = TitleFile(file);
+            let last = if last_chapter == 0 { index.chapters.len() as u32 } else { last_chapter };
+            let runs = index.chapter_runs(first_chapter.max(1), last);
+            let vob_start = {
+                let _guard = h.reader_lock.lock().unwrap();
+                title_vob_start(h.dvd_reader, title_set)
+            };
+            match (runs, vob_start) {
+                (Some(runs), Some(vob_start)) => {
+                    Ok((file, Arc::clone(&h.stream_ctx.block_device), vob_start, runs))
+                }
+                (runs, _) => {
+                    let _guard = h.reader_lock.lock().unwrap();
+                    unsafe { ffi::DVDCloseFile(file.0) };
+                    Err(match runs {
+                        None => io::Error::new(io::ErrorKind::NotFound, "Chapter range not found"),
+                        Some(_) => other("Title VOBs not found"),
+                    })
+                }
+            }
+        })
+        .unwrap_or_else(|| Err(io::Error::new(io::ErrorKind::NotFound, "DVD handle not found")))?;
+
+    let blocks: u64 = runs.iter().map(|r| (r.1 - r.0) as u64).sum();
+    let total = blocks * DVD_BLOCK as u64;
+    let resume = (resume_bytes / DVD_BLOCK as u64).min(blocks) * DVD_BLOCK as u64;
+    let positioned = out.set_len(resume).and_then(|_| out.seek(SeekFrom::Start(resume)));
+    if let Err(e) = positioned {
+        close_title_file(dvd_handle, file);
+        return Err(e);
+    }
+    let runs = skip_blocks(runs, resume / DVD_BLOCK as u64);
+
+    let (id, job) = jobs::register(total, resume);
+    let (raw_tx, raw_rx) = sync_channel::<Chunk>(READ_DEPTH);
+    let (raw_pool, raw_free) = jobs::buffer_pool(READ_DEPTH + 2, CHUNK_BYTES);
+    let (plain_tx, plain_rx) = sync_channel::<Chunk>(WRITE_DEPTH);
+    let (plain_pool, plain_free) = jobs::buffer_pool(WRITE_DEPTH + 2, CHUNK_BYTES);
+
+    let writer_job = Arc::clone(&job);
+    let writer = std::thread::Builder::new()
+        .name("dvd-extract-writer".to_string())
+        .spawn(move || write_chunks(&writer_job, out, plain_rx, plain_free));
+    let reader_job = Arc::clone(&job);
+    let reader = writer.and_then(|writer| {
+        std::thread::Builder::new()
+            .name("dvd-extract-reader".to_string())
+            .spawn(move || {
+                read_chunks(&reader_job, &cache, vob_start, &runs, raw_tx, raw_pool)
+            })
+            .map(|reader| (writer, reader))
+    });
+    let (writer, reader) = match reader {
+        Ok(threads) => threads,
+        Err(e) => {
+            // Dropping the senders ends a writer that did start.
+            jobs::abandon(id);
+            close_title_file(dvd_handle, file);
+            return Err(e);
+        }
+    };
+    let decrypt_job = Arc::clone(&job);
+    let spawned = std::thread::Builder::new()
+        .name("dvd-extract".to_string())
+        .spawn(move || {
+            let decrypted = decrypt_chunks(
+                &decrypt_job,
+                dvd_handle,
+                &file,
+                vob_start,
+                raw_rx,
+                raw_free,
+                plain_tx,
+                plain_pool,
+            );
+            let read = reader.join().unwrap_or_else(|_| Err(other("Reader thread panicked")));
+            let written = writer.join().unwrap_or_else(|_| Err(other("Writer thread panicked")));
+            close_title_file(dvd_handle, file);
+            decrypt_job.finish(read.and(decrypted).and(written));
+        });
+    if let Err(e) = spawned {
+        // The reader and writer see their queues closed and exit.
+        jobs::abandon(id);
+        close_title_file(dvd_handle, file);
+        return Err(e);
+    }
+    Ok(id)
+}
+
+fn other(msg: impl Into<String>) -> io::Error {
+    io::Error::new(io::ErrorKind::Other, msg.into())
+}
+
+/// Disc block of the title set's first title VOB. DVDReadBlocks offsets of
+/// DVD_READ_TITLE_VOBS count from here (libdvdread treats VTS_nn_1..9.VOB as
+/// one extent). Call with reader_lock held.
+fn title_vob_start(dvd_reader: *mut ffi::dvd_reader_t, title_set: i32) -> Option<u64> {
+    let name = CString::new(format!("/VIDEO_TS/VTS_{:02}_1.VOB", title_set)).ok()?;
+    let mut size = 0u32;
+    let start = unsafe { ffi::UDFFindFile(dvd_reader, name.as_ptr(), &mut size) };
+    (start != 0).then_some(start as u64)
+}
+
+/// Closes the job's title file. If the disc is already closed the file is
+/// left alone: its reader is gone.
+fn close_title_file(dvd_handle: u64, file: TitleFile) {
+    DVD_HANDLES.with(dvd_handle, |h| {
+        let _guard = h.reader_lock.lock().unwrap();
+        unsafe { ffi::DVDCloseFile(file.0) };
+    });
+}
+
+/// The runs left after the first `skip` blocks of output.
+fn skip_blocks(runs: Vec<(u32, u32)>, mut skip: u64) -> Vec<(u32, u32)> {
+    runs.into_iter()
+        .filter_map(|(start, end)| {
+            let n = (end - start) as u64;
+            if skip >= n {
+                skip -= n;
+                return None;
+            }
+            let start = start + skip as u32;
+            skip = 0;
+            Some((start, end))
+        })
+        .collect()
+}
+
+fn read_chunks(
+    job: &CopyJob,
+    cache: &BlockCache,
+    vob_start: u64,
+    runs: &[(u32, u32)],
+    raw_tx: SyncSender<Chunk>,
+    mut pool: BufferPool,
+) -> io::Result<()> {
+    for &(first, end) in runs {
+        let mut block = first;
+        while block < end {
+            if job.cancelled() {
+                return Ok(());
+            }
+            let Some(mut data) = pool.take() else {
+                return Ok(()); // decrypt stage stopped; it reports its own error
+            };
+            let blocks = CHUNK_BLOCKS.min(end - block);
+            let len = blocks as usize * DVD_BLOCK;
+            block_read::read_raw_dvd_blocks(cache, vob_start + block as u64, &mut data[..len])?;
+            if raw_tx.send(Chunk { data, block, blocks }).is_err() {
+                return Ok(());
+            }
+            block += blocks;
+        }
+    }
+    Ok(())
+}
+
+#[allow(clippy::too_many_arguments)]
+fn decrypt_chunks(
+    job: &CopyJob,
+    dvd_handle: u64,
+    file: &TitleFile,
+    vob_start: u64,
+    raw_rx: Receiver<Chunk>,
+    raw_free: BufferReturn,
+    plain_tx: SyncSender<Chunk>,
+    mut plain_pool: BufferPool,
+) -> io::Result<()> {
+    for raw in raw_rx {
+        if job.cancelled() {
+            return Ok(());
+        }
+        let Some(mut plain) = plain_pool.take() else {
+            return Ok(()); // writer stopped; it reports its own error
+        };
+        let Chunk { data, block, blocks } = raw;
+        let (n, data) = DVD_HANDLES
+            .with(dvd_handle, |h| {
+                let _guard = h.reader_lock.lock().unwrap();
+                h.stream_ctx.stage(vob_start + block as u64, data);
+                let n = unsafe {
+                    ffi::DVDReadBlocks(file.0, block as i32, blocks as usize, plain.as_mut_ptr())
+                };
+                (n, h.stream_ctx.unstage().unwrap_or_default())
+            })
+            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, "DVD handle not found"))?;
+        raw_free.give(data);
+        if n != blocks as isize {
+            return Err(other(format!("DVDReadBlocks failed at block {}", block)));
+        }
+        if plain_tx.send(Chunk { data: plain, block, blocks }).is_err() {
+            return Ok(());
+        }
+    }
+    Ok(())
+}
+
+fn write_chunks(
+    job: &CopyJob,
+    mut out: File,
+    plain_rx: Receiver<Chunk>,
+    free: BufferReturn,
+) -> io::Result<()> {
+    for chunk in plain_rx {
+        if job.cancelled() {
+            return Ok(());
+        }
+        let len = chunk.blocks as usize * DVD_BLOCK;
+        out.write_all(&chunk.data[..len])?;
+        job.add_copied(len as u64);
+        free.give(chunk.data);
+    }
+    out.flush()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn resume_skips_whole_and_partial_runs() {
+        let runs = vec![(100, 110), (0, 5), (200, 220)];
+        assert_eq!(skip_blocks(runs.clone(), 0), runs);
+        assert_eq!(skip_blocks(runs.clone(), 10), [(0, 5), (200, 220)]);
+        assert_eq!(skip_blocks(runs.clone(), 12), [(2, 5), (200, 220)]);
+        assert!(skip_blocks(runs, 35).is_empty());
+    }
+}
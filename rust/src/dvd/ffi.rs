@@ -2,7 +2,7 @@
 
 #![allow(non_camel_case_types)]
 
-use std::os::raw::{c_int, c_void};
+use std::os::raw::{c_char, c_int, c_long, c_void};
 
 pub const DVD_VIDEO_LB_LEN: usize = 2048;
 
@@ -21,6 +21,53 @@ pub struct ifo_handle_t {
     _private: [u8; 0],
 }
 
+/// Disc metadata model built by dvd_helper.c (opaque).
+#[repr(C)]
+pub struct dvd_disc_t {
+    _private: [u8; 0],
+}
+
+/// Chapter entry of the disc model (mirrors dvd_chapter_info_t in dvd_helper.c).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct dvd_chapter_info_t {
+    pub pgcn: u16,
+    pub pgn: u16,
+    pub start_ms: u32,
+    pub duration_ms: u32,
+    pub start_sector: u32,
+    pub last_sector: u32,
+    /// Index of the chapter's first cell in dvd_disc_title_cells.
+    pub first_cell: u32,
+    pub nr_of_cells: u32,
+}
+
+/// Cell sector range, inclusive (mirrors dvd_cell_range_t in dvd_helper.c).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct dvd_cell_range_t {
+    pub first_sector: u32,
+    pub last_sector: u32,
+}
+
+/// NAV pack summary (mirrors dvd_nav_info_t in dvd_helper.c).
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct dvd_nav_info_t {
+    pub lbn: u32,
+    pub vobu_ea: u32,
+    pub next_vobu: u32,
+    /// First VOBU at least vobu_index::FWDA_MS[i] later, relative to this one.
+    pub fwda: [u32; 19],
+    pub start_ptm: u32,
+    pub end_ptm: u32,
+    pub vob_id: u16,
+    pub cell_id: u8,
+}
+
+/// DSI search offset of a VOBU outside the cell.
+pub const SRI_END_OF_CELL: u32 = 0x3fff_ffff;
+
 #[repr(C)]
 pub struct dvd_reader_stream_cb {
     pub pf_seek: Option<extern "C" fn(*mut c_void, u64) -> c_int>,
@@ -75,10 +122,12 @@ extern "C" {
         data: *mut u8,
     ) -> isize;
 
-    pub fn DVDFileSeek(dvd_file: *mut dvd_file_t, seek_offset: i32) -> i32;
-
     pub fn DVDFileSize(dvd_file: *mut dvd_file_t) -> isize;
 
+    /// Looks up a file in the UDF filesystem. Returns its first logical block
+    /// (0 if not found) and stores its size in bytes.
+    pub fn UDFFindFile(dvd: *mut dvd_reader_t, filename: *const c_char, size: *mut u32) -> u32;
+
     pub fn ifoOpen(dvd: *mut dvd_reader_t, title: c_int) -> *mut ifo_handle_t;
 
     pub fn ifoClose(ifo: *mut ifo_handle_t);
@@ -90,14 +139,51 @@ extern "C" {
 
 // C helper from dvd_helper.c
 extern "C" {
-    /// Fills buf with JSON array of titles. Returns 0 on success, -1 on error.
-    pub fn dvd_list_titles_json(dvd: *mut dvd_reader_t, buf: *mut u8, buf_size: usize) -> c_int;
+    /// Parses VMGI; title sets are loaded on demand. Returns null if VMGI cannot be read.
+    pub fn dvd_describe_disc(dvd: *mut dvd_reader_t) -> *mut dvd_disc_t;
 
-    /// Fills buf with JSON array of chapters for title_id (1-based). Returns 0 on success, -1 on error.
-    pub fn dvd_list_chapters_json(
-        dvd: *mut dvd_reader_t,
+    /// Parses title set vtsn into the model unless already done. 0, or -1 if out of memory.
+    pub fn dvd_disc_load_title_set(disc: *mut dvd_disc_t, dvd: *mut dvd_reader_t, vtsn: c_int) -> c_int;
+
+    /// 1 if title set vtsn has been loaded, else 0.
+    pub fn dvd_disc_title_set_loaded(disc: *const dvd_disc_t, vtsn: c_int) -> c_int;
+
+    pub fn dvd_disc_title_count(disc: *const dvd_disc_t) -> c_int;
+
+    /// Frees a model returned by dvd_describe_disc.
+    pub fn dvd_disc_free(disc: *mut dvd_disc_t);
+
+    /// Title set (VTS) number of the 1-based title, or -1.
+    pub fn dvd_disc_title_set(disc: *const dvd_disc_t, title_id: c_int) -> c_int;
+
+    /// Chapter count of the title (or -1); points chapters at the model's entries.
+    pub fn dvd_disc_title_chapters(
+        disc: *const dvd_disc_t,
         title_id: c_int,
-        buf: *mut u8,
-        buf_size: usize,
+        chapters: *mut *const dvd_chapter_info_t,
     ) -> c_int;
+
+    /// Cell count of the title (or -1); points cells at them, in PGC order.
+    pub fn dvd_disc_title_cells(
+        disc: *const dvd_disc_t,
+        title_id: c_int,
+        cells: *mut *const dvd_cell_range_t,
+    ) -> c_int;
+
+    /// VTS_TMAPT entry count of the title (or -1); sets seconds per entry and points sectors at them.
+    pub fn dvd_disc_title_tmap(
+        disc: *const dvd_disc_t,
+        title_id: c_int,
+        unit_s: *mut u32,
+        sectors: *mut *const u32,
+    ) -> c_int;
+
+    /// Returns the byte size of the packed metadata export.
+    pub fn dvd_disc_export_size(disc: *const dvd_disc_t) -> usize;
+
+    /// Writes packed metadata into buf. Returns bytes written, -1 if buf is too small.
+    pub fn dvd_disc_export(disc: *const dvd_disc_t, buf: *mut u8, buf_size: usize) -> c_long;
+
+    /// Decodes the NAV pack in a 2048-byte block. 0, or -1 if the block is not one.
+    pub fn dvd_nav_parse(block: *const u8, info: *mut dvd_nav_info_t) -> c_int;
 }
@@ -0,0 +1,60 @@
+//! Batched metadata reads for a fast open.
+//! libdvdread parses UDF and the IFOs with many small scattered stream reads;
+//! on an optical drive each miss is a separate READ(10) and often a seek. The
+//! regions are loaded into the block cache up front in a few large sequential
+//! commands, so libdvdread's reads are hits.
+
+use crate::dvd::block_read::StreamContext;
+use crate::dvd::ffi;
+use std::ffi::CString;
+
+const DVD_BLOCK: u32 = ffi::DVD_VIDEO_LB_LEN as u32;
+/// Start of the disc (1 MiB): volume recognition sequence (block 16), UDF
+/// anchor (256), volume descriptor sequences, file set descriptor, root and
+/// VIDEO_TS directories, and usually VIDEO_TS.IFO.
+const HEAD_BLOCKS: u32 = 512;
+/// IFO extents closer than this are read as one command; reading the gap
+/// costs less than another seek.
+const MERGE_GAP_BLOCKS: u32 = 64;
+
+/// Loads the filesystem head before the reader is opened. Errors are left
+/// for libdvdread's own reads to report.
+pub fn prefetch_head(ctx: &StreamContext) {
+    let _ = ctx.prefetch_dvd_blocks(0, HEAD_BLOCKS);
+}
+
+/// Loads the IFO files of the given title sets (0 = VMG). Missing files are
+/// skipped; BUPs are only read by libdvdread when an IFO is damaged.
+pub fn prefetch_ifos(ctx: &StreamContext, dvd_reader: *mut ffi::dvd_reader_t, title_sets: &[i32]) {
+    let mut extents: Vec<(u32, u32)> = title_sets
+        .iter()
+        .filter_map(|&vtsn| ifo_extent(dvd_reader, vtsn))
+        .collect();
+    extents.sort_unstable();
+    let mut merged: Vec<(u32, u32)> = Vec::with_capacity(extents.len());
+    for (start, end) in extents {
+        match merged.last_mut() {
+            Some(last) if start <= last.1.saturating_add(MERGE_GAP_BLOCKS) => last.1 = last.1.max(end),
+            _ => merged.push((start, end)),
+        }
+    }
+    for (start, end) in merged {
+        let _ = ctx.prefetch_dvd_blocks(start as u64, end - start);
+    }
+}
+
+/// Block range [start, end) of a title set's IFO.
+fn ifo_extent(dvd_reader: *mut ffi::dvd_reader_t, vtsn: i32) -> Option<(u32, u32)> {
+    let name = if vtsn == 0 {
+        "/VIDEO_TS/VIDEO_TS.IFO".to_string()
+    } else {
+        format!("/VIDEO_TS/VTS_{:02}_0.IFO", vtsn)
+    };
+    let name = CString::new(name).ok()?;
+    let mut size = 0u32;
+    let start = unsafe { ffi::UDFFindFile(dvd_reader, name.as_ptr(), &mut size) };
+    if start == 0 || size == 0 {
+        return None;
+    }
+    Some((start, start + size.div_ceil(DVD_BLOCK)))
+}
@@ -1,128 +1,240 @@
 //! DVD playback via libdvdread with stream callbacks from ScsiBlockDevice.
 
 pub mod block_read;
+pub mod css_cache;
+pub mod extract;
 pub mod ffi;
+pub mod metadata_prefetch;
+pub mod prefetch;
+pub mod pump;
 pub mod stream;
+pub mod title_index;
+pub mod vobu_index;
 
-use block_read::{make_stream_cb, StreamContext};
+use block_read::StreamContext;
+use crate::block_cache::BlockCache;
 use crate::block_device::ScsiBlockDevice;
-use std::collections::HashMap;
-use std::sync::Mutex;
+use crate::registry::Registry;
+use std::sync::{Arc, Mutex};
+use title_index::TitleIndex;
 
-static DVD_HANDLES: std::sync::LazyLock<Mutex<HashMap<u64, DvdHandle>>> =
-    std::sync::LazyLock::new(|| Mutex::new(HashMap::new()));
-static DVD_HANDLE_ID: std::sync::LazyLock<Mutex<u64>> =
-    std::sync::LazyLock::new(|| Mutex::new(1));
+static DVD_HANDLES: std::sync::LazyLock<Registry<DvdHandle>> =
+    std::sync::LazyLock::new(Registry::new);
 
 struct DvdHandle {
     dvd_reader: *mut ffi::dvd_reader_t,
+    /// Title/chapter model: VMGI parsed at open, title sets on first use.
+    disc: *mut ffi::dvd_disc_t,
     stream_ctx: Box<StreamContext>,
+    /// Serializes libdvdread calls on this disc (prefetch threads, file open/close).
+    reader_lock: Arc<Mutex<()>>,
+    /// Shared by the disc's title streams.
+    readahead: Arc<prefetch::ReadaheadStats>,
+    /// Title streams open on the disc; close_dvd closes what is left.
+    streams: Vec<u64>,
 }
 
 unsafe impl Send for DvdHandle {}
 
+/// Opens a DVD on the device. Title keys are cached per disc under the root
+/// given to css_cache::set_cache_root. Returns once VMGI is parsed; each
+/// title set's IFO is read when one of its titles is first queried.
 pub fn open_dvd(
     session_id: u64,
     transfer: Box<dyn crate::block_device::TransferHandler>,
 ) -> Result<u64, String> {
     let block_device = ScsiBlockDevice::new(transfer, session_id)
         .map_err(|e| e.to_string())?;
-    let stream_ctx = Box::new(StreamContext {
+    let cache = Arc::new(BlockCache::new(
         block_device,
-        position: 0,
-    });
-    let stream_cb = make_stream_cb();
-    let dvd_reader = unsafe {
-        ffi::DVDOpenStream2(
-            stream_ctx.as_ref() as *const StreamContext as *mut std::ffi::c_void,
-            std::ptr::null(),
-            &stream_cb,
-        )
-    };
-    if dvd_reader.is_null() {
-        return Err("DVDOpenStream2 failed".to_string());
+        crate::block_cache::DEFAULT_BUDGET_BYTES,
+    ));
+    let stream_ctx = Box::new(StreamContext::new(cache));
+    metadata_prefetch::prefetch_head(&stream_ctx);
+    let dvd_reader = css_cache::open_reader(&stream_ctx)?;
+    metadata_prefetch::prefetch_ifos(&stream_ctx, dvd_reader, &[0]);
+    let disc = unsafe { ffi::dvd_describe_disc(dvd_reader) };
+    if disc.is_null() {
+        unsafe { ffi::DVDClose(dvd_reader) };
+        return Err("dvd_describe_disc failed".to_string());
     }
-    let id = {
-        let mut guard = DVD_HANDLE_ID.lock().unwrap();
-        let id = *guard;
-        *guard += 1;
-        id
-    };
-    DVD_HANDLES.lock().unwrap().insert(
-        id,
-        DvdHandle {
-            dvd_reader,
-            stream_ctx,
-        },
-    );
-    Ok(id)
+    Ok(DVD_HANDLES.insert(DvdHandle {
+        dvd_reader,
+        disc,
+        stream_ctx,
+        reader_lock: Arc::new(Mutex::new(())),
+        readahead: Arc::default(),
+        streams: Vec::new(),
+    }))
 }
 
+/// Closes the disc and any title streams still open on it. A pump on such a
+/// stream sees it gone and ends.
 pub fn close_dvd(dvd_handle: u64) -> bool {
-    let mut handles = DVD_HANDLES.lock().unwrap();
-    if let Some(handle) = handles.remove(&dvd_handle) {
-        unsafe {
-            ffi::DVDClose(handle.dvd_reader);
-        }
-        true
-    } else {
-        false
+    let Some(handle) = DVD_HANDLES.remove(dvd_handle) else {
+        return false;
+    };
+    for &stream_id in &handle.streams {
+        stream::close_stream(stream_id);
+    }
+    let _guard = handle.reader_lock.lock().unwrap();
+    unsafe {
+        ffi::dvd_disc_free(handle.disc);
+        ffi::DVDClose(handle.dvd_reader);
     }
+    true
+}
+
+/// Device, block cache and read-ahead counters of an open disc as JSON.
+pub fn io_stats_json(dvd_handle: u64) -> Option<String> {
+    DVD_HANDLES.with(dvd_handle, |h| {
+        let mut json = crate::cache_io_stats_json(&h.stream_ctx.block_device);
+        json.pop();
+        json.push_str(",\"readahead\":{");
+        h.readahead.write_json(&mut json);
+        json.push_str("}}");
+        json
+    })
+}
+
+/// Applies a read recovery policy to the disc's device. Zero-filled sectors
+/// reach libdvdread as scrambled-looking data, which the decoder skips.
+pub fn set_recovery_policy(dvd_handle: u64, policy: crate::recovery::RecoveryPolicy) -> bool {
+    DVD_HANDLES
+        .with(dvd_handle, |h| h.stream_ctx.block_device.recovery().set_policy(policy))
+        .is_some()
+}
+
+pub fn bad_sectors_json(dvd_handle: u64) -> Option<String> {
+    DVD_HANDLES.with(dvd_handle, |h| h.stream_ctx.block_device.recovery().bad_sectors_json())
 }
 
 pub fn get_dvd_reader(dvd_handle: u64) -> Option<*mut ffi::dvd_reader_t> {
-    DVD_HANDLES.lock().unwrap().get(&dvd_handle).map(|h| h.dvd_reader)
+    DVD_HANDLES.with(dvd_handle, |h| h.dvd_reader)
 }
 
-pub fn list_titles_json(dvd_handle: u64) -> Result<String, String> {
-    let handles = DVD_HANDLES.lock().unwrap();
-    let handle = handles.get(&dvd_handle).ok_or("DVD handle not found")?;
-    let mut buf = vec![0u8; 8192];
-    let rc = unsafe {
-        ffi::dvd_list_titles_json(handle.dvd_reader, buf.as_mut_ptr(), buf.len())
-    };
-    if rc != 0 {
-        return Err("dvd_list_titles_json failed".to_string());
+/// Parses the given title sets into the disc model, reading their IFOs in one
+/// batch. Sets already loaded are skipped.
+fn load_title_sets(handle: &DvdHandle, title_sets: &[i32]) -> Result<(), String> {
+    let mut pending: Vec<i32> = title_sets
+        .iter()
+        .copied()
+        .filter(|&vtsn| unsafe { ffi::dvd_disc_title_set_loaded(handle.disc, vtsn) } == 0)
+        .collect();
+    if pending.is_empty() {
+        return Ok(());
+    }
+    pending.sort_unstable();
+    pending.dedup();
+    let _guard = handle.reader_lock.lock().unwrap();
+    metadata_prefetch::prefetch_ifos(&handle.stream_ctx, handle.dvd_reader, &pending);
+    for vtsn in pending {
+        if unsafe { ffi::dvd_disc_load_title_set(handle.disc, handle.dvd_reader, vtsn) } < 0 {
+            return Err(format!("Out of memory loading title set {}", vtsn));
+        }
     }
-    let len = buf.iter().position(|&b| b == 0).unwrap_or(buf.len());
-    Ok(String::from_utf8_lossy(&buf[..len]).to_string())
+    Ok(())
 }
 
-pub fn list_chapters_json(dvd_handle: u64, title_id: i32) -> Result<String, String> {
-    let handles = DVD_HANDLES.lock().unwrap();
-    let handle = handles.get(&dvd_handle).ok_or("DVD handle not found")?;
-    let mut buf = vec![0u8; 4096];
-    let rc = unsafe {
-        ffi::dvd_list_chapters_json(handle.dvd_reader, title_id, buf.as_mut_ptr(), buf.len())
-    };
-    if rc != 0 {
-        return Err("dvd_list_chapters_json failed".to_string());
+/// Loads every title set referenced by a title (the full metadata export needs them all).
+fn load_all_title_sets(handle: &DvdHandle) -> Result<(), String> {
+    let count = unsafe { ffi::dvd_disc_title_count(handle.disc) };
+    let sets: Vec<i32> = (1..=count)
+        .map(|title| unsafe { ffi::dvd_disc_title_set(handle.disc, title) })
+        .filter(|&vtsn| vtsn > 0)
+        .collect();
+    load_title_sets(handle, &sets)
+}
+
+/// Size in bytes of the packed title/chapter metadata for this disc.
+pub fn metadata_size(dvd_handle: u64) -> Result<usize, String> {
+    DVD_HANDLES
+        .with(dvd_handle, |handle| {
+            load_all_title_sets(handle)?;
+            Ok(unsafe { ffi::dvd_disc_export_size(handle.disc) })
+        })
+        .ok_or("DVD handle not found")?
+}
+
+/// Writes the packed title/chapter metadata into buf (see dvd_helper.c for the layout).
+/// buf must hold at least metadata_size bytes. Returns bytes written.
+pub fn export_metadata(dvd_handle: u64, buf: &mut [u8]) -> Result<usize, String> {
+    let n = DVD_HANDLES
+        .with(dvd_handle, |handle| {
+            load_all_title_sets(handle)?;
+            Ok::<_, String>(unsafe { ffi::dvd_disc_export(handle.disc, buf.as_mut_ptr(), buf.len()) })
+        })
+        .ok_or("DVD handle not found")??;
+    if n < 0 {
+        return Err("Metadata buffer too small".to_string());
     }
-    let len = buf.iter().position(|&b| b == 0).unwrap_or(buf.len());
-    Ok(String::from_utf8_lossy(&buf[..len]).to_string())
+    Ok(n as usize)
 }
 
+/// Opens the title's VTS title VOBs and positions the stream at the title's first chapter.
 pub fn open_title_stream(dvd_handle: u64, title_id: i32) -> Result<u64, String> {
-    let handles = DVD_HANDLES.lock().unwrap();
-    let handle = handles.get(&dvd_handle).ok_or("DVD handle not found")?;
+    DVD_HANDLES
+        .with(dvd_handle, |handle| {
+            let stream = open_title(handle, dvd_handle, title_id)?;
+            let stream_id = stream::register_stream(stream);
+            handle.streams.push(stream_id);
+            Ok(stream_id)
+        })
+        .ok_or("DVD handle not found")?
+}
+
+fn open_title(handle: &DvdHandle, dvd_handle: u64, title_id: i32) -> Result<stream::DvdStream, String> {
+    let (dvd_file, index, _) = open_title_file(handle, title_id)?;
+    let readahead = Arc::clone(&handle.readahead);
+    let reader_lock = Arc::clone(&handle.reader_lock);
+    stream::DvdStream::new(dvd_file, dvd_handle, index, reader_lock, readahead).map_err(|e| {
+        let _guard = handle.reader_lock.lock().unwrap();
+        unsafe { ffi::DVDCloseFile(dvd_file) };
+        e.to_string()
+    })
+}
+
+/// Opens the title VOBs of the title's set. Returns the file, the title's
+/// index and the title set number; the caller closes the file.
+fn open_title_file(
+    handle: &DvdHandle,
+    title_id: i32,
+) -> Result<(*mut ffi::dvd_file_t, TitleIndex, i32), String> {
+    let title_set = unsafe { ffi::dvd_disc_title_set(handle.disc, title_id) };
+    if title_set < 1 {
+        return Err(format!("Title {} not found", title_id));
+    }
+    load_title_sets(handle, &[title_set])?;
+    let index = TitleIndex::from_disc(handle.disc, title_id)
+        .ok_or_else(|| format!("Title {} not found", title_id))?;
+    let _guard = handle.reader_lock.lock().unwrap();
     let dvd_file = unsafe {
         ffi::DVDOpenFile(
             handle.dvd_reader,
-            title_id,
+            title_set,
             ffi::dvd_read_domain_t::DVD_READ_TITLE_VOBS,
         )
     };
     if dvd_file.is_null() {
         return Err("DVDOpenFile failed".to_string());
     }
-    let stream = stream::DvdStream {
-        dvd_file,
-        position: 0,
-        buffer: Vec::new(),
-        buffer_offset: 0,
-        buffer_len: 0,
-    };
-    Ok(stream::register_stream(stream))
+    Ok((dvd_file, index, title_set))
+}
+
+/// Starts extracting chapters `first_chapter..=last_chapter` (0 = last) of a
+/// title into `fd` (owned from here on), continuing after `resume_bytes` of
+/// earlier output. Returns a job ID for the copy job calls; release the job
+/// before close_dvd.
+pub fn extract_title(
+    dvd_handle: u64,
+    title_id: i32,
+    first_chapter: u32,
+    last_chapter: u32,
+    resume_bytes: u64,
+    fd: i32,
+) -> Result<u64, String> {
+    extract::start(dvd_handle, title_id, first_chapter, last_chapter, resume_bytes, fd)
+        .map_err(|e| e.to_string())
 }
 
 pub fn read_stream(stream_id: u64, buf: &mut [u8]) -> Result<usize, String> {
@@ -133,13 +245,39 @@ pub fn seek_stream(stream_id: u64, offset: u64) -> Result<(), String> {
     stream::seek_stream(stream_id, offset).map_err(|e| e.to_string())
 }
 
+/// Jumps to the first sector of a 1-based chapter of the stream's title.
+pub fn seek_chapter(stream_id: u64, chapter: u32) -> Result<(), String> {
+    stream::seek_chapter(stream_id, chapter).map_err(|e| e.to_string())
+}
+
+/// Jumps to the start of the VOBU playing at a time (see vobu_index).
+pub fn seek_time(stream_id: u64, time_ms: u64) -> Result<(), String> {
+    stream::seek_time(stream_id, time_ms).map_err(|e| e.to_string())
+}
+
 pub fn close_stream(stream_id: u64) -> bool {
-    if let Some(dvd_file) = stream::close_stream(stream_id) {
-        if !dvd_file.is_null() {
-            unsafe { ffi::DVDCloseFile(dvd_file) };
-        }
-        true
-    } else {
-        false
-    }
+    let Some(dvd_handle) = stream::close_stream(stream_id) else {
+        return false;
+    };
+    DVD_HANDLES.with(dvd_handle, |h| h.streams.retain(|&id| id != stream_id));
+    true
+}
+
+/// Starts a native pump of the stream into `fd` (a pipe write end, owned from
+/// here on). Returns the pump ID.
+pub fn start_pump(stream_id: u64, fd: i32) -> Result<u64, String> {
+    pump::start(stream_id, fd).map_err(|e| e.to_string())
+}
+
+pub fn pump_seek_time(pump_id: u64, time_ms: u64) -> Result<(), String> {
+    pump::seek_time(pump_id, time_ms).map_err(|e| e.to_string())
+}
+
+pub fn pump_seek_chapter(pump_id: u64, chapter: u32) -> Result<(), String> {
+    pump::seek_chapter(pump_id, chapter).map_err(|e| e.to_string())
+}
+
+/// Stops the pump; call before close_stream.
+pub fn stop_pump(pump_id: u64) -> Result<(), String> {
+    crate::pump::stop(pump_id).map_err(|e| e.to_string())
 }
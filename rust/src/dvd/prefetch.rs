@@ -0,0 +1,480 @@
+//! Background read-ahead for a title stream.
+//! A producer thread keeps a ring of buffers filled with DVDReadBlocks ahead
+//! of the consumer; read_stream only copies out of ready buffers. Buffers are
+//! recycled, and a seek bumps the generation so in-flight reads are dropped.
+//!
+//! The read size adapts: it doubles on sustained sequential reads and drops to
+//! the minimum after a seek. Ring memory is capped per stream. When the ring is
+//! full the producer pre-warms the first blocks of the next and the current
+//! chapter, so chapter skips start from memory.
+
+use crate::dvd::ffi;
+use std::collections::VecDeque;
+use std::fmt::Write;
+use std::io;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+use std::time::Instant;
+
+const DVD_BLOCK: usize = ffi::DVD_VIDEO_LB_LEN;
+/// Read size bounds, in blocks (32 KB .. 512 KB).
+const MIN_WINDOW_BLOCKS: usize = 16;
+const INITIAL_WINDOW_BLOCKS: usize = 64;
+const MAX_WINDOW_BLOCKS: usize = 256;
+/// Sequential chunks consumed before the window doubles.
+const GROW_AFTER_CHUNKS: u32 = 2;
+/// Cap on ring buffer memory per stream.
+const RING_BUDGET_BYTES: usize = 1024 * 1024;
+/// Blocks pre-warmed at each chapter start (64 KB).
+const WARM_BLOCKS: usize = 32;
+/// Warm slots: next chapter, current chapter.
+const WARM_SLOTS: usize = 2;
+
+/// Read-ahead counters of the streams of one disc, reported by dvdGetIoStats.
+/// Stall time is how long read_stream waited on an empty ring: near zero
+/// means playback is fed from memory, growing stalls mean the producer (the
+/// drive or the bus) can't keep up.
+#[derive(Default)]
+pub struct ReadaheadStats {
+    chunks: AtomicU64,
+    stalls: AtomicU64,
+    stall_ns: AtomicU64,
+    seeks: AtomicU64,
+    /// Seeks served from a pre-warmed chapter start.
+    warm_hits: AtomicU64,
+}
+
+impl ReadaheadStats {
+    /// Appends the counters as JSON object members (no braces).
+    pub fn write_json(&self, out: &mut String) {
+        let _ = write!(
+            out,
+            "\"chunks\":{},\"stalls\":{},\"stallUs\":{},\"seeks\":{},\"warmHits\":{}",
+            self.chunks.load(Ordering::Relaxed),
+            self.stalls.load(Ordering::Relaxed),
+            self.stall_ns.load(Ordering::Relaxed) / 1000,
+            self.seeks.load(Ordering::Relaxed),
+            self.warm_hits.load(Ordering::Relaxed),
+        );
+    }
+}
+
+struct Chunk {
+    block: u32,
+    data: Vec<u8>,
+    len: usize,
+}
+
+struct Warm {
+    block: u32,
+    data: Vec<u8>,
+    len: usize,
+}
+
+struct RingState {
+    ready: VecDeque<Chunk>,
+    free: Vec<Vec<u8>>,
+    /// Bytes held by ring buffers (free, ready, in flight and being consumed).
+    allocated: usize,
+    /// Next block the producer will read.
+    next_block: u32,
+    /// Block the consumer is reading from; drives the warm targets.
+    play_block: u32,
+    /// Current read size in blocks.
+    window: usize,
+    sequential_chunks: u32,
+    generation: u64,
+    warm: [Option<Warm>; WARM_SLOTS],
+    eof: bool,
+    error: Option<String>,
+    stop: bool,
+}
+
+struct Shared {
+    state: Mutex<RingState>,
+    /// Signalled when a chunk becomes ready, or on eof/error.
+    ready_cv: Condvar,
+    /// Signalled when a buffer is freed, on seek and on stop.
+    free_cv: Condvar,
+    /// Chapter start sectors, ascending.
+    chapter_starts: Vec<u32>,
+}
+
+struct FilePtr(*mut ffi::dvd_file_t);
+// SAFETY: the file is only read by the producer, under the disc's reader lock,
+// and is closed only after the producer has been joined.
+unsafe impl Send for FilePtr {}
+
+pub struct Prefetcher {
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+    /// Chunk being consumed and the read offset into it.
+    current: Option<Chunk>,
+    current_off: usize,
+    /// Bytes to drop from the next chunk (byte seek inside a block).
+    skip: usize,
+    stats: Arc<ReadaheadStats>,
+}
+
+impl Prefetcher {
+    /// Starts the producer at `start_block`. `reader_lock` serializes libdvdread
+    /// access with other streams and metadata reads on the same disc.
+    pub fn start(
+        dvd_file: *mut ffi::dvd_file_t,
+        start_block: u32,
+        chapter_starts: Vec<u32>,
+        reader_lock: Arc<Mutex<()>>,
+        stats: Arc<ReadaheadStats>,
+    ) -> io::Result<Self> {
+        let shared = Arc::new(Shared {
+            state: Mutex::new(RingState {
+                ready: VecDeque::new(),
+                free: Vec::new(),
+                allocated: 0,
+                next_block: start_block,
+                play_block: start_block,
+                window: INITIAL_WINDOW_BLOCKS,
+                sequential_chunks: 0,
+                generation: 0,
+                warm: Default::default(),
+                eof: false,
+                error: None,
+                stop: false,
+            }),
+            ready_cv: Condvar::new(),
+            free_cv: Condvar::new(),
+            chapter_starts,
+        });
+        let producer = Arc::clone(&shared);
+        let file = FilePtr(dvd_file);
+        let thread = std::thread::Builder::new()
+            .name("dvd-prefetch".to_string())
+            .spawn(move || produce(producer, file, reader_lock))?;
+        Ok(Self {
+            shared,
+            thread: Some(thread),
+            current: None,
+            current_off: 0,
+            skip: 0,
+            stats,
+        })
+    }
+
+    /// Copies ready data into buf, waiting only when the ring is empty.
+    /// Returns 0 at end of title.
+    pub fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let mut copied = 0;
+        while copied < buf.len() {
+            if self.current.as_ref().map_or(true, |c| self.current_off >= c.len) {
+                self.recycle_current();
+                match self.next_chunk(copied == 0)? {
+                    Some(chunk) => {
+                        self.current_off = self.skip.min(chunk.len);
+                        self.skip = 0;
+                        self.current = Some(chunk);
+                    }
+                    None => break,
+                }
+                continue;
+            }
+            let chunk = self.current.as_ref().unwrap();
+            let n = (chunk.len - self.current_off).min(buf.len() - copied);
+            buf[copied..copied + n]
+                .copy_from_slice(&chunk.data[self.current_off..self.current_off + n]);
+            self.current_off += n;
+            copied += n;
+        }
+        Ok(copied)
+    }
+
+    /// Restarts the producer at `block`, skipping `skip` bytes of it.
+    /// Ready and in-flight buffers from before the seek are discarded; a
+    /// pre-warmed chapter start at `block` becomes the first ready chunk.
+    pub fn seek(&mut self, block: u32, skip: usize) {
+        self.recycle_current();
+        let mut state = self.shared.state.lock().unwrap();
+        state.generation += 1;
+        while let Some(chunk) = state.ready.pop_front() {
+            state.free.push(chunk.data);
+        }
+        state.next_block = block;
+        state.play_block = block;
+        state.window = MIN_WINDOW_BLOCKS;
+        state.sequential_chunks = 0;
+        state.eof = false;
+        state.error = None;
+
+        let hit = state
+            .warm
+            .iter()
+            .position(|w| matches!(w, Some(w) if w.block == block && w.len > 0));
+        self.stats.seeks.fetch_add(1, Ordering::Relaxed);
+        if let Some(slot) = hit {
+            self.stats.warm_hits.fetch_add(1, Ordering::Relaxed);
+            let warm = state.warm[slot].take().unwrap();
+            let mut data = match take_ring_buffer(&mut state, warm.len) {
+                Some(d) => d,
+                None => {
+                    state.allocated += warm.len;
+                    vec![0u8; warm.len]
+                }
+            };
+            data[..warm.len].copy_from_slice(&warm.data[..warm.len]);
+            state.ready.push_back(Chunk { block, data, len: warm.len });
+            state.next_block = block + (warm.len / DVD_BLOCK) as u32;
+            state.warm[slot] = Some(warm);
+        }
+        drop(state);
+        self.skip = skip;
+        self.shared.free_cv.notify_all();
+    }
+
+    /// Stops and joins the producer. The file may be closed afterwards.
+    pub fn stop(&mut self) {
+        self.shared.state.lock().unwrap().stop = true;
+        self.shared.free_cv.notify_all();
+        if let Some(t) = self.thread.take() {
+            let _ = t.join();
+        }
+    }
+
+    fn recycle_current(&mut self) {
+        if let Some(chunk) = self.current.take() {
+            let mut state = self.shared.state.lock().unwrap();
+            if state.allocated > RING_BUDGET_BYTES {
+                // Over budget after a warm hit; shrink back.
+                state.allocated -= chunk.data.len();
+            } else {
+                state.free.push(chunk.data);
+            }
+            drop(state);
+            self.shared.free_cv.notify_one();
+        }
+        self.current_off = 0;
+    }
+
+    /// Next chunk of the current generation. With `wait` false, only returns
+    /// what is already ready so a partially filled read isn't held up.
+    fn next_chunk(&mut self, wait: bool) -> io::Result<Option<Chunk>> {
+        let mut state = self.shared.state.lock().unwrap();
+        let mut stalled: Option<Instant> = None;
+        loop {
+            if let Some(chunk) = state.ready.pop_front() {
+                self.end_stall(stalled);
+                self.stats.chunks.fetch_add(1, Ordering::Relaxed);
+                if chunk.block == state.play_block {
+                    // First chunk after open or seek.
+                } else {
+                    state.sequential_chunks += 1;
+                    if state.sequential_chunks >= GROW_AFTER_CHUNKS {
+                        state.window = (state.window * 2).min(MAX_WINDOW_BLOCKS);
+                        state.sequential_chunks = 0;
+                    }
+                }
+                state.play_block = chunk.block;
+                return Ok(Some(chunk));
+            }
+            if let Some(e) = state.error.take() {
+                self.end_stall(stalled);
+                return Err(io::Error::new(io::ErrorKind::Other, e));
+            }
+            if state.eof || !wait {
+                self.end_stall(stalled);
+                return Ok(None);
+            }
+            stalled.get_or_insert_with(Instant::now);
+            state = self.shared.ready_cv.wait(state).unwrap();
+        }
+    }
+
+    fn end_stall(&self, stalled: Option<Instant>) {
+        if let Some(since) = stalled {
+            self.stats.stalls.fetch_add(1, Ordering::Relaxed);
+            self.stats.stall_ns.fetch_add(since.elapsed().as_nanos() as u64, Ordering::Relaxed);
+        }
+    }
+}
+
+impl Drop for Prefetcher {
+    fn drop(&mut self) {
+        self.stop();
+    }
+}
+
+/// A free buffer of at least `need` bytes, allocating within the ring budget.
+fn take_ring_buffer(state: &mut RingState, need: usize) -> Option<Vec<u8>> {
+    if let Some(i) = state.free.iter().position(|b| b.len() >= need) {
+        return Some(state.free.swap_remove(i));
+    }
+    // Every free buffer is smaller (the window grew): drop them all, or the
+    // budget could stay spent on buffers that never fit again.
+    let undersized: usize = state.free.drain(..).map(|b| b.len()).sum();
+    state.allocated -= undersized;
+    if state.allocated + need > RING_BUDGET_BYTES {
+        return None;
+    }
+    state.allocated += need;
+    Some(vec![0u8; need])
+}
+
+/// Warm slot that needs (re)loading and the chapter start it should hold.
+fn warm_target(shared: &Shared, state: &RingState) -> Option<(usize, u32)> {
+    let starts = &shared.chapter_starts;
+    let pos = starts.partition_point(|&s| s <= state.play_block);
+    let targets = [starts.get(pos).copied(), pos.checked_sub(1).map(|i| starts[i])];
+    targets.iter().enumerate().find_map(|(slot, target)| {
+        let target = (*target)?;
+        match &state.warm[slot] {
+            Some(w) if w.block == target => None,
+            _ => Some((slot, target)),
+        }
+    })
+}
+
+enum Job {
+    Ring { data: Vec<u8>, block: u32, blocks: usize, generation: u64 },
+    Warm { data: Vec<u8>, block: u32, slot: usize },
+}
+
+fn produce(shared: Arc<Shared>, file: FilePtr, reader_lock: Arc<Mutex<()>>) {
+    loop {
+        let job = {
+            let mut state = shared.state.lock().unwrap();
+            loop {
+                if state.stop {
+                    return;
+                }
+                if !state.eof && state.error.is_none() {
+                    let blocks = state.window;
+                    if let Some(data) = take_ring_buffer(&mut state, blocks * DVD_BLOCK) {
+                        break Job::Ring {
+                            data,
+                            block: state.next_block,
+                            blocks,
+                            generation: state.generation,
+                        };
+                    }
+                }
+                // Ring is full (or at end of title): use the idle time to warm.
+                if let Some((slot, block)) = warm_target(&shared, &state) {
+                    let data = state.warm[slot]
+                        .take()
+                        .map(|w| w.data)
+                        .unwrap_or_else(|| vec![0u8; WARM_BLOCKS * DVD_BLOCK]);
+                    break Job::Warm { data, block, slot };
+                }
+                state = shared.free_cv.wait(state).unwrap();
+            }
+        };
+
+        match job {
+            Job::Ring { mut data, block, blocks, generation } => {
+                let n = {
+                    let _guard = reader_lock.lock().unwrap();
+                    unsafe { ffi::DVDReadBlocks(file.0, block as i32, blocks, data.as_mut_ptr()) }
+                };
+                let mut state = shared.state.lock().unwrap();
+                if state.generation != generation {
+                    // A seek happened while reading; this data is for the old position.
+                    state.free.push(data);
+                    continue;
+                }
+                if n < 0 {
+                    state.free.push(data);
+                    state.error = Some("DVDReadBlocks failed".to_string());
+                } else if n == 0 {
+                    state.free.push(data);
+                    state.eof = true;
+                } else {
+                    let len = n as usize * DVD_BLOCK;
+                    state.next_block = block + n as u32;
+                    state.ready.push_back(Chunk { block, data, len });
+                }
+                drop(state);
+                shared.ready_cv.notify_all();
+            }
+            Job::Warm { mut data, block, slot } => {
+                let n = {
+                    let _guard = reader_lock.lock().unwrap();
+                    unsafe { ffi::DVDReadBlocks(file.0, block as i32, WARM_BLOCKS, data.as_mut_ptr()) }
+                };
+                let len = if n > 0 { n as usize * DVD_BLOCK } else { 0 };
+                // A failed warm read is kept as an empty slot so it isn't retried in a loop.
+                shared.state.lock().unwrap().warm[slot] = Some(Warm { block, data, len });
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn ring_state() -> RingState {
+        RingState {
+            ready: VecDeque::new(),
+            free: Vec::new(),
+            allocated: 0,
+            next_block: 0,
+            play_block: 0,
+            window: INITIAL_WINDOW_BLOCKS,
+            sequential_chunks: 0,
+            generation: 0,
+            warm: Default::default(),
+            eof: false,
+            error: None,
+            stop: false,
+        }
+    }
+
+    #[test]
+    fn reuses_a_free_buffer_that_fits() {
+        let mut state = ring_state();
+        state.free.push(vec![0u8; 4 * DVD_BLOCK]);
+        state.allocated = 4 * DVD_BLOCK;
+        let buf = take_ring_buffer(&mut state, 2 * DVD_BLOCK).unwrap();
+        assert_eq!(buf.len(), 4 * DVD_BLOCK);
+        assert_eq!(state.allocated, 4 * DVD_BLOCK);
+    }
+
+    #[test]
+    fn stays_within_budget() {
+        let mut state = ring_state();
+        let need = MAX_WINDOW_BLOCKS * DVD_BLOCK;
+        let mut held = Vec::new();
+        while let Some(b) = take_ring_buffer(&mut state, need) {
+            held.push(b);
+        }
+        assert_eq!(held.len(), RING_BUDGET_BYTES / need);
+        assert!(state.allocated <= RING_BUDGET_BYTES);
+    }
+
+    #[test]
+    fn window_growth_with_a_full_ring_frees_small_buffers() {
+        // Eight 128 KiB buffers spend the whole budget; the window then grows
+        // to 256 KiB while they're all back on the free list.
+        let mut state = ring_state();
+        let small = 64 * DVD_BLOCK;
+        for _ in 0..RING_BUDGET_BYTES / small {
+            state.free.push(vec![0u8; small]);
+        }
+        state.allocated = RING_BUDGET_BYTES;
+        let need = 128 * DVD_BLOCK;
+        let buf = take_ring_buffer(&mut state, need).expect("producer starved");
+        assert_eq!(buf.len(), need);
+        assert!(state.free.is_empty());
+        assert_eq!(state.allocated, need);
+    }
+
+    #[test]
+    fn waits_while_small_buffers_are_in_use() {
+        // The consumer holds small buffers: nothing to free yet, so the
+        // producer waits until they come back.
+        let mut state = ring_state();
+        state.allocated = RING_BUDGET_BYTES;
+        assert!(take_ring_buffer(&mut state, 128 * DVD_BLOCK).is_none());
+        state.free.push(vec![0u8; RING_BUDGET_BYTES]);
+        assert!(take_ring_buffer(&mut state, 128 * DVD_BLOCK).is_some());
+    }
+}
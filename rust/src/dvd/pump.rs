@@ -0,0 +1,35 @@
+//! Pumping a title stream into a pipe (see crate::pump).
+
+use crate::dvd::stream;
+use crate::pump::{self, PumpSource};
+use std::io;
+use std::os::fd::RawFd;
+
+/// A title stream as read by the pump; positions are title blocks.
+struct TitleSource(u64);
+
+impl PumpSource for TitleSource {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        stream::read_stream(self.0, buf)
+    }
+
+    fn seek_block(&mut self, block: u32) -> io::Result<()> {
+        stream::seek_block(self.0, block)
+    }
+}
+
+pub fn start(stream_id: u64, fd: RawFd) -> io::Result<u64> {
+    pump::start(stream_id, TitleSource(stream_id), "dvd-pump", fd)
+}
+
+/// Repositions the pumped stream at the sector for a playback time.
+pub fn seek_time(pump_id: u64, time_ms: u64) -> io::Result<()> {
+    let stream_id = pump::stream_of(pump_id)?;
+    pump::seek_block(pump_id, stream::time_sector(stream_id, time_ms)?)
+}
+
+/// Repositions the pumped stream at a 1-based chapter.
+pub fn seek_chapter(pump_id: u64, chapter: u32) -> io::Result<()> {
+    let stream_id = pump::stream_of(pump_id)?;
+    pump::seek_block(pump_id, stream::chapter_sector(stream_id, chapter)?)
+}
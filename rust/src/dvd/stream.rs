@@ -1,120 +1,169 @@
-//! Stream registry and read-ahead buffer for LibVLC Custom I/O.
+//! Stream registry for LibVLC Custom I/O; read-ahead is done by dvd::prefetch.
 
 use crate::dvd::ffi;
-use std::collections::HashMap;
+use crate::dvd::prefetch::{Prefetcher, ReadaheadStats};
+use crate::dvd::title_index::TitleIndex;
+use crate::dvd::vobu_index::{self, VobuIndex};
+use crate::registry::Registry;
 use std::io;
-use std::sync::Mutex;
+use std::sync::{Arc, Mutex};
 
-const READ_AHEAD_KB: usize = 256;
 const DVD_BLOCK: usize = ffi::DVD_VIDEO_LB_LEN;
 
-/// Stream handle for a playing title. Holds dvd_file_t and read-ahead buffer.
-/// SAFETY: dvd_file is only accessed from the thread that owns the stream.
+/// Stream handle for a playing title. Holds dvd_file_t and its prefetch ring.
+/// SAFETY: dvd_file is read by the prefetch thread (joined in close) and by
+/// time seeks, both under reader_lock.
 pub struct DvdStream {
     pub dvd_file: *mut ffi::dvd_file_t,
+    /// The disc the title is on.
+    pub dvd_handle: u64,
     pub position: u64,
-    pub buffer: Vec<u8>,
-    pub buffer_offset: usize,
-    pub buffer_len: usize,
+    pub index: TitleIndex,
+    /// VOBU starts learned from NAV packs by time seeks.
+    vobus: VobuIndex,
+    reader_lock: Arc<Mutex<()>>,
+    prefetch: Prefetcher,
 }
 
-static STREAMS: std::sync::LazyLock<Mutex<HashMap<u64, DvdStream>>> =
-    std::sync::LazyLock::new(|| Mutex::new(HashMap::new()));
-static STREAM_ID: std::sync::LazyLock<Mutex<u64>> =
-    std::sync::LazyLock::new(|| Mutex::new(1));
-
-pub fn alloc_stream_id() -> u64 {
-    let mut guard = STREAM_ID.lock().unwrap();
-    let id = *guard;
-    *guard += 1;
-    id
-}
+/// Each stream has its own lock: a read waiting on the prefetch ring only
+/// blocks calls on that stream.
+static STREAMS: std::sync::LazyLock<Registry<DvdStream>> =
+    std::sync::LazyLock::new(Registry::new);
 
 pub fn register_stream(stream: DvdStream) -> u64 {
-    let id = alloc_stream_id();
-    STREAMS.lock().unwrap().insert(id, stream);
-    id
+    STREAMS.insert(stream)
 }
 
 pub fn remove_stream(stream_id: u64) -> Option<DvdStream> {
-    STREAMS.lock().unwrap().remove(&stream_id)
+    STREAMS.remove(stream_id)
 }
 
 impl DvdStream {
-    pub fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
-        let mut copied = 0;
-        while copied < buf.len() {
-            if self.buffer_offset >= self.buffer_len {
-                self.position += self.buffer_len as u64;
-                self.fill_buffer()?;
-                if self.buffer_len == 0 {
-                    break;
-                }
-            }
-            let to_copy = (self.buffer_len - self.buffer_offset).min(buf.len() - copied);
-            buf[copied..copied + to_copy]
-                .copy_from_slice(&self.buffer[self.buffer_offset..self.buffer_offset + to_copy]);
-            self.buffer_offset += to_copy;
-            copied += to_copy;
-        }
-        Ok(copied)
+    /// Starts prefetching at the title's first sector.
+    pub fn new(
+        dvd_file: *mut ffi::dvd_file_t,
+        dvd_handle: u64,
+        index: TitleIndex,
+        reader_lock: Arc<Mutex<()>>,
+        readahead: Arc<ReadaheadStats>,
+    ) -> io::Result<Self> {
+        let first = index.first_sector();
+        let mut chapter_starts: Vec<u32> = index.chapters.iter().map(|c| c.1).collect();
+        chapter_starts.sort_unstable();
+        chapter_starts.dedup();
+        let prefetch =
+            Prefetcher::start(dvd_file, first, chapter_starts, Arc::clone(&reader_lock), readahead)?;
+        Ok(Self {
+            dvd_file,
+            dvd_handle,
+            position: first as u64 * DVD_BLOCK as u64,
+            index,
+            vobus: VobuIndex::new(),
+            reader_lock,
+            prefetch,
+        })
     }
 
-    fn fill_buffer(&mut self) -> io::Result<()> {
-        if self.buffer.is_empty() {
-            self.buffer.resize(READ_AHEAD_KB * 1024, 0);
-        }
-        let block_offset = (self.position / DVD_BLOCK as u64) as i32;
-        let blocks_to_read = (self.buffer.len() / DVD_BLOCK).min(256);
-        let n = unsafe {
-            ffi::DVDReadBlocks(
-                self.dvd_file,
-                block_offset,
-                blocks_to_read,
-                self.buffer.as_mut_ptr(),
-            )
-        };
-        if n < 0 {
-            return Err(io::Error::new(io::ErrorKind::Other, "DVDReadBlocks failed"));
-        }
-        self.buffer_len = (n as usize) * DVD_BLOCK;
-        self.buffer_offset = 0;
-        Ok(())
+    pub fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let n = self.prefetch.read(buf)?;
+        self.position += n as u64;
+        Ok(n)
     }
 
+    /// Byte offset into the title set's title VOBs. DVDReadBlocks takes explicit
+    /// block offsets, so no DVDFileSeek (and no i32 byte offset) is involved.
     pub fn seek(&mut self, offset: u64) -> io::Result<()> {
-        let result = unsafe { ffi::DVDFileSeek(self.dvd_file, offset as i32) };
-        if result < 0 {
-            return Err(io::Error::new(io::ErrorKind::Other, "DVDFileSeek failed"));
+        let block = offset / DVD_BLOCK as u64;
+        if block > u32::MAX as u64 {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Seek beyond title"));
         }
+        self.prefetch
+            .seek(block as u32, (offset % DVD_BLOCK as u64) as usize);
         self.position = offset;
-        self.buffer_offset = 0;
-        self.buffer_len = 0;
         Ok(())
     }
+
+    fn seek_block(&mut self, block: u32) {
+        self.prefetch.seek(block, 0);
+        self.position = block as u64 * DVD_BLOCK as u64;
+    }
+
+    pub fn seek_chapter(&mut self, chapter: u32) -> io::Result<()> {
+        let sector = self.index.chapter_sector(chapter).ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, format!("Chapter {} not found", chapter))
+        })?;
+        self.seek_block(sector);
+        Ok(())
+    }
+
+    pub fn seek_time(&mut self, time_ms: u64) {
+        let sector = self.time_sector(time_ms);
+        self.seek_block(sector);
+    }
+
+    /// Start of the VOBU playing at a time, refined from NAV packs.
+    fn time_sector(&mut self, time_ms: u64) -> u32 {
+        let (file, lock) = (self.dvd_file, &self.reader_lock);
+        self.vobus
+            .locate(&self.index, time_ms, |sector| vobu_index::read_nav(file, lock, sector))
+    }
+}
+
+fn not_found() -> io::Error {
+    io::Error::new(io::ErrorKind::NotFound, "Stream not found")
 }
 
 pub fn read_stream(stream_id: u64, buf: &mut [u8]) -> io::Result<usize> {
-    let mut streams = STREAMS.lock().unwrap();
-    if let Some(stream) = streams.get_mut(&stream_id) {
-        stream.read(buf)
-    } else {
-        Err(io::Error::new(io::ErrorKind::NotFound, "Stream not found"))
-    }
+    STREAMS.with(stream_id, |s| s.read(buf)).unwrap_or_else(|| Err(not_found()))
 }
 
 pub fn seek_stream(stream_id: u64, offset: u64) -> io::Result<()> {
-    let mut streams = STREAMS.lock().unwrap();
-    if let Some(stream) = streams.get_mut(&stream_id) {
-        stream.seek(offset)
-    } else {
-        Err(io::Error::new(io::ErrorKind::NotFound, "Stream not found"))
-    }
+    STREAMS.with(stream_id, |s| s.seek(offset)).unwrap_or_else(|| Err(not_found()))
+}
+
+pub fn seek_chapter(stream_id: u64, chapter: u32) -> io::Result<()> {
+    STREAMS
+        .with(stream_id, |s| s.seek_chapter(chapter))
+        .unwrap_or_else(|| Err(not_found()))
+}
+
+pub fn seek_time(stream_id: u64, time_ms: u64) -> io::Result<()> {
+    STREAMS.with(stream_id, |s| s.seek_time(time_ms)).ok_or_else(not_found)
+}
+
+/// First sector of a 1-based chapter, without moving the stream.
+pub fn chapter_sector(stream_id: u64, chapter: u32) -> io::Result<u32> {
+    STREAMS
+        .with(stream_id, |s| {
+            s.index.chapter_sector(chapter).ok_or_else(|| {
+                io::Error::new(io::ErrorKind::NotFound, format!("Chapter {} not found", chapter))
+            })
+        })
+        .unwrap_or_else(|| Err(not_found()))
+}
+
+/// VOBU start sector for a playback time, without moving the stream.
+pub fn time_sector(stream_id: u64, time_ms: u64) -> io::Result<u32> {
+    STREAMS
+        .with(stream_id, |s| s.time_sector(time_ms))
+        .ok_or_else(not_found)
+}
+
+pub fn seek_block(stream_id: u64, block: u32) -> io::Result<()> {
+    STREAMS.with(stream_id, |s| s.seek_block(block)).ok_or_else(not_found)
 }
 
-pub fn close_stream(stream_id: u64) -> Option<*mut ffi::dvd_file_t> {
-    let mut streams = STREAMS.lock().unwrap();
-    streams.remove(&stream_id).map(|s| s.dvd_file)
+/// Removes the stream, stops its prefetch thread and closes its file.
+/// Returns the stream's disc handle.
+pub fn close_stream(stream_id: u64) -> Option<u64> {
+    remove_stream(stream_id).map(|mut s| {
+        s.prefetch.stop();
+        if !s.dvd_file.is_null() {
+            let _guard = s.reader_lock.lock().unwrap();
+            unsafe { ffi::DVDCloseFile(s.dvd_file) };
+        }
+        s.dvd_handle
+    })
 }
 
 unsafe impl Send for DvdStream {}
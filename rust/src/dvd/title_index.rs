@@ -0,0 +1,155 @@
+//! Per-title chapter and time map index, copied from the disc model at stream open.
+//! Sectors are offsets into the title set's title VOBs (DVDReadBlocks offsets).
+
+use crate::dvd::ffi;
+
+pub struct TitleIndex {
+    /// (start_ms, start_sector) per chapter, in chapter order.
+    pub chapters: Vec<(u32, u32)>,
+    /// Last sector of each chapter (inclusive), in chapter order.
+    pub chapter_ends: Vec<u32>,
+    /// Sector ranges [first, last] of each chapter's cells, in PGC order.
+    pub chapter_cells: Vec<Vec<(u32, u32)>>,
+    /// Seconds per time map entry; 0 if the disc has no VTS_TMAPT for this title.
+    pub tmap_unit_s: u32,
+    /// VOBU start sector at (i + 1) * tmap_unit_s seconds.
+    pub tmap: Vec<u32>,
+}
+
+impl TitleIndex {
+    /// Copies the title's chapter table and time map. Returns None for an unknown title.
+    pub fn from_disc(disc: *const ffi::dvd_disc_t, title_id: i32) -> Option<Self> {
+        let mut chapters_ptr: *const ffi::dvd_chapter_info_t = std::ptr::null();
+        let n = unsafe { ffi::dvd_disc_title_chapters(disc, title_id, &mut chapters_ptr) };
+        if n < 0 {
+            return None;
+        }
+        let infos = if n > 0 && !chapters_ptr.is_null() {
+            unsafe { std::slice::from_raw_parts(chapters_ptr, n as usize) }
+        } else {
+            &[]
+        };
+        let chapters = infos.iter().map(|c| (c.start_ms, c.start_sector)).collect();
+        let chapter_ends = infos.iter().map(|c| c.last_sector).collect();
+
+        let mut cells_ptr: *const ffi::dvd_cell_range_t = std::ptr::null();
+        let n = unsafe { ffi::dvd_disc_title_cells(disc, title_id, &mut cells_ptr) };
+        let cells = if n > 0 && !cells_ptr.is_null() {
+            unsafe { std::slice::from_raw_parts(cells_ptr, n as usize) }
+        } else {
+            &[]
+        };
+        let chapter_cells = infos
+            .iter()
+            .map(|c| {
+                let first = (c.first_cell as usize).min(cells.len());
+                let end = (first + c.nr_of_cells as usize).min(cells.len());
+                cells[first..end].iter().map(|r| (r.first_sector, r.last_sector)).collect()
+            })
+            .collect();
+
+        let mut unit_s = 0u32;
+        let mut tmap_ptr: *const u32 = std::ptr::null();
+        let n = unsafe { ffi::dvd_disc_title_tmap(disc, title_id, &mut unit_s, &mut tmap_ptr) };
+        let tmap = if n > 0 && !tmap_ptr.is_null() {
+            unsafe { std::slice::from_raw_parts(tmap_ptr, n as usize) }.to_vec()
+        } else {
+            Vec::new()
+        };
+        Some(Self {
+            chapters,
+            chapter_ends,
+            chapter_cells,
+            tmap_unit_s: if tmap.is_empty() { 0 } else { unit_s },
+            tmap,
+        })
+    }
+
+    /// First sector of the title (its first chapter), 0 if unknown.
+    pub fn first_sector(&self) -> u32 {
+        self.chapters.first().map(|c| c.1).unwrap_or(0)
+    }
+
+    /// Start sector of a 1-based chapter.
+    pub fn chapter_sector(&self, chapter: u32) -> Option<u32> {
+        let idx = chapter.checked_sub(1)? as usize;
+        self.chapters.get(idx).map(|c| c.1)
+    }
+
+    /// Sector runs [start, end) of 1-based chapters first..=last in playback
+    /// (PGC cell) order, or None if either is out of range. Cells need not be
+    /// laid out in order on disc; runs that follow on are merged.
+    pub fn chapter_runs(&self, first: u32, last: u32) -> Option<Vec<(u32, u32)>> {
+        if first == 0 || last < first || last as usize > self.chapter_cells.len() {
+            return None;
+        }
+        let mut runs: Vec<(u32, u32)> = Vec::new();
+        for &(start, last_sector) in self.chapter_cells[first as usize - 1..last as usize].iter().flatten() {
+            let end = last_sector.max(start) + 1;
+            match runs.last_mut() {
+                Some(run) if run.1 == start => run.1 = end,
+                _ => runs.push((start, end)),
+            }
+        }
+        Some(runs)
+    }
+
+    /// Closest known VOBU start at or before a playback time, as (time_ms,
+    /// sector): the time map entry, else the start of the chapter. Later of
+    /// the two when both exist, since time map entries are evenly spaced.
+    pub fn time_anchor(&self, time_ms: u64) -> (u64, u32) {
+        let pos = self
+            .chapters
+            .partition_point(|c| c.0 as u64 <= time_ms)
+            .saturating_sub(1);
+        let chapter = self
+            .chapters
+            .get(pos)
+            .map(|c| (c.0 as u64, c.1))
+            .unwrap_or((0, 0));
+        if self.tmap_unit_s > 0 {
+            let unit_ms = self.tmap_unit_s as u64 * 1000;
+            let entry = time_ms / unit_ms;
+            if entry == 0 {
+                return (0, self.first_sector());
+            }
+            let idx = ((entry - 1) as usize).min(self.tmap.len() - 1);
+            let mapped = ((idx as u64 + 1) * unit_ms, self.tmap[idx]);
+            return if chapter.0 > mapped.0 { chapter } else { mapped };
+        }
+        chapter
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn index(chapter_cells: Vec<Vec<(u32, u32)>>) -> TitleIndex {
+        TitleIndex {
+            chapters: chapter_cells.iter().map(|c| (0, c.first().map_or(0, |r| r.0))).collect(),
+            chapter_ends: chapter_cells.iter().map(|c| c.iter().map(|r| r.1).max().unwrap_or(0)).collect(),
+            chapter_cells,
+            tmap_unit_s: 0,
+            tmap: Vec::new(),
+        }
+    }
+
+    #[test]
+    fn runs_follow_cell_order() {
+        // Chapter 2 plays a cell stored before chapter 1's, then one after.
+        let t = index(vec![vec![(100, 199), (200, 299)], vec![(0, 49), (300, 399)], vec![(400, 499)]]);
+        assert_eq!(t.chapter_runs(1, 1).unwrap(), [(100, 300)]);
+        assert_eq!(t.chapter_runs(1, 2).unwrap(), [(100, 300), (0, 50), (300, 400)]);
+        assert_eq!(t.chapter_runs(2, 3).unwrap(), [(0, 50), (300, 500)]);
+    }
+
+    #[test]
+    fn rejects_chapters_out_of_range() {
+        let t = index(vec![vec![(0, 9)], vec![(10, 19)]]);
+        assert!(t.chapter_runs(0, 1).is_none());
+        assert!(t.chapter_runs(2, 1).is_none());
+        assert!(t.chapter_runs(1, 3).is_none());
+        assert_eq!(t.chapter_runs(1, 2).unwrap(), [(0, 20)]);
+    }
+}
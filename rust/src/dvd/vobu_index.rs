@@ -0,0 +1,230 @@
+//! Time seeks that land exactly on a VOBU start, from NAV packs.
+//! The time map (if the disc has one) and chapter starts only give VOBU starts
+//! every few seconds or minutes. A seek between them is refined on demand:
+//! starting from the closest known VOBU at or before the target, NAV packs
+//! are read and the DSI search offsets followed (120 s, 60 s, ... 0.5 s ahead,
+//! then VOBU by VOBU) until the VOBU playing at the target is found. Each NAV
+//! read is one block through the block cache, and every VOBU seen is kept,
+//! so scrubbing around one spot is answered from memory.
+//! Times are counted from the anchor with the VOBU presentation times, which
+//! run continuously within a cell; across cells the VOBU durations are summed.
+
+use crate::dvd::ffi;
+use crate::dvd::title_index::TitleIndex;
+use std::sync::Mutex;
+
+const DVD_BLOCK: usize = ffi::DVD_VIDEO_LB_LEN;
+/// Time ahead of each DSI forward search offset (fwda).
+const FWDA_MS: [u64; 19] = [
+    120_000, 60_000, 30_000, 10_000, 7_500, 7_000, 6_500, 6_000, 5_500, 5_000, 4_500, 4_000,
+    3_500, 3_000, 2_500, 2_000, 1_500, 1_000, 500,
+];
+/// NAV reads per seek; from a chapter start the search offsets reach the
+/// target in about a dozen.
+const MAX_NAV_READS: usize = 16;
+/// VOBU starts kept per title (2 hours at 0.5 s per VOBU is ~14k).
+const MAX_SAMPLES: usize = 16 * 1024;
+/// Offset bits of a DSI search entry; the top bits are flags.
+const SRI_OFFSET_MASK: u32 = 0x3fff_ffff;
+
+pub struct VobuIndex {
+    /// (time_ms, sector) of VOBU starts seen so far, sorted by time.
+    samples: Vec<(u64, u32)>,
+}
+
+impl VobuIndex {
+    pub fn new() -> Self {
+        Self { samples: Vec::new() }
+    }
+
+    /// Sector of the VOBU playing at `time_ms`. `read_nav` decodes the NAV
+    /// pack at a title sector; without one the closest known VOBU start
+    /// before the target is returned.
+    pub fn locate(
+        &mut self,
+        title: &TitleIndex,
+        time_ms: u64,
+        mut read_nav: impl FnMut(u32) -> Option<ffi::dvd_nav_info_t>,
+    ) -> u32 {
+        let (mut t, mut sector) = title.time_anchor(time_ms);
+        let pos = self.samples.partition_point(|s| s.0 <= time_ms);
+        if let Some(&(st, ss)) = pos.checked_sub(1).map(|i| &self.samples[i]) {
+            if st > t {
+                (t, sector) = (st, ss);
+            }
+        }
+        let end = title.chapter_ends.iter().max().copied().unwrap_or(u32::MAX);
+        let Some(mut nav) = read_nav(sector).filter(|n| n.lbn == sector) else {
+            return sector;
+        };
+        // Search offsets longer than this overshot the target from here.
+        let mut max_jump = u64::MAX;
+        for _ in 1..MAX_NAV_READS {
+            let remaining = time_ms.saturating_sub(t);
+            let duration = ptm_ms(nav.end_ptm.wrapping_sub(nav.start_ptm));
+            if remaining < duration {
+                break;
+            }
+            let jump = FWDA_MS
+                .iter()
+                .zip(nav.fwda)
+                .find(|&(&ms, off)| ms <= remaining && ms < max_jump && usable(off));
+            let next_sector = match jump {
+                Some((_, off)) => sector + (off & SRI_OFFSET_MASK),
+                None if nav.next_vobu != ffi::SRI_END_OF_CELL && usable(nav.next_vobu) => {
+                    sector + (nav.next_vobu & SRI_OFFSET_MASK)
+                }
+                // Last VOBU of the cell: the next cell follows it.
+                None => sector + nav.vobu_ea + 1,
+            };
+            if next_sector > end {
+                break;
+            }
+            let Some(next) = read_nav(next_sector).filter(|n| n.lbn == next_sector) else {
+                break;
+            };
+            let same_cell = next.vob_id == nav.vob_id && next.cell_id == nav.cell_id;
+            let dt = match jump {
+                _ if same_cell => ptm_ms(next.start_ptm.wrapping_sub(nav.start_ptm)),
+                Some((&ms, _)) => ms,
+                None => duration,
+            };
+            if dt > remaining {
+                match jump {
+                    // "At least x later" went further than needed; try a shorter one.
+                    Some((&ms, _)) => {
+                        max_jump = ms;
+                        continue;
+                    }
+                    None => break,
+                }
+            }
+            t += dt;
+            sector = next_sector;
+            nav = next;
+            max_jump = u64::MAX;
+            self.record(t, sector);
+        }
+        sector
+    }
+
+    fn record(&mut self, time_ms: u64, sector: u32) {
+        let pos = self.samples.partition_point(|s| s.0 < time_ms);
+        if self.samples.get(pos).is_some_and(|s| s.1 == sector) || self.samples.len() >= MAX_SAMPLES {
+            return;
+        }
+        self.samples.insert(pos, (time_ms, sector));
+    }
+}
+
+/// Whether a DSI search offset points at a VOBU.
+fn usable(offset: u32) -> bool {
+    offset != ffi::SRI_END_OF_CELL && offset & SRI_OFFSET_MASK != 0
+}
+
+/// 90 kHz presentation time to milliseconds.
+fn ptm_ms(ticks: u32) -> u64 {
+    ticks as u64 / 90
+}
+
+/// Reads and decodes the NAV pack at a title sector. NAV packs are not
+/// scrambled; reading through libdvdread keeps the block cache and CSS state
+/// shared with playback.
+pub fn read_nav(
+    dvd_file: *mut ffi::dvd_file_t,
+    reader_lock: &Mutex<()>,
+    sector: u32,
+) -> Option<ffi::dvd_nav_info_t> {
+    let mut block = [0u8; DVD_BLOCK];
+    let n = {
+        let _guard = reader_lock.lock().unwrap();
+        unsafe { ffi::DVDReadBlocks(dvd_file, sector as i32, 1, block.as_mut_ptr()) }
+    };
+    if n != 1 {
+        return None;
+    }
+    let mut info = ffi::dvd_nav_info_t::default();
+    (unsafe { ffi::dvd_nav_parse(block.as_ptr(), &mut info) } == 0).then_some(info)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// VOBUs of 0.5 s and 10 sectors in one cell.
+    const VOBUS: u32 = 1000;
+    const VOBU_SECTORS: u32 = 10;
+    const VOBU_TICKS: u32 = 45_000;
+
+    fn title(chapters: Vec<(u32, u32)>) -> TitleIndex {
+        TitleIndex {
+            chapter_ends: vec![VOBUS * VOBU_SECTORS - 1; chapters.len()],
+            chapter_cells: Vec::new(),
+            chapters,
+            tmap_unit_s: 0,
+            tmap: Vec::new(),
+        }
+    }
+
+    fn nav(sector: u32) -> Option<ffi::dvd_nav_info_t> {
+        if sector % VOBU_SECTORS != 0 || sector >= VOBUS * VOBU_SECTORS {
+            return None;
+        }
+        let i = sector / VOBU_SECTORS;
+        let mut fwda = [ffi::SRI_END_OF_CELL; 19];
+        for (f, &ms) in fwda.iter_mut().zip(&FWDA_MS) {
+            let ahead = (ms / 500) as u32;
+            if i + ahead < VOBUS {
+                *f = ahead * VOBU_SECTORS;
+            }
+        }
+        Some(ffi::dvd_nav_info_t {
+            lbn: sector,
+            vobu_ea: VOBU_SECTORS - 1,
+            next_vobu: if i + 1 < VOBUS { VOBU_SECTORS } else { ffi::SRI_END_OF_CELL },
+            fwda,
+            start_ptm: i * VOBU_TICKS,
+            end_ptm: (i + 1) * VOBU_TICKS,
+            vob_id: 1,
+            cell_id: 1,
+        })
+    }
+
+    #[test]
+    fn follows_search_offsets_to_the_vobu_at_the_target() {
+        let t = title(vec![(0, 0)]);
+        let mut index = VobuIndex::new();
+        let mut reads = 0;
+        let sector = index.locate(&t, 123_456, |s| {
+            reads += 1;
+            nav(s)
+        });
+        // VOBU 246 plays 123.0-123.5 s: reached by the 120 s and 3 s offsets.
+        assert_eq!(sector, 246 * VOBU_SECTORS);
+        assert_eq!(reads, 3);
+    }
+
+    #[test]
+    fn later_seeks_start_from_vobus_seen_before() {
+        let t = title(vec![(0, 0)]);
+        let mut index = VobuIndex::new();
+        index.locate(&t, 123_456, nav);
+        let mut reads = 0;
+        let sector = index.locate(&t, 123_700, |s| {
+            reads += 1;
+            nav(s)
+        });
+        assert_eq!(sector, 247 * VOBU_SECTORS);
+        assert_eq!(reads, 2);
+        // Before the first VOBU recorded: from the chapter start again.
+        assert_eq!(index.locate(&t, 1_200, nav), 2 * VOBU_SECTORS);
+    }
+
+    #[test]
+    fn without_nav_packs_returns_the_anchor() {
+        let t = title(vec![(0, 0), (100_000, 200 * VOBU_SECTORS)]);
+        let mut index = VobuIndex::new();
+        assert_eq!(index.locate(&t, 100_250, |_| None), 200 * VOBU_SECTORS);
+        assert_eq!(index.locate(&t, 99_999, |_| None), 0);
+    }
+}
@@ -0,0 +1,130 @@
+//! Per-device SCSI command counters.
+//! Updated lock-free by ScsiBlockDevice on every command and read by
+//! getIoStats while transfers are running. Latency is the whole command as
+//! seen from Rust (CBW to CSW, including the JNI transfer calls), so many
+//! fast small commands point at per-command overhead, few slow small ones at
+//! seeks, and large reads that are slow per byte at the bus.
+
+use std::fmt::Write;
+use std::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use std::time::Duration;
+
+/// Latency histogram: bucket i counts commands under 64 us << i, from the
+/// previous bucket's bound; the last one also holds everything slower.
+pub const LATENCY_BUCKETS: usize = 15;
+const FIRST_BUCKET_US: u64 = 64;
+
+pub struct IoStats {
+    /// Commands issued, by opcode.
+    commands: [AtomicU64; 256],
+    /// Data phase bytes read from the device.
+    bytes_in: AtomicU64,
+    /// Bytes sent to the device (CBWs / command IUs).
+    bytes_out: AtomicU64,
+    /// Commands that returned an error (Check Condition or transport).
+    failed: AtomicU64,
+    check_conditions: AtomicU64,
+    /// Sense key, ASC and ASCQ of the last Check Condition.
+    last_sense: AtomicU32,
+    /// UAS commands resubmitted after BUSY / TASK SET FULL.
+    retries: AtomicU64,
+    latency: [AtomicU64; LATENCY_BUCKETS],
+    busy_ns: AtomicU64,
+}
+
+impl IoStats {
+    pub fn new() -> Self {
+        Self {
+            commands: std::array::from_fn(|_| AtomicU64::new(0)),
+            bytes_in: AtomicU64::new(0),
+            bytes_out: AtomicU64::new(0),
+            failed: AtomicU64::new(0),
+            check_conditions: AtomicU64::new(0),
+            last_sense: AtomicU32::new(0),
+            retries: AtomicU64::new(0),
+            latency: std::array::from_fn(|_| AtomicU64::new(0)),
+            busy_ns: AtomicU64::new(0),
+        }
+    }
+
+    /// Records a finished command. `bytes_in` is None if it failed.
+    pub fn record(&self, opcode: u8, elapsed: Duration, bytes_out: usize, bytes_in: Option<usize>) {
+        self.commands[opcode as usize].fetch_add(1, Ordering::Relaxed);
+        self.bytes_out.fetch_add(bytes_out as u64, Ordering::Relaxed);
+        match bytes_in {
+            Some(n) => self.bytes_in.fetch_add(n as u64, Ordering::Relaxed),
+            None => self.failed.fetch_add(1, Ordering::Relaxed),
+        };
+        let us = elapsed.as_micros() as u64;
+        let bucket = (u64::BITS - (us / FIRST_BUCKET_US).leading_zeros()) as usize;
+        self.latency[bucket.min(LATENCY_BUCKETS - 1)].fetch_add(1, Ordering::Relaxed);
+        self.busy_ns.fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
+    }
+
+    pub fn record_sense(&self, sense_key: u8, asc: u8, ascq: u8) {
+        self.check_conditions.fetch_add(1, Ordering::Relaxed);
+        let packed = (sense_key as u32) << 16 | (asc as u32) << 8 | ascq as u32;
+        self.last_sense.store(packed, Ordering::Relaxed);
+    }
+
+    pub fn record_retry(&self) {
+        self.retries.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Appends the counters as JSON object members (no braces).
+    pub fn write_json(&self, out: &mut String) {
+        out.push_str("\"commands\":{");
+        let mut first = true;
+        for (op, count) in self.commands.iter().enumerate() {
+            let n = count.load(Ordering::Relaxed);
+            if n == 0 {
+                continue;
+            }
+            if !first {
+                out.push(',');
+            }
+            first = false;
+            let _ = write!(out, "\"{}\":{}", opcode_name(op as u8), n);
+        }
+        let sense = self.last_sense.load(Ordering::Relaxed);
+        let _ = write!(
+            out,
+            "}},\"bytesIn\":{},\"bytesOut\":{},\"failed\":{},\"checkConditions\":{},\
+             \"lastSense\":[{},{},{}],\"retries\":{},\"busyUs\":{},\"latencyUs\":{},\"latency\":[",
+            self.bytes_in.load(Ordering::Relaxed),
+            self.bytes_out.load(Ordering::Relaxed),
+            self.failed.load(Ordering::Relaxed),
+            self.check_conditions.load(Ordering::Relaxed),
+            sense >> 16,
+            (sense >> 8) & 0xFF,
+            sense & 0xFF,
+            self.retries.load(Ordering::Relaxed),
+            self.busy_ns.load(Ordering::Relaxed) / 1000,
+            FIRST_BUCKET_US,
+        );
+        for (i, bucket) in self.latency.iter().enumerate() {
+            if i > 0 {
+                out.push(',');
+            }
+            let _ = write!(out, "{}", bucket.load(Ordering::Relaxed));
+        }
+        out.push(']');
+    }
+}
+
+fn opcode_name(op: u8) -> String {
+    use crate::scsi;
+    match op {
+        scsi::TEST_UNIT_READY => "TEST_UNIT_READY".to_string(),
+        scsi::REQUEST_SENSE => "REQUEST_SENSE".to_string(),
+        scsi::INQUIRY => "INQUIRY".to_string(),
+        scsi::READ_CAPACITY_10 => "READ_CAPACITY_10".to_string(),
+        scsi::READ_10 => "READ_10".to_string(),
+        scsi::READ_16 => "READ_16".to_string(),
+        scsi::SERVICE_ACTION_IN_16 => "SERVICE_ACTION_IN_16".to_string(),
+        scsi::READ_TOC => "READ_TOC".to_string(),
+        scsi::SET_CD_SPEED => "SET_CD_SPEED".to_string(),
+        scsi::READ_CD => "READ_CD".to_string(),
+        _ => format!("0x{:02X}", op),
+    }
+}
@@ -1,13 +1,57 @@
 //! JNI bridge for Android: Rust calls back to Kotlin for bulk transfers.
+//! Transfers pass direct ByteBuffers over Rust memory, so data lands in its
+//! final buffer with no Java array in between. Small transfers (CBW/CSW, UAS
+//! IUs) go through one cached control buffer to avoid a wrapper per command.
+//! A BOT command is one upcall: executeCommand runs CBW, data, CSW and REQUEST
+//! SENSE in Kotlin. Method IDs are resolved once per handler.
 
-use jni::objects::{GlobalRef, JByteArray, JObject, JValue};
+use jni::objects::{GlobalRef, JMethodID, JObject, JValue};
+use jni::signature::{Primitive, ReturnType};
+use jni::sys::jvalue;
 use jni::JNIEnv;
+use crate::block_device::{BotCompletion, UasPipe};
+use crate::scsi;
 use std::io;
+use std::sync::Mutex;
+
+/// Transfers up to this size use the cached control buffer.
+const CONTROL_BUF_SIZE: usize = 64;
+
+// executeCommand area of the control buffer, after the small-transfer area.
+// Must match BulkTransferHandler.BOT_* in Kotlin.
+const BOT_CBW: usize = 64;
+const BOT_CSW: usize = 96;
+const BOT_SENSE_CBW: usize = 112;
+const BOT_SENSE: usize = 144;
+// The REQUEST SENSE CSW lands at 176; only its presence matters here.
+const CONTROL_LEN: usize = 192;
+
+const SIG_DIRECT: &str = "(Ljava/nio/ByteBuffer;I)I";
+const SIG_PIPE_DIRECT: &str = "(ILjava/nio/ByteBuffer;I)I";
+const SIG_EXECUTE: &str = "(Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;IZ)I";
+
+/// BulkTransferHandler methods called per transfer.
+#[derive(Clone, Copy)]
+struct Methods {
+    bulk_out: JMethodID,
+    bulk_in: JMethodID,
+    pipe_out: JMethodID,
+    pipe_in: JMethodID,
+    execute: JMethodID,
+}
 
 /// Transfer handler that calls Kotlin BulkTransferHandler via JNI.
 pub struct JniTransferHandler {
     vm: jni::JavaVM,
     handler: GlobalRef,
+    /// BulkTransferHandler.maxTransferSize(), queried once.
+    max_transfer: usize,
+    /// BulkTransferHandler.isUas(), queried once.
+    uas: bool,
+    /// Backing memory of `control_ref`; locked for the duration of a transfer.
+    control: Mutex<Box<[u8]>>,
+    control_ref: GlobalRef,
+    methods: Methods,
 }
 
 impl JniTransferHandler {
@@ -18,7 +62,55 @@ impl JniTransferHandler {
         let handler = env.new_global_ref(handler).map_err(|e| {
             io::Error::new(io::ErrorKind::Other, format!("new_global_ref failed: {:?}", e))
         })?;
-        Ok(Self { vm, handler })
+        let max_transfer = env
+            .call_method(&handler, "maxTransferSize", "()I", &[])
+            .and_then(|v| v.i())
+            .ok()
+            .filter(|&n| n > 0)
+            .map(|n| n as usize)
+            .unwrap_or(crate::block_device::DEFAULT_MAX_TRANSFER_BYTES);
+        if env.exception_check().unwrap_or(false) {
+            let _ = env.exception_clear();
+        }
+        let uas = env
+            .call_method(&handler, "isUas", "()Z", &[])
+            .and_then(|v| v.z())
+            .unwrap_or(false);
+        if env.exception_check().unwrap_or(false) {
+            let _ = env.exception_clear();
+        }
+        let methods = Self::lookup_methods(env, &handler)
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, format!("get_method_id failed: {:?}", e)))?;
+        let mut control = vec![0u8; CONTROL_LEN].into_boxed_slice();
+        // The boxed slice never moves, so the direct buffer stays valid for our lifetime.
+        let control_buf = unsafe { env.new_direct_byte_buffer(control.as_mut_ptr(), control.len()) }
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, format!("new_direct_byte_buffer failed: {:?}", e)))?;
+        let control_ref = env.new_global_ref(&control_buf).map_err(|e| {
+            io::Error::new(io::ErrorKind::Other, format!("new_global_ref failed: {:?}", e))
+        })?;
+        let _ = env.delete_local_ref(control_buf);
+        Ok(Self {
+            vm,
+            handler,
+            max_transfer,
+            uas,
+            control: Mutex::new(control),
+            control_ref,
+            methods,
+        })
+    }
+
+    fn lookup_methods(env: &mut JNIEnv<'_>, handler: &GlobalRef) -> jni::errors::Result<Methods> {
+        let class = env.get_object_class(handler)?;
+        let methods = Methods {
+            bulk_out: env.get_method_id(&class, "bulkOutDirect", SIG_DIRECT)?,
+            bulk_in: env.get_method_id(&class, "bulkInDirect", SIG_DIRECT)?,
+            pipe_out: env.get_method_id(&class, "pipeOutDirect", SIG_PIPE_DIRECT)?,
+            pipe_in: env.get_method_id(&class, "pipeInDirect", SIG_PIPE_DIRECT)?,
+            execute: env.get_method_id(&class, "executeCommand", SIG_EXECUTE)?,
+        };
+        let _ = env.delete_local_ref(class);
+        Ok(methods)
     }
 
     fn with_env<F, R>(&self, f: F) -> io::Result<R>
@@ -29,48 +121,180 @@ impl JniTransferHandler {
             io::Error::new(io::ErrorKind::Other, format!("attach thread failed: {:?}", e))
         })?;
         f(&mut guard).map_err(|e| {
+            // Don't leave a Kotlin exception pending for the next upcall.
+            if guard.exception_check().unwrap_or(false) {
+                let _ = guard.exception_clear();
+            }
             io::Error::new(io::ErrorKind::Other, format!("JNI call failed: {:?}", e))
         })
     }
 
+    /// Int method through a cached ID.
+    fn call_int(&self, env: &mut JNIEnv<'_>, method: JMethodID, args: &[jvalue]) -> jni::errors::Result<usize> {
+        // SAFETY: the ID was resolved on the handler's class with a matching signature.
+        let result = unsafe {
+            env.call_method_unchecked(self.handler.as_obj(), method, ReturnType::Primitive(Primitive::Int), &args)
+        }?;
+        Ok(result.i()?.max(0) as usize)
+    }
+
+    /// Pipe-variant args when `pipe` is set: (pipe, buffer, len), else (buffer, len).
+    fn call_transfer(
+        &self,
+        env: &mut JNIEnv<'_>,
+        method: JMethodID,
+        pipe: Option<UasPipe>,
+        buffer: &JObject<'_>,
+        len: usize,
+    ) -> jni::errors::Result<usize> {
+        match pipe {
+            Some(p) => self.call_int(
+                env,
+                method,
+                &[
+                    JValue::Int(p as i32).as_jni(),
+                    JValue::Object(buffer).as_jni(),
+                    JValue::Int(len as i32).as_jni(),
+                ],
+            ),
+            None => self.call_int(
+                env,
+                method,
+                &[JValue::Object(buffer).as_jni(), JValue::Int(len as i32).as_jni()],
+            ),
+        }
+    }
 }
 
-impl crate::block_device::TransferHandler for JniTransferHandler {
-    fn bulk_out(&self, _session_id: u64, data: &[u8]) -> io::Result<usize> {
+impl JniTransferHandler {
+    /// Calls a `*Direct` method of the handler on `len` bytes at `ptr`.
+    /// `pipe` selects the UAS variant (pipe ID as first argument).
+    fn direct_transfer(&self, method: JMethodID, pipe: Option<UasPipe>, ptr: *mut u8, len: usize) -> io::Result<usize> {
         self.with_env(|env| {
-            let arr = env.byte_array_from_slice(data)?;
-            let result = env.call_method(
-                &self.handler,
-                "bulkOut",
-                "([B)I",
-                &[JValue::Object(&arr.into())],
-            )?;
-            let n: i32 = result.i()?;
-            Ok(n as usize)
+            let buffer = unsafe { env.new_direct_byte_buffer(ptr, len) }?;
+            let result = self.call_transfer(env, method, pipe, &buffer, len);
+            // Permanently attached threads never pop their local frame.
+            let _ = env.delete_local_ref(buffer);
+            result
         })
     }
 
-    fn bulk_in(&self, _session_id: u64, buf: &mut [u8]) -> io::Result<usize> {
-        self.with_env(|env| {
-            let result = env.call_method(
-                &self.handler,
-                "bulkIn",
-                "(I)[B",
-                &[JValue::Int(buf.len() as i32)],
-            )?;
-            let result_arr = result.l()?;
-            let byte_arr = unsafe { JByteArray::from_raw(result_arr.as_raw() as jni::sys::jarray) };
-            let len = env.get_array_length(&byte_arr)?;
-            let copy_len = (len as usize).min(buf.len());
-            if copy_len > 0 {
-                let mut temp = vec![0i8; copy_len];
-                env.get_byte_array_region(&byte_arr, 0, &mut temp)?;
-                for i in 0..copy_len {
-                    buf[i] = temp[i] as u8;
-                }
+    /// Same as direct_transfer, through the cached control buffer.
+    fn control_transfer(&self, method: JMethodID, pipe: Option<UasPipe>, data: &mut [u8], out: bool) -> io::Result<usize> {
+        let mut control = self.control.lock().unwrap();
+        let len = data.len();
+        if out {
+            control[..len].copy_from_slice(data);
+        }
+        let n = self.with_env(|env| self.call_transfer(env, method, pipe, self.control_ref.as_obj(), len))?;
+        let n = n.min(len);
+        if !out {
+            data[..n].copy_from_slice(&control[..n]);
+        }
+        Ok(n)
+    }
+
+    fn transfer_out(&self, method: JMethodID, pipe: Option<UasPipe>, data: &[u8]) -> io::Result<usize> {
+        if data.len() <= CONTROL_BUF_SIZE {
+            let mut tmp = [0u8; CONTROL_BUF_SIZE];
+            tmp[..data.len()].copy_from_slice(data);
+            return self.control_transfer(method, pipe, &mut tmp[..data.len()], true);
+        }
+        // Kotlin only reads from an OUT buffer.
+        self.direct_transfer(method, pipe, data.as_ptr() as *mut u8, data.len())
+    }
+
+    fn transfer_in(&self, method: JMethodID, pipe: Option<UasPipe>, buf: &mut [u8]) -> io::Result<usize> {
+        if buf.len() <= CONTROL_BUF_SIZE {
+            return self.control_transfer(method, pipe, buf, false);
+        }
+        self.direct_transfer(method, pipe, buf.as_mut_ptr(), buf.len())
+    }
+}
+
+impl JniTransferHandler {
+    /// One executeCommand upcall for a whole BOT command.
+    fn execute_command(
+        &self,
+        cbw: &[u8; scsi::CBW_SIZE],
+        sense_cbw: &[u8; scsi::CBW_SIZE],
+        data: Option<(*mut u8, usize)>,
+        direction: u8,
+    ) -> io::Result<BotCompletion> {
+        let mut control = self.control.lock().unwrap();
+        control[BOT_CBW..BOT_CBW + scsi::CBW_SIZE].copy_from_slice(cbw);
+        control[BOT_SENSE_CBW..BOT_SENSE_CBW + scsi::CBW_SIZE].copy_from_slice(sense_cbw);
+        control[BOT_CSW..BOT_CSW + scsi::CSW_SIZE].fill(0);
+        control[BOT_SENSE..BOT_SENSE + scsi::SENSE_SIZE].fill(0);
+        let (ptr, len) = data.filter(|&(p, n)| n > 0 && !p.is_null()).unwrap_or((std::ptr::null_mut(), 0));
+
+        let transferred = self.with_env(|env| {
+            let buffer = if len > 0 {
+                unsafe { env.new_direct_byte_buffer(ptr, len) }?.into()
+            } else {
+                JObject::null()
+            };
+            let result = self.call_int(
+                env,
+                self.methods.execute,
+                &[
+                    JValue::Object(self.control_ref.as_obj()).as_jni(),
+                    JValue::Object(&buffer).as_jni(),
+                    JValue::Int(len as i32).as_jni(),
+                    JValue::Bool((direction == scsi::DIRECTION_IN) as u8).as_jni(),
+                ],
+            );
+            if !buffer.is_null() {
+                let _ = env.delete_local_ref(buffer);
             }
-            Ok(copy_len)
-        })
+            result
+        })?;
+
+        let mut csw = [0u8; scsi::CSW_SIZE];
+        csw.copy_from_slice(&control[BOT_CSW..BOT_CSW + scsi::CSW_SIZE]);
+        let sense = (csw[12] == 1).then(|| {
+            let mut sense = [0u8; scsi::SENSE_SIZE];
+            sense.copy_from_slice(&control[BOT_SENSE..BOT_SENSE + scsi::SENSE_SIZE]);
+            sense
+        });
+        Ok(BotCompletion { transferred: transferred.min(len), csw, sense })
+    }
+}
+
+impl crate::block_device::TransferHandler for JniTransferHandler {
+    fn bulk_out(&self, _session_id: u64, data: &[u8]) -> io::Result<usize> {
+        self.transfer_out(self.methods.bulk_out, None, data)
+    }
+
+    fn bulk_in(&self, _session_id: u64, buf: &mut [u8]) -> io::Result<usize> {
+        self.transfer_in(self.methods.bulk_in, None, buf)
+    }
+
+    fn pipe_out(&self, _session_id: u64, pipe: UasPipe, data: &[u8]) -> io::Result<usize> {
+        self.transfer_out(self.methods.pipe_out, Some(pipe), data)
+    }
+
+    fn pipe_in(&self, _session_id: u64, pipe: UasPipe, buf: &mut [u8]) -> io::Result<usize> {
+        self.transfer_in(self.methods.pipe_in, Some(pipe), buf)
+    }
+
+    fn execute_bot(
+        &self,
+        _session_id: u64,
+        cbw: &[u8; scsi::CBW_SIZE],
+        sense_cbw: &[u8; scsi::CBW_SIZE],
+        data: Option<(*mut u8, usize)>,
+        direction: u8,
+    ) -> Option<io::Result<BotCompletion>> {
+        Some(self.execute_command(cbw, sense_cbw, data, direction))
+    }
+
+    fn is_uas(&self) -> bool {
+        self.uas
+    }
+
+    fn max_transfer_size(&self) -> usize {
+        self.max_transfer
     }
 }
 
@@ -0,0 +1,261 @@
+//! Background export of a volume file to a file descriptor (SAF document or
+//! temp file). A reader thread streams chunks from the volume while a writer
+//! thread writes the previous ones, so USB and storage I/O overlap. The
+//! volume is locked per chunk, so browsing continues during a copy.
+//! DVD title extraction (dvd::extract) reports through the same job registry,
+//! so copyJobStatus, cancelCopyJob and releaseCopyJob cover both.
+
+use crate::registry::Registry;
+use std::fs::File;
+use std::io::{self, Write};
+use std::os::fd::{FromRawFd, RawFd};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::mpsc::{sync_channel, Receiver, SyncSender};
+use std::sync::{Arc, Mutex};
+
+/// Bytes per volume read (split into bulk transfers by the block device).
+const CHUNK_BYTES: usize = 1024 * 1024;
+/// Chunks read ahead of the writer.
+const PIPELINE_DEPTH: usize = 4;
+/// Queued chunks plus the one being read and the one being written.
+const MAX_BUFFERS: usize = PIPELINE_DEPTH + 2;
+
+pub const JOB_RUNNING: i32 = 0;
+pub const JOB_DONE: i32 = 1;
+pub const JOB_FAILED: i32 = 2;
+pub const JOB_CANCELLED: i32 = 3;
+
+pub struct CopyJob {
+    /// Bytes written to the descriptor.
+    copied: AtomicU64,
+    total: u64,
+    cancel: AtomicBool,
+    /// JOB_* state and the error for JOB_FAILED.
+    state: Mutex<(i32, Option<String>)>,
+}
+
+pub struct JobStatus {
+    pub state: i32,
+    pub copied: u64,
+    pub total: u64,
+    pub error: Option<String>,
+}
+
+impl CopyJob {
+    pub(crate) fn finish(&self, result: io::Result<()>) {
+        let mut state = self.state.lock().unwrap();
+        *state = match result {
+            Ok(()) if self.cancel.load(Ordering::Relaxed) => (JOB_CANCELLED, None),
+            Ok(()) => (JOB_DONE, None),
+            Err(e) => (JOB_FAILED, Some(e.to_string())),
+        };
+    }
+
+    pub(crate) fn cancelled(&self) -> bool {
+        self.cancel.load(Ordering::Relaxed)
+    }
+
+    pub(crate) fn add_copied(&self, n: u64) {
+        self.copied.fetch_add(n, Ordering::Relaxed);
+    }
+}
+
+static JOBS: std::sync::LazyLock<Registry<Arc<CopyJob>>> =
+    std::sync::LazyLock::new(Registry::new);
+
+/// Registers a running job of `total` bytes, `copied` of them already done
+/// (a resumed export).
+pub(crate) fn register(total: u64, copied: u64) -> (u64, Arc<CopyJob>) {
+    let job = Arc::new(CopyJob {
+        copied: AtomicU64::new(copied),
+        total,
+        cancel: AtomicBool::new(false),
+        state: Mutex::new((JOB_RUNNING, None)),
+    });
+    (JOBS.insert(Arc::clone(&job)), job)
+}
+
+/// Wraps a descriptor the caller hands over (ParcelFileDescriptor.detachFd)
+/// in a File that owns it from here on.
+pub(crate) fn adopt_fd(fd: RawFd) -> File {
+    // SAFETY: Kotlin detached the descriptor and never uses or closes it again.
+    unsafe { File::from_raw_fd(fd) }
+}
+
+/// Producer side of a pool of `len`-byte buffers passed between two pipeline
+/// stages: at most `max` are allocated, and the consumer gives them back
+/// through the paired BufferReturn.
+pub(crate) struct BufferPool {
+    free_rx: Receiver<Vec<u8>>,
+    allocated: usize,
+    max: usize,
+    len: usize,
+}
+
+/// Consumer side of a BufferPool. Dropping it wakes a producer waiting on
+/// the pool.
+pub(crate) struct BufferReturn(SyncSender<Vec<u8>>);
+
+pub(crate) fn buffer_pool(max: usize, len: usize) -> (BufferPool, BufferReturn) {
+    let (free_tx, free_rx) = sync_channel(max);
+    let pool = BufferPool { free_rx, allocated: 0, max, len };
+    (pool, BufferReturn(free_tx))
+}
+
+impl BufferPool {
+    /// A returned buffer, or a new one while under `max`; otherwise waits for
+    /// one back. None once the consumer has stopped.
+    pub(crate) fn take(&mut self) -> Option<Vec<u8>> {
+        match self.free_rx.try_recv() {
+            Ok(b) => Some(b),
+            Err(_) if self.allocated < self.max => {
+                self.allocated += 1;
+                Some(vec![0u8; self.len])
+            }
+            // All buffers are in flight; wait for one back.
+            Err(_) => self.free_rx.recv().ok(),
+        }
+    }
+}
+
+impl BufferReturn {
+    pub(crate) fn give(&self, buf: Vec<u8>) {
+        let _ = self.0.try_send(buf);
+    }
+}
+
+/// Drops a job whose threads could not be started.
+pub(crate) fn abandon(job_id: u64) {
+    if let Some(job) = JOBS.remove(job_id) {
+        job.cancel.store(true, Ordering::Relaxed);
+    }
+}
+
+/// Starts copying `path` of the volume into `fd`. Takes ownership of `fd`; it
+/// is closed when the copy ends, or right away if the file can't be opened.
+pub fn copy_file_to_fd(volume_id: u64, path: &str, fd: RawFd) -> io::Result<u64> {
+    let out = adopt_fd(fd);
+    let (handle, total) = crate::VOLUMES
+        .with(volume_id, |v| {
+            let handle = v.open_file(path)?;
+            Ok((handle, v.open_file_size(handle)?))
+        })
+        .unwrap_or_else(|| Err(io::Error::new(io::ErrorKind::NotFound, "Volume not found")))?;
+
+    let (id, job) = register(total, 0);
+
+    let (full_tx, full_rx) = sync_channel::<(Vec<u8>, usize)>(PIPELINE_DEPTH);
+    let (pool, free) = buffer_pool(MAX_BUFFERS, CHUNK_BYTES);
+    let writer_job = Arc::clone(&job);
+    let writer = std::thread::Builder::new()
+        .name("copy-writer".to_string())
+        .spawn(move || write_chunks(&writer_job, out, full_rx, free))?;
+    let reader_job = Arc::clone(&job);
+    let spawned = std::thread::Builder::new()
+        .name("copy-reader".to_string())
+        .spawn(move || {
+            let read = read_chunks(&reader_job, volume_id, handle, full_tx, pool);
+            crate::VOLUMES.with(volume_id, |v| v.close_file(handle));
+            let written = writer.join().unwrap_or_else(|_| {
+                Err(io::Error::new(io::ErrorKind::Other, "Writer thread panicked"))
+            });
+            reader_job.finish(read.and(written));
+        });
+    if let Err(e) = spawned {
+        abandon(id);
+        crate::VOLUMES.with(volume_id, |v| v.close_file(handle));
+        return Err(e);
+    }
+    Ok(id)
+}
+
+fn read_chunks(
+    job: &CopyJob,
+    volume_id: u64,
+    handle: u64,
+    full_tx: SyncSender<(Vec<u8>, usize)>,
+    mut pool: BufferPool,
+) -> io::Result<()> {
+    let mut offset = 0u64;
+    while offset < job.total && !job.cancelled() {
+        let Some(mut buf) = pool.take() else {
+            return Ok(()); // writer stopped; it reports its own error
+        };
+        let n = crate::VOLUMES
+            .with(volume_id, |v| v.read_open_file_into(handle, offset, &mut buf))
+            .unwrap_or_else(|| Err(io::Error::new(io::ErrorKind::NotFound, "Volume not found")))?;
+        if n == 0 {
+            return Err(io::Error::new(io::ErrorKind::UnexpectedEof, "File ended early"));
+        }
+        offset += n as u64;
+        if full_tx.send((buf, n)).is_err() {
+            return Ok(());
+        }
+    }
+    Ok(())
+}
+
+fn write_chunks(
+    job: &CopyJob,
+    mut out: File,
+    full_rx: Receiver<(Vec<u8>, usize)>,
+    free: BufferReturn,
+) -> io::Result<()> {
+    for (buf, n) in full_rx {
+        if job.cancelled() {
+            return Ok(());
+        }
+        out.write_all(&buf[..n])?;
+        job.add_copied(n as u64);
+        free.give(buf);
+    }
+    out.flush()
+}
+
+pub fn job_status(job_id: u64) -> Option<JobStatus> {
+    JOBS.with(job_id, |job| {
+        let state = job.state.lock().unwrap();
+        JobStatus {
+            state: state.0,
+            copied: job.copied.load(Ordering::Relaxed),
+            total: job.total,
+            error: state.1.clone(),
+        }
+    })
+}
+
+/// Asks the job to stop; its state becomes JOB_CANCELLED once the threads exit.
+pub fn cancel_job(job_id: u64) -> bool {
+    JOBS.with(job_id, |job| job.cancel.store(true, Ordering::Relaxed)).is_some()
+}
+
+/// Forgets a job. A running job is cancelled first.
+pub fn release_job(job_id: u64) -> bool {
+    match JOBS.remove(job_id) {
+        Some(job) => {
+            job.cancel.store(true, Ordering::Relaxed);
+            true
+        }
+        None => false,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn pool_reuses_returned_buffers_up_to_its_limit() {
+        let (mut pool, free) = buffer_pool(2, 16);
+        let a = pool.take().unwrap();
+        let b = pool.take().unwrap();
+        assert_eq!((a.len(), b.len()), (16, 16));
+        let ptr = a.as_ptr();
+        free.give(a);
+        let again = pool.take().unwrap();
+        assert_eq!(again.as_ptr(), ptr);
+        // Both buffers are out: with the consumer gone, take stops waiting.
+        drop(free);
+        assert!(pool.take().is_none());
+    }
+}
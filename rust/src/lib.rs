@@ -1,31 +1,48 @@
-//! Connectias Rust library: SCSI BOT, NTFS read, JNI for Android.
+//! Connectias Rust library: SCSI BOT, NTFS read, JNI for Android and a C ABI
+//! for dart:ffi (c_api).
 
-mod block_device;
+// Modules used by the host benches (benches/) are public; the rest of the
+// crate is only reached through the JNI entry points.
+pub mod block_cache;
+pub mod block_device;
+mod c_api;
+pub mod cdda;
+mod dentry_cache;
+pub mod device_session;
+pub mod io_stats;
 mod jni_bridge;
-mod ntfs_reader;
-mod ntfs_volume;
+mod jobs;
+mod mft_index;
+mod ntfs_file;
+pub mod ntfs_reader;
+pub mod ntfs_volume;
 mod partition;
-mod scsi;
+mod pump;
+pub mod recovery;
+mod registry;
+pub mod scsi;
+mod uas;
 
 #[cfg(has_dvd)]
-mod dvd;
+pub mod dvd;
 
 use block_device::ScsiBlockDevice;
+use device_session::DeviceSession;
 use jni_bridge::JniTransferHandler;
 use jni::objects::{JObject, JString};
 use ntfs_volume::{DirEntry, NtfsVolume};
-use std::collections::HashMap;
+use registry::Registry;
 use std::ffi::CString;
-use std::sync::Mutex;
+use std::sync::Arc;
 
-static LAST_ERROR: std::sync::LazyLock<Mutex<Option<CString>>> =
-    std::sync::LazyLock::new(|| Mutex::new(None));
+thread_local! {
+    /// Per thread, since calls on different handles run concurrently.
+    static LAST_ERROR: std::cell::RefCell<Option<CString>> = std::cell::RefCell::new(None);
+}
 
 pub(crate) fn set_last_error(msg: &str) {
     if let Ok(cstr) = CString::new(msg) {
-        if let Ok(mut guard) = LAST_ERROR.lock() {
-            *guard = Some(cstr);
-        }
+        LAST_ERROR.with(|e| *e.borrow_mut() = Some(cstr));
     }
 }
 
@@ -37,15 +54,19 @@ pub const ERR_NTFS: i32 = 3;
 pub const ERR_NOT_FOUND: i32 = 4;
 pub const ERR_NO_NTFS: i32 = 5;
 
-static VOLUMES: std::sync::LazyLock<Mutex<HashMap<u64, NtfsVolume>>> =
-    std::sync::LazyLock::new(|| Mutex::new(HashMap::new()));
-static VOLUME_ID: std::sync::LazyLock<Mutex<u64>> =
-    std::sync::LazyLock::new(|| Mutex::new(1));
+/// Open USB block devices; volumes hold their device's cache.
+static DEVICES: std::sync::LazyLock<Registry<Arc<DeviceSession>>> =
+    std::sync::LazyLock::new(Registry::new);
+
+static VOLUMES: std::sync::LazyLock<Registry<NtfsVolume>> =
+    std::sync::LazyLock::new(Registry::new);
 
 // --- JNI entry points ---
 
+/// Opens the block device of a USB session and scans its partition table.
+/// Returns a device handle for openVolume, or negative error code.
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openVolume(
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openBlockDevice(
     env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
     session_id: jni::sys::jlong,
@@ -69,25 +90,94 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openVo
             return -(ERR_TRANSPORT as i64);
         }
     };
-    let volume = match NtfsVolume::open(block_device) {
+    match DeviceSession::open(block_device) {
+        Ok(device) => DEVICES.insert(Arc::new(device)) as i64,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            -(ERR_TRANSPORT as i64)
+        }
+    }
+}
+
+/// Partitions of an open device as a JSON array of {i, start, size, t, ntfs}
+/// objects (index, start LBA, size in bytes, MBR type, NTFS boot sector).
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_listPartitions(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    device_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    use std::fmt::Write;
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(device) = DEVICES.with(device_handle as u64, |d| Arc::clone(d)) else {
+        set_last_error("Device not found");
+        return std::ptr::null_mut();
+    };
+    let mut json = String::from("[");
+    for (i, p) in device.partitions().iter().enumerate() {
+        if i > 0 {
+            json.push(',');
+        }
+        let size = device.locate(Some(i)).map(|(_, size)| size).unwrap_or(0);
+        let _ = write!(
+            json,
+            r#"{{"i":{},"start":{},"size":{},"t":{},"ntfs":{}}}"#,
+            i, p.start_lba, size, p.mbr_type, p.is_ntfs
+        );
+    }
+    json.push(']');
+    match env.new_string(&json) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// Releases a device handle. Volumes opened on it stay usable until closed.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeBlockDevice(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    device_handle: jni::sys::jlong,
+) -> jni::sys::jint {
+    if DEVICES.remove(device_handle as u64).is_some() {
+        ERR_OK
+    } else {
+        set_last_error("Device not found");
+        -ERR_NOT_FOUND
+    }
+}
+
+/// Mounts partition `partition` of an open device (the first NTFS one if
+/// negative). Returns volume ID, or negative error code.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openVolume(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    device_handle: jni::sys::jlong,
+    partition: jni::sys::jint,
+) -> jni::sys::jlong {
+    let Some(device) = DEVICES.with(device_handle as u64, |d| Arc::clone(d)) else {
+        set_last_error("Device not found");
+        return -(ERR_NOT_FOUND as i64);
+    };
+    let index = usize::try_from(partition).ok();
+    let volume = match NtfsVolume::open(&device, index) {
         Ok(v) => v,
         Err(e) => {
             let msg = e.to_string();
             set_last_error(&msg);
+            if e.kind() == std::io::ErrorKind::NotFound {
+                return -(ERR_NOT_FOUND as i64);
+            }
             if msg.contains("No NTFS") || msg.contains("NTFS parse") {
                 return -(ERR_NO_NTFS as i64);
             }
             return -(ERR_NTFS as i64);
         }
     };
-    let id = {
-        let mut guard = VOLUME_ID.lock().unwrap();
-        let id = *guard;
-        *guard += 1;
-        id
-    };
-    VOLUMES.lock().unwrap().insert(id, volume);
-    id as i64
+    VOLUMES.insert(volume) as i64
 }
 
 #[no_mangle]
@@ -96,7 +186,7 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeV
     _class: jni::sys::jclass,
     volume_id: jni::sys::jlong,
 ) -> jni::sys::jint {
-    let removed = VOLUMES.lock().unwrap().remove(&(volume_id as u64));
+    let removed = VOLUMES.remove(volume_id as u64);
     if removed.is_some() {
         ERR_OK
     } else {
@@ -123,17 +213,13 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_listDi
             return std::ptr::null_mut();
         }
     };
-    let mut volumes = VOLUMES.lock().unwrap();
-    let volume = match volumes.get_mut(&(volume_id as u64)) {
-        Some(v) => v,
+    let entries = match VOLUMES.with(volume_id as u64, |v| v.list_directory(&path_str)) {
+        Some(Ok(e)) => e,
         None => {
             set_last_error("Volume not found");
             return std::ptr::null_mut();
         }
-    };
-    let entries = match volume.list_directory(&path_str) {
-        Ok(e) => e,
-        Err(e) => {
+        Some(Err(e)) => {
             set_last_error(&e.to_string());
             return std::ptr::null_mut();
         }
@@ -145,6 +231,88 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_listDi
     }
 }
 
+/// Opens a paged listing of a directory. Returns a cursor ID, or negative error code.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openDirCursor(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    volume_id: jni::sys::jlong,
+    path: jni::sys::jstring,
+) -> jni::sys::jlong {
+    let mut env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let path_jstr = unsafe { JString::from_raw(path) };
+    let path_str = match env.get_string(&path_jstr) {
+        Ok(s) => s.to_string_lossy().into_owned(),
+        Err(_) => {
+            set_last_error("Invalid path");
+            return -(ERR_NOT_FOUND as i64);
+        }
+    };
+    match VOLUMES.with(volume_id as u64, |v| v.open_dir_cursor(&path_str)) {
+        Some(Ok(cursor)) => cursor as i64,
+        None => {
+            set_last_error("Volume not found");
+            -(ERR_NOT_FOUND as i64)
+        }
+        Some(Err(e)) => {
+            set_last_error(&e.to_string());
+            if e.kind() == std::io::ErrorKind::NotFound {
+                -(ERR_NOT_FOUND as i64)
+            } else {
+                -(ERR_NTFS as i64)
+            }
+        }
+    }
+}
+
+/// Next page of up to `max_entries` entries as a JSON array (same format as
+/// listDirectory); a short page is the last one. Null on error.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_readDirPage(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    volume_id: jni::sys::jlong,
+    cursor: jni::sys::jlong,
+    max_entries: jni::sys::jint,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let max = max_entries.max(1) as usize;
+    let json = match VOLUMES.with(volume_id as u64, |v| {
+        v.next_dir_page(cursor as u64, max).map(entries_to_json)
+    }) {
+        Some(Ok(json)) => json,
+        None => {
+            set_last_error("Volume not found");
+            return std::ptr::null_mut();
+        }
+        Some(Err(e)) => {
+            set_last_error(&e.to_string());
+            return std::ptr::null_mut();
+        }
+    };
+    match env.new_string(&json) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeDirCursor(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    volume_id: jni::sys::jlong,
+    cursor: jni::sys::jlong,
+) -> jni::sys::jint {
+    match VOLUMES.with(volume_id as u64, |v| v.close_dir_cursor(cursor as u64)) {
+        Some(true) => ERR_OK,
+        _ => -ERR_NOT_FOUND,
+    }
+}
+
 #[no_mangle]
 pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_readFile(
     env: *mut jni::sys::JNIEnv,
@@ -165,17 +333,13 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_readFi
             return std::ptr::null_mut();
         }
     };
-    let mut volumes = VOLUMES.lock().unwrap();
-    let volume = match volumes.get_mut(&(volume_id as u64)) {
-        Some(v) => v,
+    let data = match VOLUMES.with(volume_id as u64, |v| v.read_file(&path_str, offset as u64, length as usize)) {
+        Some(Ok(d)) => d,
         None => {
             set_last_error("Volume not found");
             return std::ptr::null_mut();
         }
-    };
-    let data = match volume.read_file(&path_str, offset as u64, length as usize) {
-        Ok(d) => d,
-        Err(e) => {
+        Some(Err(e)) => {
             set_last_error(&e.to_string());
             return std::ptr::null_mut();
         }
@@ -187,152 +351,774 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_readFi
 }
 
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_getDeviceType(
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openFile(
     env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-    session_id: jni::sys::jlong,
-    handler: jni::sys::jobject,
-) -> jni::sys::jstring {
-    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
-    let handler = unsafe { JObject::from_raw(handler) };
-    let transfer = match JniTransferHandler::new(&mut env, handler) {
-        Ok(t) => t,
-        Err(e) => {
-            set_last_error(&e.to_string());
-            return std::ptr::null_mut();
+    volume_id: jni::sys::jlong,
+    path: jni::sys::jstring,
+) -> jni::sys::jlong {
+    let mut env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let path_jstr = unsafe { JString::from_raw(path) };
+    let path_str = match env.get_string(&path_jstr) {
+        Ok(s) => s.to_string_lossy().into_owned(),
+        Err(_) => {
+            set_last_error("Invalid path");
+            return -(ERR_NOT_FOUND as i64);
         }
     };
-    let dev = ScsiBlockDevice::new_minimal(Box::new(transfer), session_id as u64);
-    match dev.inquiry() {
-        Ok(0x05) => env.new_string("optical").map(|s| s.into_raw()).unwrap_or(std::ptr::null_mut()),
-        Ok(_) => env.new_string("block").map(|s| s.into_raw()).unwrap_or(std::ptr::null_mut()),
-        Err(e) => {
+    match VOLUMES.with(volume_id as u64, |v| v.open_file(&path_str)) {
+        Some(Ok(handle)) => handle as i64,
+        None => {
+            set_last_error("Volume not found");
+            -(ERR_NOT_FOUND as i64)
+        }
+        Some(Err(e)) => {
             set_last_error(&e.to_string());
-            std::ptr::null_mut()
+            if e.kind() == std::io::ErrorKind::NotFound {
+                -(ERR_NOT_FOUND as i64)
+            } else {
+                -(ERR_NTFS as i64)
+            }
         }
     }
 }
 
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_lastError(
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_readFileHandle(
     env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-) -> jni::sys::jstring {
+    volume_id: jni::sys::jlong,
+    file_handle: jni::sys::jlong,
+    offset: jni::sys::jlong,
+    length: jni::sys::jint,
+) -> jni::sys::jbyteArray {
     let env = unsafe {
         jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
     };
-    let msg = if let Ok(guard) = LAST_ERROR.lock() {
-        guard.as_ref().map(|c| c.to_string_lossy().into_owned())
-    } else {
-        None
+    let read = VOLUMES.with(volume_id as u64, |v| {
+        v.read_open_file(file_handle as u64, offset.max(0) as u64, length.max(0) as usize)
+    });
+    let data = match read {
+        Some(Ok(d)) => d,
+        None => {
+            set_last_error("Volume not found");
+            return std::ptr::null_mut();
+        }
+        Some(Err(e)) => {
+            set_last_error(&e.to_string());
+            return std::ptr::null_mut();
+        }
     };
-    let msg = msg.unwrap_or_else(|| "".to_string());
-    match env.new_string(&msg) {
-        Ok(s) => s.into_raw(),
+    match env.byte_array_from_slice(&data) {
+        Ok(arr) => arr.into_raw(),
         Err(_) => std::ptr::null_mut(),
     }
 }
 
-fn entries_to_json(entries: &[DirEntry]) -> String {
-    let mut parts: Vec<String> = Vec::new();
-    for e in entries {
-        parts.push(format!(
-            r#"{{"n":"{}","d":{},"s":{}}}"#,
-            escape_json(&e.name),
-            e.is_dir,
-            e.size
-        ));
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeFile(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    volume_id: jni::sys::jlong,
+    file_handle: jni::sys::jlong,
+) -> jni::sys::jint {
+    match VOLUMES.with(volume_id as u64, |v| v.close_file(file_handle as u64)) {
+        Some(true) => ERR_OK,
+        _ => {
+            set_last_error("File handle not found");
+            -ERR_NOT_FOUND
+        }
     }
-    format!("[{}]", parts.join(","))
-}
-
-fn escape_json(s: &str) -> String {
-    s.replace('\\', "\\\\")
-        .replace('"', "\\\"")
-        .replace('\n', "\\n")
-        .replace('\r', "\\r")
-        .replace('\t', "\\t")
 }
 
-// --- DVD JNI entry points (when has_dvd) ---
-
-#[cfg(has_dvd)]
+/// Starts indexing the volume's $MFT in the background for searchVolume.
+/// A saved index in `dir` is reused unless `rebuild`. Returns 0 or negative error code.
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openDvd(
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_startMftIndex(
     env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-    session_id: jni::sys::jlong,
-    handler: jni::sys::jobject,
-) -> jni::sys::jlong {
-    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
-    let handler = unsafe { JObject::from_raw(handler) };
-    let transfer = match JniTransferHandler::new(&mut env, handler) {
-        Ok(t) => t,
-        Err(e) => {
-            set_last_error(&e.to_string());
-            return -1;
+    volume_id: jni::sys::jlong,
+    dir: jni::sys::jstring,
+    rebuild: jni::sys::jboolean,
+) -> jni::sys::jint {
+    let mut env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let dir_jstr = unsafe { JString::from_raw(dir) };
+    let dir_str = match env.get_string(&dir_jstr) {
+        Ok(s) => s.to_string_lossy().into_owned(),
+        Err(_) => {
+            set_last_error("Invalid index directory");
+            return -ERR_NOT_FOUND;
         }
     };
-    match dvd::open_dvd(session_id as u64, Box::new(transfer)) {
-        Ok(id) => id as i64,
+    match mft_index::start(volume_id as u64, dir_str.into(), rebuild != 0) {
+        Ok(()) => ERR_OK,
         Err(e) => {
-            set_last_error(&e);
-            -1
+            set_last_error(&e.to_string());
+            if e.kind() == std::io::ErrorKind::NotFound {
+                -ERR_NOT_FOUND
+            } else {
+                -ERR_NTFS
+            }
         }
     }
 }
 
-#[cfg(has_dvd)]
+/// Fills `out` with [records scanned, records total] and returns the index
+/// state (mft_index::INDEX_*), or negative error code. For a failed scan the
+/// error is in lastError.
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeDvd(
-    _env: *mut jni::sys::JNIEnv,
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_mftIndexStatus(
+    env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-    dvd_handle: jni::sys::jlong,
-) {
-    dvd::close_dvd(dvd_handle as u64);
+    volume_id: jni::sys::jlong,
+    out: jni::sys::jlongArray,
+) -> jni::sys::jint {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(status) = VOLUMES.with(volume_id as u64, |v| v.mft_indexer().status()) else {
+        set_last_error("Volume not found");
+        return -ERR_NOT_FOUND;
+    };
+    let out = unsafe { jni::objects::JLongArray::from_raw(out) };
+    let values = [status.scanned as i64, status.total as i64];
+    if env.set_long_array_region(&out, 0, &values).is_err() {
+        set_last_error("Invalid status array");
+        return -ERR_TRANSPORT;
+    }
+    if let Some(e) = &status.error {
+        set_last_error(e);
+    }
+    status.state
 }
 
-#[cfg(has_dvd)]
+/// Names matching `query` anywhere on the volume, as a JSON array of
+/// {p, d, s} objects (path from the root, is directory, size). Null if the
+/// index isn't ready.
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdListTitles(
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_searchVolume(
     env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-    dvd_handle: jni::sys::jlong,
+    volume_id: jni::sys::jlong,
+    query: jni::sys::jstring,
+    prefix: jni::sys::jboolean,
+    limit: jni::sys::jint,
 ) -> jni::sys::jstring {
-    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
-    match dvd::list_titles_json(dvd_handle as u64) {
-        Ok(json) => env.new_string(&json).map(|s| s.into_raw()).unwrap_or(std::ptr::null_mut()),
-        Err(e) => {
-            set_last_error(&e);
-            std::ptr::null_mut()
+    let mut env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let query_jstr = unsafe { JString::from_raw(query) };
+    let query_str = match env.get_string(&query_jstr) {
+        Ok(s) => s.to_string_lossy().into_owned(),
+        Err(_) => {
+            set_last_error("Invalid query");
+            return std::ptr::null_mut();
         }
+    };
+    let Some(indexer) = VOLUMES.with(volume_id as u64, |v| v.mft_indexer()) else {
+        set_last_error("Volume not found");
+        return std::ptr::null_mut();
+    };
+    // Search outside the volume lock: the index is immutable once built.
+    let Some(index) = indexer.index() else {
+        set_last_error("Index not ready");
+        return std::ptr::null_mut();
+    };
+    let hits = index.search(&query_str, prefix != 0, limit.max(1) as usize);
+    match env.new_string(&hits_to_json(&hits)) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
     }
 }
 
-#[cfg(has_dvd)]
+/// Starts a background copy of a volume file into `fd`, which Rust takes over
+/// and closes. Returns a job ID, or negative error code.
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdListChapters(
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_copyFileToFd(
     env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-    dvd_handle: jni::sys::jlong,
-    title_id: jni::sys::jint,
-) -> jni::sys::jstring {
-    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
-    match dvd::list_chapters_json(dvd_handle as u64, title_id) {
-        Ok(json) => env.new_string(&json).map(|s| s.into_raw()).unwrap_or(std::ptr::null_mut()),
+    volume_id: jni::sys::jlong,
+    path: jni::sys::jstring,
+    fd: jni::sys::jint,
+) -> jni::sys::jlong {
+    let mut env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let path_jstr = unsafe { JString::from_raw(path) };
+    let path_str = match env.get_string(&path_jstr) {
+        Ok(s) => s.to_string_lossy().into_owned(),
+        Err(_) => {
+            unsafe { libc_close(fd) };
+            set_last_error("Invalid path");
+            return -(ERR_NOT_FOUND as i64);
+        }
+    };
+    match jobs::copy_file_to_fd(volume_id as u64, &path_str, fd) {
+        Ok(id) => id as i64,
         Err(e) => {
-            set_last_error(&e);
-            std::ptr::null_mut()
+            set_last_error(&e.to_string());
+            if e.kind() == std::io::ErrorKind::NotFound {
+                -(ERR_NOT_FOUND as i64)
+            } else {
+                -(ERR_NTFS as i64)
+            }
         }
     }
 }
 
-#[cfg(has_dvd)]
+/// Closes a descriptor we own but never wrapped in a File.
+unsafe fn libc_close(fd: i32) {
+    use std::os::fd::FromRawFd;
+    drop(std::fs::File::from_raw_fd(fd));
+}
+
+/// Fills `out` with [copied, total] and returns the job state (jobs::JOB_*),
+/// or negative error code. For a failed job the error is in lastError.
 #[no_mangle]
-pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdOpenTitleStream(
-    _env: *mut jni::sys::JNIEnv,
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_copyJobStatus(
+    env: *mut jni::sys::JNIEnv,
     _class: jni::sys::jclass,
-    dvd_handle: jni::sys::jlong,
+    job_id: jni::sys::jlong,
+    out: jni::sys::jlongArray,
+) -> jni::sys::jint {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(status) = jobs::job_status(job_id as u64) else {
+        set_last_error("Job not found");
+        return -ERR_NOT_FOUND;
+    };
+    let out = unsafe { jni::objects::JLongArray::from_raw(out) };
+    let values = [status.copied as i64, status.total as i64];
+    if env.set_long_array_region(&out, 0, &values).is_err() {
+        set_last_error("Invalid status array");
+        return -ERR_TRANSPORT;
+    }
+    if let Some(e) = &status.error {
+        set_last_error(e);
+    }
+    status.state
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cancelCopyJob(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    job_id: jni::sys::jlong,
+) -> jni::sys::jint {
+    if jobs::cancel_job(job_id as u64) {
+        ERR_OK
+    } else {
+        set_last_error("Job not found");
+        -ERR_NOT_FOUND
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_releaseCopyJob(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    job_id: jni::sys::jlong,
+) -> jni::sys::jint {
+    if jobs::release_job(job_id as u64) {
+        ERR_OK
+    } else {
+        set_last_error("Job not found");
+        -ERR_NOT_FOUND
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_getDeviceType(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    session_id: jni::sys::jlong,
+    handler: jni::sys::jobject,
+) -> jni::sys::jstring {
+    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
+    let handler = unsafe { JObject::from_raw(handler) };
+    let transfer = match JniTransferHandler::new(&mut env, handler) {
+        Ok(t) => t,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            return std::ptr::null_mut();
+        }
+    };
+    let dev = ScsiBlockDevice::new_minimal(Box::new(transfer), session_id as u64);
+    match dev.inquiry() {
+        Ok(0x05) => env.new_string("optical").map(|s| s.into_raw()).unwrap_or(std::ptr::null_mut()),
+        Ok(_) => env.new_string("block").map(|s| s.into_raw()).unwrap_or(std::ptr::null_mut()),
+        Err(e) => {
+            set_last_error(&e.to_string());
+            std::ptr::null_mut()
+        }
+    }
+}
+
+/// I/O counters of an open device since it was opened, as a JSON object
+/// (see cache_io_stats_json). Cheap enough to poll while a copy is running.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_getIoStats(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    device_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(cache) = DEVICES.with(device_handle as u64, |d| d.cache()) else {
+        set_last_error("Device not found");
+        return std::ptr::null_mut();
+    };
+    match env.new_string(cache_io_stats_json(&cache)) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// Sets how reads on an open device handle errors: up to `retries` retries
+/// with backoff, bisection of ranges with a medium error (`split_reads`) and
+/// zero-filling of sectors that stay unreadable (`skip_bad_sectors`). All off
+/// (the default) fails reads on the first error.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_setRecoveryPolicy(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    device_handle: jni::sys::jlong,
+    retries: jni::sys::jint,
+    split_reads: jni::sys::jboolean,
+    skip_bad_sectors: jni::sys::jboolean,
+) -> jni::sys::jint {
+    let Some(cache) = DEVICES.with(device_handle as u64, |d| d.cache()) else {
+        set_last_error("Device not found");
+        return -ERR_NOT_FOUND;
+    };
+    cache.recovery().set_policy(recovery_policy(retries, split_reads, skip_bad_sectors));
+    ERR_OK
+}
+
+/// Sectors zero-filled on an open device as a JSON array of [lba, count].
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_getBadSectors(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    device_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(cache) = DEVICES.with(device_handle as u64, |d| d.cache()) else {
+        set_last_error("Device not found");
+        return std::ptr::null_mut();
+    };
+    match env.new_string(cache.recovery().bad_sectors_json()) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+fn recovery_policy(
+    retries: jni::sys::jint,
+    split_reads: jni::sys::jboolean,
+    skip_bad_sectors: jni::sys::jboolean,
+) -> recovery::RecoveryPolicy {
+    recovery::RecoveryPolicy {
+        retries: retries.max(0) as u32,
+        split: split_reads != 0,
+        skip_bad: skip_bad_sectors != 0,
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_lastError(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let msg = LAST_ERROR.with(|e| e.borrow().as_ref().map(|c| c.to_string_lossy().into_owned()));
+    let msg = msg.unwrap_or_else(|| "".to_string());
+    match env.new_string(&msg) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// I/O counters of a device as a JSON object: the SCSI command counters
+/// (see IoStats), "cache":{hits, misses, readahead, evictions, bypass} in
+/// blocks (bypass in reads) and "recovery":{retries, splits, zeroFilled,
+/// badRanges}.
+pub(crate) fn cache_io_stats_json(cache: &block_cache::BlockCache) -> String {
+    use std::fmt::Write;
+    let mut out = String::with_capacity(512);
+    out.push('{');
+    cache.io_stats().write_json(&mut out);
+    let c = cache.stats();
+    let _ = write!(
+        out,
+        r#","cache":{{"hits":{},"misses":{},"readahead":{},"evictions":{},"bypass":{}}},"recovery":{{"#,
+        c.hits, c.misses, c.readahead_blocks, c.evictions, c.bypass_reads
+    );
+    cache.recovery().write_json(&mut out);
+    out.push_str("}}");
+    out
+}
+
+/// JSON array of {n, d, s} objects, built in one buffer with one escaping
+/// pass per name.
+fn entries_to_json(entries: &[DirEntry]) -> String {
+    use std::fmt::Write;
+    let mut out = String::with_capacity(2 + entries.iter().map(|e| e.name.len() + 40).sum::<usize>());
+    out.push('[');
+    for (i, e) in entries.iter().enumerate() {
+        if i > 0 {
+            out.push(',');
+        }
+        out.push_str(r#"{"n":""#);
+        push_json_escaped(&mut out, &e.name);
+        let _ = write!(out, r#"","d":{},"s":{}}}"#, e.is_dir, e.size);
+    }
+    out.push(']');
+    out
+}
+
+fn hits_to_json(hits: &[mft_index::SearchHit]) -> String {
+    use std::fmt::Write;
+    let mut out = String::with_capacity(2 + hits.iter().map(|h| h.path.len() + 40).sum::<usize>());
+    out.push('[');
+    for (i, h) in hits.iter().enumerate() {
+        if i > 0 {
+            out.push(',');
+        }
+        out.push_str(r#"{"p":""#);
+        push_json_escaped(&mut out, &h.path);
+        let _ = write!(out, r#"","d":{},"s":{}}}"#, h.is_dir, h.size);
+    }
+    out.push(']');
+    out
+}
+
+/// Appends `s` as JSON string content. Only ASCII bytes need escaping, so
+/// unescaped runs are copied as whole slices.
+fn push_json_escaped(out: &mut String, s: &str) {
+    use std::fmt::Write;
+    let mut start = 0;
+    for (i, b) in s.bytes().enumerate() {
+        let escaped = match b {
+            b'"' => "\\\"",
+            b'\\' => "\\\\",
+            b'\n' => "\\n",
+            b'\r' => "\\r",
+            b'\t' => "\\t",
+            0x00..=0x1f => "",
+            _ => continue,
+        };
+        out.push_str(&s[start..i]);
+        if escaped.is_empty() {
+            let _ = write!(out, "\\u{:04x}", b);
+        } else {
+            out.push_str(escaped);
+        }
+        start = i + 1;
+    }
+    out.push_str(&s[start..]);
+}
+
+// --- Audio CD JNI entry points ---
+
+/// Opens the audio CD in an optical drive (READ TOC, drive to full speed).
+/// Returns a CD handle, or -1 (e.g. no audio tracks).
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openCd(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    session_id: jni::sys::jlong,
+    handler: jni::sys::jobject,
+) -> jni::sys::jlong {
+    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
+    let handler = unsafe { JObject::from_raw(handler) };
+    let transfer = match JniTransferHandler::new(&mut env, handler) {
+        Ok(t) => t,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            return -1;
+        }
+    };
+    match cdda::open_cd(session_id as u64, Box::new(transfer)) {
+        Ok(id) => id as i64,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            -1
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeCd(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    cd_handle: jni::sys::jlong,
+) {
+    cdda::close_cd(cd_handle as u64);
+}
+
+/// The disc's TOC as JSON: {"leadOut", "tracks":[{number, start, sectors,
+/// durationMs, audio}]}, or null.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdGetToc(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    cd_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(json) = cdda::toc_json(cd_handle as u64) else {
+        set_last_error("CD handle not found");
+        return std::ptr::null_mut();
+    };
+    match env.new_string(&json) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// Command counters of the drive as in getIoStats, plus "cdda":{reads,
+/// corrections, unmatched, retries} of the jitter correction.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdGetIoStats(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    cd_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(json) = cdda::io_stats_json(cd_handle as u64) else {
+        set_last_error("CD handle not found");
+        return std::ptr::null_mut();
+    };
+    match env.new_string(&json) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// Opens an audio track as a WAV stream for cdStartPump. Returns stream ID, or -1.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdOpenTrackStream(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    cd_handle: jni::sys::jlong,
+    track: jni::sys::jint,
+) -> jni::sys::jlong {
+    match cdda::open_track_stream(cd_handle as u64, track.clamp(0, 99) as u8) {
+        Ok(stream_id) => stream_id as i64,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            -1
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdCloseStream(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    stream_id: jni::sys::jlong,
+) {
+    cdda::close_stream(stream_id as u64);
+}
+
+/// Starts a pump thread writing the track stream into `fd`, the write end of
+/// the player's pipe; Rust takes over the descriptor. Returns pump ID, or -1.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdStartPump(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    stream_id: jni::sys::jlong,
+    fd: jni::sys::jint,
+) -> jni::sys::jlong {
+    match cdda::start_pump(stream_id as u64, fd) {
+        Ok(pump_id) => pump_id as i64,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            -1
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdPumpSeekTime(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    pump_id: jni::sys::jlong,
+    time_ms: jni::sys::jlong,
+) -> jni::sys::jboolean {
+    match cdda::pump_seek_time(pump_id as u64, time_ms.max(0) as u64) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
+/// Stops a pump and joins its thread. Returns false if it had failed (see lastError).
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdStopPump(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    pump_id: jni::sys::jlong,
+) -> jni::sys::jboolean {
+    match cdda::stop_pump(pump_id as u64) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
+/// Starts ripping an audio track as WAV into `fd`, which Rust takes over.
+/// Returns a job ID for copyJobStatus, cancelCopyJob and releaseCopyJob, or -1.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_cdRipTrack(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    cd_handle: jni::sys::jlong,
+    track: jni::sys::jint,
+    fd: jni::sys::jint,
+) -> jni::sys::jlong {
+    match cdda::rip_track(cd_handle as u64, track.clamp(0, 99) as u8, fd) {
+        Ok(job_id) => job_id as i64,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            -1
+        }
+    }
+}
+
+// --- DVD JNI entry points (when has_dvd) ---
+
+/// Sets the CSS title-key cache root once per process (see
+/// dvd::css_cache); call right after loading the library. Returns ERR_OK, or
+/// -1 if a root was already set. A no-op without DVD support.
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_setCssCacheDir(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dir: jni::sys::jstring,
+) -> jni::sys::jint {
+    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
+    let dir_jstr = unsafe { JString::from_raw(dir) };
+    let dir = match env.get_string(&dir_jstr) {
+        Ok(s) => s.to_string_lossy().into_owned(),
+        Err(_) => String::new(),
+    };
+    #[cfg(has_dvd)]
+    if !dvd::css_cache::set_cache_root(dir.as_ref()) {
+        set_last_error("CSS cache root already set");
+        return -1;
+    }
+    #[cfg(not(has_dvd))]
+    let _ = dir;
+    ERR_OK
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_openDvd(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    session_id: jni::sys::jlong,
+    handler: jni::sys::jobject,
+) -> jni::sys::jlong {
+    let mut env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
+    let handler = unsafe { JObject::from_raw(handler) };
+    let transfer = match JniTransferHandler::new(&mut env, handler) {
+        Ok(t) => t,
+        Err(e) => {
+            set_last_error(&e.to_string());
+            return -1;
+        }
+    };
+    match dvd::open_dvd(session_id as u64, Box::new(transfer)) {
+        Ok(id) => id as i64,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_closeDvd(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+) {
+    dvd::close_dvd(dvd_handle as u64);
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdMetadataSize(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+) -> jni::sys::jint {
+    match dvd::metadata_size(dvd_handle as u64) {
+        Ok(n) => n as i32,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdReadMetadata(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+    buffer: jni::sys::jobject,
+) -> jni::sys::jint {
+    let env = unsafe { jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw") };
+    let buffer = unsafe { jni::objects::JByteBuffer::from_raw(buffer) };
+    let (ptr, cap) = match (
+        env.get_direct_buffer_address(&buffer),
+        env.get_direct_buffer_capacity(&buffer),
+    ) {
+        (Ok(p), Ok(c)) if !p.is_null() => (p, c),
+        _ => {
+            set_last_error("Metadata buffer must be a direct ByteBuffer");
+            return -1;
+        }
+    };
+    let buf = unsafe { std::slice::from_raw_parts_mut(ptr, cap) };
+    match dvd::export_metadata(dvd_handle as u64, buf) {
+        Ok(n) => n as i32,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdOpenTitleStream(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
     title_id: jni::sys::jint,
 ) -> jni::sys::jlong {
     match dvd::open_title_stream(dvd_handle as u64, title_id) {
@@ -361,8 +1147,9 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdRea
     let mut buf = vec![0u8; len];
     match dvd::read_stream(stream_id as u64, &mut buf) {
         Ok(n) => {
-            let i8_buf: Vec<i8> = buf[..n].iter().map(|&b| b as i8).collect();
-            let _ = env.set_byte_array_region(&buffer_obj, 0, &i8_buf);
+            // Same bytes reinterpreted as jbyte; no second buffer.
+            let i8_buf = unsafe { std::slice::from_raw_parts(buf.as_ptr() as *const i8, n) };
+            let _ = env.set_byte_array_region(&buffer_obj, 0, i8_buf);
             n as i32
         }
         Err(e) => {
@@ -389,6 +1176,110 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdSee
     }
 }
 
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdSeekChapter(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    stream_id: jni::sys::jlong,
+    chapter: jni::sys::jint,
+) -> jni::sys::jboolean {
+    match dvd::seek_chapter(stream_id as u64, chapter.max(0) as u32) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e);
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdSeekTime(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    stream_id: jni::sys::jlong,
+    time_ms: jni::sys::jlong,
+) -> jni::sys::jboolean {
+    match dvd::seek_time(stream_id as u64, time_ms.max(0) as u64) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e);
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
+/// Starts a Rust thread that writes the stream into `fd`, the write end of
+/// the player's pipe; Rust takes over the descriptor. Returns pump ID, or -1.
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdStartPump(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    stream_id: jni::sys::jlong,
+    fd: jni::sys::jint,
+) -> jni::sys::jlong {
+    match dvd::start_pump(stream_id as u64, fd) {
+        Ok(pump_id) => pump_id as i64,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdPumpSeekTime(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    pump_id: jni::sys::jlong,
+    time_ms: jni::sys::jlong,
+) -> jni::sys::jboolean {
+    match dvd::pump_seek_time(pump_id as u64, time_ms.max(0) as u64) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e);
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdPumpSeekChapter(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    pump_id: jni::sys::jlong,
+    chapter: jni::sys::jint,
+) -> jni::sys::jboolean {
+    match dvd::pump_seek_chapter(pump_id as u64, chapter.max(0) as u32) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e);
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
+/// Stops a pump and joins its thread. Returns false if it had failed (see lastError).
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdStopPump(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    pump_id: jni::sys::jlong,
+) -> jni::sys::jboolean {
+    match dvd::stop_pump(pump_id as u64) {
+        Ok(()) => jni::sys::JNI_TRUE,
+        Err(e) => {
+            set_last_error(&e);
+            jni::sys::JNI_FALSE
+        }
+    }
+}
+
 #[cfg(has_dvd)]
 #[no_mangle]
 pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdCloseStream(
@@ -398,3 +1289,126 @@ pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdClo
 ) {
     dvd::close_stream(stream_id as u64);
 }
+
+/// Starts extracting chapters firstChapter..=lastChapter (1-based, 0 = last)
+/// of a title, decrypted, into `fd`, which Rust takes over. With resumeBytes
+/// > 0 the file's first resumeBytes (block-aligned) are kept and the copy
+/// continues after them. Returns a job ID for copyJobStatus, cancelCopyJob
+/// and releaseCopyJob, or -1.
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdExtractTitle(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+    title_id: jni::sys::jint,
+    first_chapter: jni::sys::jint,
+    last_chapter: jni::sys::jint,
+    resume_bytes: jni::sys::jlong,
+    fd: jni::sys::jint,
+) -> jni::sys::jlong {
+    match dvd::extract_title(
+        dvd_handle as u64,
+        title_id,
+        first_chapter.max(0) as u32,
+        last_chapter.max(0) as u32,
+        resume_bytes.max(0) as u64,
+        fd,
+    ) {
+        Ok(job_id) => job_id as i64,
+        Err(e) => {
+            set_last_error(&e);
+            -1
+        }
+    }
+}
+
+/// I/O counters of an open disc as a JSON object: those of getIoStats plus
+/// "readahead":{chunks, stalls, stallUs, seeks, warmHits} of its title streams.
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdGetIoStats(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(json) = dvd::io_stats_json(dvd_handle as u64) else {
+        set_last_error("DVD handle not found");
+        return std::ptr::null_mut();
+    };
+    match env.new_string(&json) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+/// setRecoveryPolicy for the device of an open disc.
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdSetRecoveryPolicy(
+    _env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+    retries: jni::sys::jint,
+    split_reads: jni::sys::jboolean,
+    skip_bad_sectors: jni::sys::jboolean,
+) -> jni::sys::jint {
+    let policy = recovery_policy(retries, split_reads, skip_bad_sectors);
+    if dvd::set_recovery_policy(dvd_handle as u64, policy) {
+        ERR_OK
+    } else {
+        set_last_error("DVD handle not found");
+        -ERR_NOT_FOUND
+    }
+}
+
+/// getBadSectors for the device of an open disc (LBAs in 2048-byte blocks).
+#[cfg(has_dvd)]
+#[no_mangle]
+pub extern "system" fn Java_com_bleist_connectias_connectias_NativeBridge_dvdGetBadSectors(
+    env: *mut jni::sys::JNIEnv,
+    _class: jni::sys::jclass,
+    dvd_handle: jni::sys::jlong,
+) -> jni::sys::jstring {
+    let env = unsafe {
+        jni::JNIEnv::from_raw(env).expect("JNIEnv from_raw")
+    };
+    let Some(json) = dvd::bad_sectors_json(dvd_handle as u64) else {
+        set_last_error("DVD handle not found");
+        return std::ptr::null_mut();
+    };
+    match env.new_string(&json) {
+        Ok(s) => s.into_raw(),
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn entry(name: &str, is_dir: bool, size: u64) -> DirEntry {
+        DirEntry { name: name.to_string(), is_dir, size }
+    }
+
+    #[test]
+    fn entries_json_escapes_names() {
+        assert_eq!(entries_to_json(&[]), "[]");
+        let json = entries_to_json(&[
+            entry("a \"b\"\\c", false, 3),
+            entry("tab\tnl\nbell\u{7}", true, 0),
+            entry("Größe ✓", false, 1 << 40),
+        ]);
+        assert_eq!(
+            json,
+            concat!(
+                r#"[{"n":"a \"b\"\\c","d":false,"s":3},"#,
+                r#"{"n":"tab\tnl\nbell\u0007","d":true,"s":0},"#,
+                r#"{"n":"Größe ✓","d":false,"s":1099511627776}]"#,
+            )
+        );
+    }
+}
@@ -0,0 +1,642 @@
+//! Whole-volume file search from a sequential $MFT scan.
+//! A background thread reads $MFT in large transfers (the volume is locked
+//! per chunk, like a copy job) and decodes the $FILE_NAME and $DATA
+//! attributes of each record into a compact index: parent record, name,
+//! size and directory flag. Paths are rebuilt from parent links on demand.
+//! The finished index is saved per volume serial, so a remount loads it
+//! instead of rescanning.
+//! A fragmented $MFT whose extents spill into an $ATTRIBUTE_LIST has no
+//! single run list; it is then read through the ntfs crate's stream, which
+//! follows the list, in the same chunks but with more per-chunk overhead.
+
+use crate::dentry_cache;
+use crate::ntfs_file::DataRun;
+use std::fs::File;
+use std::io::{self, BufReader, BufWriter, Read, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicI32, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+pub const INDEX_NONE: i32 = 0;
+pub const INDEX_RUNNING: i32 = 1;
+pub const INDEX_READY: i32 = 2;
+pub const INDEX_FAILED: i32 = 3;
+
+/// Bytes of $MFT per volume read.
+const SCAN_CHUNK: usize = 1024 * 1024;
+const ROOT_RECORD: u64 = 5;
+/// $Volume: Windows rewrites its flags on every read-write mount.
+const VOLUME_RECORD: u64 = 3;
+/// Records below this are reserved for metadata files ($MFT, $Extend, ...).
+const FIRST_USER_RECORD: u64 = 16;
+/// Parent links followed before a path is treated as broken.
+const MAX_DEPTH: usize = 256;
+const SAVE_MAGIC: &[u8; 8] = b"CNXMFT01";
+
+const ATTR_FILE_NAME: u32 = 0x30;
+const ATTR_DATA: u32 = 0x80;
+const ATTR_END: u32 = 0xFFFF_FFFF;
+const RECORD_IN_USE: u16 = 0x01;
+const RECORD_IS_DIR: u16 = 0x02;
+const NAMESPACE_DOS: u8 = 2;
+/// Record numbers are the low 48 bits of a file reference.
+const REF_MASK: u64 = 0x0000_FFFF_FFFF_FFFF;
+
+/// Where $MFT lives, from NtfsVolume::mft_layout.
+pub struct MftLayout {
+    /// None when $MFT's extents are listed in an $ATTRIBUTE_LIST.
+    pub runs: Option<Vec<DataRun>>,
+    pub size: u64,
+    pub record_size: usize,
+    pub serial: u64,
+}
+
+struct Entry {
+    record: u64,
+    parent: u64,
+    size: u64,
+    is_dir: bool,
+    /// (start, len) in `names` and in `keys`.
+    name: (u32, u32),
+    key: (u32, u32),
+}
+
+pub struct MftIndex {
+    serial: u64,
+    /// Log sequence number of $Volume when the index was built.
+    stamp: u64,
+    /// Sorted by record number.
+    entries: Vec<Entry>,
+    names: String,
+    /// Names folded like dentry_cache::path_key, for case-insensitive search.
+    keys: String,
+}
+
+pub struct SearchHit {
+    pub path: String,
+    pub is_dir: bool,
+    pub size: u64,
+}
+
+impl MftIndex {
+    fn new(serial: u64, stamp: u64) -> Self {
+        Self {
+            serial,
+            stamp,
+            entries: Vec::new(),
+            names: String::new(),
+            keys: String::new(),
+        }
+    }
+
+    fn push_name(&mut self, name: &str) -> ((u32, u32), (u32, u32)) {
+        let key = dentry_cache::path_key(&[name]);
+        let n = (self.names.len() as u32, name.len() as u32);
+        let k = (self.keys.len() as u32, key.len() as u32);
+        self.names.push_str(name);
+        self.keys.push_str(&key);
+        (n, k)
+    }
+
+    fn position(&self, record: u64) -> Option<usize> {
+        self.entries.binary_search_by_key(&record, |e| e.record).ok()
+    }
+
+    fn name(&self, e: &Entry) -> &str {
+        &self.names[e.name.0 as usize..(e.name.0 + e.name.1) as usize]
+    }
+
+    fn key(&self, e: &Entry) -> &str {
+        &self.keys[e.key.0 as usize..(e.key.0 + e.key.1) as usize]
+    }
+
+    /// Files and directories whose name starts with (or, unless `prefix`,
+    /// contains) `query`, ignoring case. At most `limit` hits, in record order.
+    pub fn search(&self, query: &str, prefix: bool, limit: usize) -> Vec<SearchHit> {
+        let q = dentry_cache::path_key(&[query]);
+        let mut hits = Vec::new();
+        for e in &self.entries {
+            if hits.len() >= limit {
+                break;
+            }
+            if e.record < FIRST_USER_RECORD || e.name.1 == 0 {
+                continue;
+            }
+            let key = self.key(e);
+            let matched = if prefix { key.starts_with(&q) } else { key.contains(&q) };
+            if !matched {
+                continue;
+            }
+            if let Some(path) = self.path_of(e) {
+                hits.push(SearchHit { path, is_dir: e.is_dir, size: e.size });
+            }
+        }
+        hits
+    }
+
+    /// Path from the root, or None for orphans and entries under metadata directories.
+    fn path_of(&self, e: &Entry) -> Option<String> {
+        let mut parts = vec![self.name(e)];
+        let mut parent = e.parent;
+        while parent != ROOT_RECORD {
+            if parent < FIRST_USER_RECORD || parts.len() > MAX_DEPTH {
+                return None;
+            }
+            let p = &self.entries[self.position(parent)?];
+            if !p.is_dir || p.name.1 == 0 {
+                return None;
+            }
+            parts.push(self.name(p));
+            parent = p.parent;
+        }
+        parts.reverse();
+        Some(parts.join("/"))
+    }
+
+    fn save(&self, path: &Path) -> io::Result<()> {
+        let tmp = path.with_extension("tmp");
+        let mut w = BufWriter::new(File::create(&tmp)?);
+        w.write_all(SAVE_MAGIC)?;
+        w.write_all(&self.serial.to_le_bytes())?;
+        w.write_all(&self.stamp.to_le_bytes())?;
+        w.write_all(&(self.entries.len() as u64).to_le_bytes())?;
+        for e in &self.entries {
+            let name = self.name(e).as_bytes();
+            w.write_all(&e.record.to_le_bytes())?;
+            w.write_all(&e.parent.to_le_bytes())?;
+            w.write_all(&e.size.to_le_bytes())?;
+            w.write_all(&[e.is_dir as u8])?;
+            w.write_all(&(name.len() as u16).to_le_bytes())?;
+            w.write_all(name)?;
+        }
+        w.into_inner().map_err(|e| e.into_error())?.sync_all()?;
+        std::fs::rename(tmp, path)
+    }
+
+    /// Saved index for this volume, or None if missing or built before the
+    /// volume last changed.
+    fn load(path: &Path, serial: u64, stamp: u64) -> io::Result<Option<Self>> {
+        let mut r = match File::open(path) {
+            Ok(f) => BufReader::new(f),
+            Err(e) if e.kind() == io::ErrorKind::NotFound => return Ok(None),
+            Err(e) => return Err(e),
+        };
+        let mut magic = [0u8; 8];
+        r.read_exact(&mut magic)?;
+        if &magic != SAVE_MAGIC || read_u64(&mut r)? != serial || read_u64(&mut r)? != stamp {
+            return Ok(None);
+        }
+        let count = read_u64(&mut r)?;
+        let mut index = Self::new(serial, stamp);
+        let mut name = Vec::new();
+        for _ in 0..count {
+            let record = read_u64(&mut r)?;
+            let parent = read_u64(&mut r)?;
+            let size = read_u64(&mut r)?;
+            let mut head = [0u8; 3];
+            r.read_exact(&mut head)?;
+            name.resize(u16::from_le_bytes([head[1], head[2]]) as usize, 0);
+            r.read_exact(&mut name)?;
+            let name = std::str::from_utf8(&name)
+                .map_err(|_| io::Error::new(io::ErrorKind::InvalidData, "Bad name in saved index"))?;
+            let (name, key) = index.push_name(name);
+            index.entries.push(Entry { record, parent, size, is_dir: head[0] != 0, name, key });
+        }
+        Ok(Some(index))
+    }
+
+    /// Adds the names and size found in one FILE record. Extension records
+    /// (attributes that overflowed the base record) update their base entry;
+    /// one scanned before its base (a reused lower slot) goes to `deferred`
+    /// for merge_deferred.
+    fn add_record(&mut self, record: u64, buf: &mut [u8], deferred: &mut Vec<Extension>) {
+        let Some(parsed) = parse_record(buf) else { return };
+        if parsed.base == 0 {
+            let (name, key) = match &parsed.name {
+                Some((_, n)) => self.push_name(n),
+                None => ((0, 0), (0, 0)),
+            };
+            self.entries.push(Entry {
+                record,
+                parent: parsed.name.as_ref().map_or(0, |(p, _)| *p),
+                size: parsed.size.unwrap_or(0),
+                is_dir: parsed.is_dir,
+                name,
+                key,
+            });
+            return;
+        }
+        let ext = Extension { base: parsed.base, name: parsed.name, size: parsed.size };
+        match self.position(ext.base) {
+            Some(i) => self.merge(i, ext),
+            None => deferred.push(ext),
+        }
+    }
+
+    /// Applies extension records whose base came later in the scan. Those
+    /// whose base is free or unreadable are dropped.
+    fn merge_deferred(&mut self, deferred: Vec<Extension>) {
+        for ext in deferred {
+            if let Some(i) = self.position(ext.base) {
+                self.merge(i, ext);
+            }
+        }
+    }
+
+    fn merge(&mut self, i: usize, ext: Extension) {
+        if self.entries[i].name.1 == 0 {
+            if let Some((parent, n)) = &ext.name {
+                let (name, key) = self.push_name(n);
+                let e = &mut self.entries[i];
+                e.parent = *parent;
+                e.name = name;
+                e.key = key;
+            }
+        }
+        if let Some(size) = ext.size {
+            self.entries[i].size = size;
+        }
+    }
+}
+
+/// What an extension record adds to its base entry.
+struct Extension {
+    base: u64,
+    name: Option<(u64, String)>,
+    size: Option<u64>,
+}
+
+struct ParsedRecord {
+    /// Base record number; 0 for a base record.
+    base: u64,
+    is_dir: bool,
+    /// (parent record, name), preferring long names over DOS 8.3 ones.
+    name: Option<(u64, String)>,
+    /// Size of the unnamed $DATA stream, if this record holds its first extent.
+    size: Option<u64>,
+}
+
+/// Decodes a FILE record in place (applying the update sequence fixups).
+/// None for free, torn or malformed records.
+fn parse_record(buf: &mut [u8]) -> Option<ParsedRecord> {
+    if buf.len() < 48 || &buf[0..4] != b"FILE" {
+        return None;
+    }
+    apply_fixups(buf)?;
+    let flags = u16_at(buf, 22)?;
+    if flags & RECORD_IN_USE == 0 {
+        return None;
+    }
+    let mut parsed = ParsedRecord {
+        base: u64_at(buf, 32)? & REF_MASK,
+        is_dir: flags & RECORD_IS_DIR != 0,
+        name: None,
+        size: None,
+    };
+    let mut name_is_dos = false;
+    let used = std::cmp::min(u32_at(buf, 24)? as usize, buf.len());
+    let mut off = u16_at(buf, 20)? as usize;
+    while off + 16 <= used {
+        let kind = u32_at(buf, off)?;
+        let len = u32_at(buf, off + 4)? as usize;
+        if kind == ATTR_END || len < 16 || off + len > used {
+            break;
+        }
+        let attr = &buf[off..off + len];
+        let non_resident = attr[8] != 0;
+        let attr_name_len = attr[9];
+        match kind {
+            ATTR_FILE_NAME if !non_resident => {
+                if let Some((parent, ns, name)) = parse_file_name(attr) {
+                    if parsed.name.is_none() || (name_is_dos && ns != NAMESPACE_DOS) {
+                        parsed.name = Some((parent, name));
+                        name_is_dos = ns == NAMESPACE_DOS;
+                    }
+                }
+            }
+            ATTR_DATA if attr_name_len == 0 => {
+                parsed.size = if non_resident {
+                    // Only the extent starting at VCN 0 carries the stream size.
+                    (u64_at(attr, 16)? == 0).then(|| u64_at(attr, 48)).flatten()
+                } else {
+                    u32_at(attr, 16).map(|n| n as u64)
+                };
+            }
+            _ => {}
+        }
+        off += len;
+    }
+    Some(parsed)
+}
+
+/// Initialized (valid data) size of the non-resident attribute at
+/// `attr_offset` of a raw FILE record, applying the fixups first.
+pub fn initialized_size(buf: &mut [u8], attr_offset: usize) -> Option<u64> {
+    if buf.len() < 48 || &buf[0..4] != b"FILE" {
+        return None;
+    }
+    apply_fixups(buf)?;
+    let attr = buf.get(attr_offset..)?;
+    if attr.len() < 64 || attr[8] == 0 {
+        return None;
+    }
+    u64_at(attr, 56)
+}
+
+/// (parent record, namespace, name) of a resident $FILE_NAME attribute.
+fn parse_file_name(attr: &[u8]) -> Option<(u64, u8, String)> {
+    let value_len = u32_at(attr, 16)? as usize;
+    let value_off = u16_at(attr, 20)? as usize;
+    let value = attr.get(value_off..value_off + value_len)?;
+    if value.len() < 66 {
+        return None;
+    }
+    let parent = u64_at(value, 0)? & REF_MASK;
+    let chars = value[64] as usize;
+    let units: Vec<u16> = value
+        .get(66..66 + chars * 2)?
+        .chunks_exact(2)
+        .map(|c| u16::from_le_bytes([c[0], c[1]]))
+        .collect();
+    Some((parent, value[65], String::from_utf16_lossy(&units)))
+}
+
+/// Restores the last two bytes of each 512-byte stride from the update
+/// sequence array; fails if a stride doesn't carry the sequence number.
+fn apply_fixups(buf: &mut [u8]) -> Option<()> {
+    let usa_off = u16_at(buf, 4)? as usize;
+    let usa_count = u16_at(buf, 6)? as usize;
+    if usa_count == 0 || usa_off + usa_count * 2 > buf.len() {
+        return None;
+    }
+    let usn = [buf[usa_off], buf[usa_off + 1]];
+    for i in 1..usa_count {
+        let end = i * 512;
+        if end > buf.len() {
+            return None;
+        }
+        if buf[end - 2..end] != usn {
+            return None;
+        }
+        buf[end - 2] = buf[usa_off + i * 2];
+        buf[end - 1] = buf[usa_off + i * 2 + 1];
+    }
+    Some(())
+}
+
+fn u16_at(b: &[u8], off: usize) -> Option<u16> {
+    Some(u16::from_le_bytes(b.get(off..off + 2)?.try_into().ok()?))
+}
+
+fn u32_at(b: &[u8], off: usize) -> Option<u32> {
+    Some(u32::from_le_bytes(b.get(off..off + 4)?.try_into().ok()?))
+}
+
+fn u64_at(b: &[u8], off: usize) -> Option<u64> {
+    Some(u64::from_le_bytes(b.get(off..off + 8)?.try_into().ok()?))
+}
+
+fn read_u64(r: &mut impl Read) -> io::Result<u64> {
+    let mut b = [0u8; 8];
+    r.read_exact(&mut b)?;
+    Ok(u64::from_le_bytes(b))
+}
+
+/// Progress and result of a volume's indexing, shared with the scan thread.
+pub struct Indexer {
+    state: AtomicI32,
+    scanned: AtomicU64,
+    total: AtomicU64,
+    index: Mutex<Option<Arc<MftIndex>>>,
+    error: Mutex<Option<String>>,
+}
+
+pub struct IndexStatus {
+    pub state: i32,
+    /// Records scanned and records in $MFT.
+    pub scanned: u64,
+    pub total: u64,
+    pub error: Option<String>,
+}
+
+impl Indexer {
+    pub fn new() -> Self {
+        Self {
+            state: AtomicI32::new(INDEX_NONE),
+            scanned: AtomicU64::new(0),
+            total: AtomicU64::new(0),
+            index: Mutex::new(None),
+            error: Mutex::new(None),
+        }
+    }
+
+    pub fn status(&self) -> IndexStatus {
+        IndexStatus {
+            state: self.state.load(Ordering::Acquire),
+            scanned: self.scanned.load(Ordering::Relaxed),
+            total: self.total.load(Ordering::Relaxed),
+            error: self.error.lock().unwrap().clone(),
+        }
+    }
+
+    pub fn index(&self) -> Option<Arc<MftIndex>> {
+        self.index.lock().unwrap().clone()
+    }
+
+    fn finish(&self, result: io::Result<MftIndex>) {
+        match result {
+            Ok(index) => {
+                *self.index.lock().unwrap() = Some(Arc::new(index));
+                self.state.store(INDEX_READY, Ordering::Release);
+            }
+            Err(e) => {
+                *self.error.lock().unwrap() = Some(e.to_string());
+                self.state.store(INDEX_FAILED, Ordering::Release);
+            }
+        }
+    }
+}
+
+/// Starts indexing the volume in the background, loading a saved index from
+/// `dir` unless `rebuild`. No-op while a scan runs or once an index is ready
+/// (unless `rebuild`).
+pub fn start(volume_id: u64, dir: PathBuf, rebuild: bool) -> io::Result<()> {
+    let started = crate::VOLUMES
+        .with(volume_id, |v| -> io::Result<_> {
+            let state = v.mft_indexer().state.load(Ordering::Acquire);
+            if state == INDEX_RUNNING || (state == INDEX_READY && !rebuild) {
+                return Ok(None);
+            }
+            let layout = v.mft_layout()?;
+            let indexer = Arc::new(Indexer::new());
+            indexer.state.store(INDEX_RUNNING, Ordering::Release);
+            indexer
+                .total
+                .store(layout.size / layout.record_size as u64, Ordering::Relaxed);
+            v.set_mft_indexer(Arc::clone(&indexer));
+            Ok(Some((indexer, layout)))
+        })
+        .unwrap_or_else(|| Err(io::Error::new(io::ErrorKind::NotFound, "Volume not found")))?;
+    let Some((indexer, layout)) = started else {
+        return Ok(());
+    };
+    let worker = Arc::clone(&indexer);
+    let spawned = std::thread::Builder::new()
+        .name("mft-index".to_string())
+        .spawn(move || worker.finish(build(volume_id, &layout, &worker, &dir, rebuild)));
+    if let Err(e) = spawned {
+        indexer.finish(Err(io::Error::new(e.kind(), e.to_string())));
+        return Err(e);
+    }
+    Ok(())
+}
+
+fn read_mft(volume_id: u64, layout: &MftLayout, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+    crate::VOLUMES
+        .with(volume_id, |v| match &layout.runs {
+            Some(runs) => crate::ntfs_file::read_runs(v.reader(), runs, layout.size, layout.size, offset, buf),
+            None => v.read_mft_stream(offset, buf),
+        })
+        .unwrap_or_else(|| Err(io::Error::new(io::ErrorKind::NotFound, "Volume closed")))
+}
+
+fn build(
+    volume_id: u64,
+    layout: &MftLayout,
+    indexer: &Indexer,
+    dir: &Path,
+    rebuild: bool,
+) -> io::Result<MftIndex> {
+    let rs = layout.record_size;
+    let mut record = vec![0u8; rs];
+    let n = read_mft(volume_id, layout, VOLUME_RECORD * rs as u64, &mut record)?;
+    // The record's $LogFile sequence number moves whenever the volume is mounted read-write.
+    let stamp = if n == rs { u64_at(&record, 8).unwrap_or(0) } else { 0 };
+    let saved = dir.join(format!("{:016x}.mft", layout.serial));
+    if !rebuild {
+        // A damaged file just means a rescan.
+        if let Ok(Some(index)) = MftIndex::load(&saved, layout.serial, stamp) {
+            let total = indexer.total.load(Ordering::Relaxed);
+            indexer.scanned.store(total, Ordering::Relaxed);
+            return Ok(index);
+        }
+    }
+
+    let mut index = MftIndex::new(layout.serial, stamp);
+    let mut deferred = Vec::new();
+    let chunk = std::cmp::max(SCAN_CHUNK / rs, 1) * rs;
+    let mut buf = vec![0u8; chunk];
+    let mut offset = 0u64;
+    while offset < layout.size {
+        let n = read_mft(volume_id, layout, offset, &mut buf)?;
+        if n == 0 {
+            break;
+        }
+        let first = offset / rs as u64;
+        for (i, rec) in buf[..n - n % rs].chunks_exact_mut(rs).enumerate() {
+            index.add_record(first + i as u64, rec, &mut deferred);
+        }
+        offset += n as u64;
+        indexer.scanned.store(offset / rs as u64, Ordering::Relaxed);
+    }
+    index.merge_deferred(deferred);
+    // Only search speed depends on the saved copy.
+    let _ = std::fs::create_dir_all(dir).and_then(|_| index.save(&saved));
+    Ok(index)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const RECORD: usize = 1024;
+    const FIRST_ATTR: usize = 56;
+
+    /// A FILE record in on-disk form (update sequence applied) holding an
+    /// optional $FILE_NAME (parent, name) and an optional $DATA of `size`.
+    fn record(base: u64, name: Option<(u64, &str)>, size: Option<u64>) -> Vec<u8> {
+        let mut r = vec![0u8; RECORD];
+        r[0..4].copy_from_slice(b"FILE");
+        r[4..6].copy_from_slice(&48u16.to_le_bytes());
+        r[6..8].copy_from_slice(&3u16.to_le_bytes());
+        r[20..22].copy_from_slice(&(FIRST_ATTR as u16).to_le_bytes());
+        r[22..24].copy_from_slice(&RECORD_IN_USE.to_le_bytes());
+        r[32..40].copy_from_slice(&base.to_le_bytes());
+        let mut off = FIRST_ATTR;
+        if let Some((parent, name)) = name {
+            let units: Vec<u16> = name.encode_utf16().collect();
+            let value_len = 66 + units.len() * 2;
+            let len = (24 + value_len + 7) & !7;
+            let a = &mut r[off..off + len];
+            a[0..4].copy_from_slice(&ATTR_FILE_NAME.to_le_bytes());
+            a[4..8].copy_from_slice(&(len as u32).to_le_bytes());
+            a[16..20].copy_from_slice(&(value_len as u32).to_le_bytes());
+            a[20..22].copy_from_slice(&24u16.to_le_bytes());
+            let v = &mut a[24..24 + value_len];
+            v[0..8].copy_from_slice(&parent.to_le_bytes());
+            v[64] = units.len() as u8;
+            v[65] = 1; // Win32 namespace
+            for (i, u) in units.iter().enumerate() {
+                v[66 + i * 2..68 + i * 2].copy_from_slice(&u.to_le_bytes());
+            }
+            off += len;
+        }
+        if let Some(size) = size {
+            let a = &mut r[off..off + 72];
+            a[0..4].copy_from_slice(&ATTR_DATA.to_le_bytes());
+            a[4..8].copy_from_slice(&72u32.to_le_bytes());
+            a[8] = 1;
+            a[48..56].copy_from_slice(&size.to_le_bytes());
+            off += 72;
+        }
+        r[off..off + 4].copy_from_slice(&ATTR_END.to_le_bytes());
+        r[24..28].copy_from_slice(&((off + 8) as u32).to_le_bytes());
+        r[48..50].copy_from_slice(&[7, 0]);
+        for i in 1..3 {
+            let end = i * 512;
+            let (last, usa) = (end - 2, 48 + i * 2);
+            r.copy_within(last..end, usa);
+            r[last..end].copy_from_slice(&[7, 0]);
+        }
+        r
+    }
+
+    fn scan(records: &[(u64, Vec<u8>)]) -> MftIndex {
+        let mut index = MftIndex::new(1, 1);
+        let mut deferred = Vec::new();
+        for (number, r) in records {
+            index.add_record(*number, &mut r.clone(), &mut deferred);
+        }
+        index.merge_deferred(deferred);
+        index
+    }
+
+    fn hit(index: &MftIndex, query: &str) -> Vec<(String, u64)> {
+        index.search(query, true, 10).into_iter().map(|h| (h.path, h.size)).collect()
+    }
+
+    #[test]
+    fn extension_records_update_their_base() {
+        let index = scan(&[
+            (40, record(0, Some((ROOT_RECORD, "movie.mkv")), None)),
+            (41, record(40, None, Some(7_000_000))),
+        ]);
+        assert_eq!(hit(&index, "MOVIE"), [("movie.mkv".to_string(), 7_000_000)]);
+    }
+
+    #[test]
+    fn extension_records_scanned_before_their_base_are_kept() {
+        // Reused lower slots: one extension holds the base's only name and
+        // its data, another only the data of a base with its own name.
+        let index = scan(&[
+            (20, record(50, Some((ROOT_RECORD, "big.bin")), Some(12_345))),
+            (21, record(51, None, Some(99))),
+            (50, record(0, None, None)),
+            (51, record(0, Some((ROOT_RECORD, "named.txt")), None)),
+        ]);
+        assert_eq!(hit(&index, "big"), [("big.bin".to_string(), 12_345)]);
+        assert_eq!(hit(&index, "named"), [("named.txt".to_string(), 99)]);
+        // Extensions are not entries of their own.
+        assert_eq!(index.entries.iter().map(|e| e.record).collect::<Vec<_>>(), [50, 51]);
+    }
+}
@@ -1,35 +1,43 @@
 //! Read+Seek adapter for NTFS over SCSI block device.
 
-use crate::block_device::ScsiBlockDevice;
-use std::cell::Cell;
+use crate::block_cache::BlockCache;
+use std::cell::{Cell, RefCell};
 use std::io;
-use std::sync::Mutex;
+use std::sync::Arc;
+
+/// Unaligned spans up to this size are read with one covering command into
+/// the scratch buffer; longer ones read their aligned middle in place.
+const COVERING_READ_MAX: usize = 64 * 1024;
 
 /// Adapter that implements Read + Seek for the ntfs crate.
 /// Reads from a partition on the block device (with LBA offset).
 pub struct BlockDeviceReader {
-    block_device: Mutex<ScsiBlockDevice>,
+    block_device: Arc<BlockCache>,
     partition_start_lba: u64,
     partition_size_bytes: u64,
     position: Cell<u64>,
+    /// Covering blocks of short unaligned reads; reused across calls, at
+    /// most COVERING_READ_MAX bytes.
+    scratch: RefCell<Vec<u8>>,
 }
 
 impl BlockDeviceReader {
     pub fn new(
-        block_device: ScsiBlockDevice,
+        block_device: Arc<BlockCache>,
         partition_start_lba: u64,
         partition_size_bytes: u64,
     ) -> Self {
         Self {
-            block_device: Mutex::new(block_device),
+            block_device,
             partition_start_lba,
             partition_size_bytes,
             position: Cell::new(0),
+            scratch: RefCell::new(Vec::new()),
         }
     }
 
-    fn read_at(&self, pos: u64, buf: &mut [u8]) -> io::Result<usize> {
-        let block_size = self.block_device.lock().unwrap().block_size as u64;
+    pub fn read_at(&self, pos: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let block_size = self.block_device.block_size() as u64;
         if pos >= self.partition_size_bytes {
             return Ok(0);
         }
@@ -44,28 +52,59 @@ impl BlockDeviceReader {
         let offset_in_block = (pos % block_size) as usize;
         let block_size_usize = block_size as usize;
 
-        let dev = self.block_device.lock().unwrap();
+        let dev = &self.block_device;
         if offset_in_block == 0 && to_read >= block_size_usize && to_read % block_size_usize == 0 {
             let blocks = to_read / block_size_usize;
             dev.read_blocks(start_lba, blocks as u32, &mut buf[..to_read])
         } else {
-            let mut block_buf = vec![0u8; block_size_usize];
-            let mut total = 0usize;
-            let mut cur_pos = pos;
-            let mut buf_off = 0;
-            while buf_off < to_read {
-                let lba = self.partition_start_lba + cur_pos / block_size;
-                let off_in_block = (cur_pos % block_size) as usize;
-                let n = std::cmp::min(block_size_usize - off_in_block, to_read - buf_off);
-                dev.read_blocks(lba, 1, &mut block_buf)?;
-                buf[buf_off..buf_off + n].copy_from_slice(&block_buf[off_in_block..off_in_block + n]);
-                total += n;
-                buf_off += n;
-                cur_pos += n as u64;
+            let end = pos + to_read as u64;
+            let first = pos / block_size;
+            let count = (end + block_size - 1) / block_size - first;
+            let span = count as usize * block_size_usize;
+            if span > COVERING_READ_MAX {
+                return self.read_split(start_lba, offset_in_block, &mut buf[..to_read]);
+            }
+            // One covering read for the whole span; the cache fetches its
+            // uncached blocks with a single command.
+            let mut scratch = self.scratch.borrow_mut();
+            if scratch.len() < span {
+                scratch.resize(span, 0);
             }
-            Ok(total)
+            let n = dev.read_blocks(start_lba, count as u32, &mut scratch[..span])?;
+            let avail = n.saturating_sub(offset_in_block).min(to_read);
+            buf[..avail].copy_from_slice(&scratch[offset_in_block..offset_in_block + avail]);
+            Ok(avail)
         }
     }
+
+    /// Long unaligned read starting `offset` bytes into block `lba`: the
+    /// partial first and last blocks go through the cache, the whole blocks
+    /// between straight into `buf`.
+    fn read_split(&self, mut lba: u64, offset: usize, buf: &mut [u8]) -> io::Result<usize> {
+        let dev = &self.block_device;
+        let bs = dev.block_size() as usize;
+        let mut done = 0usize;
+        if offset > 0 {
+            let n = (bs - offset).min(buf.len());
+            dev.copy_from_block(lba, offset, &mut buf[..n])?;
+            lba += 1;
+            done = n;
+        }
+        let whole = (buf.len() - done) / bs;
+        if whole > 0 {
+            let n = dev.read_blocks(lba, whole as u32, &mut buf[done..done + whole * bs])?;
+            done += n;
+            if n < whole * bs {
+                return Ok(done);
+            }
+            lba += whole as u64;
+        }
+        if done < buf.len() {
+            dev.copy_from_block(lba, 0, &mut buf[done..])?;
+            done = buf.len();
+        }
+        Ok(done)
+    }
 }
 
 impl io::Read for BlockDeviceReader {
@@ -93,3 +132,51 @@ impl io::Seek for BlockDeviceReader {
         Ok(new_p)
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::block_device::testing::{mem_device, BLOCK};
+    use std::sync::Mutex;
+
+    fn volume(blocks: usize) -> (Vec<u8>, BlockDeviceReader, Arc<Mutex<Vec<(u64, u32)>>>) {
+        let data: Vec<u8> = (0..blocks * BLOCK).map(|i| (i % 251) as u8).collect();
+        let (dev, reads) = mem_device(data.clone());
+        let cache = Arc::new(BlockCache::new(dev, crate::block_cache::DEFAULT_BUDGET_BYTES));
+        // Partition from LBA 2 to the end.
+        let reader = BlockDeviceReader::new(cache, 2, ((blocks - 2) * BLOCK) as u64);
+        (data, reader, reads)
+    }
+
+    #[test]
+    fn short_unaligned_reads_use_one_covering_read() {
+        let (data, reader, reads) = volume(64);
+        let mut buf = vec![0u8; 700];
+        assert_eq!(reader.read_at(300, &mut buf).unwrap(), 700);
+        assert_eq!(buf, data[2 * BLOCK + 300..2 * BLOCK + 1000]);
+        assert_eq!(reads.lock().unwrap()[..], [(2, 2)]);
+    }
+
+    #[test]
+    fn long_unaligned_reads_go_around_the_scratch() {
+        let (data, reader, reads) = volume(512);
+        let len = COVERING_READ_MAX + 1000;
+        let mut buf = vec![0u8; len];
+        assert_eq!(reader.read_at(300, &mut buf).unwrap(), len);
+        assert_eq!(buf, data[2 * BLOCK + 300..2 * BLOCK + 300 + len]);
+        // Head block, the whole blocks in place, tail block.
+        let whole = ((len - (BLOCK - 300)) / BLOCK) as u32;
+        assert_eq!(reads.lock().unwrap()[..], [(2, 1), (3, whole), (3 + whole as u64, 1)]);
+        assert!(reader.scratch.borrow().is_empty());
+    }
+
+    #[test]
+    fn reads_stop_at_the_partition_end() {
+        let (data, reader, _) = volume(64);
+        let size = 62 * BLOCK as u64;
+        let mut buf = vec![0u8; 1000];
+        assert_eq!(reader.read_at(size - 100, &mut buf).unwrap(), 100);
+        assert_eq!(buf[..100], data[data.len() - 100..]);
+        assert_eq!(reader.read_at(size, &mut buf).unwrap(), 0);
+    }
+}
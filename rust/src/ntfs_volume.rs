@@ -1,14 +1,32 @@
 //! NTFS volume operations: list directory, read file.
 
-use crate::block_device::ScsiBlockDevice;
+use crate::dentry_cache::{self, DentryCache};
+use crate::device_session::DeviceSession;
+use crate::mft_index::{Indexer, MftLayout};
+use crate::ntfs_file::{self, DataRun, OpenFile};
 use crate::ntfs_reader::BlockDeviceReader;
-use crate::partition;
-use ntfs::{Ntfs, NtfsReadSeek};
+use ntfs::attribute_value::NtfsAttributeValue;
+use ntfs::{Ntfs, NtfsAttribute, NtfsAttributeFlags, NtfsReadSeek};
+use std::collections::HashMap;
 use std::io::{self, Read, Seek, SeekFrom};
+use std::sync::Arc;
 
 pub struct NtfsVolume {
     reader: BlockDeviceReader,
     ntfs: Ntfs,
+    root_record: u64,
+    dentries: DentryCache,
+    open_files: HashMap<u64, OpenFile>,
+    next_file_id: u64,
+    dir_cursors: HashMap<u64, DirCursor>,
+    next_cursor_id: u64,
+    mft_indexer: Arc<Indexer>,
+}
+
+/// A directory listing handed out in pages by next_dir_page.
+struct DirCursor {
+    entries: Arc<Vec<DirEntry>>,
+    pos: usize,
 }
 
 #[derive(Debug, Clone)]
@@ -19,18 +37,12 @@ pub struct DirEntry {
 }
 
 impl NtfsVolume {
-    pub fn open(block_device: ScsiBlockDevice) -> io::Result<Self> {
-        let partition_start = partition::get_partition_offset(&block_device)?;
-        let block_size = block_device.block_size as u64;
-        let block_count = block_device.block_count;
-        let partition_size_bytes = if partition_start == 0 {
-            block_count * block_size
-        } else {
-            (block_count - partition_start) * block_size
-        };
-
+    /// Mount partition `partition` of the device (the first NTFS one if None).
+    /// Volumes on one device share its block cache and command queue.
+    pub fn open(device: &DeviceSession, partition: Option<usize>) -> io::Result<Self> {
+        let (partition_start, partition_size_bytes) = device.locate(partition)?;
         let mut reader = BlockDeviceReader::new(
-            block_device,
+            device.cache(),
             partition_start,
             partition_size_bytes,
         );
@@ -53,7 +65,52 @@ impl NtfsVolume {
             )
         })?;
 
-        Ok(Self { reader, ntfs })
+        let root_record = ntfs.root_directory(&mut reader)?.file_record_number();
+
+        Ok(Self {
+            reader,
+            ntfs,
+            root_record,
+            dentries: DentryCache::new(),
+            open_files: HashMap::new(),
+            next_file_id: 1,
+            dir_cursors: HashMap::new(),
+            next_cursor_id: 1,
+            mft_indexer: Arc::new(Indexer::new()),
+        })
+    }
+
+    /// Record number for a path, walking from the deepest cached ancestor.
+    fn resolve(&mut self, parts: &[&str]) -> io::Result<u64> {
+        if parts.is_empty() {
+            return Ok(self.root_record);
+        }
+        if let Some(r) = self.dentries.record(&dentry_cache::path_key(parts)) {
+            return Ok(r);
+        }
+        let mut depth = parts.len() - 1;
+        let mut current_record = self.root_record;
+        while depth > 0 {
+            if let Some(r) = self.dentries.record(&dentry_cache::path_key(&parts[..depth])) {
+                current_record = r;
+                break;
+            }
+            depth -= 1;
+        }
+        for i in depth..parts.len() {
+            current_record = match Self::find_entry_record_number_in_dir(
+                &self.ntfs,
+                &mut self.reader,
+                current_record,
+                parts[i],
+            )? {
+                Some(r) => r,
+                None => return Err(io::Error::new(io::ErrorKind::NotFound, format!("Not found: {}", parts[i]))),
+            };
+            self.dentries
+                .insert_record(dentry_cache::path_key(&parts[..=i]), current_record);
+        }
+        Ok(current_record)
     }
 
     fn find_entry_record_number_in_dir(
@@ -73,8 +130,13 @@ impl NtfsVolume {
         }
     }
 
-    fn list_dir_by_record_number(&mut self, dir_record_number: u64) -> io::Result<Vec<DirEntry>> {
+    /// Entries of a directory, plus the record numbers of its subdirectories.
+    fn list_dir_by_record_number(
+        &mut self,
+        dir_record_number: u64,
+    ) -> io::Result<(Vec<DirEntry>, Vec<(String, u64)>)> {
         let mut entries = Vec::new();
+        let mut subdirs = Vec::new();
         let dir = self.ntfs.file(&mut self.reader, dir_record_number)?;
         let index = dir.directory_index(&mut self.reader)?;
         let mut iter = index.entries();
@@ -87,6 +149,9 @@ impl NtfsVolume {
                 }
                 let is_dir = key.is_directory();
                 let size = key.data_size();
+                if is_dir {
+                    subdirs.push((name.clone(), entry.file_reference().file_record_number()));
+                }
                 entries.push(DirEntry {
                     name,
                     is_dir,
@@ -94,67 +159,256 @@ impl NtfsVolume {
                 });
             }
         }
-        Ok(entries)
+        Ok((entries, subdirs))
     }
 
-    pub fn list_directory(&mut self, path: &str) -> io::Result<Vec<DirEntry>> {
-        let path = path.trim_matches('/');
-        if path.is_empty() {
-            let root = self.ntfs.root_directory(&mut self.reader)?;
-            return self.list_dir_by_record_number(root.file_record_number());
-        }
+    pub fn list_directory(&mut self, path: &str) -> io::Result<Arc<Vec<DirEntry>>> {
         let parts: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
-        let mut current_record = self.ntfs.root_directory(&mut self.reader)?.file_record_number();
-        for part in parts {
-            current_record = match Self::find_entry_record_number_in_dir(
-                &self.ntfs,
-                &mut self.reader,
-                current_record,
-                part,
-            )? {
-                Some(r) => r,
-                None => return Err(io::Error::new(io::ErrorKind::NotFound, format!("Not found: {}", part))),
-            };
+        let record = self.resolve(&parts)?;
+        if let Some(entries) = self.dentries.listing(record) {
+            return Ok(entries);
         }
-        self.list_dir_by_record_number(current_record)
+        let (entries, subdirs) = self.list_dir_by_record_number(record)?;
+        // Browsing usually continues into a subdirectory: resolve it without an index lookup.
+        let mut child = parts.clone();
+        let prime = if subdirs.len() <= dentry_cache::PRIME_MAX { &subdirs[..] } else { &[] };
+        for (name, child_record) in prime {
+            child.push(name);
+            self.dentries.insert_record(dentry_cache::path_key(&child), *child_record);
+            child.pop();
+        }
+        let entries = Arc::new(entries);
+        self.dentries.insert_listing(record, Arc::clone(&entries));
+        Ok(entries)
+    }
+
+    /// Start paging through a directory with next_dir_page. Returns a cursor
+    /// valid until close_dir_cursor or until the volume is closed.
+    pub fn open_dir_cursor(&mut self, path: &str) -> io::Result<u64> {
+        let entries = self.list_directory(path)?;
+        let id = self.next_cursor_id;
+        self.next_cursor_id += 1;
+        self.dir_cursors.insert(id, DirCursor { entries, pos: 0 });
+        Ok(id)
+    }
+
+    /// Next `max` entries of a cursor; shorter (possibly empty) at the end.
+    pub fn next_dir_page(&mut self, cursor: u64, max: usize) -> io::Result<&[DirEntry]> {
+        let c = self.dir_cursors.get_mut(&cursor).ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "Directory cursor not found")
+        })?;
+        let start = c.pos;
+        let end = std::cmp::min(start + max, c.entries.len());
+        c.pos = end;
+        Ok(&c.entries[start..end])
+    }
+
+    /// Like next_dir_page, handing the entries to `take` until it returns
+    /// false (the entry stays for the next page) or `max` were taken.
+    /// Returns (entries taken, whether any are left).
+    pub fn drain_dir_page(
+        &mut self,
+        cursor: u64,
+        max: usize,
+        mut take: impl FnMut(&DirEntry) -> bool,
+    ) -> io::Result<(usize, bool)> {
+        let c = self.dir_cursors.get_mut(&cursor).ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "Directory cursor not found")
+        })?;
+        let rest = &c.entries[c.pos..];
+        let taken = rest.iter().take(max).take_while(|e| take(e)).count();
+        c.pos += taken;
+        Ok((taken, c.pos < c.entries.len()))
+    }
+
+    pub fn close_dir_cursor(&mut self, cursor: u64) -> bool {
+        self.dir_cursors.remove(&cursor).is_some()
     }
 
     pub fn read_file(&mut self, path: &str, offset: u64, length: usize) -> io::Result<Vec<u8>> {
-        let path = path.trim_matches('/');
-        let parts: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
-        if parts.is_empty() {
-            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Invalid path"));
+        let parts = file_path_parts(path)?;
+        let record_num = self.resolve(&parts)?;
+        self.read_record(record_num, offset, length)
+    }
+
+    /// Read through the ntfs crate: file record, $DATA attribute, then seek.
+    /// Short only at the end of the stream; a single value read may stop
+    /// early, so it is repeated until `length` bytes are in.
+    fn read_record(&mut self, record_num: u64, offset: u64, length: usize) -> io::Result<Vec<u8>> {
+        let file = self.ntfs.file(&mut self.reader, record_num)?;
+        if file.is_directory() {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Is a directory"));
+        }
+        let data_item = file.data(&mut self.reader, "").ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "No data stream")
+        })??;
+        let attr = data_item.to_attribute()?;
+        let mut value = attr.value(&mut self.reader)?;
+        value.seek(&mut self.reader, SeekFrom::Start(offset))?;
+        let mut data = vec![0u8; length];
+        let mut n = 0;
+        while n < length {
+            let m = value.read(&mut self.reader, &mut data[n..])?;
+            if m == 0 {
+                break;
+            }
+            n += m;
         }
+        data.truncate(n);
+        Ok(data)
+    }
 
-        let mut current_record = self.ntfs.root_directory(&mut self.reader)?.file_record_number();
-        for (i, part) in parts.iter().enumerate() {
-            let record_num = match Self::find_entry_record_number_in_dir(
-                &self.ntfs,
-                &mut self.reader,
-                current_record,
-                part,
-            )? {
-                Some(r) => r,
-                None => return Err(io::Error::new(io::ErrorKind::NotFound, format!("Not found: {}", part))),
-            };
-            if i == parts.len() - 1 {
-                let file = self.ntfs.file(&mut self.reader, record_num)?;
-                if file.is_directory() {
-                    return Err(io::Error::new(io::ErrorKind::InvalidInput, "Is a directory"));
+    /// Resolve a file and decode its data runs for read_open_file. Returns a
+    /// handle valid until close_file or until the volume is closed.
+    pub fn open_file(&mut self, path: &str) -> io::Result<u64> {
+        let parts = file_path_parts(path)?;
+        let record_num = self.resolve(&parts)?;
+        let open = self.open_record(record_num)?;
+        let id = self.next_file_id;
+        self.next_file_id += 1;
+        self.open_files.insert(id, open);
+        Ok(id)
+    }
+
+    /// Read plan for the unnamed $DATA stream of a file record.
+    fn open_record(&mut self, record_num: u64) -> io::Result<OpenFile> {
+        let file = self.ntfs.file(&mut self.reader, record_num)?;
+        if file.is_directory() {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "Is a directory"));
+        }
+        let data_item = file.data(&mut self.reader, "").ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "No data stream")
+        })??;
+        let attr = data_item.to_attribute()?;
+        let flags = attr.flags();
+        let fallback = OpenFile::Record { record: record_num, size: attr.value_length() };
+        let open = if flags.contains(NtfsAttributeFlags::COMPRESSED)
+            || flags.contains(NtfsAttributeFlags::ENCRYPTED)
+        {
+            fallback
+        } else {
+            match attr.value(&mut self.reader)? {
+                NtfsAttributeValue::Resident(value) => OpenFile::Resident(value.data().to_vec()),
+                NtfsAttributeValue::NonResident(value) => {
+                    let mut runs = Vec::new();
+                    let mut file_offset = 0u64;
+                    for run in value.data_runs() {
+                        let run = run?;
+                        let len = run.allocated_size();
+                        runs.push(DataRun {
+                            file_offset,
+                            len,
+                            volume_pos: run.data_position().value().map(|p| p.get()),
+                        });
+                        file_offset += len;
+                    }
+                    let size = value.len();
+                    let initialized = self.initialized_size(&attr).map_or(size, |n| n.min(size));
+                    OpenFile::Runs { runs, size, initialized }
                 }
-                let data_item = file.data(&mut self.reader, "").ok_or_else(|| {
-                    io::Error::new(io::ErrorKind::NotFound, "No data stream")
-                })??;
-                let attr = data_item.to_attribute()?;
-                let mut value = attr.value(&mut self.reader)?;
-                value.seek(&mut self.reader, SeekFrom::Start(offset))?;
-                let mut data = vec![0u8; length];
-                let n = value.read(&mut self.reader, &mut data)?;
-                data.truncate(n);
-                return Ok(data);
+                _ => fallback,
+            }
+        };
+        Ok(open)
+    }
+
+    /// Valid data length of a non-resident attribute, from its header in the
+    /// raw file record (the ntfs crate reads no further than the data size).
+    fn initialized_size(&self, attr: &NtfsAttribute) -> Option<u64> {
+        let record_pos = attr.position().value()?.get().checked_sub(attr.offset() as u64)?;
+        let mut record = vec![0u8; self.ntfs.file_record_size() as usize];
+        ntfs_file::read_exact_at(&self.reader, record_pos, &mut record).ok()?;
+        crate::mft_index::initialized_size(&mut record, attr.offset())
+    }
+
+    pub fn read_open_file(&mut self, handle: u64, offset: u64, length: usize) -> io::Result<Vec<u8>> {
+        let size = self.open_file_size(handle)?;
+        let mut data = vec![0u8; std::cmp::min(length as u64, size.saturating_sub(offset)) as usize];
+        let n = self.read_open_file_into(handle, offset, &mut data)?;
+        data.truncate(n);
+        Ok(data)
+    }
+
+    /// Data size of an open file.
+    pub fn open_file_size(&self, handle: u64) -> io::Result<u64> {
+        self.open_files
+            .get(&handle)
+            .map(|f| f.size())
+            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, "File handle not found"))
+    }
+
+    /// Like read_open_file, into a caller buffer. Returns bytes read (0 at end of file).
+    pub fn read_open_file_into(&mut self, handle: u64, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let open = self.open_files.get(&handle).ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "File handle not found")
+        })?;
+        match open {
+            OpenFile::Resident(data) => {
+                let start = std::cmp::min(offset, data.len() as u64) as usize;
+                let end = std::cmp::min(start + buf.len(), data.len());
+                buf[..end - start].copy_from_slice(&data[start..end]);
+                Ok(end - start)
+            }
+            OpenFile::Runs { runs, size, initialized } => {
+                ntfs_file::read_runs(&self.reader, runs, *size, *initialized, offset, buf)
+            }
+            OpenFile::Record { record, .. } => {
+                let record = *record;
+                let data = self.read_record(record, offset, buf.len())?;
+                buf[..data.len()].copy_from_slice(&data);
+                Ok(data.len())
             }
-            current_record = record_num;
         }
-        Err(io::Error::new(io::ErrorKind::NotFound, "File not found"))
     }
+
+    pub fn reader(&self) -> &BlockDeviceReader {
+        &self.reader
+    }
+
+    /// $MFT's data runs and geometry, for mft_index's sequential scan.
+    pub fn mft_layout(&mut self) -> io::Result<MftLayout> {
+        let (runs, size) = match self.open_record(0)? {
+            OpenFile::Runs { runs, size, .. } => (Some(runs), size),
+            // Extents listed in an $ATTRIBUTE_LIST: the crate follows them.
+            OpenFile::Record { size, .. } => (None, size),
+            OpenFile::Resident(_) => {
+                return Err(io::Error::new(io::ErrorKind::InvalidData, "$MFT is resident"))
+            }
+        };
+        Ok(MftLayout {
+            runs,
+            size,
+            record_size: self.ntfs.file_record_size() as usize,
+            serial: self.ntfs.serial_number(),
+        })
+    }
+
+    /// Reads $MFT through the ntfs crate, for a layout without runs.
+    /// Returns bytes read.
+    pub fn read_mft_stream(&mut self, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let data = self.read_record(0, offset, buf.len())?;
+        buf[..data.len()].copy_from_slice(&data);
+        Ok(data.len())
+    }
+
+    /// Search index of this volume (state INDEX_NONE until mft_index::start).
+    pub fn mft_indexer(&self) -> Arc<Indexer> {
+        Arc::clone(&self.mft_indexer)
+    }
+
+    pub fn set_mft_indexer(&mut self, indexer: Arc<Indexer>) {
+        self.mft_indexer = indexer;
+    }
+
+    pub fn close_file(&mut self, handle: u64) -> bool {
+        self.open_files.remove(&handle).is_some()
+    }
+}
+
+fn file_path_parts(path: &str) -> io::Result<Vec<&str>> {
+    let parts: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
+    if parts.is_empty() {
+        return Err(io::Error::new(io::ErrorKind::InvalidInput, "Invalid path"));
+    }
+    Ok(parts)
 }
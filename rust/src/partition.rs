@@ -4,6 +4,15 @@ use std::io;
 
 /// Partition type for NTFS in MBR.
 pub const PARTITION_TYPE_NTFS: u8 = 0x07;
+/// Extended partitions holding a chain of logical ones (CHS and LBA variants).
+const PARTITION_TYPE_EXTENDED: u8 = 0x05;
+const PARTITION_TYPE_EXTENDED_LBA: u8 = 0x0F;
+/// Protective MBR entry of a GPT disk.
+const PARTITION_TYPE_GPT_PROTECTIVE: u8 = 0xEE;
+/// Logical partitions followed in an extended partition chain.
+const MAX_LOGICAL: usize = 64;
+/// OEM ID at bytes 3..11 of an NTFS boot sector.
+pub const NTFS_OEM_ID: &[u8; 8] = b"NTFS    ";
 
 /// Microsoft basic data (NTFS/FAT) partition type GUID for GPT.
 /// Stored as mixed endian in disk: EBD0A0A2-B9E5-4433-87C0-68B6B72699C7.
@@ -11,34 +20,48 @@ const GPT_TYPE_MS_BASIC_DATA: [u8; 16] = [
     0xA2, 0xA0, 0xD0, 0xEB, 0xE5, 0xB9, 0x33, 0x44, 0x87, 0xC0, 0x68, 0xB6, 0xB7, 0x26, 0x99, 0xC7,
 ];
 
-/// Find the first NTFS partition's start LBA from MBR.
-/// Returns None if no NTFS partition found.
-pub fn find_first_ntfs_partition(mbr: &[u8]) -> Option<u64> {
-    if mbr.len() < 512 {
-        return None;
-    }
-    let sig1 = mbr[510];
-    let sig2 = mbr[511];
-    if sig1 != 0x55 || sig2 != 0xAA {
-        return None;
+/// One partition table entry.
+#[derive(Debug, Clone)]
+pub struct PartitionEntry {
+    pub start_lba: u64,
+    pub block_count: u64,
+    /// MBR type byte; PARTITION_TYPE_NTFS for GPT basic data partitions.
+    pub mbr_type: u8,
+}
+
+fn mbr_slot(mbr: &[u8], i: usize) -> (u8, u64, u64) {
+    let off = 446 + i * 16;
+    let lba = u32::from_le_bytes([mbr[off + 8], mbr[off + 9], mbr[off + 10], mbr[off + 11]]);
+    let count = u32::from_le_bytes([mbr[off + 12], mbr[off + 13], mbr[off + 14], mbr[off + 15]]);
+    (mbr[off + 4], lba as u64, count as u64)
+}
+
+fn has_mbr_signature(sector: &[u8]) -> bool {
+    sector.len() >= 512 && sector[510] == 0x55 && sector[511] == 0xAA
+}
+
+pub fn is_ntfs_boot_sector(sector: &[u8]) -> bool {
+    sector.len() >= 11 && &sector[3..11] == NTFS_OEM_ID
+}
+
+/// True if sector 0 holds an MBR partition table. A boot sector at LBA 0
+/// (superfloppy) also ends in 0x55AA, so the slots must make sense as well:
+/// boot flag 0x00 or 0x80 and, when used, a non-empty range on the disk.
+/// `block_count` 0 skips the range check, as does a GPT protective entry,
+/// which is clamped to 0xFFFFFFFF on large disks.
+fn is_partition_table(sector0: &[u8], block_count: u64) -> bool {
+    if !has_mbr_signature(sector0) || is_ntfs_boot_sector(sector0) {
+        return false;
     }
-    for i in 0..4 {
-        let off = 446 + i * 16;
-        if off + 16 > mbr.len() {
-            break;
+    (0..4).all(|i| {
+        let boot_flag = sector0[446 + i * 16];
+        let (typ, lba, count) = mbr_slot(sector0, i);
+        if boot_flag & 0x7F != 0 {
+            return false;
         }
-        let part_type = mbr[off + 4];
-        if part_type == PARTITION_TYPE_NTFS {
-            let lba = u32::from_le_bytes([
-                mbr[off + 8],
-                mbr[off + 9],
-                mbr[off + 10],
-                mbr[off + 11],
-            ]);
-            return Some(lba as u64);
-        }
-    }
-    None
+        let in_range = block_count == 0 || typ == PARTITION_TYPE_GPT_PROTECTIVE || lba + count <= block_count;
+        typ == 0 || (lba > 0 && count > 0 && in_range)
+    })
 }
 
 /// Check if GPT header signature is present (at LBA 1 sector).
@@ -54,60 +77,81 @@ fn is_gpt_header(sector: &[u8]) -> bool {
         && sector[7] == 0x54
 }
 
-/// Find first NTFS (Microsoft basic data) partition LBA from GPT.
+/// Used entries of a GPT partition entry array, in table order.
 /// header: GPT header. entries: full partition entry array (num_entries * entry_size bytes).
-fn find_first_ntfs_gpt(header: &[u8], entries: &[u8]) -> Option<u64> {
+fn gpt_entries(header: &[u8], entries: &[u8]) -> Vec<PartitionEntry> {
+    let mut out = Vec::new();
     if header.len() < 88 {
-        return None;
+        return out;
     }
-    let num_entries = u32::from_le_bytes(header[80..84].try_into().ok()?);
-    let entry_size = u32::from_le_bytes(header[84..88].try_into().ok()?);
-    if entry_size == 0 || entry_size > 256 {
-        return None;
+    let num_entries = u32::from_le_bytes([header[80], header[81], header[82], header[83]]);
+    let entry_size = u32::from_le_bytes([header[84], header[85], header[86], header[87]]) as usize;
+    if entry_size < 48 || entry_size > 256 {
+        return out;
     }
-    let entry_size = entry_size as usize;
-    for i in 0..num_entries {
-        let start = i as usize * entry_size;
-        if start + 40 > entries.len() || start + entry_size > entries.len() {
+    for i in 0..num_entries as usize {
+        let start = i * entry_size;
+        if start + entry_size > entries.len() {
             break;
         }
-        let typ = &entries[start..start + 16];
-        if typ == GPT_TYPE_MS_BASIC_DATA {
-            let first_lba = u64::from_le_bytes(entries[start + 32..start + 40].try_into().ok()?);
-            if first_lba > 0 {
-                return Some(first_lba);
-            }
+        let e = &entries[start..start + entry_size];
+        let typ = &e[0..16];
+        if typ.iter().all(|&b| b == 0) {
+            continue;
         }
+        let first_lba = u64::from_le_bytes(e[32..40].try_into().unwrap());
+        let last_lba = u64::from_le_bytes(e[40..48].try_into().unwrap());
+        if first_lba == 0 || last_lba < first_lba {
+            continue;
+        }
+        out.push(PartitionEntry {
+            start_lba: first_lba,
+            block_count: last_lba - first_lba + 1,
+            mbr_type: if typ == GPT_TYPE_MS_BASIC_DATA { PARTITION_TYPE_NTFS } else { 0 },
+        });
     }
-    None
+    out
 }
 
-/// Read MBR/GPT from block device and return first NTFS partition LBA.
-/// Tries MBR first, then GPT (LBA 1 + partition entries at LBA 2).
-/// Returns 0 only if no NTFS partition found (try whole disk for superfloppy).
-pub fn get_partition_offset(block_device: &crate::block_device::ScsiBlockDevice) -> io::Result<u64> {
-    let block_size = block_device.block_size as usize;
+/// Read the MBR (with logical partitions) or GPT and list all partitions in
+/// table order. Empty for a disk without a partition table (superfloppy),
+/// including one whose boot sector's 0x55AA would pass for an MBR.
+pub fn read_partitions(block_device: &crate::block_cache::BlockCache) -> io::Result<Vec<PartitionEntry>> {
+    let block_size = block_device.block_size() as usize;
     let mut sector0 = vec![0u8; block_size];
     block_device.read_blocks(0, 1, &mut sector0)?;
+    if !is_partition_table(&sector0, block_device.block_count()) {
+        return Ok(Vec::new());
+    }
 
-    if let Some(lba) = find_first_ntfs_partition(&sector0) {
-        return Ok(lba);
+    let mut out = Vec::new();
+    let mut protective = false;
+    for i in 0..4 {
+        let (typ, lba, count) = mbr_slot(&sector0, i);
+        match typ {
+            0 => {}
+            PARTITION_TYPE_GPT_PROTECTIVE => protective = true,
+            PARTITION_TYPE_EXTENDED | PARTITION_TYPE_EXTENDED_LBA => {
+                read_logical(block_device, lba, &mut out)?;
+            }
+            _ => out.push(PartitionEntry { start_lba: lba, block_count: count, mbr_type: typ }),
+        }
+    }
+    if !protective {
+        return Ok(out);
     }
 
     let mut sector1 = vec![0u8; block_size];
     block_device.read_blocks(1, 1, &mut sector1)?;
-    if !is_gpt_header(&sector1) {
-        return Ok(0);
-    }
-    if sector1.len() < 88 {
-        return Ok(0);
+    if !is_gpt_header(&sector1) || sector1.len() < 88 {
+        return Ok(out);
     }
     let entry_lba = u64::from_le_bytes(sector1[72..80].try_into().unwrap_or([0u8; 8]));
     let num_entries = u32::from_le_bytes(sector1[80..84].try_into().unwrap_or([0u8; 4]));
     let entry_size = u32::from_le_bytes(sector1[84..88].try_into().unwrap_or([0u8; 4]));
     let entry_size = entry_size as usize;
     if entry_size == 0 || entry_size > 256 {
-        return Ok(0);
+        return Ok(out);
     }
     // Read full partition entry array (e.g. 128 entries * 128 bytes = 32 sectors of 512 bytes).
     let entries_bytes = (num_entries as usize).saturating_mul(entry_size).min(128 * 128);
@@ -115,9 +159,99 @@ pub fn get_partition_offset(block_device: &crate::block_device::ScsiBlockDevice)
     let mut entries_buf = vec![0u8; sectors_to_read * block_size];
     block_device.read_blocks(entry_lba, sectors_to_read as u32, &mut entries_buf)?;
     let entries_used = entries_bytes.min(entries_buf.len());
-    if let Some(lba) = find_first_ntfs_gpt(&sector1, &entries_buf[..entries_used]) {
-        return Ok(lba);
+    Ok(gpt_entries(&sector1, &entries_buf[..entries_used]))
+}
+
+/// Follow the EBR chain of an extended partition starting at `base`.
+/// Logical starts are relative to their EBR, links relative to `base`.
+fn read_logical(
+    block_device: &crate::block_cache::BlockCache,
+    base: u64,
+    out: &mut Vec<PartitionEntry>,
+) -> io::Result<()> {
+    let mut ebr = vec![0u8; block_device.block_size() as usize];
+    let mut lba = base;
+    for _ in 0..MAX_LOGICAL {
+        block_device.read_blocks(lba, 1, &mut ebr)?;
+        if !has_mbr_signature(&ebr) {
+            break;
+        }
+        let (typ, rel, count) = mbr_slot(&ebr, 0);
+        if typ != 0 && rel > 0 {
+            out.push(PartitionEntry { start_lba: lba + rel, block_count: count, mbr_type: typ });
+        }
+        let (next_typ, next_rel, _) = mbr_slot(&ebr, 1);
+        if next_rel == 0 || (next_typ != PARTITION_TYPE_EXTENDED && next_typ != PARTITION_TYPE_EXTENDED_LBA) {
+            break;
+        }
+        lba = base + next_rel;
     }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
 
-    Ok(0)
+    fn mbr(slots: &[(u8, u8, u32, u32)]) -> Vec<u8> {
+        let mut s = vec![0u8; 512];
+        for (i, &(flag, typ, lba, count)) in slots.iter().enumerate() {
+            let off = 446 + i * 16;
+            s[off] = flag;
+            s[off + 4] = typ;
+            s[off + 8..off + 12].copy_from_slice(&lba.to_le_bytes());
+            s[off + 12..off + 16].copy_from_slice(&count.to_le_bytes());
+        }
+        s[510] = 0x55;
+        s[511] = 0xAA;
+        s
+    }
+
+    #[test]
+    fn accepts_a_partition_table() {
+        let s = mbr(&[(0x80, PARTITION_TYPE_NTFS, 2048, 4096), (0, PARTITION_TYPE_EXTENDED, 8192, 1000)]);
+        assert!(is_partition_table(&s, 10_000));
+        assert_eq!(mbr_slot(&s, 1), (PARTITION_TYPE_EXTENDED, 8192, 1000));
+        // A protective entry may claim more than the disk.
+        assert!(is_partition_table(&mbr(&[(0, PARTITION_TYPE_GPT_PROTECTIVE, 1, u32::MAX)]), 10_000));
+    }
+
+    #[test]
+    fn ntfs_boot_sector_is_a_superfloppy() {
+        let mut s = mbr(&[(0, PARTITION_TYPE_NTFS, 2048, 4096)]);
+        s[3..11].copy_from_slice(NTFS_OEM_ID);
+        assert!(is_ntfs_boot_sector(&s));
+        assert!(!is_partition_table(&s, 10_000));
+    }
+
+    #[test]
+    fn rejects_garbage_slots() {
+        // Boot code spilling into the table: bad boot flag, ranges off the disk.
+        assert!(!is_partition_table(&mbr(&[(0x33, PARTITION_TYPE_NTFS, 2048, 4096)]), 10_000));
+        assert!(!is_partition_table(&mbr(&[(0, PARTITION_TYPE_NTFS, 9000, 4096)]), 10_000));
+        assert!(!is_partition_table(&mbr(&[(0, PARTITION_TYPE_NTFS, 0, 4096)]), 10_000));
+        assert!(!is_partition_table(&mbr(&[(0, PARTITION_TYPE_NTFS, 2048, 0)]), 10_000));
+        let mut s = mbr(&[]);
+        s[511] = 0;
+        assert!(!is_partition_table(&s, 10_000));
+    }
+
+    #[test]
+    fn lists_used_gpt_entries() {
+        let mut header = vec![0u8; 92];
+        header[80..84].copy_from_slice(&3u32.to_le_bytes());
+        header[84..88].copy_from_slice(&128u32.to_le_bytes());
+        let mut entries = vec![0u8; 3 * 128];
+        entries[0..16].copy_from_slice(&GPT_TYPE_MS_BASIC_DATA);
+        entries[32..40].copy_from_slice(&2048u64.to_le_bytes());
+        entries[40..48].copy_from_slice(&4095u64.to_le_bytes());
+        // Entry 1 unused; entry 2 another type.
+        entries[256] = 0x01;
+        entries[256 + 32..256 + 40].copy_from_slice(&8192u64.to_le_bytes());
+        entries[256 + 40..256 + 48].copy_from_slice(&8192u64.to_le_bytes());
+        let parts = gpt_entries(&header, &entries);
+        assert_eq!(parts.len(), 2);
+        assert_eq!((parts[0].start_lba, parts[0].block_count, parts[0].mbr_type), (2048, 2048, PARTITION_TYPE_NTFS));
+        assert_eq!((parts[1].start_lba, parts[1].block_count, parts[1].mbr_type), (8192, 1, 0));
+    }
 }
@@ -0,0 +1,185 @@
+//! Stream pump: a thread that moves a stream (a DVD title, a CD track)
+//! straight into a pipe. LibVLC reads the other end of the pipe, so playback
+//! needs no JVM thread and no JNI call per chunk. The pipe is non-blocking; when it is full the
+//! pump waits in poll() with a timeout, so a stop request is seen even while
+//! the player is paused. Seeks are queued to the pump, which drops the chunk
+//! it had not written yet before repositioning the stream.
+
+use crate::registry::Registry;
+use std::fs::File;
+use std::io::{self, Write};
+use std::os::fd::{AsRawFd, RawFd};
+use std::os::raw::{c_int, c_short};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{channel, Receiver, Sender};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+/// Bytes read from the stream per chunk.
+const CHUNK_BYTES: usize = 256 * 1024;
+/// Longest wait for pipe space before re-checking for stop and seeks.
+const POLL_TIMEOUT_MS: c_int = 100;
+
+const F_GETFL: c_int = 3;
+const F_SETFL: c_int = 4;
+const O_NONBLOCK: c_int = 0o4000;
+const POLLOUT: c_short = 0x4;
+
+#[repr(C)]
+struct PollFd {
+    fd: c_int,
+    events: c_short,
+    revents: c_short,
+}
+
+// nfds_t differs between bionic and glibc.
+#[cfg(target_os = "android")]
+type NfdsT = std::os::raw::c_uint;
+#[cfg(not(target_os = "android"))]
+type NfdsT = std::os::raw::c_ulong;
+
+extern "C" {
+    fn fcntl(fd: c_int, cmd: c_int, ...) -> c_int;
+    fn poll(fds: *mut PollFd, nfds: NfdsT, timeout: c_int) -> c_int;
+}
+
+/// What a pump reads from.
+pub trait PumpSource: Send + 'static {
+    /// Next bytes of the stream; 0 at the end.
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize>;
+    /// Repositions at a block in the source's own units (DVD title block,
+    /// CD track sector).
+    fn seek_block(&mut self, block: u32) -> io::Result<()>;
+}
+
+enum Command {
+    SeekBlock(u32),
+}
+
+pub struct Pump {
+    commands: Sender<Command>,
+    stop: Arc<AtomicBool>,
+    thread: Option<JoinHandle<io::Result<()>>>,
+    /// Only DVD seeks resolve their target through the stream.
+    #[cfg_attr(not(has_dvd), allow(dead_code))]
+    stream_id: u64,
+}
+
+static PUMPS: std::sync::LazyLock<Registry<Pump>> =
+    std::sync::LazyLock::new(Registry::new);
+
+/// Starts pumping `source` (stream `stream_id`) into `fd`, the write end of a
+/// pipe. Takes ownership of `fd`; it is closed when the pump ends, which the
+/// reader sees as end of stream.
+pub fn start(stream_id: u64, source: impl PumpSource, name: &str, fd: RawFd) -> io::Result<u64> {
+    let out = crate::jobs::adopt_fd(fd);
+    let flags = unsafe { fcntl(fd, F_GETFL) };
+    if flags < 0 || unsafe { fcntl(fd, F_SETFL, flags | O_NONBLOCK) } < 0 {
+        return Err(io::Error::last_os_error());
+    }
+    let (tx, rx) = channel();
+    let stop = Arc::new(AtomicBool::new(false));
+    let thread_stop = Arc::clone(&stop);
+    let thread = std::thread::Builder::new()
+        .name(name.to_string())
+        .spawn(move || run(source, out, rx, &thread_stop))?;
+    Ok(PUMPS.insert(Pump {
+        commands: tx,
+        stop,
+        thread: Some(thread),
+        stream_id,
+    }))
+}
+
+/// Queues a reposition of the pumped stream at `block` (see PumpSource).
+pub fn seek_block(pump_id: u64, block: u32) -> io::Result<()> {
+    send(pump_id, Command::SeekBlock(block))
+}
+
+/// Stops the pump and waits for its thread. Returns the error that ended it
+/// early, if any; the stream itself stays open.
+pub fn stop(pump_id: u64) -> io::Result<()> {
+    let mut pump = PUMPS.remove(pump_id).ok_or_else(not_found)?;
+    pump.stop.store(true, Ordering::Relaxed);
+    match pump.thread.take().map(|t| t.join()) {
+        Some(Ok(result)) => result,
+        Some(Err(_)) => Err(io::Error::new(io::ErrorKind::Other, "Pump thread panicked")),
+        None => Ok(()),
+    }
+}
+
+fn not_found() -> io::Error {
+    io::Error::new(io::ErrorKind::NotFound, "Pump not found")
+}
+
+/// The stream a pump reads, for resolving seek targets.
+#[cfg_attr(not(has_dvd), allow(dead_code))]
+pub fn stream_of(pump_id: u64) -> io::Result<u64> {
+    PUMPS
+        .with(pump_id, |p| p.stream_id)
+        .ok_or_else(not_found)
+}
+
+fn send(pump_id: u64, command: Command) -> io::Result<()> {
+    PUMPS
+        .with(pump_id, |p| p.commands.send(command).is_ok())
+        .filter(|&sent| sent)
+        .map(|_| ())
+        .ok_or_else(|| io::Error::new(io::ErrorKind::BrokenPipe, "Pump has ended"))
+}
+
+fn run(
+    mut source: impl PumpSource,
+    mut out: File,
+    commands: Receiver<Command>,
+    stop: &AtomicBool,
+) -> io::Result<()> {
+    let mut buf = vec![0u8; CHUNK_BYTES];
+    // Bytes of the current chunk not yet written, as buf[start..end].
+    let (mut start, mut end) = (0usize, 0usize);
+    while !stop.load(Ordering::Relaxed) {
+        let mut seek = None;
+        while let Ok(Command::SeekBlock(block)) = commands.try_recv() {
+            seek = Some(block);
+        }
+        if let Some(block) = seek {
+            source.seek_block(block)?;
+            start = 0;
+            end = 0;
+        }
+        if start == end {
+            let n = source.read(&mut buf)?;
+            if n == 0 {
+                return Ok(());
+            }
+            start = 0;
+            end = n;
+        }
+        match out.write(&buf[start..end]) {
+            Ok(0) => return Err(io::Error::new(io::ErrorKind::WriteZero, "Pipe closed")),
+            Ok(n) => start += n,
+            Err(e) if e.kind() == io::ErrorKind::WouldBlock => wait_writable(&out)?,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            // The player closed its end (EPIPE) on stop.
+            Err(e) if e.kind() == io::ErrorKind::BrokenPipe => return Ok(()),
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(())
+}
+
+/// Waits until the pipe has room or the poll timeout passes.
+fn wait_writable(out: &File) -> io::Result<()> {
+    let mut pfd = PollFd {
+        fd: out.as_raw_fd(),
+        events: POLLOUT,
+        revents: 0,
+    };
+    if unsafe { poll(&mut pfd, 1, POLL_TIMEOUT_MS) } < 0 {
+        let e = io::Error::last_os_error();
+        if e.kind() != io::ErrorKind::Interrupted {
+            return Err(e);
+        }
+    }
+    Ok(())
+}
@@ -0,0 +1,188 @@
+//! Degraded-media reads.
+//! Without a policy a Check Condition fails the whole READ, so one bad sector
+//! on a scratched disc or a failing disk fails a 32-128 KB request and stops
+//! playback or a copy. With one, ScsiBlockDevice retries transient failures,
+//! bisects a range that hit a medium error down to the bad sectors, and can
+//! zero-fill those and carry on. Sectors found bad are remembered, so later
+//! reads go around them instead of waiting on the drive's own retries again.
+
+use crate::scsi;
+use std::collections::BTreeMap;
+use std::fmt::Write;
+use std::io;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+use std::time::Duration;
+
+/// First retry delay; doubled per attempt up to MAX_BACKOFF.
+const BASE_BACKOFF: Duration = Duration::from_millis(20);
+const MAX_BACKOFF: Duration = Duration::from_millis(500);
+/// Upper bound on configured retries.
+pub const MAX_RETRIES: u32 = 8;
+
+#[derive(Debug, Clone, Copy, Default)]
+pub struct RecoveryPolicy {
+    /// Retries of a failed READ (transient errors, and bad single sectors).
+    pub retries: u32,
+    /// Bisect a range that hit a medium error to find the bad sectors.
+    pub split: bool,
+    /// Return zeros for sectors that still fail and record them.
+    pub skip_bad: bool,
+}
+
+impl RecoveryPolicy {
+    /// Errors fail the read (the default).
+    pub fn is_strict(&self) -> bool {
+        self.retries == 0 && !self.split && !self.skip_bad
+    }
+
+    pub fn backoff(attempt: u32) -> Duration {
+        BASE_BACKOFF.saturating_mul(1 << attempt.min(8)).min(MAX_BACKOFF)
+    }
+}
+
+/// How a failed READ may be recovered.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Failure {
+    /// Not ready yet, unit attention, aborted command: the same READ may pass.
+    Transient,
+    /// Unreadable sectors somewhere in the range.
+    Medium,
+    /// Transport errors and other sense keys (e.g. illegal request) are
+    /// returned as they are; repeating them only adds delay.
+    Fatal,
+}
+
+pub fn classify(e: &io::Error) -> Failure {
+    match scsi::sense_error(e).map(|s| s.sense_key) {
+        Some(scsi::SENSE_NOT_READY | scsi::SENSE_UNIT_ATTENTION | scsi::SENSE_ABORTED_COMMAND) => {
+            Failure::Transient
+        }
+        Some(scsi::SENSE_MEDIUM_ERROR | scsi::SENSE_HARDWARE_ERROR) => Failure::Medium,
+        _ => Failure::Fatal,
+    }
+}
+
+/// Policy and bad-sector map of one device, shared like its IoStats.
+#[derive(Default)]
+pub struct Recovery {
+    policy: Mutex<RecoveryPolicy>,
+    /// Zero-filled sectors: start LBA -> end LBA (exclusive), merged.
+    bad: Mutex<BTreeMap<u64, u64>>,
+    retries: AtomicU64,
+    /// Reads bisected after a medium error.
+    splits: AtomicU64,
+    zero_filled: AtomicU64,
+}
+
+impl Recovery {
+    pub fn policy(&self) -> RecoveryPolicy {
+        *self.policy.lock().unwrap()
+    }
+
+    pub fn set_policy(&self, mut policy: RecoveryPolicy) {
+        policy.retries = policy.retries.min(MAX_RETRIES);
+        *self.policy.lock().unwrap() = policy;
+    }
+
+    pub fn record_retry(&self) {
+        self.retries.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn record_split(&self) {
+        self.splits.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Records `count` zero-filled sectors at `lba`.
+    pub fn record_bad(&self, lba: u64, count: u64) {
+        self.zero_filled.fetch_add(count, Ordering::Relaxed);
+        let mut bad = self.bad.lock().unwrap();
+        let mut start = lba;
+        let mut end = lba + count;
+        if let Some((&s, &e)) = bad.range(..=start).next_back() {
+            if e >= start {
+                start = s;
+                end = end.max(e);
+            }
+        }
+        let absorbed: Vec<u64> = bad.range(start..=end).map(|(&s, _)| s).collect();
+        for s in absorbed {
+            end = end.max(bad.remove(&s).unwrap());
+        }
+        bad.insert(start, end);
+    }
+
+    /// First known bad range overlapping [lba, lba + count), clipped to it.
+    pub fn known_bad(&self, lba: u64, count: u64) -> Option<(u64, u64)> {
+        let end = lba + count;
+        let bad = self.bad.lock().unwrap();
+        let before = bad.range(..=lba).next_back().filter(|(_, &e)| e > lba);
+        let (&s, &e) = before.or_else(|| bad.range(lba..end).next())?;
+        Some((s.max(lba), e.min(end)))
+    }
+
+    /// Zero-filled ranges as a JSON array of [lba, count] pairs.
+    pub fn bad_sectors_json(&self) -> String {
+        let bad = self.bad.lock().unwrap();
+        let mut out = String::with_capacity(2 + bad.len() * 24);
+        out.push('[');
+        for (i, (s, e)) in bad.iter().enumerate() {
+            if i > 0 {
+                out.push(',');
+            }
+            let _ = write!(out, "[{},{}]", s, e - s);
+        }
+        out.push(']');
+        out
+    }
+
+    /// Appends the counters as JSON object members (no braces).
+    pub fn write_json(&self, out: &mut String) {
+        let ranges = self.bad.lock().unwrap().len();
+        let _ = write!(
+            out,
+            "\"retries\":{},\"splits\":{},\"zeroFilled\":{},\"badRanges\":{}",
+            self.retries.load(Ordering::Relaxed),
+            self.splits.load(Ordering::Relaxed),
+            self.zero_filled.load(Ordering::Relaxed),
+            ranges,
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn bad_ranges_merge_when_overlapping_or_adjacent() {
+        let r = Recovery::default();
+        r.record_bad(100, 10);
+        r.record_bad(200, 5);
+        assert_eq!(r.bad_sectors_json(), "[[100,10],[200,5]]");
+        // Adjacent to the first, overlapping nothing else.
+        r.record_bad(110, 2);
+        assert_eq!(r.bad_sectors_json(), "[[100,12],[200,5]]");
+        // Inside an existing range.
+        r.record_bad(102, 3);
+        assert_eq!(r.bad_sectors_json(), "[[100,12],[200,5]]");
+        // Bridging both.
+        r.record_bad(105, 100);
+        assert_eq!(r.bad_sectors_json(), "[[100,105]]");
+        // Covering it from before.
+        r.record_bad(90, 200);
+        assert_eq!(r.bad_sectors_json(), "[[90,200]]");
+    }
+
+    #[test]
+    fn known_bad_clips_to_the_query() {
+        let r = Recovery::default();
+        r.record_bad(100, 10);
+        r.record_bad(200, 5);
+        assert_eq!(r.known_bad(0, 100), None);
+        assert_eq!(r.known_bad(95, 10), Some((100, 105)));
+        assert_eq!(r.known_bad(105, 200), Some((105, 110)));
+        assert_eq!(r.known_bad(110, 90), None);
+        assert_eq!(r.known_bad(150, 100), Some((200, 205)));
+    }
+}
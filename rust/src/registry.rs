@@ -0,0 +1,90 @@
+//! Handle registry for objects owned by JNI callers (volumes, DVDs, streams).
+//! The map lock is held only to look up, insert or remove an entry; each
+//! handle has its own lock, so I/O on one handle never blocks the others.
+
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+/// A slot is emptied on remove; callers that looked it up just before see None.
+type Entry<T> = Arc<Mutex<Option<T>>>;
+
+pub struct Registry<T> {
+    entries: Mutex<HashMap<u64, Entry<T>>>,
+    next_id: AtomicU64,
+}
+
+impl<T> Registry<T> {
+    pub fn new() -> Self {
+        Self {
+            entries: Mutex::new(HashMap::new()),
+            next_id: AtomicU64::new(1),
+        }
+    }
+
+    pub fn insert(&self, value: T) -> u64 {
+        let id = self.next_id.fetch_add(1, Ordering::Relaxed);
+        self.entries
+            .lock()
+            .unwrap()
+            .insert(id, Arc::new(Mutex::new(Some(value))));
+        id
+    }
+
+    /// Runs `f` under the handle's own lock. None if the id is unknown or closed.
+    pub fn with<R>(&self, id: u64, f: impl FnOnce(&mut T) -> R) -> Option<R> {
+        let entry = self.entries.lock().unwrap().get(&id).cloned()?;
+        let mut slot = entry.lock().unwrap();
+        slot.as_mut().map(f)
+    }
+
+    /// Unregisters the handle and returns it once calls in flight on it have finished.
+    pub fn remove(&self, id: u64) -> Option<T> {
+        let entry = self.entries.lock().unwrap().remove(&id)?;
+        let mut slot = entry.lock().unwrap();
+        slot.take()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::AtomicBool;
+    use std::time::Duration;
+
+    #[test]
+    fn ids_are_not_reused() {
+        let reg = Registry::new();
+        let a = reg.insert(1);
+        assert_eq!(reg.remove(a), Some(1));
+        let b = reg.insert(2);
+        assert_ne!(a, b);
+        assert_eq!(reg.with(a, |v| *v), None);
+        assert_eq!(reg.with(b, |v| *v), Some(2));
+        assert_eq!(reg.remove(a), None);
+    }
+
+    #[test]
+    fn remove_waits_for_a_call_in_flight() {
+        let reg = Arc::new(Registry::new());
+        let id = reg.insert(0u32);
+        let entered = Arc::new(AtomicBool::new(false));
+        let call = {
+            let (reg, entered) = (Arc::clone(&reg), Arc::clone(&entered));
+            std::thread::spawn(move || {
+                reg.with(id, |v| {
+                    entered.store(true, Ordering::SeqCst);
+                    std::thread::sleep(Duration::from_millis(50));
+                    *v = 7;
+                })
+            })
+        };
+        while !entered.load(Ordering::SeqCst) {
+            std::thread::yield_now();
+        }
+        // The value comes back with the call's write, and later calls miss.
+        assert_eq!(reg.remove(id), Some(7));
+        assert_eq!(call.join().unwrap(), Some(()));
+        assert_eq!(reg.with(id, |v| *v), None);
+    }
+}
@@ -6,6 +6,8 @@ pub const CBW_SIGNATURE: u32 = 0x4342_5355; // "USBC" little endian
 pub const CSW_SIGNATURE: u32 = 0x5342_5355; // "USBS" little endian
 pub const CBW_SIZE: usize = 31;
 pub const CSW_SIZE: usize = 13;
+/// Fixed-format sense data requested after a Check Condition.
+pub const SENSE_SIZE: usize = 18;
 
 pub const DIRECTION_OUT: u8 = 0x00;
 pub const DIRECTION_IN: u8 = 0x80;
@@ -17,10 +19,24 @@ pub const INQUIRY: u8 = 0x12;
 pub const READ_CAPACITY_10: u8 = 0x25;
 pub const READ_10: u8 = 0x28;
 pub const READ_10_OPCODE: u8 = 0x28;
+pub const READ_16: u8 = 0x88;
+pub const SERVICE_ACTION_IN_16: u8 = 0x9E;
+pub const SA_READ_CAPACITY_16: u8 = 0x10;
+// MMC (optical drives)
+pub const READ_TOC: u8 = 0x43;
+pub const SET_CD_SPEED: u8 = 0xBB;
+pub const READ_CD: u8 = 0xBE;
+
+/// Raw CD-DA sector: 588 stereo 16-bit frames.
+pub const CD_RAW_SECTOR: usize = 2352;
+
+// VPD pages
+pub const VPD_SUPPORTED_PAGES: u8 = 0x00;
+pub const VPD_BLOCK_LIMITS: u8 = 0xB0;
 
 /// Build CBW (Command Block Wrapper).
-pub fn build_cbw(tag: u32, data_length: u32, flags: u8, cdb: &[u8]) -> Vec<u8> {
-    let mut buf = vec![0u8; CBW_SIZE];
+pub fn build_cbw(tag: u32, data_length: u32, flags: u8, cdb: &[u8]) -> [u8; CBW_SIZE] {
+    let mut buf = [0u8; CBW_SIZE];
     buf[0..4].copy_from_slice(&CBW_SIGNATURE.to_le_bytes());
     buf[4..8].copy_from_slice(&tag.to_le_bytes());
     buf[8..12].copy_from_slice(&data_length.to_le_bytes());
@@ -47,6 +63,54 @@ pub fn build_read_10_cdb(lba: u32, block_count: u16) -> [u8; 10] {
     cdb
 }
 
+/// Build READ CAPACITY(16) CDB (SERVICE ACTION IN(16), 32-byte response).
+pub fn build_read_capacity_16_cdb() -> [u8; 16] {
+    let mut cdb = [0u8; 16];
+    cdb[0] = SERVICE_ACTION_IN_16;
+    cdb[1] = SA_READ_CAPACITY_16;
+    cdb[10..14].copy_from_slice(&32u32.to_be_bytes());
+    cdb
+}
+
+/// Build READ(16) CDB: 64-bit LBA, 32-bit transfer length.
+pub fn build_read_16_cdb(lba: u64, block_count: u32) -> [u8; 16] {
+    let mut cdb = [0u8; 16];
+    cdb[0] = READ_16;
+    cdb[2..10].copy_from_slice(&lba.to_be_bytes());
+    cdb[10..14].copy_from_slice(&block_count.to_be_bytes());
+    cdb
+}
+
+/// Build READ TOC/PMA/ATIP CDB, format 0 (track descriptors) with LBA
+/// addresses, starting at track 1.
+pub fn build_read_toc_cdb(allocation_length: u16) -> [u8; 10] {
+    let mut cdb = [0u8; 10];
+    cdb[0] = READ_TOC;
+    cdb[6] = 1;
+    cdb[7..9].copy_from_slice(&allocation_length.to_be_bytes());
+    cdb
+}
+
+/// Build READ CD CDB for CD-DA sectors, user data only (2352 bytes each).
+pub fn build_read_cd_cdb(lba: u32, sector_count: u32) -> [u8; 12] {
+    let mut cdb = [0u8; 12];
+    cdb[0] = READ_CD;
+    cdb[1] = 0x04; // expected sector type: CD-DA
+    cdb[2..6].copy_from_slice(&lba.to_be_bytes());
+    cdb[6..9].copy_from_slice(&sector_count.to_be_bytes()[1..]);
+    cdb[9] = 0x10; // user data
+    cdb
+}
+
+/// Build SET CD SPEED CDB; 0xFFFF asks for the drive's maximum.
+pub fn build_set_cd_speed_cdb(read_kb_s: u16) -> [u8; 12] {
+    let mut cdb = [0u8; 12];
+    cdb[0] = SET_CD_SPEED;
+    cdb[2..4].copy_from_slice(&read_kb_s.to_be_bytes());
+    cdb[4..6].copy_from_slice(&0xFFFFu16.to_be_bytes());
+    cdb
+}
+
 /// Build REQUEST SENSE CDB.
 pub fn build_request_sense_cdb(allocation_length: u8) -> [u8; 6] {
     let mut cdb = [0u8; 6];
@@ -71,6 +135,16 @@ pub fn build_inquiry_cdb() -> [u8; 6] {
     cdb
 }
 
+/// Build INQUIRY CDB for a Vital Product Data page (EVPD = 1).
+pub fn build_inquiry_vpd_cdb(page: u8, allocation_length: u16) -> [u8; 6] {
+    let mut cdb = [0u8; 6];
+    cdb[0] = INQUIRY;
+    cdb[1] = 0x01;
+    cdb[2] = page;
+    cdb[3..5].copy_from_slice(&allocation_length.to_be_bytes());
+    cdb
+}
+
 /// Parse CSW (Command Status Wrapper). Returns (signature_ok, tag_ok, status, residue).
 pub fn parse_csw(buf: &[u8]) -> io::Result<(bool, bool, u8, u32)> {
     if buf.len() < CSW_SIZE {
@@ -108,4 +182,41 @@ pub fn parse_sense(buf: &[u8]) -> (u8, u8, u8) {
 }
 
 pub const SENSE_NO_SENSE: u8 = 0x00;
+pub const SENSE_NOT_READY: u8 = 0x02;
+pub const SENSE_MEDIUM_ERROR: u8 = 0x03;
+pub const SENSE_HARDWARE_ERROR: u8 = 0x04;
+pub const SENSE_UNIT_ATTENTION: u8 = 0x06;
+pub const SENSE_ABORTED_COMMAND: u8 = 0x0B;
 pub const ASC_NO_MEDIUM: u8 = 0x3A;
+
+/// A command that ended in Check Condition, carried as the inner error of an
+/// io::Error so callers can tell device-reported failures from transport ones.
+#[derive(Debug, Clone, Copy)]
+pub struct SenseError {
+    pub sense_key: u8,
+    pub asc: u8,
+    pub ascq: u8,
+}
+
+impl SenseError {
+    pub fn into_io(self) -> io::Error {
+        io::Error::new(io::ErrorKind::Other, self)
+    }
+}
+
+impl std::fmt::Display for SenseError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(
+            f,
+            "SCSI Check Condition: sense_key={} asc=0x{:02x} ascq=0x{:02x}",
+            self.sense_key, self.asc, self.ascq
+        )
+    }
+}
+
+impl std::error::Error for SenseError {}
+
+/// Sense data of an error returned for a Check Condition.
+pub fn sense_error(e: &io::Error) -> Option<SenseError> {
+    e.get_ref()?.downcast_ref::<SenseError>().copied()
+}
@@ -0,0 +1,434 @@
+//! USB Attached SCSI (UAS) over the four UAS pipes.
+//! Android exposes no USB 3 bulk streams, so this is the high-speed (stream-less)
+//! protocol: Command IUs go out on the command pipe, and the device announces
+//! each data phase with a READ READY IU on the status pipe, tagged with the
+//! command it belongs to. That lets several tagged READs be outstanding at once.
+
+use crate::block_device::{TransferHandler, UasPipe};
+use crate::io_stats::IoStats;
+use crate::scsi;
+use std::collections::VecDeque;
+use std::io;
+use std::time::Instant;
+
+pub const IU_COMMAND: u8 = 0x01;
+pub const IU_SENSE: u8 = 0x03;
+pub const IU_RESPONSE: u8 = 0x04;
+pub const IU_TASK_MANAGEMENT: u8 = 0x05;
+pub const IU_READ_READY: u8 = 0x06;
+pub const IU_WRITE_READY: u8 = 0x07;
+
+pub const COMMAND_IU_SIZE: usize = 32;
+pub const TASK_MGMT_IU_SIZE: usize = 16;
+/// Sense IU header (16) plus fixed-format sense data, rounded up.
+pub const STATUS_IU_SIZE: usize = 64;
+/// Outstanding commands per batch. Tag 1 is left for task management.
+pub const QUEUE_DEPTH: usize = 4;
+const FIRST_TAG: u16 = 2;
+const TASK_MGMT_TAG: u16 = 1;
+const TMF_ABORT_TASK: u8 = 0x01;
+/// Status IUs read per abort before giving up on the device.
+const MAX_ABORT_IUS: usize = 4 * QUEUE_DEPTH;
+
+// SAM status codes in the Sense IU
+const STATUS_GOOD: u8 = 0x00;
+const STATUS_CHECK_CONDITION: u8 = 0x02;
+const STATUS_BUSY: u8 = 0x08;
+const STATUS_TASK_SET_FULL: u8 = 0x28;
+
+/// Build Command IU: 16-byte CDB field, SIMPLE task attribute, LUN 0.
+pub fn build_command_iu(tag: u16, cdb: &[u8]) -> [u8; COMMAND_IU_SIZE] {
+    let mut iu = [0u8; COMMAND_IU_SIZE];
+    iu[0] = IU_COMMAND;
+    iu[2..4].copy_from_slice(&tag.to_be_bytes());
+    let n = cdb.len().min(16);
+    iu[16..16 + n].copy_from_slice(&cdb[..n]);
+    iu
+}
+
+pub enum StatusIu {
+    ReadReady(u16),
+    WriteReady(u16),
+    /// tag, SAM status, (sense_key, asc, ascq)
+    Sense(u16, u8, (u8, u8, u8)),
+    /// tag, response code
+    Response(u16, u8),
+}
+
+pub fn parse_status_iu(buf: &[u8]) -> io::Result<StatusIu> {
+    if buf.len() < 4 {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, "Status IU too short"));
+    }
+    let tag = u16::from_be_bytes([buf[2], buf[3]]);
+    match buf[0] {
+        IU_READ_READY => Ok(StatusIu::ReadReady(tag)),
+        IU_WRITE_READY => Ok(StatusIu::WriteReady(tag)),
+        IU_SENSE if buf.len() >= 16 => {
+            let sense_len = u16::from_be_bytes([buf[14], buf[15]]) as usize;
+            let sense = &buf[16..(16 + sense_len).min(buf.len())];
+            Ok(StatusIu::Sense(tag, buf[6], scsi::parse_sense(sense)))
+        }
+        IU_RESPONSE if buf.len() >= 8 => Ok(StatusIu::Response(tag, buf[7])),
+        id => Err(io::Error::new(
+            io::ErrorKind::InvalidData,
+            format!("Unexpected UAS IU 0x{:02x}", id),
+        )),
+    }
+}
+
+/// One data-in command of a queued batch.
+pub struct UasCommand<'a> {
+    pub cdb: [u8; 16],
+    pub cdb_len: usize,
+    pub data: &'a mut [u8],
+    pub transferred: usize,
+}
+
+/// Batch entries in flight, by tag slot.
+type Slots = [Option<usize>; QUEUE_DEPTH];
+
+/// Run the commands with up to QUEUE_DEPTH in flight. Returns total bytes
+/// transferred; fails on the first command that doesn't complete GOOD.
+/// Each command's latency runs from its Command IU to its Sense IU.
+/// On failure the other commands still in flight are aborted first, so the
+/// next batch can reuse their tags.
+pub fn execute_queued(
+    transfer: &dyn TransferHandler,
+    session_id: u64,
+    cmds: &mut [UasCommand<'_>],
+    stats: &IoStats,
+) -> io::Result<usize> {
+    let mut slots: Slots = [None; QUEUE_DEPTH];
+    let result = run_queue(transfer, session_id, cmds, stats, &mut slots);
+    if result.is_err() && slots.iter().any(|s| s.is_some()) {
+        abort_in_flight(transfer, session_id, cmds, &mut slots);
+    }
+    result
+}
+
+fn run_queue(
+    transfer: &dyn TransferHandler,
+    session_id: u64,
+    cmds: &mut [UasCommand<'_>],
+    stats: &IoStats,
+    slots: &mut Slots,
+) -> io::Result<usize> {
+    let mut pending: VecDeque<usize> = (0..cmds.len()).collect();
+    let mut submitted = [Instant::now(); QUEUE_DEPTH];
+    let mut depth = QUEUE_DEPTH;
+    let mut status = [0u8; STATUS_IU_SIZE];
+    let mut total = 0usize;
+
+    loop {
+        let in_flight = slots.iter().filter(|s| s.is_some()).count();
+        let mut room = depth.saturating_sub(in_flight);
+        for (slot, entry) in slots.iter_mut().enumerate() {
+            if room == 0 {
+                break;
+            }
+            if entry.is_some() {
+                continue;
+            }
+            let Some(idx) = pending.pop_front() else { break };
+            let cmd = &mut cmds[idx];
+            cmd.transferred = 0;
+            let iu = build_command_iu(FIRST_TAG + slot as u16, &cmd.cdb[..cmd.cdb_len]);
+            let n = transfer.pipe_out(session_id, UasPipe::Command, &iu)?;
+            if n != iu.len() {
+                return Err(io::Error::new(
+                    io::ErrorKind::Other,
+                    format!("Command IU transfer failed: {} != {}", n, iu.len()),
+                ));
+            }
+            *entry = Some(idx);
+            submitted[slot] = Instant::now();
+            room -= 1;
+        }
+        if slots.iter().all(|s| s.is_none()) {
+            return Ok(total);
+        }
+
+        let n = transfer.pipe_in(session_id, UasPipe::Status, &mut status)?;
+        let iu = parse_status_iu(&status[..n])?;
+        let Some((slot, idx)) = slot_of(slots, iu_tag(&iu)) else {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidData,
+                format!("UAS IU for unknown tag {}", iu_tag(&iu)),
+            ));
+        };
+
+        match iu {
+            StatusIu::ReadReady(_) => read_data(transfer, session_id, &mut cmds[idx])?,
+            StatusIu::WriteReady(_) => {
+                return Err(io::Error::new(
+                    io::ErrorKind::InvalidData,
+                    "UAS WRITE READY for a data-in command",
+                ));
+            }
+            StatusIu::Sense(_, sam_status, (sense_key, asc, ascq)) => {
+                slots[slot] = None;
+                if !matches!(sam_status, STATUS_BUSY | STATUS_TASK_SET_FULL) {
+                    let done = (sam_status == STATUS_GOOD).then_some(cmds[idx].transferred);
+                    stats.record(cmds[idx].cdb[0], submitted[slot].elapsed(), COMMAND_IU_SIZE, done);
+                }
+                match sam_status {
+                    STATUS_GOOD => total += cmds[idx].transferred,
+                    STATUS_BUSY | STATUS_TASK_SET_FULL => {
+                        // Device queue is smaller than ours: shrink to what it
+                        // still holds and resubmit.
+                        stats.record_retry();
+                        depth = slots.iter().filter(|s| s.is_some()).count().max(1);
+                        pending.push_front(idx);
+                    }
+                    STATUS_CHECK_CONDITION => {
+                        stats.record_sense(sense_key, asc, ascq);
+                        return Err(scsi::SenseError { sense_key, asc, ascq }.into_io());
+                    }
+                    s => {
+                        return Err(io::Error::new(
+                            io::ErrorKind::Other,
+                            format!("SCSI command failed with status {}", s),
+                        ));
+                    }
+                }
+            }
+            StatusIu::Response(_, code) => {
+                return Err(io::Error::new(
+                    io::ErrorKind::Other,
+                    format!("UAS response code 0x{:02x}", code),
+                ));
+            }
+        }
+    }
+}
+
+fn iu_tag(iu: &StatusIu) -> u16 {
+    match *iu {
+        StatusIu::ReadReady(t) | StatusIu::WriteReady(t) | StatusIu::Sense(t, _, _) | StatusIu::Response(t, _) => t,
+    }
+}
+
+/// Slot and batch entry of an in-flight tag.
+fn slot_of(slots: &Slots, tag: u16) -> Option<(usize, usize)> {
+    let slot = tag.checked_sub(FIRST_TAG).map(|s| s as usize).filter(|&s| s < QUEUE_DEPTH)?;
+    slots[slot].map(|idx| (slot, idx))
+}
+
+/// Data for a tag follows its READ READY on the data-in pipe; a short packet ends it.
+fn read_data(transfer: &dyn TransferHandler, session_id: u64, cmd: &mut UasCommand<'_>) -> io::Result<()> {
+    let max = transfer.max_transfer_size().max(1);
+    while cmd.transferred < cmd.data.len() {
+        let end = (cmd.transferred + max).min(cmd.data.len());
+        let want = end - cmd.transferred;
+        let got = transfer.pipe_in(session_id, UasPipe::DataIn, &mut cmd.data[cmd.transferred..end])?;
+        cmd.transferred += got;
+        if got < want {
+            break;
+        }
+    }
+    Ok(())
+}
+
+/// Build a Task Management IU for `function` on task `managed`, LUN 0.
+pub fn build_task_management_iu(tag: u16, function: u8, managed: u16) -> [u8; TASK_MGMT_IU_SIZE] {
+    let mut iu = [0u8; TASK_MGMT_IU_SIZE];
+    iu[0] = IU_TASK_MANAGEMENT;
+    iu[2..4].copy_from_slice(&tag.to_be_bytes());
+    iu[4] = function;
+    iu[6..8].copy_from_slice(&managed.to_be_bytes());
+    iu
+}
+
+/// Sends ABORT TASK for each command still in flight and consumes the IUs
+/// until the device has answered every abort. Commands that complete in the
+/// meantime have their data drained into their buffers. Best effort: the
+/// batch's own error is what the caller reports.
+fn abort_in_flight(transfer: &dyn TransferHandler, session_id: u64, cmds: &mut [UasCommand<'_>], slots: &mut Slots) {
+    let mut status = [0u8; STATUS_IU_SIZE];
+    for slot in 0..QUEUE_DEPTH {
+        if slots[slot].is_none() {
+            continue;
+        }
+        let iu = build_task_management_iu(TASK_MGMT_TAG, TMF_ABORT_TASK, FIRST_TAG + slot as u16);
+        if !matches!(transfer.pipe_out(session_id, UasPipe::Command, &iu), Ok(n) if n == iu.len()) {
+            return;
+        }
+        let mut answered = false;
+        for _ in 0..MAX_ABORT_IUS {
+            let Ok(n) = transfer.pipe_in(session_id, UasPipe::Status, &mut status) else { return };
+            let Ok(iu) = parse_status_iu(&status[..n]) else { return };
+            match iu {
+                StatusIu::Response(TASK_MGMT_TAG, _) => {
+                    answered = true;
+                    break;
+                }
+                StatusIu::ReadReady(t) => {
+                    if let Some((_, idx)) = slot_of(slots, t) {
+                        if read_data(transfer, session_id, &mut cmds[idx]).is_err() {
+                            return;
+                        }
+                    }
+                }
+                StatusIu::Sense(t, _, _) => {
+                    if let Some((s, _)) = slot_of(slots, t) {
+                        slots[s] = None;
+                    }
+                }
+                _ => {}
+            }
+        }
+        if !answered {
+            return;
+        }
+        // Aborted, or it had completed before the abort arrived.
+        slots[slot] = None;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::Mutex;
+
+    const BLOCK: usize = 512;
+
+    /// Device that completes every command at once, except `fail_tag`, which
+    /// gets a Check Condition while the others stay queued until aborted.
+    #[derive(Default)]
+    struct Device {
+        fail_tag: Option<u16>,
+        held: Vec<u16>,
+        aborted: Vec<u16>,
+        status: VecDeque<Vec<u8>>,
+        data: VecDeque<Vec<u8>>,
+    }
+
+    struct FakeUas(Mutex<Device>);
+
+    fn sense_iu(tag: u16, sam_status: u8, key: u8) -> Vec<u8> {
+        let mut iu = vec![0u8; 16 + 18];
+        iu[0] = IU_SENSE;
+        iu[2..4].copy_from_slice(&tag.to_be_bytes());
+        iu[6] = sam_status;
+        iu[14..16].copy_from_slice(&18u16.to_be_bytes());
+        iu[16] = 0x70;
+        iu[18] = key;
+        iu[16 + 12] = 0x11;
+        iu
+    }
+
+    fn tagged_iu(id: u8, tag: u16) -> Vec<u8> {
+        let mut iu = vec![0u8; 8];
+        iu[0] = id;
+        iu[2..4].copy_from_slice(&tag.to_be_bytes());
+        iu
+    }
+
+    impl TransferHandler for FakeUas {
+        fn bulk_out(&self, _: u64, _: &[u8]) -> io::Result<usize> {
+            unreachable!("UAS commands use the UAS pipes")
+        }
+        fn bulk_in(&self, _: u64, _: &mut [u8]) -> io::Result<usize> {
+            unreachable!("UAS commands use the UAS pipes")
+        }
+        fn is_uas(&self) -> bool {
+            true
+        }
+        fn pipe_out(&self, _: u64, pipe: UasPipe, data: &[u8]) -> io::Result<usize> {
+            assert_eq!(pipe, UasPipe::Command);
+            let mut d = self.0.lock().unwrap();
+            let tag = u16::from_be_bytes([data[2], data[3]]);
+            match data[0] {
+                IU_COMMAND if d.fail_tag == Some(tag) => {
+                    d.status.push_back(sense_iu(tag, STATUS_CHECK_CONDITION, 0x03));
+                }
+                IU_COMMAND if d.fail_tag.is_some() => d.held.push(tag),
+                IU_COMMAND => {
+                    d.status.push_back(tagged_iu(IU_READ_READY, tag));
+                    d.data.push_back(vec![tag as u8; BLOCK]);
+                    d.status.push_back(sense_iu(tag, STATUS_GOOD, 0));
+                }
+                IU_TASK_MANAGEMENT => {
+                    assert_eq!(data.len(), TASK_MGMT_IU_SIZE);
+                    assert_eq!((tag, data[4]), (TASK_MGMT_TAG, TMF_ABORT_TASK));
+                    let managed = u16::from_be_bytes([data[6], data[7]]);
+                    d.held.retain(|&t| t != managed);
+                    d.aborted.push(managed);
+                    d.status.push_back(tagged_iu(IU_RESPONSE, TASK_MGMT_TAG));
+                }
+                id => panic!("unexpected IU 0x{:02x}", id),
+            }
+            Ok(data.len())
+        }
+        fn pipe_in(&self, _: u64, pipe: UasPipe, buf: &mut [u8]) -> io::Result<usize> {
+            let mut d = self.0.lock().unwrap();
+            let next = match pipe {
+                UasPipe::Status => d.status.pop_front(),
+                UasPipe::DataIn => d.data.pop_front(),
+                p => panic!("read on {:?}", p),
+            };
+            let Some(next) = next else {
+                return Err(io::Error::new(io::ErrorKind::TimedOut, "no IU pending"));
+            };
+            buf[..next.len()].copy_from_slice(&next);
+            Ok(next.len())
+        }
+    }
+
+    fn read_cdb(lba: u32) -> [u8; 16] {
+        let mut cdb = [0u8; 16];
+        cdb[..10].copy_from_slice(&scsi::build_read_10_cdb(lba, 1));
+        cdb
+    }
+
+    fn run(dev: &FakeUas, bufs: &mut [Vec<u8>]) -> io::Result<usize> {
+        let mut cmds: Vec<UasCommand> = bufs
+            .iter_mut()
+            .enumerate()
+            .map(|(i, b)| UasCommand { cdb: read_cdb(i as u32), cdb_len: 10, data: b, transferred: 0 })
+            .collect();
+        execute_queued(dev, 1, &mut cmds, &IoStats::new())
+    }
+
+    #[test]
+    fn parses_status_ius() {
+        assert!(matches!(parse_status_iu(&tagged_iu(IU_READ_READY, 7)).unwrap(), StatusIu::ReadReady(7)));
+        assert!(matches!(
+            parse_status_iu(&sense_iu(3, STATUS_CHECK_CONDITION, 0x03)).unwrap(),
+            StatusIu::Sense(3, STATUS_CHECK_CONDITION, (0x03, 0x11, 0))
+        ));
+        let mut response = tagged_iu(IU_RESPONSE, 1);
+        response[7] = 0x05;
+        assert!(matches!(parse_status_iu(&response).unwrap(), StatusIu::Response(1, 0x05)));
+        assert!(parse_status_iu(&[IU_SENSE, 0, 0]).is_err());
+        assert!(parse_status_iu(&tagged_iu(IU_COMMAND, 2)).is_err());
+    }
+
+    #[test]
+    fn completes_a_batch_deeper_than_the_queue() {
+        let dev = FakeUas(Mutex::new(Device::default()));
+        let mut bufs = vec![vec![0u8; BLOCK]; QUEUE_DEPTH + 2];
+        assert_eq!(run(&dev, &mut bufs).unwrap(), bufs.len() * BLOCK);
+        // Tags are reused once their command completes.
+        assert_eq!(bufs[0][0], FIRST_TAG as u8);
+        assert_eq!(bufs[QUEUE_DEPTH][0], FIRST_TAG as u8);
+    }
+
+    #[test]
+    fn check_condition_aborts_the_other_tags() {
+        let dev = FakeUas(Mutex::new(Device { fail_tag: Some(FIRST_TAG + 1), ..Device::default() }));
+        let mut bufs = vec![vec![0u8; BLOCK]; QUEUE_DEPTH];
+        let err = run(&dev, &mut bufs).unwrap_err();
+        assert_eq!(scsi::sense_error(&err).map(|s| s.sense_key), Some(0x03));
+        {
+            let d = dev.0.lock().unwrap();
+            assert!(d.held.is_empty());
+            assert_eq!(d.aborted, [FIRST_TAG, FIRST_TAG + 2, FIRST_TAG + 3]);
+            assert!(d.status.is_empty());
+        }
+
+        // Nothing left on the device: the next batch gets every tag back.
+        dev.0.lock().unwrap().fail_tag = None;
+        assert_eq!(run(&dev, &mut bufs).unwrap(), QUEUE_DEPTH * BLOCK);
+    }
+}
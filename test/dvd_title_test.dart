@@ -0,0 +1,88 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:connectias/src/features/dvd/data/dvd_title.dart';
+
+/// Chapter of [_export]: pgcn identifies it in the checks.
+typedef _Chapter = ({int pgcn, int startMs, int durationMs, int startSector});
+
+/// Packs titles the way dvd_disc_export (rust/c/dvd_helper.c) does: title
+/// records in title order, then each title's chapter records in title order,
+/// with first_chapter counting the records written before it.
+Uint8List _export(List<({int titleSet, List<_Chapter> chapters})> titles) {
+  final chapterCount = titles.fold<int>(0, (n, t) => n + t.chapters.length);
+  final bytes = Uint8List(16 + titles.length * 20 + chapterCount * 24);
+  final data = ByteData.sublistView(bytes);
+  data.setUint32(0, 0x4D445644, Endian.little);
+  data.setUint16(4, 2, Endian.little);
+  data.setUint16(6, titles.length, Endian.little);
+  data.setUint32(8, chapterCount, Endian.little);
+  data.setUint16(12, 20, Endian.little);
+  data.setUint16(14, 24, Endian.little);
+  var firstRecord = 0;
+  for (var i = 0; i < titles.length; i++) {
+    final t = titles[i];
+    final off = 16 + i * 20;
+    data.setUint16(off, i + 1, Endian.little);
+    data.setUint8(off + 2, t.titleSet);
+    data.setUint8(off + 3, 1);
+    data.setUint8(off + 4, 1);
+    data.setUint16(off + 6, t.chapters.length, Endian.little);
+    data.setUint16(off + 8, t.chapters.length, Endian.little);
+    data.setUint32(off + 12, firstRecord, Endian.little);
+    data.setUint32(
+      off + 16,
+      t.chapters.fold<int>(0, (ms, c) => ms + c.durationMs),
+      Endian.little,
+    );
+    firstRecord += t.chapters.length;
+  }
+  var co = 16 + titles.length * 20;
+  for (final t in titles) {
+    for (var c = 0; c < t.chapters.length; c++) {
+      final ch = t.chapters[c];
+      data.setUint16(co, c + 1, Endian.little);
+      data.setUint16(co + 2, ch.pgcn, Endian.little);
+      data.setUint16(co + 4, 1, Endian.little);
+      data.setUint32(co + 8, ch.startMs, Endian.little);
+      data.setUint32(co + 12, ch.durationMs, Endian.little);
+      data.setUint32(co + 16, ch.startSector, Endian.little);
+      data.setUint32(co + 20, ch.startSector + 99, Endian.little);
+      co += 24;
+    }
+  }
+  return bytes;
+}
+
+_Chapter _chapter(int pgcn, int startMs) =>
+    (pgcn: pgcn, startMs: startMs, durationMs: 1000, startSector: pgcn * 100);
+
+void main() {
+  test('each title gets its own chapters when title sets load out of order', () {
+    // Title 1 lives in VTS 2, title 2 in VTS 1: the chapter pool is filled
+    // VTS 1 first, the export is in title order.
+    final bytes = _export([
+      (titleSet: 2, chapters: [_chapter(21, 0), _chapter(22, 1000), _chapter(23, 2000)]),
+      (titleSet: 1, chapters: [_chapter(11, 0), _chapter(12, 1000)]),
+      (titleSet: 3, chapters: const []),
+    ]);
+    final titles = DvdTitle.fromMetadata(bytes);
+    expect(titles.map((t) => t.titleNumber), [1, 2, 3]);
+    expect(titles[0].titleSetNr, 2);
+    expect(titles[0].chapters.map((c) => c.pgcn), [21, 22, 23]);
+    expect(titles[0].chapters.map((c) => c.chapterNumber), [1, 2, 3]);
+    expect(titles[0].durationMs, 3000);
+    expect(titles[1].chapters.map((c) => c.pgcn), [11, 12]);
+    expect(titles[1].chapters[1].startMs, 1000);
+    expect(titles[1].chapters[1].startSector, 1200);
+    expect(titles[2].chapters, isEmpty);
+  });
+
+  test('rejects metadata shorter than its chapter count', () {
+    final bytes = _export([
+      (titleSet: 1, chapters: [_chapter(11, 0)]),
+    ]);
+    expect(DvdTitle.fromMetadata(Uint8List.sublistView(bytes, 0, bytes.length - 1)), isEmpty);
+  });
+}
@@ -12,5 +12,7 @@
 #define HAVE_UNISTD_H 1
 /* Android: no DVD ioctls (we use stream callbacks only); device.c/ioctl.c will have empty stubs */
 #define UNUSED __attribute__((unused))
+/* No HAVE_PWD_H: there is no home directory to derive a key cache from. The app
+ * sets DVDCSS_CACHE once at load (rust/src/dvd/css_cache.rs). */
 
 #endif